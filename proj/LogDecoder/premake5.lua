@@ -0,0 +1,27 @@
+project "LogDecoder"
+	kind "ConsoleApp"
+	staticruntime "off"
+	language "C++"
+	cppdialect "C++17"
+	location ""
+	targetdir "../../build/%{cfg.buildcfg}"
+	objdir "obj/%{cfg.buildcfg}"
+	files { 
+		"../../tools/LogDecoder/**.cpp",
+		"../../src/Logger/BinaryLogFormat.hpp",
+		"../../src/Logger/BinaryLogFormat.cpp"
+	}
+
+	flags {
+		"MultiProcessorCompile"
+	}
+
+	filter "configurations:Debug"
+		defines { "DEBUG" }
+		symbols "On"
+
+	filter "configurations:Release"
+		defines { "RELEASE" }
+		optimize "On"
+
+	filter {}
@@ -30,6 +30,9 @@ project "RayMarcher"
 		"EverViewport"
 	}
 	
+	filter "system:linux"
+		links { "pthread" }
+
 	filter "configurations:Debug"
 		defines { "DEBUG" }
 		symbols "On"
@@ -38,4 +41,7 @@ project "RayMarcher"
 		defines { "RELEASE" }
 		optimize "On"
 
+	filter "options:track-allocations"
+		defines { "TRACK_ALLOCATIONS" }
+
 	filter {}
@@ -0,0 +1,61 @@
+project "Tests"
+	kind "ConsoleApp"
+	staticruntime "off"
+	language "C++"
+	cppdialect "C++17"
+	location ""
+	targetdir "../../build/%{cfg.buildcfg}"
+	objdir "obj/%{cfg.buildcfg}"
+	-- Only the modules which build without a window or a GPU, no HawkEye or EverViewport.
+	files { 
+		"../../tests/**.hpp",
+		"../../tests/**.cpp",
+		"../../src/Camera/**.hpp",
+		"../../src/Camera/**.cpp",
+		"../../src/Config/**.hpp",
+		"../../src/Config/**.cpp",
+		"../../src/CpuRenderer/**.hpp",
+		"../../src/CpuRenderer/**.cpp",
+		"../../src/Filesystem/**.hpp",
+		"../../src/Filesystem/**.cpp",
+		"../../src/Logger/**.hpp",
+		"../../src/Logger/**.cpp",
+		"../../src/Memory/**.hpp",
+		"../../src/Memory/**.cpp",
+		"../../src/Scene/**.hpp",
+		"../../src/Scene/**.cpp",
+		"../../src/ShaderCache/**.hpp",
+		"../../src/ShaderCache/**.cpp",
+		"../../src/Sweep/**.hpp",
+		"../../src/Sweep/**.cpp",
+		"../../src/Uniforms/**.hpp"
+	}
+
+	flags {
+		"MultiProcessorCompile"
+	}
+
+	includedirs {
+		SoftwareCoreInclude,
+		"../../ext/Eigen",
+	}
+
+	links {
+		"SoftwareCore"
+	}
+
+	-- cpu-renderer/main-loop-allocations counts the allocations of a frame.
+	defines { "TRACK_ALLOCATIONS" }
+	
+	filter "system:linux"
+		links { "pthread" }
+
+	filter "configurations:Debug"
+		defines { "DEBUG" }
+		symbols "On"
+
+	filter "configurations:Release"
+		defines { "RELEASE" }
+		optimize "On"
+
+	filter {}
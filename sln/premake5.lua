@@ -9,6 +9,13 @@ workspace "RayMarcher"
 		"MultiProcessorCompile"
 	}
 	
+newoption {
+	trigger = "track-allocations",
+	description = "Count heap allocations for the main-loop benchmark (replaces the global operator new)"
+}
+
 include "../dependencies.lua"
 	
-include "../proj/RayMarcher"
\ No newline at end of file
+include "../proj/RayMarcher"
+include "../proj/LogDecoder"
+include "../proj/Tests"
\ No newline at end of file
@@ -0,0 +1,2150 @@
+#include "Benchmark.hpp"
+#include "../Config/ConfigBlob.hpp"
+#include "../Config/PipelineConfig.hpp"
+#include "../CpuRenderer/AmbientOcclusion.hpp"
+#include "../CpuRenderer/Arena.hpp"
+#include "../CpuRenderer/CpuRenderer.hpp"
+#include "../CpuRenderer/Upscale.hpp"
+#include "../Filesystem/Filesystem.hpp"
+#include "../HotReload/PipelineReloader.hpp"
+#include "../Input/Input.hpp"
+#include "../Logger/AsyncLogSink.hpp"
+#include "../Logger/BinaryLog.hpp"
+#include "../Memory/AllocationTracker.hpp"
+#include "../Scene/SceneParameters.hpp"
+#include "../ShaderCache/ShaderPrecompiler.hpp"
+#include "../ShaderCache/ShaderPreprocessor.hpp"
+#include "../ShaderCache/ShaderVariantCache.hpp"
+#include "../Sweep/ParameterSweep.hpp"
+#include "../Uniforms/ParameterBlock.hpp"
+#include "../Uniforms/UniformRing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Measures the wall time of the callable in milliseconds.
+	double MeasureMs(const std::function<void()>& callable)
+	{
+		const auto before = std::chrono::high_resolution_clock::now();
+		callable();
+		const auto after = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(after - before).count();
+	}
+
+	// Cameras on a circle around the mandelbulb, the typical set of preview viewpoints.
+	std::vector<Camera> OrbitCameras(const int count, const float aspect)
+	{
+		std::vector<Camera> cameras;
+		cameras.reserve(count);
+		for (int i = 0; i < count; ++i)
+		{
+			const float angle = 2.f * float(EIGEN_PI) * i / count;
+			const Eigen::Vector3f target(0.f, 0.f, 25.f);
+			const Eigen::Vector3f position = target + 60.f * Eigen::Vector3f(std::sin(angle), -.2f, -std::cos(angle));
+			cameras.emplace_back(position, target, Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, aspect, .01f, 10000.f);
+		}
+		return cameras;
+	}
+
+	bool BatchRenderBenchmark()
+	{
+		const int viewCount = 32;
+		const int width = 48;
+		const int height = 32;
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		const std::vector<Camera> cameras = OrbitCameras(viewCount, width / float(height));
+
+		std::vector<uint8_t> pixels(size_t(width) * height * CpuRenderer::CHANNELS);
+		const double sequentialMs = MeasureMs([&]()
+		{
+			for (Camera camera : cameras)
+			{
+				camera.UpdateRayBasis();
+				renderer.Render(camera.GetRayBasis(), width, height, pixels.data());
+			}
+		});
+
+		std::vector<uint8_t> images;
+		const double batchMs = MeasureMs([&]() { images = renderer.RenderBatch(cameras, width, height); });
+
+		std::printf("batch-render: %d views of %dx%d on %u threads\n", viewCount, width, height, threadPool.GetThreadCount());
+		std::printf("  sequential Render():  %8.1f ms  %8.1f views/s\n", sequentialMs, viewCount * 1000. / sequentialMs);
+		std::printf("  RenderBatch():        %8.1f ms  %8.1f views/s\n", batchMs, viewCount * 1000. / batchMs);
+		return true;
+	}
+
+	bool StereoBenchmark()
+	{
+		const int width = 64;
+		const int height = 48;
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+
+		std::printf("stereo: %dx%d per eye\n", width, height);
+		for (const float eyeDistance : { .02f, .1f, .5f })
+		{
+			Camera left(Eigen::Vector3f(0.f, 0.f, -40.f), Eigen::Vector3f(0.f, 0.f, 0.f), Eigen::Vector3f(0.f, 1.f, 0.f),
+				60.f, width / float(height), .01f, 10000.f);
+			Camera right = left;
+			left.TranslateLocal(-.5f * eyeDistance, 0.f, 0.f);
+			right.TranslateLocal(.5f * eyeDistance, 0.f, 0.f);
+			left.UpdateRayBasis();
+			right.UpdateRayBasis();
+
+			std::vector<uint8_t> leftPixels(size_t(width) * height * CpuRenderer::CHANNELS);
+			std::vector<uint8_t> rightPixels(leftPixels.size());
+
+			renderer.ResetStatistics();
+			const double independentMs = MeasureMs([&]()
+			{
+				renderer.Render(left.GetRayBasis(), width, height, leftPixels.data());
+				renderer.Render(right.GetRayBasis(), width, height, rightPixels.data());
+			});
+			const uint64_t independentEvaluations = renderer.GetDistanceEvaluations();
+			const std::vector<uint8_t> reference = rightPixels;
+
+			renderer.ResetStatistics();
+			const double stereoMs = MeasureMs([&]()
+			{
+				renderer.RenderStereo(left.GetRayBasis(), right.GetRayBasis(), width, height, leftPixels.data(), rightPixels.data());
+			});
+			const uint64_t stereoEvaluations = renderer.GetDistanceEvaluations();
+
+			int maxDifference = 0;
+			for (size_t i = 0; i < reference.size(); ++i)
+			{
+				maxDifference = std::max(maxDifference, std::abs(int(reference[i]) - int(rightPixels[i])));
+			}
+
+			std::printf("  eye distance %.2f\n", eyeDistance);
+			std::printf("    independent: %8.1f ms  %10llu DE calls\n", independentMs, (unsigned long long)independentEvaluations);
+			std::printf("    shared:      %8.1f ms  %10llu DE calls (%.1f%% saved), max difference %d/255\n", stereoMs,
+				(unsigned long long)stereoEvaluations, 100. * (1. - double(stereoEvaluations) / double(independentEvaluations)), maxDifference);
+		}
+		return true;
+	}
+
+	const Eigen::Vector3d deepZoomOutside(.3, .4, -2.);
+	const Eigen::Vector3d deepZoomDirection = Eigen::Vector3d(-.3, -.4, 2.).normalized();
+
+	// Marches the mandelbulb in double-double precision until the estimate drops below the
+	// tolerance, giving a reference point on the surface as the distance estimator sees it.
+	SceneFunctions::Vector3<DoubleDouble> SurfacePoint(const int iterations, const double tolerance)
+	{
+		SceneFunctions::Vector3<DoubleDouble> point;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			point(axis) = DoubleDouble(deepZoomOutside(axis));
+		}
+
+		for (int step = 0; step < 100000; ++step)
+		{
+			SceneFunctions::Vector4<DoubleDouble> color;
+			const DoubleDouble dist = SceneFunctions::Mandelbulb(point, color, iterations);
+			if (dist < DoubleDouble(tolerance))
+			{
+				break;
+			}
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				point(axis) += dist * DoubleDouble(deepZoomDirection(axis));
+			}
+		}
+		return point;
+	}
+
+	bool DeepZoomBenchmark()
+	{
+		const int width = 32;
+		const int height = 24;
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+
+		const char* names[] = { "float", "double", "double-double", "full double-double" };
+		const DeepZoomPrecision precisions[] = { DeepZoomPrecision::Float, DeepZoomPrecision::Double, DeepZoomPrecision::DoubleDouble,
+			DeepZoomPrecision::DoubleDoubleFull };
+
+		std::printf("deep-zoom: %dx%d, cost per pixel and pixels off the full double-double image by more than 8/255\n", width, height);
+		std::printf("  %-8s %-10s %-15s %-28s %-28s %-28s %-28s\n", "zoom", "iterations", "automatic", names[0], names[1], names[2], names[3]);
+		for (const double zoom : { 1e-1, 1e-4, 1e-7, 1e-10, 1e-13, 1e-16, 1e-19 })
+		{
+			DeepZoomView view;
+			view.fractalIterations = SceneFunctions::FRACTAL_ITERATIONS + int(8. * -std::log10(zoom));
+			view.reference = SurfacePoint(view.fractalIterations, 1e-3 * zoom);
+			view.forward = deepZoomDirection;
+			view.up = Eigen::Vector3d(0., 1., 0.);
+			view.position = -3. * zoom * view.forward;
+			view.aspect = width / double(height);
+
+			std::vector<uint8_t> images[4];
+			double costs[4];
+			for (int i = 3; i >= 0; --i)
+			{
+				images[i].resize(size_t(width) * height * CpuRenderer::CHANNELS);
+				costs[i] = MeasureMs([&]() { renderer.RenderDeepZoom(view, width, height, images[i].data(), precisions[i]); });
+			}
+
+			std::printf("  %-8.0e %-10d %-15s", zoom, view.fractalIterations, names[int(CpuRenderer::SelectDeepZoomPrecision(view, height))]);
+			for (int i = 0; i < 4; ++i)
+			{
+				int wrongPixels = 0;
+				for (size_t pixel = 0; pixel < images[i].size(); pixel += CpuRenderer::CHANNELS)
+				{
+					wrongPixels += std::abs(int(images[i][pixel]) - int(images[3][pixel])) > 8;
+				}
+				std::printf(" %8.2f us/px %6.1f%% off   ", costs[i] * 1000. / (width * height), 100. * wrongPixels / (width * height));
+			}
+			std::printf("\n");
+		}
+		return true;
+	}
+
+	// Spins the camera in place with small yaw steps, moving it forward and back between the
+	// steps, and reports how far it drifts from the analytically rotated start.
+	template <class T>
+	void CameraDrift(const char* name, const Eigen::Vector3d& startPosition)
+	{
+		using Vector3 = typename CameraT<T>::Vector3;
+
+		const int rotations = 1000000;
+		const double turns = 10.25;
+		const T angle = T(2. * EIGEN_PI * turns / rotations);
+		const double totalAngle = double(angle) * rotations;
+
+		const Vector3 start = startPosition.template cast<T>();
+		CameraT<T> camera(start, start + Vector3(T(0), T(0), T(1)), Vector3(T(0), T(1), T(0)), T(60), T(1.5), T(.01), T(10000));
+
+		const double ms = MeasureMs([&]()
+		{
+			for (int i = 0; i < rotations; ++i)
+			{
+				camera.Rotate(Vector3(T(0), T(1), T(0)), angle);
+				camera.TranslateLocal(T(0), T(0), T(.5));
+				camera.TranslateLocal(T(0), T(0), T(-.5));
+			}
+		});
+
+		const Eigen::Vector3d forward = camera.GetForwardNormalized().template cast<double>();
+		const Eigen::Vector3d up = camera.GetUpNormalized().template cast<double>();
+		const Eigen::Vector3d expectedForward(std::sin(totalAngle), 0., std::cos(totalAngle));
+		const double directionError = std::acos(std::min(1., forward.dot(expectedForward)));
+		const double positionError = (camera.GetPosition() - start).template cast<double>().norm();
+
+		std::printf("  %-7s %8.1f ms  direction error %.3e rad  |up| - 1 %+.3e  up.forward %+.3e  position error %.3e\n",
+			name, ms, directionError, up.norm() - 1., up.dot(forward), positionError);
+	}
+
+	bool CameraDriftBenchmark()
+	{
+		std::printf("camera-drift: 1e6 incremental rotations (10.25 turns) with local translations\n");
+		for (const Eigen::Vector3d& start : { Eigen::Vector3d(0., 0., -40.), Eigen::Vector3d(10000., 20., -10000.) })
+		{
+			std::printf(" at (%g, %g, %g)\n", start.x(), start.y(), start.z());
+			CameraDrift<float>("float", start);
+			CameraDrift<double>("double", start);
+		}
+		return true;
+	}
+
+	// Logs from every thread and reports the throughput and the latency each call adds.
+	void MeasureLogging(const char* name, const int threadCount, const std::function<void(const char*)>& log)
+	{
+		const int messagesPerThread = 20000;
+		std::vector<std::vector<float>> latencies(threadCount, std::vector<float>(messagesPerThread));
+		std::vector<std::thread> threads;
+
+		const double ms = MeasureMs([&]()
+		{
+			for (int t = 0; t < threadCount; ++t)
+			{
+				threads.emplace_back([&, t]()
+				{
+					char message[96];
+					for (int i = 0; i < messagesPerThread; ++i)
+					{
+						std::snprintf(message, sizeof(message), "Tile %d of frame %d finished.\n", i, t);
+						const auto before = std::chrono::steady_clock::now();
+						log(message);
+						const auto after = std::chrono::steady_clock::now();
+						latencies[t][i] = std::chrono::duration<float, std::nano>(after - before).count();
+					}
+				});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		});
+
+		std::vector<float> all;
+		for (const std::vector<float>& threadLatencies : latencies)
+		{
+			all.insert(all.end(), threadLatencies.begin(), threadLatencies.end());
+		}
+		double sum = 0.;
+		for (const float latency : all)
+		{
+			sum += latency;
+		}
+		std::sort(all.begin(), all.end());
+		std::printf("    %-12s %10.0f calls/s  latency mean %7.0f ns  p99 %8.0f ns  max %9.0f ns\n", name,
+			all.size() * 1000. / ms, sum / all.size(), all[all.size() * 99 / 100], all.back());
+	}
+
+	bool AsyncLogBenchmark()
+	{
+		const std::string path = RMFS.GetAbsolutePath("benchmark-log.txt");
+		std::printf("async-log: 20000 messages per thread into %s\n", path.c_str());
+		for (const int threadCount : { 1, 2, 4, 8 })
+		{
+			std::printf("  %d thread(s)\n", threadCount);
+			{
+				// What PrintFile did before: formatting and the stream write on the calling thread.
+				std::ofstream output(path, std::ios_base::trunc);
+				std::mutex mutex;
+				MeasureLogging("synchronous", threadCount, [&](const char* message)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					output << "[Info] " << message;
+				});
+			}
+			for (const AsyncLogSink::FullPolicy policy : { AsyncLogSink::FullPolicy::Block, AsyncLogSink::FullPolicy::Drop })
+			{
+				std::ofstream output(path, std::ios_base::trunc);
+				AsyncLogSink sink({ { &output, Core::LoggerSeverity::Info } }, AsyncLogSink::DEFAULT_CAPACITY, policy);
+				const bool block = policy == AsyncLogSink::FullPolicy::Block;
+				MeasureLogging(block ? "async block" : "async drop", threadCount,
+					[&](const char* message) { sink.Push(message, Core::LoggerSeverity::Info); });
+				if (!block)
+				{
+					std::printf("%59s(%llu dropped)\n", "", (unsigned long long)sink.GetDroppedCount());
+				}
+			}
+		}
+		std::remove(path.c_str());
+		return true;
+	}
+
+	// Size of the file in bytes.
+	double FileBytes(const std::string& path)
+	{
+		std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+		return double(file.tellg());
+	}
+
+	bool BinaryLogBenchmark()
+	{
+		const uint32_t recordCount = 200000;
+		const char* format = "Tile %u of frame %u: %d steps, %.3f ms\n";
+		const std::string textPath = RMFS.GetAbsolutePath("benchmark-log.txt");
+		const std::string binaryPath = RMFS.GetAbsolutePath("benchmark-log.rmbl");
+
+		// Per-tile statistics as the CPU renderer would report them.
+		const auto steps = [](uint32_t i) { return int(i * 7919u % 256u); };
+		const auto tileMs = [](uint32_t i) { return .05 + (i % 97) * .001; };
+
+		std::printf("binary-log: %u per-tile records \"%s\"\n", recordCount, "Tile %u of frame %u: %d steps, %.3f ms");
+
+		double textMs;
+		{
+			std::ofstream output(textPath, std::ios_base::trunc);
+			textMs = MeasureMs([&]()
+			{
+				char message[128];
+				for (uint32_t i = 0; i < recordCount; ++i)
+				{
+					std::snprintf(message, sizeof(message), format, i % 1024, i / 1024, steps(i), tileMs(i));
+					output << "[Info] " << message;
+				}
+			});
+		}
+		const double textBytes = FileBytes(textPath);
+
+		double asyncMs;
+		{
+			std::ofstream output(textPath, std::ios_base::trunc);
+			AsyncLogSink sink({ { &output, Core::LoggerSeverity::Info } });
+			asyncMs = MeasureMs([&]()
+			{
+				char message[128];
+				for (uint32_t i = 0; i < recordCount; ++i)
+				{
+					std::snprintf(message, sizeof(message), format, i % 1024, i / 1024, steps(i), tileMs(i));
+					sink.Push(message, Core::LoggerSeverity::Info);
+				}
+			});
+		}
+		const double asyncBytes = FileBytes(textPath);
+
+		double binaryMs;
+		{
+			BinaryLog log(binaryPath);
+			const uint32_t formatId = log.RegisterFormat(format);
+			binaryMs = MeasureMs([&]()
+			{
+				for (uint32_t i = 0; i < recordCount; ++i)
+				{
+					log.Record(formatId, i % 1024, i / 1024, steps(i), tileMs(i));
+				}
+			});
+		}
+		const double binaryBytes = FileBytes(binaryPath);
+
+		std::printf("  text (caller formats and writes): %7.1f ns/record  %6.1f bytes/record\n", textMs * 1e6 / recordCount, textBytes / recordCount);
+		std::printf("  text through AsyncLogSink:        %7.1f ns/record  %6.1f bytes/record\n", asyncMs * 1e6 / recordCount, asyncBytes / recordCount);
+		std::printf("  binary:                           %7.1f ns/record  %6.1f bytes/record\n", binaryMs * 1e6 / recordCount, binaryBytes / recordCount);
+
+		std::remove(textPath.c_str());
+		std::remove(binaryPath.c_str());
+		return true;
+	}
+
+	const char* const sceneShaders[] = { "mandelbulb", "recursive-tetrahedron", "sphere", "spheres" };
+
+	// Compiles every scene shader in every preset twice into an empty cache: the first pass
+	// has to miss, the second has to hit.
+	bool ShaderCacheBenchmark()
+	{
+		ConfigBlob frontendConfig;
+		std::vector<ShaderPreset> presets;
+		std::string defaultPreset;
+		std::string error;
+		if (!LoadFrontendConfig(RMFS.GetAbsolutePath("../../src/FrontendConfig.yaml"), frontendConfig, error) ||
+			!LoadShaderPresets(frontendConfig.GetRoot(), presets, defaultPreset, error))
+		{
+			std::printf("shader-cache: %s\n", error.c_str());
+			return false;
+		}
+
+		const std::string directory = RMFS.GetAbsolutePath("shader-cache-benchmark");
+		std::filesystem::remove_all(directory);
+		ShaderVariantCache cache(directory);
+
+		std::printf("shader-cache: %zu shaders x %zu presets\n", sizeof(sceneShaders) / sizeof(sceneShaders[0]), presets.size());
+		for (const char* pass : { "cold", "warm" })
+		{
+			uint32_t compiled = 0;
+			uint32_t failed = 0;
+			std::string firstLog;
+			const uint32_t hitsBefore = cache.GetHitCount();
+			const uint32_t missesBefore = cache.GetMissCount();
+			const double ms = MeasureMs([&]()
+			{
+				for (const ShaderPreset& preset : presets)
+				{
+					for (const char* shader : sceneShaders)
+					{
+						ShaderVariantCache::Variant variant;
+						const std::string path = RMFS.GetAbsolutePath(std::string("../../src/Shaders/") + shader + ".comp.glsl");
+						if (cache.GetVariant(path, preset.constants, variant) && variant.compiled)
+						{
+							++compiled;
+						}
+						else
+						{
+							++failed;
+							firstLog = firstLog.empty() ? variant.log : firstLog;
+						}
+					}
+				}
+			});
+			std::printf("  %s: %8.1f ms  %u hits  %u misses  %u compiled  %u failed\n", pass, ms,
+				cache.GetHitCount() - hitsBefore, cache.GetMissCount() - missesBefore, compiled, failed);
+			if (!firstLog.empty())
+			{
+				std::printf("    first failure: %s\n", firstLog.c_str());
+			}
+		}
+		std::filesystem::remove_all(directory);
+		return true;
+	}
+
+	// Expands the includes of every scene shader, tests/ShaderCacheTests.cpp checks the result.
+	bool ShaderPreprocessBenchmark()
+	{
+		std::printf("shader-preprocess:\n");
+		const ShaderPreprocessor preprocessor;
+		for (const char* shader : sceneShaders)
+		{
+			ShaderPreprocessor::Result result;
+			std::string error;
+			bool expanded = false;
+			const std::string path = RMFS.GetAbsolutePath(std::string("../../src/Shaders/") + shader + ".comp.glsl");
+			const double ms = MeasureMs([&]() { expanded = preprocessor.Expand(path, result, error); });
+			if (!expanded)
+			{
+				std::printf("  %-22s failed: %s\n", shader, error.c_str());
+				return false;
+			}
+			std::printf("  %-22s %6.3f ms  %5zu bytes  %zu files\n", shader, ms, result.source.size(), result.files.size());
+		}
+		return true;
+	}
+
+	// Copies the shaders and the configs into the directory, with the node shaders of the
+	// frontend config pointing at the copy, so they can be edited.
+	bool CopyPipelineSources(const std::string& directory, std::string& frontendPath, std::string& backendPath, std::string& error)
+	{
+		std::error_code copyError;
+		std::filesystem::create_directories(directory, copyError);
+		std::filesystem::copy(RMFS.GetAbsolutePath("../../src/Shaders"), directory + "/Shaders", std::filesystem::copy_options::recursive, copyError);
+		backendPath = directory + "/BackendConfig.yaml";
+		std::filesystem::copy_file(RMFS.GetAbsolutePath("../../src/BackendConfig.yaml"), backendPath, copyError);
+		if (copyError)
+		{
+			error = copyError.message();
+			return false;
+		}
+
+		YamlNode config;
+		if (!YamlNode::Load(RMFS.GetAbsolutePath("../../src/FrontendConfig.yaml"), config, error))
+		{
+			return false;
+		}
+		if (YamlNode* nodes = config.Find("nodes"))
+		{
+			for (YamlNode& node : nodes->GetItems())
+			{
+				if (YamlNode* shaders = node.Find("shaders"))
+				{
+					for (auto& shader : shaders->GetEntries())
+					{
+						const std::string name = std::filesystem::path(shader.second.GetScalar()).filename().string();
+						shader.second = YamlNode(std::filesystem::absolute(directory + "/Shaders/" + name).string());
+					}
+				}
+			}
+		}
+		frontendPath = directory + "/FrontendConfig.yaml";
+		std::ofstream(frontendPath) << config.Emit();
+		return true;
+	}
+
+	// Edits a copy of the shaders and configs while the CPU renderer keeps rendering frames,
+	// and measures how long each edit takes to show up in a rendered frame.
+	bool HotReloadBenchmark()
+	{
+		const int width = 64;
+		const int height = 48;
+		const std::chrono::milliseconds debounce(50);
+		const std::chrono::milliseconds timeout(10000);
+
+		const std::string directory = std::filesystem::absolute(RMFS.GetAbsolutePath("hot-reload-benchmark")).string();
+		std::filesystem::remove_all(directory);
+		std::string frontendPath;
+		std::string backendPath;
+		std::string error;
+		if (!CopyPipelineSources(directory, frontendPath, backendPath, error))
+		{
+			std::printf("hot-reload: %s\n", error.c_str());
+			return false;
+		}
+		const bool hasCompiler = ShaderVariantCache(directory + "/cache").HasCompiler();
+
+		struct Edit
+		{
+			const char* name;
+			const char* file;
+			std::function<void(std::string&)> apply;
+		};
+		const auto replace = [](const std::string& from, const std::string& to)
+		{
+			return [from, to](std::string& text)
+			{
+				const size_t position = text.find(from);
+				text = position == std::string::npos ? text : text.replace(position, from.size(), to);
+			};
+		};
+		const auto append = [](const std::string& line) { return [line](std::string& text) { text += line; }; };
+		const Edit edits[] = {
+			{ "preset MAX_ITERATIONS 256 -> 96", "FrontendConfig.yaml", replace("MAX_ITERATIONS: 256", "MAX_ITERATIONS: 96") },
+			{ "included common/march.glsl", "Shaders/common/march.glsl", append("// Edited.\n") },
+			// Dropped without a reload.
+			{ "unused sphere.comp.glsl", "Shaders/sphere.comp.glsl", append("// Edited.\n") },
+			{ "comment in FrontendConfig.yaml", "FrontendConfig.yaml", append("# Edited.\n") },
+			// Rejected by the compiler, without one the pipeline would have to reject it.
+			{ "#error in mandelbulb.comp.glsl", "Shaders/mandelbulb.comp.glsl", replace("\n", "\n#error Edited.\n") },
+		};
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		Camera camera(Eigen::Vector3f(0.f, 0.f, -40.f), Eigen::Vector3f(0.f, 0.f, 0.f), Eigen::Vector3f(0.f, 1.f, 0.f),
+			60.f, width / float(height), .01f, 10000.f);
+		camera.UpdateRayBasis();
+		std::vector<uint8_t> pixels(size_t(width) * height * CpuRenderer::CHANNELS);
+
+		{
+			PipelineReloader reloader(frontendPath, backendPath, "", { directory + "/Shaders" }, directory + "/cache", debounce);
+			CpuRenderSettings settings;
+			ApplyShaderConstants(reloader.GetPrepared().preset.constants, settings);
+			renderer.SetSettings(settings);
+
+			const auto renderFrame = [&]()
+			{
+				renderer.ResetStatistics();
+				return MeasureMs([&]() { renderer.Render(camera.GetRayBasis(), width, height, pixels.data()); });
+			};
+			const double frameMs = renderFrame();
+			std::printf("hot-reload: %dx%d CPU frames of %.1f ms, %lld ms debounce, %s\n", width, height, frameMs,
+				(long long)debounce.count(), hasCompiler ? "shader compiler found" : "no shader compiler");
+
+			for (const Edit& edit : edits)
+			{
+				const uint64_t evaluationsBefore = renderer.GetDistanceEvaluations();
+				const uint32_t settledBefore = reloader.GetIgnoredCount() + reloader.GetRejectedCount();
+
+				const std::string path = directory + '/' + edit.file;
+				std::ifstream input(path);
+				std::string text((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+				input.close();
+				edit.apply(text);
+				const auto written = std::chrono::steady_clock::now();
+				std::ofstream(path) << text;
+
+				// The render loop keeps going until the edit is swapped in or known to be dropped.
+				PipelineReloader::Reload reload;
+				bool reloaded = false;
+				int frames = 0;
+				double slowestMs = 0.;
+				while (std::chrono::steady_clock::now() - written < timeout)
+				{
+					reloaded = reloader.TakeReload(reload);
+					if (reloaded)
+					{
+						ApplyShaderConstants(reload.constants, settings);
+						renderer.SetSettings(settings);
+					}
+					slowestMs = std::max(slowestMs, renderFrame());
+					++frames;
+					if (reloaded || reloader.GetIgnoredCount() + reloader.GetRejectedCount() != settledBefore)
+					{
+						break;
+					}
+				}
+				const double latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - written).count();
+
+				std::string nodes;
+				for (const std::string& node : reload.nodes)
+				{
+					nodes += (nodes.empty() ? "" : ",") + node;
+				}
+				std::printf("  %-32s %-9s after %7.1f ms  %3d frames (slowest %5.1f ms)  DE calls/frame %6llu -> %6llu  nodes: %s\n",
+					edit.name, reloaded ? "reloaded" : "dropped", latencyMs, frames, slowestMs, (unsigned long long)evaluationsBefore,
+					(unsigned long long)renderer.GetDistanceEvaluations(), nodes.empty() ? "-" : nodes.c_str());
+			}
+			std::printf("  ignored %u, rejected %u\n", reloader.GetIgnoredCount(), reloader.GetRejectedCount());
+		}
+		std::filesystem::remove_all(directory);
+		return true;
+	}
+
+	// Time until the scene pipeline can be configured at startup, and the precompilation of every
+	// variant, cold and warm, on the calling thread and on the thread pool.
+	bool ShaderStartupBenchmark()
+	{
+		const std::string frontendPath = RMFS.GetAbsolutePath("../../src/FrontendConfig.yaml");
+		const std::string shaderDirectory = RMFS.GetAbsolutePath("../../src/Shaders");
+		const std::string directory = RMFS.GetAbsolutePath("shader-startup-benchmark");
+		ThreadPool threadPool;
+
+		std::printf("shader-startup: %u threads, %s\n", threadPool.GetThreadCount(),
+			ShaderVariantCache(directory).HasCompiler() ? "shader compiler found" : "no shader compiler");
+		for (const bool parallel : { false, true })
+		{
+			std::filesystem::remove_all(directory);
+			ShaderVariantCache cache(directory);
+			ThreadPool* pool = parallel ? &threadPool : nullptr;
+
+			for (const char* pass : { "cold", "warm" })
+			{
+				PreparedShaderVariants prepared;
+				std::string error;
+				bool ok = false;
+				const double startupMs = MeasureMs([&]() { ok = PrepareShaderVariants(frontendPath, "", cache, "", prepared, error, pool); });
+
+				PrecompileReport report;
+				const double precompileMs = MeasureMs([&]()
+				{
+					ok = ok && PrecompileShaderVariants(frontendPath, shaderDirectory, cache, pool, report, error);
+				});
+				if (!ok)
+				{
+					std::printf("  failed: %s\n", error.c_str());
+					return false;
+				}
+				std::printf("  %-8s %s: scene pipeline ready after %7.1f ms, all %u variants after %7.1f ms more (%u from the cache, %zu failed)\n",
+					parallel ? "parallel" : "serial", pass, startupMs, report.variants, precompileMs, report.cacheHits, report.failed.size());
+			}
+		}
+		std::filesystem::remove_all(directory);
+		return true;
+	}
+
+	bool ConfigStartupBenchmark()
+	{
+		const int iterations = 200;
+		const std::string directory = RMFS.GetAbsolutePath("config-startup-benchmark");
+
+		std::printf("config-startup: average of %d loads, validated on every load, the YAML is only read on the cold load\n", iterations);
+		for (const std::string name : { "BackendConfig", "FrontendConfig" })
+		{
+			const std::string path = RMFS.GetAbsolutePath("../../src/" + name + ".yaml");
+			const auto validate = name == "BackendConfig" ? &ValidateBackendConfig : &ValidateFrontendConfig;
+			std::filesystem::remove_all(directory);
+
+			YamlNode root;
+			ConfigBlob blob;
+			std::string error;
+			bool ok = true;
+			const double yamlMs = MeasureMs([&]()
+			{
+				for (int i = 0; i < iterations; ++i)
+				{
+					ok = ok && YamlNode::Load(path, root, error);
+				}
+			});
+			const double coldMs = MeasureMs([&]() { ok = ok && LoadCompiledConfig(path, directory, validate, blob, error); });
+			const double blobMs = MeasureMs([&]()
+			{
+				for (int i = 0; i < iterations; ++i)
+				{
+					ok = ok && LoadCompiledConfig(path, directory, validate, blob, error);
+				}
+			});
+			if (!ok)
+			{
+				std::printf("  %s: %s\n", name.c_str(), error.c_str());
+				std::filesystem::remove_all(directory);
+				return false;
+			}
+
+			double blobBytes = 0.0;
+			for (const auto& entry : std::filesystem::directory_iterator(directory))
+			{
+				blobBytes += FileBytes(entry.path().string());
+			}
+			std::printf("  %-15s YAML %6.0f bytes, parse only %7.1f us | blob %6.0f bytes, cold %7.1f us, warm and validated %7.1f us (%.1fx)\n",
+				name.c_str(), FileBytes(path), yamlMs * 1000.0 / iterations, blobBytes, coldMs * 1000.0,
+				blobMs * 1000.0 / iterations, yamlMs / blobMs);
+		}
+
+		std::filesystem::remove_all(directory);
+		return true;
+	}
+
+	// Stands in for HawkEye::Pipeline, which takes uniforms by the names of the node and the
+	// uniform and looks both up on every call - hashed here - and cannot be configured without a
+	// window.
+	class CountingPipeline
+	{
+	public:
+		template <class T>
+		void SetUniform(const std::string& node, const std::string& uniform, const T& value)
+		{
+			checksum += std::hash<std::string>()(node) ^ std::hash<std::string>()(uniform);
+			checksum += *reinterpret_cast<const uint8_t*>(&value);
+			++uploads;
+		}
+
+		uint64_t uploads = 0;
+		uint64_t checksum = 0;
+	};
+
+	// The per-frame uniform uploads of the interactive loop before UniformRing - a SetUniform() by
+	// name for every uniform - against writing them through handles and flushing the ring, with
+	// both ending in the same pipeline calls.
+	bool UniformStagingBenchmark()
+	{
+		const int frameCount = 1000000;
+
+		std::printf("uniform-staging: %d frames, ns per frame, every uniform written each frame\n", frameCount);
+		for (const int uniformCount : { 2, 8, 32 })
+		{
+			std::vector<std::string> names;
+			for (int i = 0; i < uniformCount; ++i)
+			{
+				names.push_back(i == 0 ? "camera" : i == 1 ? "time" : "parameter" + std::to_string(i));
+			}
+			const Eigen::Vector4f value(1.f, 2.f, 3.f, 4.f);
+			UniformRing ring;
+			std::vector<UniformRing::Handle> handles;
+			for (const std::string& name : names)
+			{
+				handles.push_back(ring.Register<Eigen::Vector4f>("rayMarch", name.c_str()));
+			}
+
+			CountingPipeline direct;
+			const double directMs = MeasureMs([&]()
+			{
+				for (int frame = 0; frame < frameCount; ++frame)
+				{
+					for (const std::string& name : names)
+					{
+						direct.SetUniform("rayMarch", name.c_str(), value);
+					}
+				}
+			});
+			CountingPipeline staged;
+			const double ringMs = MeasureMs([&]()
+			{
+				for (int frame = 0; frame < frameCount; ++frame)
+				{
+					for (const UniformRing::Handle handle : handles)
+					{
+						ring.Write(handle, value);
+					}
+					ring.FlushTo([&](const UniformRing::Handle handle, const uint8_t* data)
+					{
+						staged.SetUniform(ring.GetNode(handle), ring.GetUniform(handle), *reinterpret_cast<const Eigen::Vector4f*>(data));
+					});
+				}
+			});
+
+			std::printf("  %2d uniforms: SetUniform by name %7.1f, ring %7.1f (%.2fx), %llu and %llu uploads\n", uniformCount,
+				directMs * 1e6 / frameCount, ringMs * 1e6 / frameCount, directMs / ringMs, (unsigned long long)direct.uploads,
+				(unsigned long long)staged.uploads);
+		}
+		return true;
+	}
+
+	// Animates the smooth union factor through the parameter block and checks on the CPU renderer
+	// that a parameter change shows up in the image without touching a shader.
+	bool SceneParametersBenchmark()
+	{
+		const int frameCount = 1000000;
+		CountingPipeline pipeline;
+		UniformRing ring;
+		ParameterBlock<SceneParameters> block(ring, "rayMarch", "sceneParameters");
+
+		SceneParameters parameters;
+		std::string error;
+		if (!LoadSceneParameters(RMFS.GetAbsolutePath("../../src/SceneParameters.yaml"), parameters, error))
+		{
+			std::printf("scene-parameters: %s\n", error.c_str());
+			return false;
+		}
+		std::printf("scene-parameters: SceneParameters.yaml %s the defaults\n", block.Set(parameters).IsEmpty() ? "matches" : "differs from");
+
+		const auto flush = [&]()
+		{
+			ring.FlushTo([&](const UniformRing::Handle handle, const uint8_t* data)
+			{
+				pipeline.SetUniform(ring.GetNode(handle), ring.GetUniform(handle), *data);
+			});
+		};
+
+		uint64_t changes = 0;
+		const double animatedMs = MeasureMs([&]()
+		{
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				parameters.smoothUnionK = 2.5f + std::sin(frame * .001f);
+				changes += block.Set(parameters).IsEmpty() ? 0 : 1;
+				flush();
+			}
+		});
+		const double unchangedMs = MeasureMs([&]()
+		{
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				changes += block.Set(parameters).IsEmpty() ? 0 : 1;
+				flush();
+			}
+		});
+		std::printf("  animated smoothUnionK: %6.1f ns per frame (%llu changes), unchanged: %6.1f ns per frame, %llu uploads\n",
+			animatedMs * 1e6 / frameCount, (unsigned long long)changes, unchangedMs * 1e6 / frameCount, (unsigned long long)pipeline.uploads);
+
+		const int width = 96;
+		const int height = 64;
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		Camera camera = OrbitCameras(1, width / float(height)).front();
+		camera.UpdateRayBasis();
+		std::vector<uint8_t> before(size_t(width) * height * CpuRenderer::CHANNELS);
+		std::vector<uint8_t> after(before.size());
+		const float factors[] = { 2.5f, 8.f };
+		for (const float factor : factors)
+		{
+			CpuRenderSettings settings = renderer.GetSettings();
+			settings.parameters.smoothUnionK = factor;
+			renderer.SetSettings(settings);
+			const double ms = MeasureMs([&]() { renderer.Render(camera.GetRayBasis(), width, height, (factor == factors[0] ? before : after).data()); });
+			std::printf("  CPU render %dx%d with smoothUnionK %.1f: %7.1f ms\n", width, height, factor, ms);
+		}
+		size_t differing = 0;
+		for (size_t i = 0; i < before.size(); i += CpuRenderer::CHANNELS)
+		{
+			differing += std::memcmp(&before[i], &after[i], CpuRenderer::CHANNELS) != 0 ? 1 : 0;
+		}
+		std::printf("  %zu of %d pixels changed\n", differing, width * height);
+		return true;
+	}
+
+	bool SweepBenchmark()
+	{
+		const std::string directory = RMFS.GetAbsolutePath("sweep-benchmark");
+		ThreadPool threadPool;
+		std::printf("sweep: %u threads\n", threadPool.GetThreadCount());
+		for (const char* name : { "tetrahedron-folds", "mandelbulb-power" })
+		{
+			SweepSpec spec;
+			std::string error;
+			if (!LoadSweepSpec(RMFS.GetAbsolutePath(std::string("../../src/Sweeps/") + name + ".yaml"), spec, error))
+			{
+				std::printf("  %s: %s\n", name, error.c_str());
+				return false;
+			}
+
+			std::filesystem::remove_all(directory);
+			for (const char* pass : { "cold", "warm" })
+			{
+				SweepReport report;
+				if (!RunSweep(spec, directory, threadPool, report, error))
+				{
+					std::printf("  %s: %s\n", name, error.c_str());
+					return false;
+				}
+				double renderMs = 0.0;
+				for (const SweepCell& cell : report.cells)
+				{
+					renderMs += cell.cached ? 0.0 : cell.renderMs;
+				}
+				std::printf("  %-18s %s: %2zu cells of %dx%d in %8.1f ms, %3u rendered (%7.1f ms each), %3u cached, %7.1f cells/s\n",
+					name, pass, report.cells.size(), spec.width, spec.height, report.totalMs, report.rendered,
+					report.rendered ? renderMs / report.rendered : 0.0, report.cached, report.cells.size() * 1000.0 / report.totalMs);
+			}
+		}
+		std::filesystem::remove_all(directory);
+		return true;
+	}
+
+	// Surface points of the scene seen through a grid of rays, marched the way the shaders do.
+	std::vector<Eigen::Vector3f> HitPoints(const Scene scene, const Camera& camera, const int columns, const int rows)
+	{
+		const SceneFunctions::MarchConstants constants = SceneFunctions::GetMarchConstants(scene);
+		const Camera::RayBasis& basis = camera.GetRayBasis();
+		std::vector<Eigen::Vector3f> points;
+		for (int y = 0; y < rows; ++y)
+		{
+			for (int x = 0; x < columns; ++x)
+			{
+				const float u = x / float(columns - 1);
+				const float v = y / float(rows - 1);
+				const Eigen::Vector3f origin = basis.origin0 + u * basis.originHorizontal + v * basis.originVertical;
+				const Eigen::Vector3f ray = (basis.ray0 + u * basis.horizontal + v * basis.vertical).normalized();
+				float t = 0.f;
+				for (int i = 0; i < constants.maxIterations && t < constants.maxDistance; ++i)
+				{
+					const float dist = SceneFunctions::Distance(scene, Eigen::Vector3f(origin + t * ray), 0.f).dist;
+					const float threshold = scene == Scene::Mandelbulb ? constants.epsilon * t * .25f :
+						scene == Scene::RecursiveTetrahedron ? constants.epsilon * t : constants.epsilon;
+					if (dist < threshold)
+					{
+						points.push_back(origin + t * ray);
+						break;
+					}
+					t += dist;
+				}
+			}
+		}
+		return points;
+	}
+
+	// Compares the analytic normals against the tetrahedral and central difference estimates,
+	// taking central differences of the double precision estimate as the reference.
+	bool NormalsBenchmark()
+	{
+		const int repetitions = 20;
+		const std::pair<const char*, Scene> scenes[] = {
+			{ "mandelbulb", Scene::Mandelbulb }, { "recursive-tetrahedron", Scene::RecursiveTetrahedron },
+			{ "sphere", Scene::Sphere }, { "spheres", Scene::Spheres } };
+		const float epsilon = SceneFunctions::GetMarchConstants(Scene::Mandelbulb).epsilon;
+
+		std::printf("normals: angle to the reference in degrees (mean / max), ns per normal\n");
+		for (const auto& scene : scenes)
+		{
+			Camera camera(Eigen::Vector3f(0.f, -2.f, scene.second == Scene::Spheres ? -3.f : -45.f),
+				Eigen::Vector3f(0.f, 0.f, scene.second == Scene::Mandelbulb ? -25.f : 0.f), Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, 1.f, .01f, 10000.f);
+			camera.UpdateRayBasis();
+			const std::vector<Eigen::Vector3f> points = HitPoints(scene.second, camera, 48, 48);
+			if (points.empty())
+			{
+				std::printf("  %s: no surface in view\n", scene.first);
+				continue;
+			}
+
+			std::vector<Eigen::Vector3d> reference;
+			for (const Eigen::Vector3f& point : points)
+			{
+				Eigen::Vector3d gradient;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					Eigen::Vector3d offset = Eigen::Vector3d::Zero();
+					offset(axis) = 1e-6;
+					gradient(axis) = SceneFunctions::Distance(scene.second, Eigen::Vector3d(point.cast<double>() + offset), 0.).dist -
+						SceneFunctions::Distance(scene.second, Eigen::Vector3d(point.cast<double>() - offset), 0.).dist;
+				}
+				reference.push_back(gradient.normalized());
+			}
+
+			const auto measure = [&](const char* name, const std::function<Eigen::Vector3f(const Eigen::Vector3f&)>& normal)
+			{
+				double sum = 0.0;
+				double largest = 0.0;
+				std::vector<Eigen::Vector3f> normals(points.size());
+				const double ms = MeasureMs([&]()
+				{
+					for (int r = 0; r < repetitions; ++r)
+					{
+						for (size_t i = 0; i < points.size(); ++i)
+						{
+							normals[i] = normal(points[i]);
+						}
+					}
+				});
+				for (size_t i = 0; i < points.size(); ++i)
+				{
+					const double angle = std::acos(std::clamp(normals[i].cast<double>().dot(reference[i]), -1.0, 1.0)) * 180.0 / EIGEN_PI;
+					sum += angle;
+					largest = std::max(largest, angle);
+				}
+				std::printf("    %-22s %7.3f / %7.3f  %9.0f ns\n", name, sum / points.size(), largest, ms * 1e6 / (repetitions * points.size()));
+			};
+
+			uint32_t fallbacks = 0;
+			for (const Eigen::Vector3f& point : points)
+			{
+				Eigen::Vector3f normal;
+				fallbacks += SceneFunctions::AnalyticNormal(scene.second, point, 0.f, normal) ? 0 : 1;
+			}
+			std::printf("  %s: %zu surface points, %u without an analytic normal\n", scene.first, points.size(), fallbacks);
+			measure("central differences", [&](const Eigen::Vector3f& point)
+			{
+				Eigen::Vector3f gradient;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					Eigen::Vector3f offset = Eigen::Vector3f::Zero();
+					offset(axis) = epsilon;
+					gradient(axis) = SceneFunctions::Distance(scene.second, Eigen::Vector3f(point + offset), 0.f).dist -
+						SceneFunctions::Distance(scene.second, Eigen::Vector3f(point - offset), 0.f).dist;
+				}
+				return Eigen::Vector3f(gradient.normalized());
+			});
+			measure("tetrahedral", [&](const Eigen::Vector3f& point)
+			{
+				return SceneFunctions::TetrahedralNormal(scene.second, point, 0.f, epsilon);
+			});
+			measure("analytic with fallback", [&](const Eigen::Vector3f& point)
+			{
+				Eigen::Vector3f normal;
+				return SceneFunctions::AnalyticNormal(scene.second, point, 0.f, normal) ? normal :
+					SceneFunctions::TetrahedralNormal(scene.second, point, 0.f, epsilon);
+			});
+		}
+		return true;
+	}
+
+	// Cost of the distance gradient in dual numbers against the four distance estimates of the
+	// tetrahedral finite differences, and the local Lipschitz constant the gradient gives.
+	bool DualGradientBenchmark()
+	{
+		const int repetitions = 20;
+		const std::pair<const char*, Scene> scenes[] = {
+			{ "mandelbulb", Scene::Mandelbulb }, { "recursive-tetrahedron", Scene::RecursiveTetrahedron },
+			{ "sphere", Scene::Sphere }, { "spheres", Scene::Spheres } };
+		const float epsilon = SceneFunctions::GetMarchConstants(Scene::Mandelbulb).epsilon;
+
+		std::printf("dual-gradient: ns per point, gradient error against central differences of the double estimate\n");
+		for (const auto& scene : scenes)
+		{
+			Camera camera(Eigen::Vector3f(0.f, -2.f, scene.second == Scene::Spheres ? -3.f : -45.f),
+				Eigen::Vector3f(0.f, 0.f, scene.second == Scene::Mandelbulb ? -25.f : 0.f), Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, 1.f, .01f, 10000.f);
+			camera.UpdateRayBasis();
+			const std::vector<Eigen::Vector3f> points = HitPoints(scene.second, camera, 48, 48);
+			if (points.empty())
+			{
+				std::printf("  %s: no surface in view\n", scene.first);
+				continue;
+			}
+
+			// Keeps the evaluations from being optimized away.
+			volatile float sink = 0.f;
+			const auto perPoint = [&](const std::function<void(const Eigen::Vector3f&)>& evaluate)
+			{
+				const double ms = MeasureMs([&]()
+				{
+					for (int r = 0; r < repetitions; ++r)
+					{
+						for (const Eigen::Vector3f& point : points)
+						{
+							evaluate(point);
+						}
+					}
+				});
+				return ms * 1e6 / (repetitions * points.size());
+			};
+			const double distanceNs = perPoint([&](const Eigen::Vector3f& point)
+			{
+				sink = SceneFunctions::Distance(scene.second, point, 0.f).dist;
+			});
+			const double tetrahedralNs = perPoint([&](const Eigen::Vector3f& point)
+			{
+				sink = SceneFunctions::TetrahedralNormal(scene.second, point, 0.f, epsilon).x();
+			});
+			const double dualNs = perPoint([&](const Eigen::Vector3f& point)
+			{
+				Eigen::Vector3f gradient;
+				sink = SceneFunctions::DistanceGradient(scene.second, point, 0.f, gradient).dist + gradient.x();
+			});
+
+			double maxError = 0.0;
+			double angleSum = 0.0;
+			double lipschitzSum = 0.0;
+			double lipschitzMax = 0.0;
+			for (const Eigen::Vector3f& point : points)
+			{
+				Eigen::Vector3d reference;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					Eigen::Vector3d offset = Eigen::Vector3d::Zero();
+					offset(axis) = 1e-6;
+					reference(axis) = (SceneFunctions::Distance(scene.second, Eigen::Vector3d(point.cast<double>() + offset), 0.).dist -
+						SceneFunctions::Distance(scene.second, Eigen::Vector3d(point.cast<double>() - offset), 0.).dist) / 2e-6;
+				}
+				Eigen::Vector3f gradient;
+				SceneFunctions::DistanceGradient(scene.second, point, 0.f, gradient);
+				maxError = std::max(maxError, (gradient.cast<double>() - reference).norm() / reference.norm());
+				angleSum += std::acos(std::clamp(gradient.cast<double>().normalized().dot(reference.normalized()), -1.0, 1.0)) * 180.0 / EIGEN_PI;
+				lipschitzSum += gradient.norm();
+				lipschitzMax = std::max(lipschitzMax, double(gradient.norm()));
+			}
+
+			std::printf("  %s: %zu surface points\n", scene.first, points.size());
+			std::printf("    distance %7.0f ns, 4 distances (tetrahedral) %7.0f ns, dual gradient %7.0f ns = %.2fx a distance, %.2fx tetrahedral\n",
+				distanceNs, tetrahedralNs, dualNs, dualNs / distanceNs, dualNs / tetrahedralNs);
+			std::printf("    relative error max %.2e, mean angle %.3f deg, |gradient| mean %.3f max %.3f\n", maxError,
+				angleSum / points.size(), lipschitzSum / points.size(), lipschitzMax);
+		}
+		return true;
+	}
+
+	// Cost of the soft shadow modes of the fractal scenes and how far the reduced resolution and
+	// the reuse of the previous frame's shadows are from tracing every pixel.
+	bool ShadowsBenchmark()
+	{
+		const int width = 160;
+		const int height = 120;
+		const struct
+		{
+			const char* name;
+			Scene scene;
+			Eigen::Vector3f position;
+			Eigen::Vector3f target;
+		} views[] = {
+			{ "mandelbulb", Scene::Mandelbulb, Eigen::Vector3f(15.f, -8.f, -5.f), Eigen::Vector3f(0.f, 0.f, -25.f) },
+			{ "recursive-tetrahedron", Scene::RecursiveTetrahedron, Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero() } };
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		std::printf("shadows: %dx%d, distance estimates per pixel, difference to one shadow ray per pixel in 8-bit steps (mean / max)\n",
+			width, height);
+		for (const auto& view : views)
+		{
+			Camera camera(view.position, view.target, Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height), .01f, 10000.f);
+			camera.UpdateRayBasis();
+			// The same view a little to the side, as after a frame of camera movement.
+			Camera moved(view.position + Eigen::Vector3f(.2f, 0.f, 0.f), view.target, Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height),
+				.01f, 10000.f);
+			moved.UpdateRayBasis();
+
+			CpuRenderSettings settings;
+			settings.scene = view.scene;
+			std::vector<uint8_t> reference(size_t(width) * height * CpuRenderer::CHANNELS);
+			std::vector<uint8_t> pixels(reference.size());
+			settings.shadows = ShadowMode::Full;
+			renderer.SetSettings(settings);
+			renderer.Render(moved.GetRayBasis(), width, height, reference.data());
+			std::vector<uint8_t> movedReference = reference;
+			renderer.Render(camera.GetRayBasis(), width, height, reference.data());
+
+			std::printf("  %s\n", view.name);
+			double offMs = 0.0;
+			const auto report = [&](const char* name, const double ms, const std::vector<uint8_t>& expected, const ShadowHistory* history)
+			{
+				double sum = 0.0;
+				int largest = 0;
+				for (size_t i = 0; i < pixels.size(); i += CpuRenderer::CHANNELS)
+				{
+					const int difference = std::abs(int(pixels[i]) - int(expected[i]));
+					sum += difference;
+					largest = std::max(largest, difference);
+				}
+				std::printf("    %-26s %8.1f ms %6.1fx  %7.1f DE/pixel  %5.2f / %3d", name, ms, offMs > 0.0 ? ms / offMs : 1.0,
+					renderer.GetDistanceEvaluations() / double(width * height), sum / (width * height), largest);
+				if (history)
+				{
+					std::printf("  %u traced, %u reused", history->GetTracedCount(), history->GetReusedCount());
+				}
+				std::printf("\n");
+			};
+
+			for (const ShadowMode mode : { ShadowMode::Off, ShadowMode::Full, ShadowMode::Half })
+			{
+				settings.shadows = mode;
+				renderer.SetSettings(settings);
+				renderer.ResetStatistics();
+				ShadowHistory history;
+				const double ms = MeasureMs([&]() { renderer.Render(camera.GetRayBasis(), width, height, pixels.data(), history); });
+				offMs = mode == ShadowMode::Off ? ms : offMs;
+				report(mode == ShadowMode::Off ? "off" : mode == ShadowMode::Full ? "full resolution" : "half resolution", ms, reference,
+					mode == ShadowMode::Off ? nullptr : &history);
+			}
+
+			// Second frames with the previous one in the history.
+			for (const ShadowMode mode : { ShadowMode::Full, ShadowMode::Half })
+			{
+				settings.shadows = mode;
+				renderer.SetSettings(settings);
+				ShadowHistory history;
+				renderer.Render(camera.GetRayBasis(), width, height, pixels.data(), history);
+				renderer.ResetStatistics();
+				double ms = MeasureMs([&]() { renderer.Render(camera.GetRayBasis(), width, height, pixels.data(), history); });
+				report(mode == ShadowMode::Full ? "full, static" : "half, static", ms, reference, &history);
+
+				renderer.Render(camera.GetRayBasis(), width, height, pixels.data(), history);
+				renderer.ResetStatistics();
+				ms = MeasureMs([&]() { renderer.Render(moved.GetRayBasis(), width, height, pixels.data(), history); });
+				report(mode == ShadowMode::Full ? "full, camera moved" : "half, camera moved", ms, movedReference, &history);
+			}
+		}
+		return true;
+	}
+
+	// Per-pass cost of the ambient occlusion of the fractal scenes over a few frames of a still
+	// and a moving camera, against sampling the occlusion of every pixel.
+	bool AmbientOcclusionBenchmark()
+	{
+		const int width = 160;
+		const int height = 120;
+		const int frameCount = 6;
+		const struct
+		{
+			const char* name;
+			Scene scene;
+			Eigen::Vector3f position;
+			Eigen::Vector3f target;
+		} views[] = {
+			{ "mandelbulb", Scene::Mandelbulb, Eigen::Vector3f(15.f, -8.f, -5.f), Eigen::Vector3f(0.f, 0.f, -25.f) },
+			{ "recursive-tetrahedron", Scene::RecursiveTetrahedron, Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero() } };
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		AmbientOcclusionPass occlusionPass(threadPool);
+		std::printf("ambient-occlusion: %dx%d, ms per pass, distance estimates per pixel, difference to sampling every pixel "
+			"in 8-bit steps (mean / max)\n", width, height);
+		for (const auto& view : views)
+		{
+			CpuRenderSettings settings;
+			settings.scene = view.scene;
+			renderer.SetSettings(settings);
+			std::printf("  %s\n", view.name);
+
+			const ImageShape shape = { width, height, ImageLayout::Tiled };
+			GBuffer gbuffer;
+			std::vector<float> reference(shape.GetSize());
+			ImageBuffer<float> occlusion;
+			std::vector<uint8_t> pixels(size_t(width) * height * CpuRenderer::CHANNELS);
+			occlusionPass.Reset();
+			for (int frame = 0; frame < 2 * frameCount; ++frame)
+			{
+				// A still camera, then one moving a little every frame.
+				const float offset = frame < frameCount ? 0.f : .1f * (frame - frameCount + 1);
+				Camera camera(view.position + Eigen::Vector3f(offset, 0.f, 0.f), view.target, Eigen::Vector3f(0.f, 1.f, 0.f), 60.f,
+					width / float(height), .01f, 10000.f);
+				camera.UpdateRayBasis();
+
+				renderer.ResetStatistics();
+				const double surfaceMs = MeasureMs([&]() { renderer.RenderGBuffer(camera.GetRayBasis(), shape, gbuffer); });
+				const double surfaceEvaluations = renderer.GetDistanceEvaluations() / double(width * height);
+				const double referenceMs = MeasureMs([&]()
+				{
+					threadPool.ParallelFor(uint32_t(height), [&](const uint32_t y)
+					{
+						for (int x = 0; x < width; ++x)
+						{
+							const size_t i = shape.Index(x, int(y));
+							reference[i] = gbuffer.hits(i) ? AmbientOcclusionPass::Occlusion(settings, gbuffer.GetPosition(x, int(y)), gbuffer.GetNormal(i)) : 1.f;
+						}
+					});
+				});
+
+				occlusionPass.Run(settings, gbuffer, occlusion);
+				const double compositeMs = MeasureMs([&]() { renderer.Composite(gbuffer, nullptr, &occlusion, pixels.data()); });
+
+				double sum = 0.0;
+				double largest = 0.0;
+				for (int y = 0; y < height; ++y)
+				{
+					for (int x = 0; x < width; ++x)
+					{
+						const size_t i = shape.Index(x, y);
+						const double difference = std::abs(occlusion(i) - reference[i]) * 255.0;
+						sum += difference;
+						largest = std::max(largest, difference);
+					}
+				}
+				const AmbientOcclusionPass::Timings& timings = occlusionPass.GetTimings();
+				if (frame == 0)
+				{
+					std::printf("    surface %.1f ms (%.1f DE/pixel), every pixel %.1f ms (%.1f DE/pixel), composite %.1f ms\n", surfaceMs,
+						surfaceEvaluations, referenceMs, double(AmbientOcclusionPass::SAMPLES), compositeMs);
+				}
+				std::printf("    frame %2d %-6s sample %5.1f ms, upsample %5.1f ms, accumulate %4.1f ms, %4.2f DE/pixel, %5.2f / %5.1f\n",
+					frame, frame < frameCount ? "still" : "moving", timings.sampleMs, timings.upsampleMs, timings.accumulateMs,
+					occlusionPass.GetDistanceEvaluations() / double(width * height), sum / (width * height), largest);
+			}
+		}
+		return true;
+	}
+
+	// Rendering through the G-buffer against the single pass of Render(), and what re-shading a
+	// frame costs when only the shading passes run again.
+	bool GBufferBenchmark()
+	{
+		const int width = 160;
+		const int height = 120;
+		const struct
+		{
+			const char* name;
+			Scene scene;
+			Eigen::Vector3f position;
+			Eigen::Vector3f target;
+		} views[] = {
+			{ "mandelbulb", Scene::Mandelbulb, Eigen::Vector3f(15.f, -8.f, -5.f), Eigen::Vector3f(0.f, 0.f, -25.f) },
+			{ "recursive-tetrahedron", Scene::RecursiveTetrahedron, Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero() },
+			{ "spheres", Scene::Spheres, Eigen::Vector3f(0.f, 0.f, -8.f), Eigen::Vector3f::Zero() } };
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		AmbientOcclusionPass occlusionPass(threadPool);
+		std::printf("gbuffer: %dx%d, half resolution shadows, %zu bytes per pixel\n", width, height,
+			8 * sizeof(float) + sizeof(int) + sizeof(uint8_t));
+		for (const auto& view : views)
+		{
+			Camera camera(view.position, view.target, Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height), .01f, 10000.f);
+			camera.UpdateRayBasis();
+			CpuRenderSettings settings;
+			settings.scene = view.scene;
+			settings.shadows = ShadowMode::Half;
+			renderer.SetSettings(settings);
+
+			std::vector<uint8_t> reference(size_t(width) * height * CpuRenderer::CHANNELS);
+			std::vector<uint8_t> pixels(reference.size());
+			renderer.ResetStatistics();
+			const double renderMs = MeasureMs([&]() { renderer.Render(camera.GetRayBasis(), width, height, reference.data()); });
+			const uint64_t renderEvaluations = renderer.GetDistanceEvaluations();
+
+			GBuffer gbuffer;
+			ImageBuffer<float> shadows;
+			ImageBuffer<float> occlusion;
+			renderer.ResetStatistics();
+			const double marchMs = MeasureMs([&]() { renderer.RenderGBuffer(camera.GetRayBasis(), { width, height, ImageLayout::Tiled }, gbuffer); });
+			const uint64_t marchEvaluations = renderer.GetDistanceEvaluations();
+			renderer.ResetStatistics();
+			const double shadowsMs = MeasureMs([&]() { renderer.RenderShadows(gbuffer, shadows); });
+			const uint64_t shadowEvaluations = renderer.GetDistanceEvaluations();
+			const double compositeMs = MeasureMs([&]() { renderer.Composite(gbuffer, &shadows, nullptr, pixels.data()); });
+
+			// A change of the shading alone (say post-processing or the occlusion) reuses the march
+			// and the shadows.
+			occlusionPass.Reset();
+			const double occlusionMs = MeasureMs([&]() { occlusionPass.Run(settings, gbuffer, occlusion); });
+			const double reshadeMs = MeasureMs([&]() { renderer.Composite(gbuffer, &shadows, &occlusion, pixels.data()); });
+
+			const double pixelCount = double(width) * height;
+			std::printf("  %s\n", view.name);
+			std::printf("    render           %7.1f ms  %6.1f DE/pixel\n", renderMs, renderEvaluations / pixelCount);
+			std::printf("    g-buffer march   %7.1f ms  %6.1f DE/pixel\n", marchMs, marchEvaluations / pixelCount);
+			std::printf("    shadows          %7.1f ms  %6.1f DE/pixel\n", shadowsMs, shadowEvaluations / pixelCount);
+			std::printf("    composite        %7.1f ms\n", compositeMs);
+			std::printf("    occlusion        %7.1f ms  %6.1f DE/pixel\n", occlusionMs, occlusionPass.GetDistanceEvaluations() / pixelCount);
+			std::printf("    re-shade         %7.1f ms  %5.1f%% of march + shadows + composite\n", reshadeMs,
+				100.0 * reshadeMs / (marchMs + shadowsMs + compositeMs));
+		}
+		return true;
+	}
+
+	// Set-associative cache with LRU replacement fed with the addresses of a traversal, for the
+	// cache misses of a memory layout independent of the machine - 32 KiB with 8 ways of 64 byte
+	// lines, the L1 data cache of current x86 cores.
+	class CacheModel
+	{
+	public:
+		CacheModel()
+		{
+			std::fill(std::begin(lines), std::end(lines), ~uint64_t(0));
+		}
+
+		void Access(const void* address)
+		{
+			const uint64_t line = uint64_t(reinterpret_cast<uintptr_t>(address)) / LINE_SIZE;
+			uint64_t* set = lines + (line % SETS) * WAYS;
+			int way = 0;
+			while (way < WAYS && set[way] != line)
+			{
+				++way;
+			}
+			if (way == WAYS)
+			{
+				++misses;
+				way = WAYS - 1;
+			}
+			// The set is kept in the order of use, the least recently used line last.
+			for (; way > 0; --way)
+			{
+				set[way] = set[way - 1];
+			}
+			set[0] = line;
+		}
+
+		uint64_t GetMisses() const
+		{
+			return misses;
+		}
+
+	private:
+		static constexpr int LINE_SIZE = 64;
+		static constexpr int SETS = 64;
+		static constexpr int WAYS = 8;
+
+		uint64_t lines[SETS * WAYS];
+		uint64_t misses = 0;
+	};
+
+	// Hardware counter of the cache misses of the calling thread, where the kernel grants access
+	// to it (Linux only).
+	class CacheMissCounter
+	{
+	public:
+		CacheMissCounter()
+		{
+#ifdef __linux__
+			perf_event_attr attributes = {};
+			attributes.size = sizeof(attributes);
+			attributes.type = PERF_TYPE_HARDWARE;
+			attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+			attributes.disabled = 1;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			descriptor = int(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+		}
+
+		~CacheMissCounter()
+		{
+#ifdef __linux__
+			if (descriptor >= 0)
+			{
+				close(descriptor);
+			}
+#endif
+		}
+
+		CacheMissCounter(const CacheMissCounter&) = delete;
+		CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+		bool IsAvailable() const
+		{
+			return descriptor >= 0;
+		}
+
+		// Misses while the callable ran.
+		uint64_t Count(const std::function<void()>& callable) const
+		{
+			uint64_t count = 0;
+#ifdef __linux__
+			ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+			ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+			callable();
+			ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(descriptor, &count, sizeof(count)) != sizeof(count))
+			{
+				count = 0;
+			}
+#else
+			callable();
+#endif
+			return count;
+		}
+
+	private:
+		int descriptor = -1;
+	};
+
+	// Traversals of the intermediate buffers of the CPU renderer. Each hands the address of every
+	// value it touches to the visitor, which either accesses it or feeds it to a CacheModel.
+	template <class Visitor>
+	void VisitTiles(const ImageShape& shape, ImageBuffer<float>& image, Visitor&& visit)
+	{
+		// Every channel of every pixel tile by tile, like the march writing the G-buffer.
+		for (int y0 = 0; y0 < shape.height; y0 += CpuRenderer::TILE_SIZE)
+		{
+			for (int x0 = 0; x0 < shape.width; x0 += CpuRenderer::TILE_SIZE)
+			{
+				for (int y = y0; y < std::min(y0 + CpuRenderer::TILE_SIZE, shape.height); ++y)
+				{
+					for (int x = x0; x < std::min(x0 + CpuRenderer::TILE_SIZE, shape.width); ++x)
+					{
+						const size_t i = shape.Index(x, y);
+						for (int channel = 0; channel < image.GetChannels(); ++channel)
+						{
+							visit(&image(i, channel));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	template <class Visitor>
+	void VisitNeighbourhoods(const ImageShape& shape, ImageBuffer<float>& image, Visitor&& visit)
+	{
+		// The 3x3 neighbourhood of every pixel in the first channel tile by tile, like the
+		// upsampling of the shadows and the occlusion.
+		for (int y0 = 0; y0 < shape.height; y0 += CpuRenderer::TILE_SIZE)
+		{
+			for (int x0 = 0; x0 < shape.width; x0 += CpuRenderer::TILE_SIZE)
+			{
+				for (int y = y0; y < std::min(y0 + CpuRenderer::TILE_SIZE, shape.height); ++y)
+				{
+					for (int x = x0; x < std::min(x0 + CpuRenderer::TILE_SIZE, shape.width); ++x)
+					{
+						for (int dy = -1; dy <= 1; ++dy)
+						{
+							for (int dx = -1; dx <= 1; ++dx)
+							{
+								visit(&image(shape.Index(std::clamp(x + dx, 0, shape.width - 1), std::clamp(y + dy, 0, shape.height - 1))));
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	template <class Visitor>
+	void VisitRows(const ImageShape& shape, ImageBuffer<float>& image, Visitor&& visit)
+	{
+		// Every channel of every pixel row by row, like the conversion to RGBA8 rows.
+		for (int y = 0; y < shape.height; ++y)
+		{
+			for (int x = 0; x < shape.width; ++x)
+			{
+				const size_t i = shape.Index(x, y);
+				for (int channel = 0; channel < image.GetChannels(); ++channel)
+				{
+					visit(&image(i, channel));
+				}
+			}
+		}
+	}
+
+	// Throughput and cache misses of the traversals of the renderer's intermediate buffers in the
+	// linear and the tiled layout, on one thread. Then the passes reading the G-buffer in both.
+	bool ImageLayoutBenchmark()
+	{
+		const int channels = 8;
+		const CacheMissCounter counter;
+		std::printf("image-layout: %d float channels, Mpixel/s, simulated L1 misses per pixel (32 KiB, 8 ways), hardware "
+			"cache misses per pixel%s\n", channels, counter.IsAvailable() ? "" : " (no counter access)");
+
+		const char* traversalNames[] = { "tile write", "tile 3x3 read", "row read" };
+		// Runs the traversal with the visitor inlined, so the timings measure the memory accesses.
+		const auto traverse = [](const int traversal, const ImageShape& shape, ImageBuffer<float>& image, auto&& visit)
+		{
+			switch (traversal)
+			{
+			case 0:
+				VisitTiles(shape, image, visit);
+				break;
+			case 1:
+				VisitNeighbourhoods(shape, image, visit);
+				break;
+			default:
+				VisitRows(shape, image, visit);
+				break;
+			}
+		};
+
+		for (const auto& size : { std::make_pair(1920, 1080), std::make_pair(2048, 1024) })
+		{
+			std::printf("  %dx%d\n", size.first, size.second);
+			for (int traversal = 0; traversal < 3; ++traversal)
+			{
+				for (const ImageLayout layout : { ImageLayout::Linear, ImageLayout::Tiled })
+				{
+					const ImageShape shape = { size.first, size.second, layout };
+					ImageBuffer<float> image;
+					image.Resize(shape, channels);
+					image.Fill(1.f);
+
+					// The first traversal writes, the others read.
+					float sum = 0.f;
+					const auto access = [&](float* value)
+					{
+						if (traversal == 0)
+						{
+							*value += 1.f;
+						}
+						else
+						{
+							sum += *value;
+						}
+					};
+					traverse(traversal, shape, image, access);
+					const double ms = MeasureMs([&]() { traverse(traversal, shape, image, access); });
+					const uint64_t hardwareMisses = counter.IsAvailable() ? counter.Count([&]() { traverse(traversal, shape, image, access); }) : 0;
+					volatile float sink = sum;
+					(void)sink;
+
+					CacheModel cache;
+					traverse(traversal, shape, image, [&](float* value) { cache.Access(value); });
+
+					const double pixelCount = double(shape.width) * shape.height;
+					std::printf("    %-14s %-7s %8.1f Mpixel/s %8.3f simulated", traversalNames[traversal], layout == ImageLayout::Linear ? "linear" : "tiled",
+						pixelCount / (ms * 1e3), cache.GetMisses() / pixelCount);
+					if (counter.IsAvailable())
+					{
+						std::printf(" %8.3f hardware", hardwareMisses / pixelCount);
+					}
+					std::printf("\n");
+				}
+			}
+		}
+
+		// The passes after the march on a G-buffer of each layout.
+		const int width = 320;
+		const int height = 240;
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		AmbientOcclusionPass occlusionPass(threadPool);
+		CpuRenderSettings settings;
+		settings.scene = Scene::RecursiveTetrahedron;
+		settings.shadows = ShadowMode::Half;
+		renderer.SetSettings(settings);
+		Camera camera(Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero(), Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height),
+			.01f, 10000.f);
+		camera.UpdateRayBasis();
+		std::printf("  recursive-tetrahedron %dx%d, ms per pass\n", width, height);
+		std::vector<uint8_t> pixels(size_t(width) * height * CpuRenderer::CHANNELS);
+		for (const ImageLayout layout : { ImageLayout::Linear, ImageLayout::Tiled })
+		{
+			GBuffer gbuffer;
+			ImageBuffer<float> shadows;
+			ImageBuffer<float> occlusion;
+			const double marchMs = MeasureMs([&]() { renderer.RenderGBuffer(camera.GetRayBasis(), { width, height, layout }, gbuffer); });
+			const double shadowsMs = MeasureMs([&]() { renderer.RenderShadows(gbuffer, shadows); });
+			occlusionPass.Reset();
+			const double occlusionMs = MeasureMs([&]() { occlusionPass.Run(settings, gbuffer, occlusion); });
+			const double compositeMs = MeasureMs([&]() { renderer.Composite(gbuffer, &shadows, &occlusion, pixels.data()); });
+			std::printf("    %-7s march %7.1f, shadows %6.1f, occlusion %5.1f, composite %4.1f\n", layout == ImageLayout::Linear ? "linear" : "tiled",
+				marchMs, shadowsMs, occlusionMs, compositeMs);
+		}
+		return true;
+	}
+
+	// Per-tile scratch memory from an arena against std::vector, and the arena allocations of the
+	// steady-state render loop.
+	bool ArenaBenchmark()
+	{
+		// The arrays of a shadow tile of RenderTile().
+		const size_t pixelCount = size_t(CpuRenderer::TILE_SIZE) * CpuRenderer::TILE_SIZE;
+		const int tileCount = 200000;
+		volatile float sink = 0.f;
+		const double vectorMs = MeasureMs([&]()
+		{
+			for (int tile = 0; tile < tileCount; ++tile)
+			{
+				std::vector<Eigen::Vector3f> origins(pixelCount);
+				std::vector<Eigen::Vector3f> rays(pixelCount);
+				std::vector<Eigen::Vector3f> positions(pixelCount);
+				std::vector<float> factors(pixelCount, 1.f);
+				std::vector<float> blockFactors(pixelCount / 4, 1.f);
+				origins[tile % pixelCount].x() = factors[0];
+				sink = sink + origins[tile % pixelCount].x() + rays[0].x() + positions[0].x() + blockFactors[0];
+			}
+		});
+		Arena arena;
+		const double arenaMs = MeasureMs([&]()
+		{
+			for (int tile = 0; tile < tileCount; ++tile)
+			{
+				const ArenaScope scope(arena);
+				Eigen::Vector3f* origins = arena.Allocate<Eigen::Vector3f>(pixelCount);
+				Eigen::Vector3f* rays = arena.Allocate<Eigen::Vector3f>(pixelCount);
+				Eigen::Vector3f* positions = arena.Allocate<Eigen::Vector3f>(pixelCount);
+				float* factors = arena.Allocate<float>(pixelCount);
+				float* blockFactors = arena.Allocate<float>(pixelCount / 4);
+				std::fill_n(factors, pixelCount, 1.f);
+				std::fill_n(blockFactors, pixelCount / 4, 1.f);
+				origins[tile % pixelCount].x() = factors[0];
+				sink = sink + origins[tile % pixelCount].x() + rays[0].x() + positions[0].x() + blockFactors[0];
+			}
+		});
+		std::printf("arena: scratch of a shadow tile, std::vector %.1f ns, arena %.1f ns per tile (%u heap blocks)%s\n",
+			vectorMs * 1e6 / tileCount, arenaMs * 1e6 / tileCount, unsigned(arena.GetStatistics().heapAllocations),
+#ifdef DEBUG
+			", released memory poisoned");
+#else
+			"");
+#endif
+
+		// Frames of a still camera through Render() and through the G-buffer passes.
+		const int width = 64;
+		const int height = 48;
+		const int warmUpFrames = 2;
+		const int frameCount = 6;
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		AmbientOcclusionPass occlusionPass(threadPool);
+		CpuRenderSettings settings;
+		settings.scene = Scene::RecursiveTetrahedron;
+		settings.shadows = ShadowMode::Half;
+		renderer.SetSettings(settings);
+		Camera camera(Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero(), Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height),
+			.01f, 10000.f);
+		camera.UpdateRayBasis();
+
+		std::vector<uint8_t> pixels(size_t(width) * height * CpuRenderer::CHANNELS);
+		ShadowHistory history;
+		GBuffer gbuffer;
+		ImageBuffer<float> shadows;
+		ImageBuffer<float> occlusion;
+		const auto frame = [&]()
+		{
+			renderer.Render(camera.GetRayBasis(), width, height, pixels.data(), history);
+			renderer.RenderGBuffer(camera.GetRayBasis(), { width, height, ImageLayout::Tiled }, gbuffer);
+			renderer.RenderShadows(gbuffer, shadows);
+			occlusionPass.Run(settings, gbuffer, occlusion);
+			renderer.Composite(gbuffer, &shadows, &occlusion, pixels.data());
+		};
+
+		for (int i = 0; i < warmUpFrames; ++i)
+		{
+			frame();
+		}
+		renderer.ResetStatistics();
+		occlusionPass.ResetArenaStatistics();
+		for (int i = 0; i < frameCount; ++i)
+		{
+			frame();
+		}
+
+		ArenaStatistics statistics = renderer.GetArenaStatistics();
+		statistics += occlusionPass.GetArenaStatistics();
+		std::printf("  %dx%d, %d frames after %d to warm up: %.1f allocations and %.1f KiB per frame, peak %.1f KiB, capacity %.1f KiB\n",
+			width, height, frameCount, warmUpFrames, statistics.allocations / double(frameCount), statistics.bytes / 1024.0 / frameCount,
+			statistics.peakBytes / 1024.0, statistics.capacity / 1024.0);
+		std::printf("  heap allocations of the arenas in the steady state: %u\n", unsigned(statistics.heapAllocations));
+		return true;
+	}
+
+	// Headless replay of the interactive loop of Source.cpp: scripted input through ApplyInput(),
+	// scene parameters changing as after a reload, the uniform ring flushed and the CPU renderer
+	// drawing the frame in place of the pipeline. Once warmed up a frame must not allocate,
+	// allocator jitter shows up in the frame times. Counting needs a --track-allocations build.
+	bool MainLoopBenchmark()
+	{
+		const int width = 64;
+		const int height = 48;
+		const int warmUpFrames = 8;
+		const int frameCount = 120;
+		const float timeDelta = 1000.f / 60.f;
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		CpuRenderSettings settings;
+		settings.scene = Scene::RecursiveTetrahedron;
+		settings.shadows = ShadowMode::Half;
+		renderer.SetSettings(settings);
+		UniformRing ring;
+		SceneUniforms uniforms(ring);
+		Camera camera(Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero(), Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height),
+			.01f, 10000.f);
+
+		std::vector<uint8_t> pixels(size_t(width) * height * CpuRenderer::CHANNELS);
+		ShadowHistory history;
+		std::vector<double> frameMs(frameCount);
+		std::vector<AllocationCounts> frameAllocations(frameCount);
+		uint64_t uploads = 0;
+		// Stands in for the pipeline taking the uniforms.
+		uint64_t uploadedSum = 0;
+		const auto frame = [&](const int index)
+		{
+			// Walks forward and back, then drags the view around.
+			const int phase = index % 40;
+			FrameInput input;
+			input.forward = phase < 10;
+			input.back = phase >= 10 && phase < 20;
+			input.dragX = phase >= 20 ? 3 : 0;
+			input.dragY = phase >= 30 ? -2 : 0;
+			ApplyInput(uniforms, camera, input, timeDelta);
+
+			if (index % 16 == 0)
+			{
+				settings.parameters.smoothUnionK = 2.5f + std::sin(index * .1f);
+				if (!uniforms.parameters.Set(settings.parameters).IsEmpty())
+				{
+					renderer.SetSettings(settings);
+				}
+			}
+
+			uploads += ring.FlushTo([&](const UniformRing::Handle, const uint8_t* data) { uploadedSum += data[0]; });
+			renderer.Render(camera.GetRayBasis(), width, height, pixels.data(), history);
+			LogTelemetry("Replayed frame %d\n", index);
+		};
+
+		for (int i = 0; i < warmUpFrames; ++i)
+		{
+			frame(i);
+		}
+		for (int i = 0; i < frameCount; ++i)
+		{
+			// Timed without MeasureMs(), a std::function may allocate itself.
+			const AllocationCounts before = GetAllocationCounts();
+			const auto start = std::chrono::high_resolution_clock::now();
+			frame(warmUpFrames + i);
+			frameMs[i] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			frameAllocations[i] = GetAllocationCounts() - before;
+		}
+
+		AllocationCounts total;
+		int allocatingFrames = 0;
+		for (const AllocationCounts& counts : frameAllocations)
+		{
+			total.allocations += counts.allocations;
+			total.bytes += counts.bytes;
+			allocatingFrames += counts.allocations > 0 ? 1 : 0;
+		}
+		std::vector<double> sorted = frameMs;
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.0;
+		for (const double ms : sorted)
+		{
+			sum += ms;
+		}
+		std::printf("main-loop: %dx%d, %d replayed frames after %d to warm up, %llu uniform uploads\n", width, height, frameCount, warmUpFrames,
+			(unsigned long long)uploads);
+		std::printf("  frame time mean %.3f ms, median %.3f ms, p99 %.3f ms, max %.3f ms\n", sum / frameCount, sorted[frameCount / 2],
+			sorted[frameCount * 99 / 100], sorted.back());
+		if (!IsAllocationTrackingEnabled())
+		{
+			std::printf("  allocations not counted, build with premake5 --track-allocations\n");
+			return true;
+		}
+		std::printf("  heap allocations in the steady state: %llu (%llu bytes) in %d frame(s)\n", (unsigned long long)total.allocations,
+			(unsigned long long)total.bytes, allocatingFrames);
+		return true;
+	}
+
+	// Peak signal to noise ratio of the RGB channels of an RGBA8 image against the reference in dB,
+	// infinite for identical images.
+	double Psnr(const std::vector<uint8_t>& image, const std::vector<uint8_t>& reference)
+	{
+		double squaredError = 0.0;
+		for (size_t i = 0; i < image.size(); ++i)
+		{
+			if (i % CpuRenderer::CHANNELS != 3)
+			{
+				const double difference = double(image[i]) - double(reference[i]);
+				squaredError += difference * difference;
+			}
+		}
+		const double meanSquaredError = squaredError / (image.size() / CpuRenderer::CHANNELS * 3);
+		return meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+	}
+
+	// Uniform and adaptive supersampling of the fractal scenes at the same sample budget, against
+	// a uniform reference with many samples per pixel.
+	bool AdaptiveSamplingBenchmark()
+	{
+		const int width = 128;
+		const int height = 96;
+		const int referenceSamples = 32;
+		const struct
+		{
+			const char* name;
+			Scene scene;
+			Eigen::Vector3f position;
+			Eigen::Vector3f target;
+		} views[] = {
+			{ "mandelbulb", Scene::Mandelbulb, Eigen::Vector3f(15.f, -8.f, -5.f), Eigen::Vector3f(0.f, 0.f, -25.f) },
+			{ "recursive-tetrahedron", Scene::RecursiveTetrahedron, Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero() } };
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		std::printf("adaptive-sampling: %dx%d, PSNR against %d uniform samples per pixel\n", width, height, referenceSamples);
+		for (const auto& view : views)
+		{
+			Camera camera(view.position, view.target, Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height), .01f, 10000.f);
+			camera.UpdateRayBasis();
+			CpuRenderSettings settings;
+			settings.scene = view.scene;
+			renderer.SetSettings(settings);
+
+			GBuffer gbuffer;
+			SamplePlan plan;
+			std::vector<uint8_t> reference(size_t(width) * height * CpuRenderer::CHANNELS);
+			std::vector<uint8_t> pixels(reference.size());
+			renderer.RenderGBuffer(camera.GetRayBasis(), { width, height, ImageLayout::Tiled }, gbuffer);
+			SamplingSettings sampling;
+			sampling.uniform = true;
+			sampling.budget = float(referenceSamples);
+			sampling.maxSamples = referenceSamples;
+			renderer.PlanSamples(gbuffer, sampling, plan);
+			renderer.Composite(gbuffer, nullptr, nullptr, reference.data(), &plan);
+
+			std::printf("  %s\n", view.name);
+			for (const float budget : { 1.f, 2.f, 4.f })
+			{
+				for (const bool uniform : { true, false })
+				{
+					if (budget == 1.f && !uniform)
+					{
+						continue;
+					}
+					sampling = SamplingSettings();
+					sampling.budget = budget;
+					sampling.uniform = uniform;
+					renderer.ResetStatistics();
+					const double ms = MeasureMs([&]()
+					{
+						renderer.RenderGBuffer(camera.GetRayBasis(), { width, height, ImageLayout::Tiled }, gbuffer);
+						renderer.PlanSamples(gbuffer, sampling, plan);
+						renderer.Composite(gbuffer, nullptr, nullptr, pixels.data(), &plan);
+					});
+					const double pixelCount = double(width) * height;
+					std::printf("    %-8s budget %.0f: %4.2f samples/pixel, %7.1f ms, %6.1f DE/pixel, PSNR %5.2f dB\n", uniform ? "uniform" : "adaptive",
+						budget, plan.samples / pixelCount, ms, renderer.GetDistanceEvaluations() / pixelCount, Psnr(pixels, reference));
+					if (!uniform)
+					{
+						// Pixels by their sample count, in powers of two.
+						std::printf("      scale %.1f, pixels with", plan.scale);
+						for (int low = 1; low <= sampling.maxSamples; low *= 2)
+						{
+							const int high = low == 1 ? 1 : std::min(2 * low - 1, sampling.maxSamples);
+							uint32_t count = 0;
+							for (int samples = low; samples <= high; ++samples)
+							{
+								count += plan.histogram[samples - 1];
+							}
+							if (low == high)
+							{
+								std::printf(" %d: %.1f%%", low, 100.0 * count / pixelCount);
+							}
+							else
+							{
+								std::printf(" %d-%d: %.1f%%", low, high, 100.0 * count / pixelCount);
+							}
+						}
+						std::printf("\n");
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	// Mean structural similarity of the RGB channels of an RGBA8 image to the reference, over 7x7
+	// windows around every pixel the image fully contains. 1 for identical images.
+	double Ssim(const std::vector<uint8_t>& image, const std::vector<uint8_t>& reference, const int width, const int height)
+	{
+		const int radius = 3;
+		const double c1 = (.01 * 255.0) * (.01 * 255.0);
+		const double c2 = (.03 * 255.0) * (.03 * 255.0);
+		double sum = 0.0;
+		uint64_t windows = 0;
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			for (int y = radius; y < height - radius; ++y)
+			{
+				for (int x = radius; x < width - radius; ++x)
+				{
+					double meanA = 0.0, meanB = 0.0, squaresA = 0.0, squaresB = 0.0, products = 0.0;
+					for (int dy = -radius; dy <= radius; ++dy)
+					{
+						for (int dx = -radius; dx <= radius; ++dx)
+						{
+							const size_t i = (size_t(y + dy) * width + (x + dx)) * CpuRenderer::CHANNELS + channel;
+							const double a = image[i];
+							const double b = reference[i];
+							meanA += a;
+							meanB += b;
+							squaresA += a * a;
+							squaresB += b * b;
+							products += a * b;
+						}
+					}
+					const double count = (2 * radius + 1) * (2 * radius + 1);
+					meanA /= count;
+					meanB /= count;
+					const double varianceA = squaresA / count - meanA * meanA;
+					const double varianceB = squaresB / count - meanB * meanB;
+					const double covariance = products / count - meanA * meanB;
+					sum += (2.0 * meanA * meanB + c1) * (2.0 * covariance + c2) /
+						((meanA * meanA + meanB * meanB + c1) * (varianceA + varianceB + c2));
+					++windows;
+				}
+			}
+		}
+		return windows > 0 ? sum / windows : 1.0;
+	}
+
+	// Marching the scenes at half resolution and upscaling, against marching at full resolution.
+	bool UpscaleBenchmark()
+	{
+		const int width = 320;
+		const int height = 240;
+		const int lowWidth = (width + 1) / 2;
+		const int lowHeight = (height + 1) / 2;
+		const struct
+		{
+			const char* name;
+			Scene scene;
+			Eigen::Vector3f position;
+			Eigen::Vector3f target;
+		} views[] = {
+			{ "mandelbulb", Scene::Mandelbulb, Eigen::Vector3f(15.f, -8.f, -5.f), Eigen::Vector3f(0.f, 0.f, -25.f) },
+			{ "recursive-tetrahedron", Scene::RecursiveTetrahedron, Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero() },
+			{ "spheres", Scene::Spheres, Eigen::Vector3f(0.f, 0.f, -8.f), Eigen::Vector3f::Zero() } };
+		const struct
+		{
+			const char* name;
+			UpscaleFilter filter;
+		} filters[] = { { "nearest", UpscaleFilter::Nearest }, { "bilinear", UpscaleFilter::Bilinear }, { "edge-aware", UpscaleFilter::EdgeAware } };
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		UpscalePass upscalePass(threadPool);
+		std::printf("upscale: %dx%d from %dx%d, PSNR and SSIM against the full resolution march\n", width, height, lowWidth, lowHeight);
+		for (const auto& view : views)
+		{
+			Camera camera(view.position, view.target, Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height), .01f, 10000.f);
+			camera.UpdateRayBasis();
+			CpuRenderSettings settings;
+			settings.scene = view.scene;
+			renderer.SetSettings(settings);
+
+			GBuffer gbuffer;
+			std::vector<uint8_t> reference(size_t(width) * height * CpuRenderer::CHANNELS);
+			std::vector<uint8_t> pixels(reference.size());
+			renderer.ResetStatistics();
+			const double fullMs = MeasureMs([&]()
+			{
+				renderer.RenderGBuffer(camera.GetRayBasis(), { width, height, ImageLayout::Tiled }, gbuffer);
+				renderer.Composite(gbuffer, nullptr, nullptr, reference.data());
+			});
+			const uint64_t fullEvaluations = renderer.GetDistanceEvaluations();
+
+			ImageBuffer<float> colors;
+			renderer.ResetStatistics();
+			const double lowMs = MeasureMs([&]()
+			{
+				renderer.RenderGBuffer(camera.GetRayBasis(), { lowWidth, lowHeight, ImageLayout::Tiled }, gbuffer);
+				renderer.Composite(gbuffer, nullptr, nullptr, colors);
+			});
+			const uint64_t lowEvaluations = renderer.GetDistanceEvaluations();
+
+			const double pixelCount = double(width) * height;
+			std::printf("  %s\n", view.name);
+			std::printf("    full resolution   %7.1f ms  %6.1f DE/pixel\n", fullMs, fullEvaluations / pixelCount);
+			std::printf("    half resolution   %7.1f ms  %6.1f DE/pixel\n", lowMs, lowEvaluations / pixelCount);
+			for (const auto& filter : filters)
+			{
+				const double upscaleMs = MeasureMs([&]() { upscalePass.Run(gbuffer, colors, filter.filter, width, height, pixels.data()); });
+				std::printf("      %-10s %6.2f ms  %5.1f%% of the full march, PSNR %5.2f dB, SSIM %.4f", filter.name, upscaleMs,
+					100.0 * (lowMs + upscaleMs) / fullMs, Psnr(pixels, reference), Ssim(pixels, reference, width, height));
+				if (filter.filter == UpscaleFilter::EdgeAware)
+				{
+					std::printf(", %.1f%% edge pixels", 100.0 * upscalePass.GetEdgePixels() / pixelCount);
+				}
+				std::printf("\n");
+			}
+		}
+		return true;
+	}
+
+	struct BenchmarkEntry
+	{
+		const char* name;
+		// Whether the benchmark could run.
+		bool (*function)();
+	};
+
+	const BenchmarkEntry benchmarks[] = {
+		{ "batch-render", &BatchRenderBenchmark },
+		{ "stereo", &StereoBenchmark },
+		{ "deep-zoom", &DeepZoomBenchmark },
+		{ "camera-drift", &CameraDriftBenchmark },
+		{ "async-log", &AsyncLogBenchmark },
+		{ "binary-log", &BinaryLogBenchmark },
+		{ "shader-cache", &ShaderCacheBenchmark },
+		{ "shader-preprocess", &ShaderPreprocessBenchmark },
+		{ "hot-reload", &HotReloadBenchmark },
+		{ "shader-startup", &ShaderStartupBenchmark },
+		{ "config-startup", &ConfigStartupBenchmark },
+		{ "uniform-staging", &UniformStagingBenchmark },
+		{ "scene-parameters", &SceneParametersBenchmark },
+		{ "sweep", &SweepBenchmark },
+		{ "normals", &NormalsBenchmark },
+		{ "dual-gradient", &DualGradientBenchmark },
+		{ "shadows", &ShadowsBenchmark },
+		{ "ambient-occlusion", &AmbientOcclusionBenchmark },
+		{ "gbuffer", &GBufferBenchmark },
+		{ "image-layout", &ImageLayoutBenchmark },
+		{ "arena", &ArenaBenchmark },
+		{ "main-loop", &MainLoopBenchmark },
+		{ "adaptive-sampling", &AdaptiveSamplingBenchmark },
+		{ "upscale", &UpscaleBenchmark },
+	};
+}
+
+int RunBenchmark(const std::string& name)
+{
+	for (const BenchmarkEntry& benchmark : benchmarks)
+	{
+		if (name == benchmark.name)
+		{
+			return benchmark.function() ? 0 : 1;
+		}
+	}
+
+	std::printf("Unknown benchmark '%s', available:\n", name.c_str());
+	for (const BenchmarkEntry& benchmark : benchmarks)
+	{
+		std::printf("  %s\n", benchmark.name);
+	}
+	return 1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+
+/// Runs the benchmark of the given name and prints its report to the standard output.
+/// Benchmarks only use the CPU renderer, so they run without a window or a GPU.
+/// Benchmarks only measure, the checks of the same code are in the headless tests (tests/).
+/// @returns Process exit code - 0 on success, 1 if the benchmark failed to run or does not exist.
+int RunBenchmark(const std::string& name);
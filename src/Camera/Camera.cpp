@@ -3,20 +3,23 @@
 
 #include "SceneUtils.hpp"
 
-Camera::Camera(const float aspect) :
-	position_(0.f, 0.f, 2.f),
-	target_(0.f, 0.f, 0.f),
-	up_(0.f, 1.f, 0.f),
-	zNear_(0.01f),
-	zFar_(10000.f),
-	fov_(SceneUtils::DegsToRads(60.f)),
+template <class T>
+CameraT<T>::CameraT(const T aspect) :
+	position_(T(0), T(0), T(2)),
+	target_(T(0), T(0), T(0)),
+	up_(T(0), T(1), T(0)),
+	zNear_(T(0.01)),
+	zFar_(T(10000)),
+	fov_(SceneUtils::DegsToRads(T(60))),
 	aspect_(aspect),
 	perspective_(true) {
 	UpdateViewProjectionMatrices();
+	UpdateRayBasis();
 }
 
-Camera::Camera(const Eigen::Vector3f& position, const Eigen::Vector3f& target, const Eigen::Vector3f& up, const float fov, const float aspect,
-	const float zNear, const float zFar, const bool perspective) :
+template <class T>
+CameraT<T>::CameraT(const Vector3& position, const Vector3& target, const Vector3& up, const T fov, const T aspect,
+	const T zNear, const T zFar, const bool perspective) :
 	position_(position),
 	target_(target),
 	up_(up.normalized()),
@@ -26,176 +29,305 @@ Camera::Camera(const Eigen::Vector3f& position, const Eigen::Vector3f& target, c
 	aspect_(aspect),
 	perspective_(perspective) {
 	UpdateViewProjectionMatrices();
+	UpdateRayBasis();
 }
 
-void Camera::Translate(const Eigen::Vector3f& offset) {
+template <class T>
+void CameraT<T>::Translate(const Vector3& offset) {
 	position_ += offset;
 	target_ += offset;
 	viewMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::Translate(const float dx, const float dy, const float dz) {
-	Translate(Eigen::Vector3f(dx, dy, dz));
+template <class T>
+void CameraT<T>::Translate(const T dx, const T dy, const T dz) {
+	Translate(Vector3(dx, dy, dz));
 }
 
-void Camera::TranslateLocal(const Eigen::Vector3f& offset) {
+template <class T>
+void CameraT<T>::TranslateLocal(const Vector3& offset) {
 	Translate(GetLocalToGlobalMatrix() * offset);
 }
 
-void Camera::TranslateLocal(const float dx, const float dy, const float dz) {
-	TranslateLocal(Eigen::Vector3f(dx, dy, dz));
+template <class T>
+void CameraT<T>::TranslateLocal(const T dx, const T dy, const T dz) {
+	TranslateLocal(Vector3(dx, dy, dz));
 }
 
-void Camera::Rotate(const Eigen::Vector3f& axis, const float angle) {
+template <class T>
+void CameraT<T>::Rotate(const Vector3& axis, const T angle) {
 	if (axis.isZero() || angle == 0) { return; }
 
-	const auto axisRotation = Eigen::AngleAxisf(angle, axis);
+	const auto axisRotation = Eigen::AngleAxis<T>(angle, axis);
 	target_ = axisRotation * GetForward() + position_;
 	up_ = axisRotation * up_;
 
 	viewMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::Rotate(const float x, const float y, const float z, const float angle) {
-	Rotate(Eigen::Vector3f(x, y, z), angle);
+template <class T>
+void CameraT<T>::Rotate(const T x, const T y, const T z, const T angle) {
+	Rotate(Vector3(x, y, z), angle);
 }
 
-void Camera::RotateLocal(const Eigen::Vector3f& axis, const float angle) {
+template <class T>
+void CameraT<T>::RotateLocal(const Vector3& axis, const T angle) {
 	Rotate(GetLocalToGlobalMatrix() * axis, angle);
 }
 
-void Camera::RotateLocal(const float x, const float y, const float z, const float angle) {
-	RotateLocal(Eigen::Vector3f(x, y, z), angle);
+template <class T>
+void CameraT<T>::RotateLocal(const T x, const T y, const T z, const T angle) {
+	RotateLocal(Vector3(x, y, z), angle);
 }
 
-void Camera::SetPosition(const Eigen::Vector3f& position) {
+template <class T>
+void CameraT<T>::SetPosition(const Vector3& position) {
 	position_ = position;
 	viewMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::SetPosition(const float x, const float y, const float z) {
-	SetPosition(Eigen::Vector3f(x, y, z));
+template <class T>
+void CameraT<T>::SetPosition(const T x, const T y, const T z) {
+	SetPosition(Vector3(x, y, z));
 }
 
-void Camera::SetTarget(const Eigen::Vector3f& target) {
+template <class T>
+void CameraT<T>::SetTarget(const Vector3& target) {
 	target_ = target;
 	viewMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::SetTarget(const float x, const float y, const float z) {
-	SetTarget(Eigen::Vector3f(x, y, z));
+template <class T>
+void CameraT<T>::SetTarget(const T x, const T y, const T z) {
+	SetTarget(Vector3(x, y, z));
 }
 
-void Camera::SetUp(const Eigen::Vector3f& up) {
+template <class T>
+void CameraT<T>::SetUp(const Vector3& up) {
 	up_ = up.normalized();
 	viewMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::SetUp(const float x, const float y, const float z) {
-	SetUp(Eigen::Vector3f(x, y, z));
+template <class T>
+void CameraT<T>::SetUp(const T x, const T y, const T z) {
+	SetUp(Vector3(x, y, z));
 }
 
-const Eigen::Vector3f& Camera::GetPosition() const { return position_; }
+template <class T>
+const typename CameraT<T>::Vector3& CameraT<T>::GetPosition() const { return position_; }
 
-const Eigen::Vector3f& Camera::GetTarget() const { return target_; }
+template <class T>
+const typename CameraT<T>::Vector3& CameraT<T>::GetTarget() const { return target_; }
 
-const Eigen::Vector3f& Camera::GetUpNormalized() const { return up_; }
+template <class T>
+const typename CameraT<T>::Vector3& CameraT<T>::GetUpNormalized() const { return up_; }
 
-Eigen::Vector3f Camera::GetForward() const { return target_ - position_; }
+template <class T>
+typename CameraT<T>::Vector3 CameraT<T>::GetForward() const { return target_ - position_; }
 
-Eigen::Vector3f Camera::GetForwardNormalized() const { return GetForward().normalized(); }
+template <class T>
+typename CameraT<T>::Vector3 CameraT<T>::GetForwardNormalized() const { return GetForward().normalized(); }
 
-Eigen::Vector3f Camera::GetAsideNormalized() const { return GetForwardNormalized().cross(up_).normalized(); }
+template <class T>
+typename CameraT<T>::Vector3 CameraT<T>::GetAsideNormalized() const { return GetForwardNormalized().cross(up_).normalized(); }
 
-void Camera::SetPerspective(const bool perspective) {
+template <class T>
+void CameraT<T>::SetPerspective(const bool perspective) {
 	perspective_ = perspective;
 	projectionMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::SetFrustum(const float fov, const float aspect, const float zNear, const float zFar) {
+template <class T>
+void CameraT<T>::SetFrustum(const T fov, const T aspect, const T zNear, const T zFar) {
 	fov_ = SceneUtils::DegsToRads(fov);
 	aspect_ = aspect;
 	zNear_ = zNear;
 	zFar_ = zFar;
 	projectionMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::SetAspect(const float aspect) {
+template <class T>
+void CameraT<T>::SetAspect(const T aspect) {
 	aspect_ = aspect;
 	projectionMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::SetNearFar(const float zNear, const float zFar) {
+template <class T>
+void CameraT<T>::SetNearFar(const T zNear, const T zFar) {
 	zNear_ = zNear;
 	zFar_ = zFar;
 	projectionMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::SetNear(const float zNear) {
+template <class T>
+void CameraT<T>::SetNear(const T zNear) {
 	zNear_ = zNear;
 	projectionMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::SetFar(const float zFar) {
+template <class T>
+void CameraT<T>::SetFar(const T zFar) {
 	zFar_ = zFar;
 	projectionMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-void Camera::SetFov(const float fov) {
+template <class T>
+void CameraT<T>::SetFov(const T fov) {
 	fov_ = SceneUtils::DegsToRads(fov);
 	projectionMatrixDirty_ = true;
+	rayBasisDirty_ = true;
 }
 
-bool Camera::GetPerspective() const { return perspective_; }
+template <class T>
+bool CameraT<T>::GetPerspective() const { return perspective_; }
 
-float Camera::GetAspect() const { return aspect_; }
+template <class T>
+T CameraT<T>::GetAspect() const { return aspect_; }
 
-float Camera::GetNear() const { return zNear_; }
+template <class T>
+T CameraT<T>::GetNear() const { return zNear_; }
 
-float Camera::GetFar() const { return zFar_; }
+template <class T>
+T CameraT<T>::GetFar() const { return zFar_; }
 
-float Camera::GetFov() const { return SceneUtils::RadsToDegs(fov_); }
+template <class T>
+T CameraT<T>::GetFov() const { return SceneUtils::RadsToDegs(fov_); }
 
-void Camera::UpdateViewProjectionMatrices() {
+template <class T>
+void CameraT<T>::UpdateViewProjectionMatrices() {
 	UpdateViewMatrix();
 	UpdateProjectionMatrix();
 }
 
-const Eigen::Matrix4f& Camera::GetViewMatrix() const { return viewMatrix_; }
+template <class T>
+const typename CameraT<T>::Matrix4& CameraT<T>::GetViewMatrix() const { return viewMatrix_; }
 
-const Eigen::Matrix4f& Camera::GetProjectionMatrix() const { return projectionMatrix_; }
+template <class T>
+const typename CameraT<T>::Matrix4& CameraT<T>::GetProjectionMatrix() const { return projectionMatrix_; }
 
-Eigen::Matrix4f Camera::GetViewProjectionInverseMatrix() const {
+template <class T>
+typename CameraT<T>::Matrix4 CameraT<T>::GetViewProjectionInverseMatrix() const {
 	return (projectionMatrix_ * viewMatrix_).inverse();
 }
 
-Eigen::Matrix3f Camera::GetLocalToGlobalMatrix() const {
+template <class T>
+void CameraT<T>::UpdateRayBasis() {
+	if (!rayBasisDirty_) { return; }
+
+	// Same orthonormal frame as SceneUtils::LookAt builds.
+	const Vector3 forward = GetForwardNormalized();
+	const Vector3 aside = forward.cross(up_).normalized();
+	const Vector3 up = aside.cross(forward);
+
+	if (perspective_) {
+		// Distance of the NDC z = 0 plane from the eye along the forward axis.
+		const T depth = T(2) * zFar_ * zNear_ / (zFar_ + zNear_);
+		const T halfHeight = depth * std::tan(fov_ * T(.5));
+		const T halfWidth = halfHeight * aspect_;
+
+		rayBasis_.origin0 = position_;
+		rayBasis_.originHorizontal.setZero();
+		rayBasis_.originVertical.setZero();
+		rayBasis_.ray0 = depth * forward - halfWidth * aside - halfHeight * up;
+		rayBasis_.horizontal = T(2) * halfWidth * aside;
+		rayBasis_.vertical = T(2) * halfHeight * up;
+	}
+	else {
+		const T scale = T(SceneUtils::ORTHOGRAPHIC_SCALE);
+		const T depth = (zFar_ + zNear_) / scale;
+		const T halfHeight = T(2) / scale;
+		const T halfWidth = halfHeight * aspect_;
+
+		rayBasis_.origin0 = position_ - halfWidth * aside - halfHeight * up;
+		rayBasis_.originHorizontal = T(2) * halfWidth * aside;
+		rayBasis_.originVertical = T(2) * halfHeight * up;
+		rayBasis_.ray0 = depth * forward;
+		rayBasis_.horizontal.setZero();
+		rayBasis_.vertical.setZero();
+	}
+
+	rayBasisDirty_ = false;
+}
+
+template <class T>
+const typename CameraT<T>::RayBasis& CameraT<T>::GetRayBasis() const { return rayBasis_; }
+
+template <class T>
+T CameraT<T>::MeasureRayBasisError() {
+	UpdateViewProjectionMatrices();
+	UpdateRayBasis();
+	const Matrix4 inverseViewProjectionMatrix = GetViewProjectionInverseMatrix();
+
+	const T points[5][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 }, { T(.5), T(.5) } };
+	T error = 0;
+	for (const auto& point : points) {
+		Eigen::Matrix<T, 4, 1> expected = inverseViewProjectionMatrix * Eigen::Matrix<T, 4, 1>(point[0] * 2 - 1, point[1] * 2 - 1, 0, 1);
+		expected /= expected.w();
+
+		const Vector3 origin = rayBasis_.origin0 + point[0] * rayBasis_.originHorizontal + point[1] * rayBasis_.originVertical;
+		const Vector3 direction = rayBasis_.ray0 + point[0] * rayBasis_.horizontal + point[1] * rayBasis_.vertical;
+		const T distance = (origin + direction - expected.template head<3>()).norm();
+		error = std::max(error, distance / std::max(T(1), expected.template head<3>().norm()));
+	}
+	return error;
+}
+
+template <class T>
+CameraRayBasis<float> CameraT<T>::GetFloatRayBasis(const Vector3& reference) const {
+	CameraRayBasis<float> floatRayBasis;
+	floatRayBasis.origin0 = (rayBasis_.origin0 - reference).template cast<float>();
+	floatRayBasis.originHorizontal = rayBasis_.originHorizontal.template cast<float>();
+	floatRayBasis.originVertical = rayBasis_.originVertical.template cast<float>();
+	floatRayBasis.ray0 = rayBasis_.ray0.template cast<float>();
+	floatRayBasis.horizontal = rayBasis_.horizontal.template cast<float>();
+	floatRayBasis.vertical = rayBasis_.vertical.template cast<float>();
+	return floatRayBasis;
+}
+
+template <class T>
+typename CameraT<T>::Matrix3 CameraT<T>::GetLocalToGlobalMatrix() const {
 	const auto aside = GetAsideNormalized();
 	const auto up = GetUpNormalized();
 	const auto forward = GetForwardNormalized();
 
-	Eigen::Matrix3f m;
+	Matrix3 m;
 	m << aside, up, forward;
 
 	return m;
 }
 
-void Camera::UpdateViewMatrix() {
+template <class T>
+void CameraT<T>::UpdateViewMatrix() {
 	if (!viewMatrixDirty_) { return; }
 
-	viewMatrix_ = SceneUtils::LookAt<float>(position_, target_, up_);
+	viewMatrix_ = SceneUtils::LookAt<T>(position_, target_, up_);
 	viewMatrixDirty_ = false;
 }
 
-void Camera::UpdateProjectionMatrix() {
+template <class T>
+void CameraT<T>::UpdateProjectionMatrix() {
 	if (!projectionMatrixDirty_) { return; }
 
 	if (perspective_) {
-		projectionMatrix_ = SceneUtils::Perspective<float>(fov_, aspect_, zNear_, zFar_);
+		projectionMatrix_ = SceneUtils::Perspective<T>(fov_, aspect_, zNear_, zFar_);
 	}
 	else {
-		projectionMatrix_ = SceneUtils::Orthographic<float>(aspect_, zNear_, zFar_);
+		projectionMatrix_ = SceneUtils::Orthographic<T>(aspect_, zNear_, zFar_);
 	}
 
 	projectionMatrixDirty_ = false;
 }
+
+template class CameraT<float>;
+template class CameraT<double>;
@@ -2,15 +2,44 @@
 
 #include <Eigen/Dense>
 
+/// Ray parametrization of the image plane, built directly from the camera parameters.
+/// For a pixel at normalized coordinates (x, y) in [0, 1] x [0, 1] the ray starts at
+/// origin0 + x * originHorizontal + y * originVertical and points along
+/// ray0 + x * horizontal + y * vertical. The direction is not normalized - origin plus
+/// direction lands on the same point as unprojecting the NDC point (2x - 1, 2y - 1, 0)
+/// with the inverse view-projection matrix.
+/// Perspective cameras share one origin (the position), orthographic cameras share one
+/// direction (forward).
+template <class T>
+struct CameraRayBasis {
+    Eigen::Matrix<T, 3, 1> origin0;
+    Eigen::Matrix<T, 3, 1> originHorizontal;
+    Eigen::Matrix<T, 3, 1> originVertical;
+    Eigen::Matrix<T, 3, 1> ray0;
+    Eigen::Matrix<T, 3, 1> horizontal;
+    Eigen::Matrix<T, 3, 1> vertical;
+};
+
 /// Represents the camera used to render the scene.
         /// The camera can be transformed and allows access to the transforamtion matrices.
-class Camera {
+/// The scalar type T (float or double) is used for all of the camera's state, double keeps
+/// long sequences of incremental transformations and large coordinates from drifting.
+template <class T>
+class CameraT {
 public:
-    virtual ~Camera() = default;
+    using Scalar = T;
+    using Vector3 = Eigen::Matrix<T, 3, 1>;
+    using Matrix3 = Eigen::Matrix<T, 3, 3>;
+    using Matrix4 = Eigen::Matrix<T, 4, 4>;
+
+    /// Ray parametrization of the image plane, see CameraRayBasis.
+    using RayBasis = CameraRayBasis<T>;
+
+    virtual ~CameraT() = default;
 
     /// Creates camera with default values in all parameters - does not represent a usable
     /// camera object.
-    Camera(float aspect);
+    CameraT(T aspect);
 
     /// Creates a camera with the given parameters.
     /// @param position Position of the camera
@@ -21,69 +50,69 @@ public:
     /// @param zNear Near clipping distance of the camera
     /// @param zFar Far clipping distance of the camera
     /// @param perspective Whether the camera is perspective(true) or orthographic(false)
-    Camera(const Eigen::Vector3f& position, const Eigen::Vector3f& target, const Eigen::Vector3f& up, float fov, float aspect, float zNear, float zFar, bool perspective = true);
+    CameraT(const Vector3& position, const Vector3& target, const Vector3& up, T fov, T aspect, T zNear, T zFar, bool perspective = true);
 
     /// Translates the camera by the offset given as a 3D vector.
     /// Moves both the camera itself and its corresponding target point.
-    void Translate(const Eigen::Vector3f& offset);
+    void Translate(const Vector3& offset);
     /// Translates the camera by the offset vector (dx, dy, dz).
     /// Moves both the camera itself and its corresponding target point.
-    void Translate(float dx, float dy, float dz);
+    void Translate(T dx, T dy, T dz);
 
     /// Translates the camera by an offset given as 3D vector in the local frame of the camera.
     /// Moves both the camera itself and its corresponding target point.
-    void TranslateLocal(const Eigen::Vector3f& offset);
+    void TranslateLocal(const Vector3& offset);
     /// Translates the camera by the vector (dx,dy,dz) in the local frame of the camera.
     /// Moves both the camera itself and its corresponding target point.
-    void TranslateLocal(float dx, float dy, float dz);
+    void TranslateLocal(T dx, T dy, T dz);
 
     /// Rotates the camera around the specified axis by an angle specified in radians.
-    void Rotate(const Eigen::Vector3f& axis, float angle);
+    void Rotate(const Vector3& axis, T angle);
     /// Rotates the camera around the specified axis given by vector (x,y,z) by an angle
     /// specified in radians.
-    void Rotate(float x, float y, float z, float angle);
+    void Rotate(T x, T y, T z, T angle);
 
     /// Rotates the camera around the specified axis by an angle specified in radians in
     /// the local frame of the camera.
-    void RotateLocal(const Eigen::Vector3f& axis, float angle);
+    void RotateLocal(const Vector3& axis, T angle);
     /// Rotates the camera around the axis given as vector (x,y,z) by an angle specified in
     /// radians in the local frame of the camera.
-    void RotateLocal(float x, float y, float z, float angle);
+    void RotateLocal(T x, T y, T z, T angle);
 
     /// Sets the position of the camera in (position, target, up) camera configuration.
-    void SetPosition(const Eigen::Vector3f& position);
+    void SetPosition(const Vector3& position);
     /// Sets the position of the camera in (position, target, up) camera configuration.
-    void SetPosition(float x, float y, float z);
+    void SetPosition(T x, T y, T z);
 
     /// Sets the target point of the camera in (position, target, up) camera configuration.
-    void SetTarget(const Eigen::Vector3f& target);
+    void SetTarget(const Vector3& target);
     /// Sets the target point of the camera in (position, target, up) camera configuration.
-    void SetTarget(float x, float y, float z);
+    void SetTarget(T x, T y, T z);
 
     /// Sets the up vector of the camera in (position, target, up) camera configuration.
-    void SetUp(const Eigen::Vector3f& up);
+    void SetUp(const Vector3& up);
     /// Sets the up vector of the camera in (position, target, up) camera configuration.
-    void SetUp(float x, float y, float z);
+    void SetUp(T x, T y, T z);
 
     /// Getter for the position of the camera in the (position, target, up) camera configuration.
-    const Eigen::Vector3f& GetPosition() const;
+    const Vector3& GetPosition() const;
 
     /// Getter for the target point of the camera in (position, target, up) camera configuration.
-    const Eigen::Vector3f& GetTarget() const;
+    const Vector3& GetTarget() const;
 
     /// Getter for the up vector in the (position, target, up) camera configuration.
-    const Eigen::Vector3f& GetUpNormalized() const;
+    const Vector3& GetUpNormalized() const;
 
     /// Getter for the forward vector of the camera.
     /// The forward vector is defined as target - position
-    Eigen::Vector3f GetForward() const;
+    Vector3 GetForward() const;
 
     /// Getter for the normalized version of the forward vector.
     /// The forward vector is defined as target-position
-    Eigen::Vector3f GetForwardNormalized() const;
+    Vector3 GetForwardNormalized() const;
 
     /// Getter for the cross product of the forward vector and the up vector => (right) side vector
-    Eigen::Vector3f GetAsideNormalized() const;
+    Vector3 GetAsideNormalized() const;
 
     /// Sets whether the camera is perspective or orthographic.
     /// @param perspective Whether the camera is perspective. True value means the camera
@@ -95,72 +124,94 @@ public:
     /// @param aspect The aspect ratio of the camera frustum
     /// @param zNear Near distance of the camera frustum.
     /// @param zFar Far distance of the camera frustum.
-    void SetFrustum(float fov, float aspect, float zNear, float zFar);
+    void SetFrustum(T fov, T aspect, T zNear, T zFar);
 
     /// Sets the aspect ratio of the camera.
-    void SetAspect(float aspect);
+    void SetAspect(T aspect);
 
     /// Sets the near and far distances of the camera frustum.
-    void SetNearFar(float zNear, float zFar);
+    void SetNearFar(T zNear, T zFar);
 
     /// Sets the near distance of the camera frustum.
-    void SetNear(float zNear);
+    void SetNear(T zNear);
 
     /// Sets the far distance of the camera frustum
-    void SetFar(float zFar);
+    void SetFar(T zFar);
 
     /// Sets the field of view of the camera in degrees.
     /// @param fov Vertical field of view of the camera.
-    void SetFov(float fov);
+    void SetFov(T fov);
 
     /// Getter which returns whether the camera is perspective or orthographic.
     /// @returns True if the camera is perspective, false otherwise(orthographic)
     bool GetPerspective() const;
 
     /// Getter for the aspect ratio of the camera.
-    float GetAspect() const;
+    T GetAspect() const;
 
     /// Getter for the near distance of the camera frustum.
-    float GetNear() const;
+    T GetNear() const;
 
     /// Getter for the far distance of the camera frustum.
-    float GetFar() const;
+    T GetFar() const;
 
     /// Getter for the field of view of the camera.
     /// @returns Fielf o view in degrees.
-    float GetFov() const;
+    T GetFov() const;
 
     /// Updates view and projection matrices based on the current camera settings.
     void UpdateViewProjectionMatrices();
 
     /// Returns the lookAt camera matrix.
-    const Eigen::Matrix4f& GetViewMatrix() const;
+    const Matrix4& GetViewMatrix() const;
 
     /// Returns the projection matrix of the camera computed with the cameras frustum parameters.
-    const Eigen::Matrix4f& GetProjectionMatrix() const;
+    const Matrix4& GetProjectionMatrix() const;
 
     /// Returns the inverse of projection and view matrix multiplication.
-    Eigen::Matrix4f GetViewProjectionInverseMatrix() const;
+    Matrix4 GetViewProjectionInverseMatrix() const;
+
+    /// Updates the ray basis based on the current camera settings.
+    /// Does not need the view and projection matrices and does not invert anything.
+    void UpdateRayBasis();
+
+    /// Returns the ray basis computed by the last call to UpdateRayBasis().
+    const RayBasis& GetRayBasis() const;
+
+    /// Checks the ray basis against unprojecting NDC points with the inverse view-projection
+    /// matrix - the way the basis used to be computed. Updates both.
+    /// @returns Largest distance between the points of the two at the corners and the center of
+    ///          the image, relative to their distance from the world origin (at least 1).
+    T MeasureRayBasisError();
+
+    /// Returns the ray basis converted to float for upload to the GPU.
+    /// Positions are made relative to the given reference point before the conversion, so a
+    /// double camera far from the origin keeps its precision when the shader works relative
+    /// to the same point.
+    CameraRayBasis<float> GetFloatRayBasis(const Vector3& reference = Vector3::Zero()) const;
 
 private:
-    Eigen::Vector3f position_;
-    Eigen::Vector3f target_;
-    Eigen::Vector3f up_;
+    Vector3 position_;
+    Vector3 target_;
+    Vector3 up_;
 
-    float zNear_;
-    float zFar_;
-    float fov_;
-    float aspect_;
+    T zNear_;
+    T zFar_;
+    T fov_;
+    T aspect_;
 
-    Eigen::Matrix4f viewMatrix_;
-    Eigen::Matrix4f projectionMatrix_;
+    Matrix4 viewMatrix_;
+    Matrix4 projectionMatrix_;
+
+    RayBasis rayBasis_;
 
     bool viewMatrixDirty_ = true;
     bool projectionMatrixDirty_ = true;
+    bool rayBasisDirty_ = true;
 
     bool perspective_;
 
-    Eigen::Matrix3f GetLocalToGlobalMatrix() const;
+    Matrix3 GetLocalToGlobalMatrix() const;
 
     /// Creates the lookAt matrix.
     void UpdateViewMatrix();
@@ -168,3 +219,6 @@ private:
     /// Creates projection matrix.
     void UpdateProjectionMatrix();
 };
+
+using Camera = CameraT<float>;
+using CameraDouble = CameraT<double>;
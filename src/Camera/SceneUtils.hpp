@@ -1,13 +1,21 @@
 #pragma once
 
+#include "Camera.hpp"
+
 #include <Eigen/Dense>
 
+#include <algorithm>
+
 /// Static class with utility methods for handling scene objects.
 class SceneUtils {
 public:
     /// Epsilon value used to define equality for floating point numbers.
     static constexpr float FLOAT_EPSILON = 0.0001f;
 
+    /// Zoom factor of the orthographic projection - the view volume is 2 * aspect / scale
+    /// units wide and 2 / scale units high.
+    static constexpr float ORTHOGRAPHIC_SCALE = 7.f;
+
     /// Creates perspective camera matrix out of the camera frustum parameters passed as arguments to
     /// the function.
     /// @param fovy Vertical field of view of the camera given in radians
@@ -53,7 +61,7 @@ public:
         const float bottom = -1;
         const float right = top * aspect;
         const float left = bottom * aspect;
-        const float scale = 7;
+        const float scale = ORTHOGRAPHIC_SCALE;
         Matrix4     res;
         res << scale / (right - left), 0, 0, -(right + left) / (right - left),
             0, scale / (top - bottom), 0, -(top + bottom) / (top - bottom),
@@ -165,6 +173,63 @@ public:
         return rotationZ * rotationY * rotationX;
     }
 
+    /// Finds the normalized image coordinates (u, v) of the pixel whose ray passes through the
+    /// point - the inverse of the ray basis.
+    /// @returns Whether the point is in front of the camera and within the image.
+    template <class T>
+    static bool ProjectToImage(
+        const CameraRayBasis<T>& basis,
+        const Eigen::Matrix<T, 3, 1>& point,
+        T& u,
+        T& v) {
+        using Matrix3 = Eigen::Matrix<T, 3, 3>;
+        using Vector3 = Eigen::Matrix<T, 3, 1>;
+
+        Matrix3 system;
+        if (basis.originHorizontal.isZero()) {
+            // Perspective: point - origin0 = s * (ray0 + u * horizontal + v * vertical).
+            system << basis.ray0, basis.horizontal, basis.vertical;
+            const Vector3 solution = system.partialPivLu().solve(Vector3(point - basis.origin0));
+            if (!(solution.x() > T(0))) {
+                return false;
+            }
+            u = solution.y() / solution.x();
+            v = solution.z() / solution.x();
+        }
+        else {
+            // Orthographic: point - origin0 = u * originHorizontal + v * originVertical + s * ray0.
+            system << basis.originHorizontal, basis.originVertical, basis.ray0;
+            const Vector3 solution = system.partialPivLu().solve(Vector3(point - basis.origin0));
+            u = solution.x();
+            v = solution.y();
+        }
+
+        // Points seen by the border pixels land a rounding error outside of the image.
+        const T margin = T(1e-4);
+        return u >= -margin && u <= T(1) + margin && v >= -margin && v <= T(1) + margin;
+    }
+
+    /// Distance between the surface points seen by neighbouring pixels - the size of a pixel at
+    /// the surface point - for the pixel at the normalized image coordinates (u, v).
+    /// @param distance Distance of the surface point from the origin of the ray, along the ray.
+    /// @param height Height of the image in pixels.
+    template <class T>
+    static T PixelFootprint(
+        const CameraRayBasis<T>& basis,
+        T u,
+        T v,
+        T distance,
+        int height) {
+        const T pixels = T(std::max(height - 1, 1));
+        if (!basis.originHorizontal.isZero()) {
+            // Orthographic: parallel rays, as far apart as their origins.
+            return basis.originVertical.norm() / pixels;
+        }
+        // Perspective: the rays spread with the distance.
+        const Eigen::Matrix<T, 3, 1> ray = basis.ray0 + u * basis.horizontal + v * basis.vertical;
+        return distance * basis.vertical.norm() / (ray.norm() * pixels);
+    }
+
     /// Converts angle given in degrees into angle in radians.
     template <class T>
     static T DegsToRads(T degrees) {
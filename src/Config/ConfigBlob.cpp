@@ -0,0 +1,409 @@
+#include "ConfigBlob.hpp"
+#include "../Filesystem/Filesystem.hpp"
+#include "../Filesystem/Hash.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+namespace
+{
+	// Deeper documents are not copied into a YamlNode.
+	constexpr uint32_t MAX_DEPTH = 256;
+
+	// A file written within this long before its blob was compiled may have been written again
+	// without changing its timestamp, FAT has a resolution of two seconds.
+	const int64_t RACY_TICKS = std::chrono::duration_cast<std::filesystem::file_time_type::duration>(std::chrono::seconds(2)).count();
+
+	int64_t GetFileClockTicks()
+	{
+		return std::filesystem::file_time_type::clock::now().time_since_epoch().count();
+	}
+
+	bool GetFileStamp(const std::string& path, uint64_t& size, int64_t& time)
+	{
+		std::error_code fileError;
+		size = std::filesystem::file_size(path, fileError);
+		if (fileError)
+		{
+			return false;
+		}
+		time = std::filesystem::last_write_time(path, fileError).time_since_epoch().count();
+		return !fileError;
+	}
+
+	// The blob is a cache, a config is loaded even if its blob can not be written.
+	void WriteBlob(const std::string& blobDirectory, const std::string& blobPath, const std::string& serialized)
+	{
+		std::error_code fileError;
+		std::filesystem::create_directories(blobDirectory, fileError);
+		WriteFileAtomically(blobPath, serialized);
+	}
+}
+
+std::string ConfigBlob::Serialize(const YamlNode& root, const uint64_t sourceHash, const uint64_t sourceSize, const int64_t sourceTime)
+{
+	std::vector<Node> table;
+	std::string pool;
+	std::map<std::string, uint32_t> offsets;
+	const auto addString = [&pool, &offsets](const std::string& text)
+	{
+		const auto known = offsets.find(text);
+		if (known != offsets.end())
+		{
+			return known->second;
+		}
+		const uint32_t offset = uint32_t(pool.size());
+		pool += text;
+		offsets.emplace(text, offset);
+		return offset;
+	};
+
+	// Breadth first, so the children of every node get consecutive indices.
+	std::vector<const YamlNode*> queue = { &root };
+	table.push_back(Node{});
+	for (size_t i = 0; i < queue.size(); ++i)
+	{
+		const YamlNode& node = *queue[i];
+		Node entry = table[i];
+		entry.type = uint8_t(node.GetType());
+		entry.scalarOffset = addString(node.GetScalar());
+		entry.scalarLength = uint32_t(node.GetScalar().size());
+		entry.firstChild = uint32_t(table.size());
+
+		if (node.GetType() == YamlNode::Type::Sequence)
+		{
+			for (const YamlNode& item : node.GetItems())
+			{
+				table.push_back(Node{});
+				queue.push_back(&item);
+			}
+			entry.childCount = uint32_t(node.GetItems().size());
+		}
+		else if (node.GetType() == YamlNode::Type::Mapping)
+		{
+			for (const auto& child : node.GetEntries())
+			{
+				Node childEntry{};
+				childEntry.keyOffset = addString(child.first);
+				childEntry.keyLength = uint32_t(child.first.size());
+				table.push_back(childEntry);
+				queue.push_back(&child.second);
+			}
+			entry.childCount = uint32_t(node.GetEntries().size());
+		}
+		table[i] = entry;
+	}
+
+	Header header{};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+	header.compileTime = GetFileClockTicks();
+	header.nodeCount = uint32_t(table.size());
+	header.stringBytes = uint32_t(pool.size());
+
+	std::string blob(sizeof(Header) + table.size() * sizeof(Node) + pool.size(), '\0');
+	std::memcpy(&blob[0], &header, sizeof(Header));
+	std::memcpy(&blob[sizeof(Header)], table.data(), table.size() * sizeof(Node));
+	std::memcpy(&blob[sizeof(Header) + table.size() * sizeof(Node)], pool.data(), pool.size());
+	return blob;
+}
+
+uint64_t ConfigBlob::HashSource(const std::string& text)
+{
+	const uint32_t version = VERSION;
+	return HashString(text, HashBytes(&version, sizeof(version)));
+}
+
+bool ConfigBlob::Open(const std::string& path, std::string& error)
+{
+	Close();
+	if (!file.Open(path, error))
+	{
+		return false;
+	}
+	if (!Attach(file.GetData(), file.GetSize(), path, error))
+	{
+		file.Close();
+		return false;
+	}
+	return true;
+}
+
+bool ConfigBlob::Assign(std::string serialized, std::string& error)
+{
+	Close();
+	owned = std::move(serialized);
+	if (!Attach(reinterpret_cast<const uint8_t*>(owned.data()), owned.size(), "the compiled config", error))
+	{
+		owned.clear();
+		return false;
+	}
+	return true;
+}
+
+void ConfigBlob::Close()
+{
+	header = nullptr;
+	nodes = nullptr;
+	strings = nullptr;
+	file.Close();
+	owned.clear();
+}
+
+bool ConfigBlob::Attach(const uint8_t* data, const size_t size, const std::string& name, std::string& error)
+{
+	const Header* candidate = reinterpret_cast<const Header*>(data);
+	if (size < sizeof(Header) || candidate->magic != MAGIC || candidate->version != VERSION ||
+		size != sizeof(Header) + uint64_t(candidate->nodeCount) * sizeof(Node) + candidate->stringBytes ||
+		candidate->nodeCount == 0)
+	{
+		error = name + " is not a config blob of version " + std::to_string(VERSION);
+		return false;
+	}
+
+	// Checked once here, so nodes can be read without bounds checks while the blob is open.
+	// Children always follow their parent, which rules out cycles.
+	const Node* table = reinterpret_cast<const Node*>(data + sizeof(Header));
+	for (uint32_t i = 0; i < candidate->nodeCount; ++i)
+	{
+		const Node& entry = table[i];
+		const bool container = entry.type == uint8_t(YamlNode::Type::Sequence) || entry.type == uint8_t(YamlNode::Type::Mapping);
+		if (entry.type > uint8_t(YamlNode::Type::Mapping) ||
+			uint64_t(entry.scalarOffset) + entry.scalarLength > candidate->stringBytes ||
+			uint64_t(entry.keyOffset) + entry.keyLength > candidate->stringBytes ||
+			(entry.childCount > 0 && (!container || entry.firstChild <= i ||
+				uint64_t(entry.firstChild) + entry.childCount > candidate->nodeCount)))
+		{
+			error = name + " has a malformed node " + std::to_string(i);
+			return false;
+		}
+	}
+
+	header = candidate;
+	nodes = table;
+	strings = reinterpret_cast<const char*>(data + sizeof(Header) + header->nodeCount * sizeof(Node));
+	return true;
+}
+
+uint64_t ConfigBlob::GetSourceHash() const
+{
+	return header ? header->sourceHash : 0;
+}
+
+bool ConfigBlob::IsCurrent(const uint64_t sourceSize, const int64_t sourceTime) const
+{
+	return header && header->sourceSize == sourceSize && header->sourceTime == sourceTime &&
+		sourceTime + RACY_TICKS < header->compileTime;
+}
+
+std::string ConfigBlob::Restamp(const uint64_t sourceSize, const int64_t sourceTime) const
+{
+	if (!header)
+	{
+		return std::string();
+	}
+	std::string blob(reinterpret_cast<const char*>(header), sizeof(Header) + header->nodeCount * sizeof(Node) + header->stringBytes);
+	Header stamp = *header;
+	stamp.sourceSize = sourceSize;
+	stamp.sourceTime = sourceTime;
+	stamp.compileTime = GetFileClockTicks();
+	std::memcpy(&blob[0], &stamp, sizeof(Header));
+	return blob;
+}
+
+ConfigNode ConfigBlob::GetRoot() const
+{
+	return header ? ConfigNode(nodes, strings, 0) : ConfigNode();
+}
+
+ConfigNode::ConfigNode(const ConfigBlob::Node* nodes, const char* strings, const uint32_t index)
+	: nodes(nodes), strings(strings), index(index)
+{
+}
+
+ConfigNode::operator bool() const
+{
+	return nodes != nullptr;
+}
+
+YamlNode::Type ConfigNode::GetType() const
+{
+	return nodes ? YamlNode::Type(nodes[index].type) : YamlNode::Type::Null;
+}
+
+bool ConfigNode::IsNull() const
+{
+	return GetType() == YamlNode::Type::Null;
+}
+
+std::string_view ConfigNode::GetScalar() const
+{
+	if (!nodes)
+	{
+		return std::string_view();
+	}
+	return std::string_view(strings + nodes[index].scalarOffset, nodes[index].scalarLength);
+}
+
+uint32_t ConfigNode::GetChildCount() const
+{
+	return nodes ? nodes[index].childCount : 0;
+}
+
+ConfigNode ConfigNode::GetChild(const uint32_t child) const
+{
+	return ConfigNode(nodes, strings, nodes[index].firstChild + child);
+}
+
+std::string_view ConfigNode::GetKey(const uint32_t child) const
+{
+	const ConfigBlob::Node& entry = nodes[nodes[index].firstChild + child];
+	return std::string_view(strings + entry.keyOffset, entry.keyLength);
+}
+
+ConfigNode ConfigNode::Find(const std::string_view key) const
+{
+	if (GetType() != YamlNode::Type::Mapping)
+	{
+		return ConfigNode();
+	}
+	for (uint32_t i = 0; i < nodes[index].childCount; ++i)
+	{
+		if (GetKey(i) == key)
+		{
+			return GetChild(i);
+		}
+	}
+	return ConfigNode();
+}
+
+bool ConfigNode::ToYaml(YamlNode& node, std::string& error) const
+{
+	return ToYaml(node, 0, error);
+}
+
+bool ConfigNode::ToYaml(YamlNode& node, const uint32_t depth, std::string& error) const
+{
+	if (depth > MAX_DEPTH)
+	{
+		error = "the config is nested deeper than " + std::to_string(MAX_DEPTH) + " levels";
+		return false;
+	}
+
+	const YamlNode::Type type = GetType();
+	switch (type)
+	{
+	case YamlNode::Type::Null:
+		node = YamlNode();
+		return true;
+	case YamlNode::Type::Scalar:
+		node = YamlNode(std::string(GetScalar()));
+		return true;
+	case YamlNode::Type::Sequence:
+		node = YamlNode(type);
+		node.GetItems().resize(GetChildCount());
+		for (uint32_t i = 0; i < GetChildCount(); ++i)
+		{
+			if (!GetChild(i).ToYaml(node.GetItems()[i], depth + 1, error))
+			{
+				return false;
+			}
+		}
+		return true;
+	case YamlNode::Type::Mapping:
+		node = YamlNode(type);
+		node.GetEntries().resize(GetChildCount());
+		for (uint32_t i = 0; i < GetChildCount(); ++i)
+		{
+			node.GetEntries()[i].first = std::string(GetKey(i));
+			if (!GetChild(i).ToYaml(node.GetEntries()[i].second, depth + 1, error))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+bool LoadCompiledConfig(const std::string& yamlPath, const std::string& blobDirectory,
+	bool (*validate)(const ConfigNode& root, std::string& error), ConfigBlob& blob, std::string& error, bool* fromBlob)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if (!GetFileStamp(yamlPath, sourceSize, sourceTime))
+	{
+		error = "cannot open " + yamlPath;
+		return false;
+	}
+
+	// One blob per config file, configs of the same name in different directories do not collide.
+	const std::string source = NormalizePath(yamlPath);
+	const std::string blobPath = (std::filesystem::path(blobDirectory) /
+		(std::filesystem::path(source).stem().string() + '-' + HashToString(HashString(source)) + ".rmcb")).string();
+
+	std::string blobError;
+	bool compiled = false;
+	if (!blob.Open(blobPath, blobError) || !blob.IsCurrent(sourceSize, sourceTime))
+	{
+		std::ifstream file(yamlPath, std::ios_base::binary | std::ios_base::ate);
+		std::string text(file ? size_t(file.tellg()) : 0, '\0');
+		if (!file || !file.seekg(0).read(&text[0], std::streamsize(text.size())))
+		{
+			blob.Close();
+			error = "cannot read " + yamlPath;
+			return false;
+		}
+
+		const uint64_t sourceHash = ConfigBlob::HashSource(text);
+		if (blob.GetSourceHash() == sourceHash)
+		{
+			// Touched without changing the text. Stamped again once the new stamp can be trusted,
+			// until then the text is compared on every load.
+			if (sourceTime + RACY_TICKS < GetFileClockTicks())
+			{
+				std::string restamped = blob.Restamp(sourceSize, sourceTime);
+				// Closed before the new blob replaces the mapped one.
+				blob.Close();
+				WriteBlob(blobDirectory, blobPath, restamped);
+				blob.Assign(std::move(restamped), blobError);
+			}
+		}
+		else
+		{
+			YamlNode root;
+			if (!YamlNode::Parse(text, root, error))
+			{
+				blob.Close();
+				error = yamlPath + ", " + error;
+				return false;
+			}
+			std::string serialized = ConfigBlob::Serialize(root, sourceHash, sourceSize, sourceTime);
+			blob.Close();
+			WriteBlob(blobDirectory, blobPath, serialized);
+			if (!blob.Assign(std::move(serialized), error))
+			{
+				return false;
+			}
+			compiled = true;
+		}
+	}
+	if (fromBlob)
+	{
+		*fromBlob = !compiled;
+	}
+
+	if (validate && !validate(blob.GetRoot(), error))
+	{
+		blob.Close();
+		error = yamlPath + ", " + error;
+		return false;
+	}
+	return true;
+}
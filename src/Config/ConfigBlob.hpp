@@ -0,0 +1,135 @@
+#pragma once
+#include "Yaml.hpp"
+#include "../Filesystem/MappedFile.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class ConfigNode;
+
+/// Binary form of a parsed config - a node table with the children of each node stored next
+/// to each other and a pool of the deduplicated key and scalar strings. A blob records the
+/// size, last write time and hash of the YAML text it was compiled from, so a stale blob is
+/// recognized without reading the text as long as the file is not touched.
+///
+/// Layout, in host byte order as the blob never leaves the machine: Header, Header::nodeCount
+/// Node entries, Header::stringBytes bytes of strings. Node 0 is the root.
+class ConfigBlob
+{
+public:
+	static constexpr uint32_t MAGIC = 0x42434d52; // "RMCB"
+	static constexpr uint32_t VERSION = 2;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash;
+		uint64_t sourceSize;
+		/// Last write time of the YAML file and the time the blob was compiled, in ticks of
+		/// std::filesystem::file_time_type.
+		int64_t sourceTime;
+		int64_t compileTime;
+		uint32_t nodeCount;
+		uint32_t stringBytes;
+	};
+
+	struct Node
+	{
+		uint8_t type;
+		uint8_t padding[3];
+		/// Items of a sequence or entries of a mapping, at [firstChild, firstChild + childCount).
+		uint32_t childCount;
+		uint32_t firstChild;
+		/// Key of a mapping entry.
+		uint32_t keyOffset;
+		uint32_t keyLength;
+		uint32_t scalarOffset;
+		uint32_t scalarLength;
+	};
+
+	/// Serializes the document.
+	/// @param sourceHash Hash of the YAML text the document was parsed from, see HashSource()
+	/// @param sourceSize, sourceTime Size and last write time of the YAML file
+	static std::string Serialize(const YamlNode& root, uint64_t sourceHash, uint64_t sourceSize, int64_t sourceTime);
+	/// Hash identifying the YAML text, includes the blob version.
+	static uint64_t HashSource(const std::string& text);
+
+	/// Maps the blob file and checks its header and node table.
+	bool Open(const std::string& path, std::string& error);
+	/// Takes a blob returned by Serialize(), for a config whose blob could not be written.
+	bool Assign(std::string serialized, std::string& error);
+	void Close();
+
+	uint64_t GetSourceHash() const;
+	/// Whether the blob was compiled from a file of this size and last write time. A file
+	/// written shortly before the blob was compiled may have been written again within the
+	/// resolution of its timestamp, its blob is not trusted without comparing the hash.
+	bool IsCurrent(uint64_t sourceSize, int64_t sourceTime) const;
+	/// Copy of the open blob with a new size and last write time, for a file which was
+	/// touched without changing its text.
+	std::string Restamp(uint64_t sourceSize, int64_t sourceTime) const;
+
+	/// Root of the document, valid while the blob stays open.
+	ConfigNode GetRoot() const;
+
+private:
+	bool Attach(const uint8_t* data, size_t size, const std::string& name, std::string& error);
+
+	MappedFile file;
+	std::string owned;
+	const Header* header = nullptr;
+	const Node* nodes = nullptr;
+	const char* strings = nullptr;
+};
+
+/// Read-only node of an open ConfigBlob, the reading half of YamlNode without copying the
+/// document out of the blob. A default constructed node is absent, as a key Find() did not find.
+class ConfigNode
+{
+public:
+	ConfigNode() = default;
+
+	/// Whether the node exists.
+	explicit operator bool() const;
+
+	YamlNode::Type GetType() const;
+	bool IsNull() const;
+
+	/// Value of a scalar node, empty for other types.
+	std::string_view GetScalar() const;
+
+	/// Number of items of a sequence node or entries of a mapping node.
+	uint32_t GetChildCount() const;
+	/// Item of a sequence node or value of an entry of a mapping node.
+	ConfigNode GetChild(uint32_t index) const;
+	/// Key of an entry of a mapping node.
+	std::string_view GetKey(uint32_t index) const;
+
+	/// Value of the key in a mapping node, absent if the node is not a mapping or lacks the key.
+	ConfigNode Find(std::string_view key) const;
+
+	/// Copies the subtree, for callers which edit the document. Fails on documents nested
+	/// deeper than YamlNode can be copied recursively.
+	bool ToYaml(YamlNode& node, std::string& error) const;
+
+private:
+	friend class ConfigBlob;
+	ConfigNode(const ConfigBlob::Node* nodes, const char* strings, uint32_t index);
+
+	bool ToYaml(YamlNode& node, uint32_t depth, std::string& error) const;
+
+	const ConfigBlob::Node* nodes = nullptr;
+	const char* strings = nullptr;
+	uint32_t index = 0;
+};
+
+/// Loads a config through its blob in the blob directory. If the blob is missing or was compiled
+/// from a different text, the YAML is parsed and compiled into a new blob. The text is only read
+/// when the size or last write time of the file differ from the ones the blob recorded.
+/// @param validate Checks the config on every load, a blob hit included as the files a config
+/// refers to may be gone since it was compiled, may be null
+/// @param fromBlob Receives whether the blob was used, may be null
+bool LoadCompiledConfig(const std::string& yamlPath, const std::string& blobDirectory,
+	bool (*validate)(const ConfigNode& root, std::string& error), ConfigBlob& blob, std::string& error, bool* fromBlob = nullptr);
@@ -0,0 +1,124 @@
+#include "PipelineConfig.hpp"
+#include "../Filesystem/Filesystem.hpp"
+#include "../ShaderCache/ShaderVariantCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+namespace
+{
+	bool RequireMapping(const ConfigNode& parent, const char* key, const std::string& path, std::string& error)
+	{
+		if (parent.Find(key).GetType() != YamlNode::Type::Mapping)
+		{
+			error = path + key + " has to be a mapping";
+			return false;
+		}
+		return true;
+	}
+}
+
+std::string GetConfigBlobDirectory()
+{
+	return RMFS.GetAbsolutePath("config-cache");
+}
+
+bool ValidateBackendConfig(const ConfigNode& root, std::string& error)
+{
+	if (!RequireMapping(root, "Application", "", error) || !RequireMapping(root, "Instance", "", error) ||
+		!RequireMapping(root, "Device", "", error) || !RequireMapping(root.Find("Device"), "queues", "Device.", error))
+	{
+		return false;
+	}
+	if (root.Find("Application").Find("vulkan-version").GetType() != YamlNode::Type::Scalar)
+	{
+		error = "Application.vulkan-version is missing";
+		return false;
+	}
+	return true;
+}
+
+bool ValidateFrontendConfig(const ConfigNode& root, std::string& error)
+{
+	const ConfigNode nodes = root.Find("nodes");
+	if (nodes.GetType() != YamlNode::Type::Sequence || nodes.GetChildCount() == 0)
+	{
+		error = "nodes has to be a sequence of at least one node";
+		return false;
+	}
+
+	std::vector<std::string_view> names;
+	for (uint32_t i = 0; i < nodes.GetChildCount(); ++i)
+	{
+		const ConfigNode node = nodes.GetChild(i);
+		const ConfigNode name = node.Find("name");
+		if (name.GetType() != YamlNode::Type::Scalar || node.Find("type").GetType() != YamlNode::Type::Scalar)
+		{
+			error = "node " + std::to_string(i) + " needs a name and a type";
+			return false;
+		}
+		if (std::find(names.begin(), names.end(), name.GetScalar()) != names.end())
+		{
+			error = "node name " + std::string(name.GetScalar()) + " is not unique";
+			return false;
+		}
+		names.push_back(name.GetScalar());
+
+		const ConfigNode shaders = node.Find("shaders");
+		for (uint32_t j = 0; j < shaders.GetChildCount(); ++j)
+		{
+			std::error_code fileError;
+			const std::string path = ResolveShaderPath(std::string(shaders.GetChild(j).GetScalar()));
+			if (!std::filesystem::is_regular_file(path, fileError))
+			{
+				error = "node " + std::string(name.GetScalar()) + " " + std::string(shaders.GetKey(j)) + " shader " + path + " does not exist";
+				return false;
+			}
+		}
+	}
+
+	std::vector<ShaderPreset> presets;
+	std::string defaultPreset;
+	if (!LoadShaderPresets(root, presets, defaultPreset, error))
+	{
+		return false;
+	}
+	if (!presets.empty() && std::none_of(presets.begin(), presets.end(), [&defaultPreset](const ShaderPreset& p) { return p.name == defaultPreset; }))
+	{
+		error = "default shader preset " + defaultPreset + " does not exist";
+		return false;
+	}
+	return true;
+}
+
+bool LoadBackendConfig(const std::string& path, ConfigBlob& blob, std::string& error)
+{
+	return LoadCompiledConfig(path, GetConfigBlobDirectory(), &ValidateBackendConfig, blob, error);
+}
+
+bool LoadFrontendConfig(const std::string& path, ConfigBlob& blob, std::string& error)
+{
+	return LoadCompiledConfig(path, GetConfigBlobDirectory(), &ValidateFrontendConfig, blob, error);
+}
+
+int RunConfigCompile()
+{
+	int result = 0;
+	for (const std::string name : { "BackendConfig", "FrontendConfig" })
+	{
+		ConfigBlob blob;
+		std::string error;
+		bool fromBlob = false;
+		const std::string path = RMFS.GetAbsolutePath("../../src/" + name + ".yaml");
+		const auto validate = name == "BackendConfig" ? &ValidateBackendConfig : &ValidateFrontendConfig;
+		if (!LoadCompiledConfig(path, GetConfigBlobDirectory(), validate, blob, error, &fromBlob))
+		{
+			std::printf("%s is invalid: %s\n", name.c_str(), error.c_str());
+			result = 1;
+			continue;
+		}
+		std::printf("%s is valid, %s\n", name.c_str(), fromBlob ? "its blob is up to date" : "compiled to a blob");
+	}
+	return result;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "ConfigBlob.hpp"
+
+#include <string>
+
+/// Directory of the compiled config blobs (see ConfigBlob), next to the executable.
+std::string GetConfigBlobDirectory();
+
+/// Checks the sections HawkEye needs from the backend config - Application, Instance and Device
+/// with its queues.
+bool ValidateBackendConfig(const ConfigNode& root, std::string& error);
+/// Checks the nodes of the frontend config - a unique name and a type each, shader files which
+/// exist - and its shader presets.
+bool ValidateFrontendConfig(const ConfigNode& root, std::string& error);
+
+/// Loads and validates the config through its compiled blob, compiling it again if the YAML
+/// changed since the blob was written. The document is read through blob.GetRoot().
+bool LoadBackendConfig(const std::string& path, ConfigBlob& blob, std::string& error);
+bool LoadFrontendConfig(const std::string& path, ConfigBlob& blob, std::string& error);
+
+/// Headless config compilation for deployment images: RayMarcher --compile-configs
+/// Validates both configs, writes their blobs and prints a report to the standard output.
+/// @returns Process exit code - 0 if both configs are valid, 1 otherwise.
+int RunConfigCompile();
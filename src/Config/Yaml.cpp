@@ -0,0 +1,494 @@
+#include "Yaml.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	struct Line
+	{
+		int indent;
+		std::string text;
+		int number;
+	};
+
+	std::string Trim(const std::string& text)
+	{
+		const size_t begin = text.find_first_not_of(' ');
+		if (begin == std::string::npos)
+		{
+			return "";
+		}
+		const size_t end = text.find_last_not_of(" \r");
+		return text.substr(begin, end - begin + 1);
+	}
+
+	// Position of the comment start, ignoring # inside quotes and inside plain words.
+	size_t FindComment(const std::string& text)
+	{
+		char quote = 0;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			const char c = text[i];
+			if (quote)
+			{
+				if (c == '\\' && quote == '"')
+				{
+					++i;
+				}
+				else if (c == quote)
+				{
+					quote = 0;
+				}
+			}
+			else if ((c == '"' || c == '\'') && (i == 0 || text[i - 1] == ' ' || text[i - 1] == '-'))
+			{
+				quote = c;
+			}
+			else if (c == '#' && (i == 0 || text[i - 1] == ' '))
+			{
+				return i;
+			}
+		}
+		return std::string::npos;
+	}
+
+	// Position of the colon ending a mapping key, npos if the text is not a key.
+	size_t FindKeyColon(const std::string& text)
+	{
+		char quote = 0;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			const char c = text[i];
+			if (quote)
+			{
+				if (c == '\\' && quote == '"')
+				{
+					++i;
+				}
+				else if (c == quote)
+				{
+					quote = 0;
+				}
+			}
+			else if ((c == '"' || c == '\'') && i == 0)
+			{
+				quote = c;
+			}
+			else if (c == ':' && (i + 1 == text.size() || text[i + 1] == ' '))
+			{
+				return i;
+			}
+		}
+		return std::string::npos;
+	}
+
+	bool IsSequenceItem(const std::string& text)
+	{
+		return text == "-" || text.compare(0, 2, "- ") == 0;
+	}
+
+	std::string Unquote(const std::string& text)
+	{
+		if (text.size() >= 2 && text.front() == '"' && text.back() == '"')
+		{
+			std::string value;
+			for (size_t i = 1; i + 1 < text.size(); ++i)
+			{
+				if (text[i] == '\\' && i + 2 < text.size())
+				{
+					++i;
+					value += text[i] == 'n' ? '\n' : text[i] == 't' ? '\t' : text[i];
+				}
+				else
+				{
+					value += text[i];
+				}
+			}
+			return value;
+		}
+		if (text.size() >= 2 && text.front() == '\'' && text.back() == '\'')
+		{
+			std::string value;
+			for (size_t i = 1; i + 1 < text.size(); ++i)
+			{
+				value += text[i];
+				if (text[i] == '\'' && text[i + 1] == '\'')
+				{
+					++i;
+				}
+			}
+			return value;
+		}
+		return text;
+	}
+
+	bool NeedsQuotes(const std::string& value)
+	{
+		if (value.empty() || value == "{}" || value == "[]" || value.front() == ' ' || value.back() == ' ')
+		{
+			return true;
+		}
+		if (std::strchr("-?:,[]{}#&*!|>'\"%@`", value.front()) && !(value.front() == '-' && value.size() > 1 && value[1] != ' '))
+		{
+			return true;
+		}
+		return value.find(": ") != std::string::npos || value.find(" #") != std::string::npos || value.back() == ':' ||
+			value.find('\n') != std::string::npos || value.find('\t') != std::string::npos;
+	}
+
+	std::string Quote(const std::string& value)
+	{
+		if (!NeedsQuotes(value))
+		{
+			return value;
+		}
+		std::string quoted = "\"";
+		for (const char c : value)
+		{
+			switch (c)
+			{
+			case '"': quoted += "\\\""; break;
+			case '\\': quoted += "\\\\"; break;
+			case '\n': quoted += "\\n"; break;
+			case '\t': quoted += "\\t"; break;
+			default: quoted += c; break;
+			}
+		}
+		return quoted + '"';
+	}
+
+	class Parser
+	{
+	public:
+		Parser(std::vector<Line> lines, std::string& error) : lines(std::move(lines)), error(error) {}
+
+		bool ParseDocument(YamlNode& root)
+		{
+			root = YamlNode();
+			if (lines.empty())
+			{
+				return true;
+			}
+			if (!ParseBlock(lines[0].indent, root))
+			{
+				return false;
+			}
+			if (current < lines.size())
+			{
+				return Fail("unexpected indentation");
+			}
+			return true;
+		}
+
+	private:
+		bool Fail(const std::string& reason)
+		{
+			const int number = current < lines.size() ? lines[current].number : (lines.empty() ? 0 : lines.back().number);
+			error = "line " + std::to_string(number) + ": " + reason;
+			return false;
+		}
+
+		bool ParseBlock(const int indent, YamlNode& node)
+		{
+			return IsSequenceItem(lines[current].text) ? ParseSequence(indent, node) : ParseMapping(indent, node);
+		}
+
+		static YamlNode ParseScalar(const std::string& text)
+		{
+			if (text == "{}")
+			{
+				return YamlNode(YamlNode::Type::Mapping);
+			}
+			if (text == "[]")
+			{
+				return YamlNode(YamlNode::Type::Sequence);
+			}
+			if (text == "~" || text == "null")
+			{
+				return YamlNode();
+			}
+			return YamlNode(Unquote(text));
+		}
+
+		bool ParseSequence(const int indent, YamlNode& node)
+		{
+			node = YamlNode(YamlNode::Type::Sequence);
+			while (current < lines.size() && lines[current].indent == indent && IsSequenceItem(lines[current].text))
+			{
+				Line& line = lines[current];
+				const std::string rest = Trim(line.text.substr(1));
+				node.GetItems().emplace_back();
+				YamlNode& item = node.GetItems().back();
+
+				if (rest.empty())
+				{
+					++current;
+					if (current < lines.size() && lines[current].indent > indent)
+					{
+						if (!ParseBlock(lines[current].indent, item))
+						{
+							return false;
+						}
+					}
+				}
+				else if (IsSequenceItem(rest) || FindKeyColon(rest) != std::string::npos)
+				{
+					// Collection starting on the item line, continued at the column of its first key.
+					line.indent += int(line.text.find(rest));
+					line.text = rest;
+					if (!ParseBlock(line.indent, item))
+					{
+						return false;
+					}
+				}
+				else
+				{
+					item = ParseScalar(rest);
+					++current;
+				}
+			}
+			if (current < lines.size() && lines[current].indent > indent)
+			{
+				return Fail("unexpected indentation");
+			}
+			return true;
+		}
+
+		bool ParseMapping(const int indent, YamlNode& node)
+		{
+			node = YamlNode(YamlNode::Type::Mapping);
+			while (current < lines.size() && lines[current].indent == indent)
+			{
+				const std::string& text = lines[current].text;
+				if (IsSequenceItem(text))
+				{
+					return Fail("expected a mapping key");
+				}
+
+				// A key without a colon is read as a key without a value.
+				const size_t colon = FindKeyColon(text);
+				const std::string key = Unquote(Trim(text.substr(0, colon)));
+				const std::string value = colon == std::string::npos ? "" : Trim(text.substr(colon + 1));
+				if (node.Find(key))
+				{
+					return Fail("duplicate key '" + key + "'");
+				}
+				node.GetEntries().emplace_back(key, YamlNode());
+				YamlNode& child = node.GetEntries().back().second;
+				++current;
+
+				if (!value.empty())
+				{
+					child = ParseScalar(value);
+				}
+				else if (current < lines.size() && lines[current].indent > indent)
+				{
+					if (!ParseBlock(lines[current].indent, child))
+					{
+						return false;
+					}
+				}
+				else if (current < lines.size() && lines[current].indent == indent && IsSequenceItem(lines[current].text))
+				{
+					if (!ParseSequence(indent, child))
+					{
+						return false;
+					}
+				}
+			}
+			if (current < lines.size() && lines[current].indent > indent)
+			{
+				return Fail("unexpected indentation");
+			}
+			return true;
+		}
+
+		std::vector<Line> lines;
+		size_t current = 0;
+		std::string& error;
+	};
+}
+
+YamlNode::YamlNode(Type type) : type(type) {}
+
+YamlNode::YamlNode(std::string scalar) : type(Type::Scalar), scalar(std::move(scalar)) {}
+
+bool YamlNode::Parse(const std::string& text, YamlNode& root, std::string& error)
+{
+	std::vector<Line> lines;
+	std::istringstream stream(text);
+	std::string line;
+	int number = 0;
+	while (std::getline(stream, line))
+	{
+		++number;
+		const size_t indent = line.find_first_not_of(' ');
+		if (indent != std::string::npos && line[indent] == '\t')
+		{
+			error = "line " + std::to_string(number) + ": tabs can not be used for indentation";
+			return false;
+		}
+
+		const size_t comment = FindComment(line);
+		const std::string content = Trim(comment == std::string::npos ? line : line.substr(0, comment));
+		if (content.empty() || content == "---")
+		{
+			continue;
+		}
+		lines.push_back({ int(indent), content, number });
+	}
+
+	return Parser(std::move(lines), error).ParseDocument(root);
+}
+
+bool YamlNode::Load(const std::string& path, YamlNode& root, std::string& error)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+	if (!Parse(text.str(), root, error))
+	{
+		error = path + ", " + error;
+		return false;
+	}
+	return true;
+}
+
+std::string YamlNode::Emit() const
+{
+	std::string output;
+	Emit(output, 0);
+	return output;
+}
+
+void YamlNode::Emit(std::string& output, const int indent) const
+{
+	const std::string padding(indent, ' ');
+
+	// Writes the value following a key or a dash, nested collections go on the next lines.
+	const auto emitValue = [&output, indent](const YamlNode& value)
+	{
+		switch (value.type)
+		{
+		case Type::Null:
+			output += '\n';
+			break;
+		case Type::Scalar:
+			output += ' ' + Quote(value.scalar) + '\n';
+			break;
+		case Type::Sequence:
+			if (value.items.empty())
+			{
+				output += " []\n";
+				break;
+			}
+			output += '\n';
+			value.Emit(output, indent + 4);
+			break;
+		case Type::Mapping:
+			if (value.entries.empty())
+			{
+				output += " {}\n";
+				break;
+			}
+			output += '\n';
+			value.Emit(output, indent + 4);
+			break;
+		}
+	};
+
+	switch (type)
+	{
+	case Type::Null:
+		break;
+	case Type::Scalar:
+		output += padding + Quote(scalar) + '\n';
+		break;
+	case Type::Sequence:
+		for (const YamlNode& item : items)
+		{
+			output += padding + '-';
+			emitValue(item);
+		}
+		break;
+	case Type::Mapping:
+		for (const auto& entry : entries)
+		{
+			output += padding + Quote(entry.first) + ':';
+			emitValue(entry.second);
+		}
+		break;
+	}
+}
+
+YamlNode::Type YamlNode::GetType() const
+{
+	return type;
+}
+
+bool YamlNode::IsNull() const
+{
+	return type == Type::Null;
+}
+
+const std::string& YamlNode::GetScalar() const
+{
+	return scalar;
+}
+
+const std::vector<YamlNode>& YamlNode::GetItems() const
+{
+	return items;
+}
+
+std::vector<YamlNode>& YamlNode::GetItems()
+{
+	return items;
+}
+
+const std::vector<std::pair<std::string, YamlNode>>& YamlNode::GetEntries() const
+{
+	return entries;
+}
+
+std::vector<std::pair<std::string, YamlNode>>& YamlNode::GetEntries()
+{
+	return entries;
+}
+
+const YamlNode* YamlNode::Find(const std::string& key) const
+{
+	for (const auto& entry : entries)
+	{
+		if (entry.first == key)
+		{
+			return &entry.second;
+		}
+	}
+	return nullptr;
+}
+
+YamlNode* YamlNode::Find(const std::string& key)
+{
+	return const_cast<YamlNode*>(static_cast<const YamlNode*>(this)->Find(key));
+}
+
+bool YamlNode::Remove(const std::string& key)
+{
+	for (auto it = entries.begin(); it != entries.end(); ++it)
+	{
+		if (it->first == key)
+		{
+			entries.erase(it);
+			return true;
+		}
+	}
+	return false;
+}
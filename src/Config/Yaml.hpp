@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Document tree of the YAML subset used by the pipeline configs: block mappings and block
+/// sequences nested by indentation, plain or quoted scalars, empty values and comments.
+/// Flow collections are only understood when empty ({} and []).
+class YamlNode
+{
+public:
+	enum class Type
+	{
+		Null,
+		Scalar,
+		Sequence,
+		Mapping
+	};
+
+	YamlNode() = default;
+	explicit YamlNode(Type type);
+	explicit YamlNode(std::string scalar);
+
+	/// Parses the document, on failure the error holds the line and the reason.
+	static bool Parse(const std::string& text, YamlNode& root, std::string& error);
+	/// Reads and parses the file.
+	static bool Load(const std::string& path, YamlNode& root, std::string& error);
+
+	/// Block style document which parses back to the same tree.
+	std::string Emit() const;
+
+	Type GetType() const;
+	bool IsNull() const;
+
+	/// Value of a scalar node, empty for other types.
+	const std::string& GetScalar() const;
+
+	/// Items of a sequence node.
+	const std::vector<YamlNode>& GetItems() const;
+	std::vector<YamlNode>& GetItems();
+
+	/// Entries of a mapping node in document order.
+	const std::vector<std::pair<std::string, YamlNode>>& GetEntries() const;
+	std::vector<std::pair<std::string, YamlNode>>& GetEntries();
+
+	/// Value of the key in a mapping node, null if the node is not a mapping or lacks the key.
+	const YamlNode* Find(const std::string& key) const;
+	YamlNode* Find(const std::string& key);
+
+	/// Removes the key from a mapping node, returns whether it was present.
+	bool Remove(const std::string& key);
+
+private:
+	void Emit(std::string& output, int indent) const;
+
+	Type type = Type::Null;
+	std::string scalar;
+	std::vector<YamlNode> items;
+	std::vector<std::pair<std::string, YamlNode>> entries;
+};
@@ -0,0 +1,238 @@
+#include "AmbientOcclusion.hpp"
+#include "../Camera/SceneUtils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double ElapsedMs(const Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	constexpr uint32_t NO_SAMPLE = ~uint32_t(0);
+
+	// Calls pixel(x, y) for every pixel of the image tile by tile, with the tiles distributed
+	// across the pool - contiguous blocks of the tiled layout.
+	// @returns The sum of the distance estimates pixel() returns.
+	template <class Pixel>
+	uint64_t ForEachPixel(ThreadPool& threadPool, const ImageShape& shape, const Pixel& pixel)
+	{
+		const int tilesX = (shape.width + CpuRenderer::TILE_SIZE - 1) / CpuRenderer::TILE_SIZE;
+		const int tilesY = (shape.height + CpuRenderer::TILE_SIZE - 1) / CpuRenderer::TILE_SIZE;
+		std::atomic<uint64_t> evaluations{ 0 };
+		threadPool.ParallelFor(uint32_t(tilesX * tilesY), [&](const uint32_t tile)
+		{
+			const int x0 = int(tile % tilesX) * CpuRenderer::TILE_SIZE;
+			const int y0 = int(tile / tilesX) * CpuRenderer::TILE_SIZE;
+			uint64_t tileEvaluations = 0;
+			for (int y = y0; y < std::min(y0 + CpuRenderer::TILE_SIZE, shape.height); ++y)
+			{
+				for (int x = x0; x < std::min(x0 + CpuRenderer::TILE_SIZE, shape.width); ++x)
+				{
+					tileEvaluations += pixel(x, y);
+				}
+			}
+			evaluations += tileEvaluations;
+		});
+		return evaluations;
+	}
+}
+
+AmbientOcclusionPass::AmbientOcclusionPass(ThreadPool& threadPool)
+	: threadPool(threadPool)
+{
+}
+
+void AmbientOcclusionPass::Run(const CpuRenderSettings& settings, const GBuffer& gbuffer, ImageBuffer<float>& occlusion)
+{
+	const ImageShape& shape = gbuffer.shape;
+	const int width = shape.width;
+	const int height = shape.height;
+	const size_t pixelCount = shape.GetSize();
+	const int blocksX = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const int blocksY = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	// The pixel of every block sampled in this frame, cycling through all of them.
+	const int jitterX = int(frame % BLOCK_SIZE);
+	const int jitterY = int(frame / BLOCK_SIZE % BLOCK_SIZE);
+	evaluations = 0;
+
+	Clock::time_point start = Clock::now();
+	const size_t blockCount = size_t(blocksX) * blocksY;
+	float* samples = frameArena.Allocate<float>(blockCount);
+	uint32_t* samplePixels = frameArena.Allocate<uint32_t>(blockCount);
+	std::fill_n(samples, blockCount, 1.f);
+	std::fill_n(samplePixels, blockCount, NO_SAMPLE);
+	threadPool.ParallelFor(uint32_t(blocksY), [&](const uint32_t by)
+	{
+		uint64_t blockEvaluations = 0;
+		for (int bx = 0; bx < blocksX; ++bx)
+		{
+			const int x = std::min(bx * BLOCK_SIZE + jitterX, width - 1);
+			const int y = std::min(int(by) * BLOCK_SIZE + jitterY, height - 1);
+			const size_t i = shape.Index(x, y);
+			if (gbuffer.hits(i))
+			{
+				samples[size_t(by) * blocksX + bx] = Occlusion(settings, gbuffer.GetPosition(x, y), gbuffer.GetNormal(i));
+				samplePixels[size_t(by) * blocksX + bx] = uint32_t(i);
+				blockEvaluations += SAMPLES;
+			}
+		}
+		evaluations += blockEvaluations;
+	});
+	timings.sampleMs = ElapsedMs(start);
+
+	// Bilinear upsampling weighted by how close the sample is to the surface of the pixel. Pixels
+	// without a sample of their surface nearby take their own.
+	start = Clock::now();
+	float* current = frameArena.Allocate<float>(pixelCount);
+	evaluations += ForEachPixel(threadPool, shape, [&](const int x, const int y) -> uint64_t
+	{
+		const size_t i = shape.Index(x, y);
+		if (!gbuffer.hits(i))
+		{
+			current[i] = 1.f;
+			return 0;
+		}
+
+		const float fx = std::clamp((x - jitterX) / float(BLOCK_SIZE), 0.f, float(blocksX - 1));
+		const float fy = std::clamp((y - jitterY) / float(BLOCK_SIZE), 0.f, float(blocksY - 1));
+		const int bx0 = int(fx);
+		const int by0 = int(fy);
+		const int bx1 = std::min(bx0 + 1, blocksX - 1);
+		const int by1 = std::min(by0 + 1, blocksY - 1);
+		const float wx = fx - bx0;
+		const float wy = fy - by0;
+		const int corners[4][2] = { { bx0, by0 }, { bx1, by0 }, { bx0, by1 }, { bx1, by1 } };
+		const float bilinear[4] = { (1.f - wx) * (1.f - wy), wx * (1.f - wy), (1.f - wx) * wy, wx * wy };
+
+		const Eigen::Vector3f normal = gbuffer.GetNormal(i);
+		float value = 0.f;
+		float weight = 0.f;
+		for (int c = 0; c < 4; ++c)
+		{
+			const size_t block = size_t(corners[c][1]) * blocksX + corners[c][0];
+			const uint32_t s = samplePixels[block];
+			if (s == NO_SAMPLE || bilinear[c] == 0.f)
+			{
+				continue;
+			}
+			const float depthWeight = 1.f - std::abs(gbuffer.depths(s) - gbuffer.depths(i)) / (DEPTH_TOLERANCE * gbuffer.depths(i));
+			const float cosine = gbuffer.GetNormal(s).dot(normal);
+			if (depthWeight > 0.f && cosine > 0.f)
+			{
+				const float w = bilinear[c] * depthWeight * std::pow(cosine, float(NORMAL_POWER));
+				value += w * samples[block];
+				weight += w;
+			}
+		}
+
+		if (weight > 1e-3f)
+		{
+			current[i] = value / weight;
+			return 0;
+		}
+		current[i] = Occlusion(settings, gbuffer.GetPosition(x, y), normal);
+		return SAMPLES;
+	});
+	timings.upsampleMs = ElapsedMs(start);
+
+	// Running average with the previous frames at the same surface point.
+	start = Clock::now();
+	const bool accumulate = hasPrevious && SameSceneGeometry(previousSettings, settings);
+	occlusion.Resize(shape);
+	frames.resize(pixelCount);
+	positions.resize(pixelCount);
+	const Camera::RayBasis& rayBasis = gbuffer.rayBasis;
+	ForEachPixel(threadPool, shape, [&](const int x, const int y) -> uint64_t
+	{
+		const size_t i = shape.Index(x, y);
+		occlusion(i) = current[i];
+		frames[i] = gbuffer.hits(i) ? 1 : 0;
+		positions[i] = gbuffer.GetPosition(x, y);
+
+		float u, v;
+		if (!accumulate || !gbuffer.hits(i) || !SceneUtils::ProjectToImage(previousRayBasis, positions[i], u, v))
+		{
+			return 0;
+		}
+		const int px = std::clamp(int(std::lround(u * (previousShape.width - 1))), 0, previousShape.width - 1);
+		const int py = std::clamp(int(std::lround(v * (previousShape.height - 1))), 0, previousShape.height - 1);
+		const size_t j = previousShape.Index(px, py);
+
+		// About a pixel at the depth of the point, how far apart the surface points of a pixel
+		// are after a small camera movement.
+		const float tolerance = 1.5f * SceneUtils::PixelFootprint(rayBasis, x / float(std::max(width - 1, 1)),
+			y / float(std::max(height - 1, 1)), gbuffer.depths(i), height);
+		if (previousFrames[j] == 0 || (previousPositions[j] - positions[i]).norm() > tolerance)
+		{
+			return 0;
+		}
+
+		frames[i] = uint8_t(std::min(previousFrames[j] + 1, MAX_HISTORY));
+		occlusion(i) = previousOcclusion(j) + (current[i] - previousOcclusion(j)) / frames[i];
+		return 0;
+	});
+
+	previousSettings = settings;
+	previousRayBasis = gbuffer.rayBasis;
+	previousShape = shape;
+	std::swap(previousPositions, positions);
+	previousOcclusion = occlusion;
+	std::swap(previousFrames, frames);
+	hasPrevious = true;
+	++frame;
+	frameArena.Reset();
+	timings.accumulateMs = ElapsedMs(start);
+}
+
+void AmbientOcclusionPass::Reset()
+{
+	hasPrevious = false;
+	frame = 0;
+}
+
+const AmbientOcclusionPass::Timings& AmbientOcclusionPass::GetTimings() const
+{
+	return timings;
+}
+
+uint64_t AmbientOcclusionPass::GetDistanceEvaluations() const
+{
+	return evaluations;
+}
+
+const ArenaStatistics& AmbientOcclusionPass::GetArenaStatistics() const
+{
+	return frameArena.GetStatistics();
+}
+
+void AmbientOcclusionPass::ResetArenaStatistics()
+{
+	frameArena.ResetStatistics();
+}
+
+float AmbientOcclusionPass::Occlusion(const CpuRenderSettings& settings, const Eigen::Vector3f& position, const Eigen::Vector3f& normal)
+{
+	const int fractalIterations = settings.fractalIterations > 0 ? settings.fractalIterations : SceneFunctions::FRACTAL_ITERATIONS;
+
+	// Average of how much closer the surface is than the distance along the normal, nearer
+	// samples weighing more.
+	float occluded = 0.f;
+	float weights = 0.f;
+	float weight = 1.f;
+	for (int i = 1; i <= SAMPLES; ++i)
+	{
+		const float h = DISTANCE * i / SAMPLES;
+		const float dist = SceneFunctions::Distance(settings.scene, Eigen::Vector3f(position + h * normal), settings.time, fractalIterations,
+			settings.parameters).dist;
+		occluded += weight * std::max(h - dist, 0.f) / h;
+		weights += weight;
+		weight *= .75f;
+	}
+	return std::clamp(1.f - STRENGTH * occluded / weights, 0.f, 1.f);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "Arena.hpp"
+#include "CpuRenderer.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/// Ambient occlusion of the G-buffer written by CpuRenderer::RenderGBuffer(), the counterpart
+/// of common/ambient-occlusion.glsl. The distance estimate is sampled along the normal at SAMPLES
+/// distances for one pixel per 2x2 block, upsampled with weights leaving out samples of other
+/// surfaces (depth and normal) and accumulated over frames where the surface stays the same.
+/// The sampled pixel of a block changes every frame, so a still view converges to the
+/// occlusion of every pixel.
+class AmbientOcclusionPass
+{
+public:
+	/// Constants of common/ambient-occlusion.glsl.
+	static constexpr int SAMPLES = 5;
+	/// Distance along the normal of the last sample.
+	static constexpr float DISTANCE = 1.5f;
+	static constexpr float STRENGTH = 1.5f;
+	/// Edge length of the pixel blocks sharing a sample.
+	static constexpr int BLOCK_SIZE = 2;
+	/// Samples further from the depth of a pixel than this fraction of it are not upsampled into it.
+	static constexpr float DEPTH_TOLERANCE = .05f;
+	/// Exponent of the cosine between the normals of a sample and a pixel in the upsampling weight.
+	static constexpr int NORMAL_POWER = 8;
+	/// Number of frames the accumulation averages at most, later frames replace the oldest.
+	static constexpr int MAX_HISTORY = 8;
+
+	/// Wall time of the stages of the last Run().
+	struct Timings
+	{
+		double sampleMs = 0.0;
+		double upsampleMs = 0.0;
+		double accumulateMs = 0.0;
+	};
+
+	explicit AmbientOcclusionPass(ThreadPool& threadPool);
+
+	/// Computes the occlusion factor of every pixel of the G-buffer in its shape, 1 where nothing
+	/// occludes.
+	/// The frame is accumulated with the previous one where the settings keep the scene
+	/// geometry and the surface point of a pixel reprojects onto the same point.
+	void Run(const CpuRenderSettings& settings, const GBuffer& gbuffer, ImageBuffer<float>& occlusion);
+
+	/// Forgets the previous frames.
+	void Reset();
+
+	const Timings& GetTimings() const;
+	/// Distance estimates of the last Run().
+	uint64_t GetDistanceEvaluations() const;
+	/// Allocations from the arena of the frames since the last call of ResetArenaStatistics().
+	const ArenaStatistics& GetArenaStatistics() const;
+	void ResetArenaStatistics();
+
+	/// Occlusion factor of the surface point, sampled along the normal - SAMPLES distance estimates.
+	static float Occlusion(const CpuRenderSettings& settings, const Eigen::Vector3f& position, const Eigen::Vector3f& normal);
+
+private:
+	ThreadPool& threadPool;
+	uint32_t frame = 0;
+	Timings timings;
+	std::atomic<uint64_t> evaluations{ 0 };
+
+	// Data of a single Run() - the samples of the blocks and the pixel of its block each was
+	// taken at, the occlusion before the accumulation.
+	Arena frameArena;
+	// Surface point of every pixel in the order of the shape's layout, kept for the next frame.
+	std::vector<Eigen::Vector3f> positions;
+
+	bool hasPrevious = false;
+	CpuRenderSettings previousSettings;
+	Camera::RayBasis previousRayBasis;
+	ImageShape previousShape;
+	std::vector<Eigen::Vector3f> previousPositions;
+	ImageBuffer<float> previousOcclusion;
+	std::vector<uint8_t> previousFrames;
+	std::vector<uint8_t> frames;
+};
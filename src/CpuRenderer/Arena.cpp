@@ -0,0 +1,142 @@
+#include "Arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+ArenaStatistics& ArenaStatistics::operator+=(const ArenaStatistics& other)
+{
+	allocations += other.allocations;
+	bytes += other.bytes;
+	peakBytes += other.peakBytes;
+	heapAllocations += other.heapAllocations;
+	capacity += other.capacity;
+	return *this;
+}
+
+Arena::Arena(const size_t blockSize)
+	: blockSize(blockSize)
+{
+}
+
+void* Arena::Allocate(const size_t size, const size_t alignment)
+{
+	// The first block from the current one onwards with room for the allocation. Blocks skipped
+	// are left unused until the arena is rewound.
+	for (; block < blocks.size(); ++block, offset = 0)
+	{
+		const uintptr_t base = reinterpret_cast<uintptr_t>(blocks[block].memory.get());
+		const size_t aligned = size_t(((base + offset + alignment - 1) & ~uintptr_t(alignment - 1)) - base);
+		if (aligned + size <= blocks[block].size)
+		{
+			offset = aligned + size;
+			break;
+		}
+	}
+
+	if (block == blocks.size())
+	{
+		Block newBlock;
+		newBlock.size = std::max(blockSize, size + alignment);
+		newBlock.memory.reset(new uint8_t[newBlock.size]);
+		blocks.push_back(std::move(newBlock));
+		++statistics.heapAllocations;
+		statistics.capacity += blocks.back().size;
+
+		const uintptr_t base = reinterpret_cast<uintptr_t>(blocks.back().memory.get());
+		offset = size_t(((base + alignment - 1) & ~uintptr_t(alignment - 1)) - base) + size;
+	}
+
+	++statistics.allocations;
+	statistics.bytes += size;
+	bytesInUse += size;
+	statistics.peakBytes = std::max(statistics.peakBytes, bytesInUse);
+	return blocks[block].memory.get() + offset - size;
+}
+
+Arena::Marker Arena::GetMarker() const
+{
+	return { block, offset, bytesInUse };
+}
+
+void Arena::Rewind(const Marker& marker)
+{
+#ifdef DEBUG
+	for (size_t i = marker.block; i <= block && i < blocks.size(); ++i)
+	{
+		const size_t begin = i == marker.block ? marker.offset : 0;
+		const size_t end = i == block ? offset : blocks[i].size;
+		if (end > begin)
+		{
+			std::memset(blocks[i].memory.get() + begin, POISON, end - begin);
+		}
+	}
+#endif
+
+	block = marker.block;
+	offset = marker.offset;
+	bytesInUse = marker.bytesInUse;
+}
+
+void Arena::Reset()
+{
+	Rewind(Marker());
+}
+
+const ArenaStatistics& Arena::GetStatistics() const
+{
+	return statistics;
+}
+
+void Arena::ResetStatistics()
+{
+	const uint64_t capacity = statistics.capacity;
+	statistics = ArenaStatistics();
+	statistics.capacity = capacity;
+	statistics.peakBytes = bytesInUse;
+}
+
+ThreadArenas::ThreadArenas(const ThreadPool& threadPool, const size_t blockSize)
+	: threadPool(threadPool)
+{
+	// The workers and the thread calling into the pool.
+	arenas.resize(threadPool.GetThreadCount() + 1);
+	for (std::unique_ptr<Arena>& arena : arenas)
+	{
+		arena = std::make_unique<Arena>(blockSize);
+	}
+}
+
+Arena& ThreadArenas::Get()
+{
+	const uint32_t index = threadPool.GetCurrentThreadIndex();
+	if (index == threadPool.GetThreadCount())
+	{
+		// The first caller claims the arena, owner receives the thread holding it otherwise.
+		const std::thread::id self = std::this_thread::get_id();
+		std::thread::id owner;
+		if (!caller.compare_exchange_strong(owner, self))
+		{
+			assert(owner == self && "ThreadArenas used from a second thread outside its pool.");
+		}
+	}
+	return *arenas[index];
+}
+
+ArenaStatistics ThreadArenas::GetStatistics() const
+{
+	ArenaStatistics statistics;
+	for (const std::unique_ptr<Arena>& arena : arenas)
+	{
+		statistics += arena->GetStatistics();
+	}
+	return statistics;
+}
+
+void ThreadArenas::ResetStatistics()
+{
+	for (const std::unique_ptr<Arena>& arena : arenas)
+	{
+		arena->ResetStatistics();
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Allocation counts of one or more arenas since their statistics were reset.
+struct ArenaStatistics
+{
+	/// Allocations and bytes handed out.
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+	/// Most bytes in use at once.
+	uint64_t peakBytes = 0;
+	/// Blocks taken from the heap, zero once the arenas have grown to the peak of a frame.
+	uint64_t heapAllocations = 0;
+	/// Bytes of the blocks held (not reset).
+	uint64_t capacity = 0;
+
+	ArenaStatistics& operator+=(const ArenaStatistics& other);
+};
+
+/// Bump allocator for transient data with a lifetime of a frame or a tile. Allocations are taken
+/// from blocks which are kept when the arena is rewound, so once it has grown to the peak of a
+/// frame it no longer touches the heap, and releasing everything is O(1). Nothing is destructed,
+/// only trivially destructible types can be allocated. Debug builds overwrite released memory
+/// with POISON, so reads of data from an earlier frame or tile stand out.
+class Arena
+{
+public:
+	static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+	static constexpr uint8_t POISON = 0xcd;
+
+	/// Position of the arena to rewind to, everything allocated after it is released.
+	struct Marker
+	{
+		size_t block = 0;
+		size_t offset = 0;
+		uint64_t bytesInUse = 0;
+	};
+
+	/// @param blockSize Size of the blocks taken from the heap, larger allocations get a block of their own.
+	explicit Arena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	/// Uninitialized memory of the given size and alignment (a power of two).
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/// Default-initialized array of count values.
+	template <class T>
+	T* Allocate(const size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "Arena memory is released without destructing it.");
+		T* values = static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+		std::uninitialized_default_construct_n(values, count);
+		return values;
+	}
+
+	Marker GetMarker() const;
+	void Rewind(const Marker& marker);
+	/// Releases every allocation.
+	void Reset();
+
+	const ArenaStatistics& GetStatistics() const;
+	void ResetStatistics();
+
+private:
+	struct Block
+	{
+		std::unique_ptr<uint8_t[]> memory;
+		size_t size = 0;
+	};
+
+	size_t blockSize;
+	std::vector<Block> blocks;
+	// Block allocated from and the first free byte of it.
+	size_t block = 0;
+	size_t offset = 0;
+	uint64_t bytesInUse = 0;
+	ArenaStatistics statistics;
+};
+
+/// Rewinds the arena to where it was at construction when it goes out of scope.
+class ArenaScope
+{
+public:
+	explicit ArenaScope(Arena& arena) : arena(arena), marker(arena.GetMarker()) {}
+	~ArenaScope() { arena.Rewind(marker); }
+
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+	Arena& arena;
+	Arena::Marker marker;
+};
+
+/// One arena per thread of a pool - its workers and the thread calling ThreadPool::ParallelFor() -
+/// for the transient data of the tile a thread works on. Every thread outside the pool would
+/// get the same arena, so it belongs to the first of them to call Get() and a call from
+/// another one asserts.
+class ThreadArenas
+{
+public:
+	explicit ThreadArenas(const ThreadPool& threadPool, size_t blockSize = Arena::DEFAULT_BLOCK_SIZE);
+
+	/// Arena of the calling thread.
+	Arena& Get();
+
+	/// Sum of the statistics of the arenas.
+	ArenaStatistics GetStatistics() const;
+	void ResetStatistics();
+
+private:
+	const ThreadPool& threadPool;
+	std::vector<std::unique_ptr<Arena>> arenas;
+	/// Thread outside the pool owning the last arena, none until the first call.
+	std::atomic<std::thread::id> caller{ std::thread::id() };
+};
@@ -0,0 +1,1139 @@
+#include "CpuRenderer.hpp"
+#include "../Camera/SceneUtils.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	using Vector3 = SceneFunctions::Vector3<float>;
+
+	uint8_t ToUnorm8(const float value)
+	{
+		return uint8_t(std::clamp(value, 0.f, 1.f) * 255.f + .5f);
+	}
+
+	void WritePixel(uint8_t* pixel, const Vector3& color)
+	{
+		pixel[0] = ToUnorm8(color.x());
+		pixel[1] = ToUnorm8(color.y());
+		pixel[2] = ToUnorm8(color.z());
+		pixel[3] = 255;
+	}
+
+	// Analytic normal where the scene has one, four tetrahedral samples elsewhere - sceneNormal()
+	// of common/march.glsl.
+	Vector3 SurfaceNormal(const Scene scene, const Vector3& position, const float time, const float epsilon,
+		const int fractalIterations, const SceneParameters& parameters, uint64_t& evaluations)
+	{
+		Vector3 normal;
+		++evaluations;
+		if (SceneFunctions::AnalyticNormal(scene, position, time, normal, fractalIterations, parameters))
+		{
+			return normal;
+		}
+		evaluations += 4;
+		return SceneFunctions::TetrahedralNormal(scene, position, time, epsilon, fractalIterations, parameters);
+	}
+
+	// Light of the fractal scenes, LIGHT_POSITION of common/shadow.glsl.
+	const Vector3 LIGHT_POSITION(10.f, 10.f, 5.f);
+
+	// Shadow samples further from the depth of a pixel than this fraction of it are not
+	// upsampled into the pixel, SHADOW_DEPTH_TOLERANCE of common/shadow.glsl.
+	constexpr float SHADOW_DEPTH_TOLERANCE = .05f;
+
+	// Whether the shadows of a frame rendered with the one settings are valid for the other.
+	// The light is fixed, so only the scene can have changed.
+	bool SameShadowScene(const CpuRenderSettings& a, const CpuRenderSettings& b)
+	{
+		return SameSceneGeometry(a, b) && a.epsilon == b.epsilon && a.shadows == b.shadows;
+	}
+
+	// Whether the pixels at the indices lie on either side of an edge - a hit next to a miss or
+	// depths further apart than SamplingSettings::DEPTH_TOLERANCE - edge() of
+	// common/adaptive-sampling.glsl.
+	bool IsDiscontinuity(const GBuffer& gbuffer, const size_t a, const size_t b)
+	{
+		const bool hitA = gbuffer.hits(a) != 0;
+		if (hitA != (gbuffer.hits(b) != 0))
+		{
+			return true;
+		}
+		const float depthA = gbuffer.depths(a);
+		const float depthB = gbuffer.depths(b);
+		return hitA && std::abs(depthA - depthB) > SamplingSettings::DEPTH_TOLERANCE * std::min(depthA, depthB);
+	}
+
+	// Offset of a sample from the center of its pixel in pixels, zero for the first one. The R2
+	// low-discrepancy sequence, sampleOffset() of common/adaptive-sampling.glsl.
+	Eigen::Vector2f SampleOffset(const int index)
+	{
+		const float x = .5f + index * .754877666f;
+		const float y = .5f + index * .569840291f;
+		return Eigen::Vector2f(x - std::floor(x) - .5f, y - std::floor(y) - .5f);
+	}
+
+	// Rays further than this from the reference point have escaped the mandelbulb.
+	constexpr double DEEP_ZOOM_MAX_DISTANCE = 10.;
+
+	// Orbit offsets this large relative to the orbit magnitude (about 1) are resolved in double.
+	constexpr double DOUBLE_RESOLVED_OFFSET = 1e-12;
+
+	// Evaluates the mandelbulb in double-double precision until the orbit's running derivative
+	// has grown the footprint above the double resolution, then finishes in double.
+	double MixedPrecisionMandelbulb(const SceneFunctions::Vector3<DoubleDouble>& position, const int iterations, const double footprint)
+	{
+		SceneFunctions::MandelbulbOrbit<DoubleDouble> orbit = SceneFunctions::MandelbulbStart(position);
+		int i = 0;
+		bool escaped = false;
+		for (; i < iterations && double(orbit.dz) * footprint < DOUBLE_RESOLVED_OFFSET; ++i)
+		{
+			if (!SceneFunctions::MandelbulbStep(position, orbit))
+			{
+				escaped = true;
+				break;
+			}
+		}
+
+		const Eigen::Vector3d positionDouble = position.unaryExpr([](const DoubleDouble& value) { return double(value); });
+		SceneFunctions::MandelbulbOrbit<double> orbitDouble;
+		orbitDouble.w = orbit.w.unaryExpr([](const DoubleDouble& value) { return double(value); });
+		orbitDouble.m = double(orbit.m);
+		orbitDouble.dz = double(orbit.dz);
+		orbitDouble.trap = orbit.trap.unaryExpr([](const DoubleDouble& value) { return double(value); });
+
+		for (; !escaped && i < iterations; ++i)
+		{
+			if (!SceneFunctions::MandelbulbStep(positionDouble, orbitDouble))
+			{
+				break;
+			}
+		}
+
+		SceneFunctions::Vector4<double> color;
+		return SceneFunctions::MandelbulbDistance(orbitDouble, color);
+	}
+
+	// Marches the deep zoom ray given by its offset from the reference point and returns the step count.
+	template <class T, bool Mixed = false>
+	int DeepZoomSteps(const SceneFunctions::Vector3<DoubleDouble>& reference, const Eigen::Vector3d& origin,
+		const Eigen::Vector3d& ray, const int fractalIterations, const double pixelAngle, uint64_t& evaluations)
+	{
+		const SceneFunctions::MarchConstants constants = SceneFunctions::GetMarchConstants(Scene::Mandelbulb);
+
+		double t = 0.;
+		for (int i = 0; i < constants.maxIterations; ++i)
+		{
+			// Only the sum with the reference point needs the extended precision.
+			const Eigen::Vector3d offset = origin + t * ray;
+			SceneFunctions::Vector3<T> position;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				position(axis) = T(reference(axis) + DoubleDouble(offset(axis)));
+			}
+
+			double dist;
+			if constexpr (Mixed)
+			{
+				dist = MixedPrecisionMandelbulb(position, fractalIterations, t * pixelAngle);
+			}
+			else
+			{
+				SceneFunctions::Vector4<T> color;
+				dist = double(SceneFunctions::Mandelbulb(position, color, fractalIterations));
+			}
+			++evaluations;
+
+			t += dist;
+
+			if (dist < constants.epsilon * t * .25)
+			{
+				return i;
+			}
+
+			if (t > DEEP_ZOOM_MAX_DISTANCE)
+			{
+				break;
+			}
+		}
+
+		return constants.maxIterations;
+	}
+}
+
+bool SameSceneGeometry(const CpuRenderSettings& a, const CpuRenderSettings& b)
+{
+	return a.scene == b.scene && a.time == b.time && a.fractalIterations == b.fractalIterations &&
+		std::memcmp(&a.parameters, &b.parameters, sizeof(SceneParameters)) == 0;
+}
+
+CpuRenderer::CpuRenderer(ThreadPool& threadPool)
+	: threadPool(threadPool), tileArenas(threadPool)
+{
+}
+
+void CpuRenderer::SetSettings(const CpuRenderSettings& newSettings)
+{
+	settings = newSettings;
+}
+
+const CpuRenderSettings& CpuRenderer::GetSettings() const
+{
+	return settings;
+}
+
+void CpuRenderer::Render(const Camera::RayBasis& rayBasis, const int width, const int height, uint8_t* pixels) const
+{
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	threadPool.ParallelFor(uint32_t(tilesX * tilesY), [&](const uint32_t tile)
+	{
+		const int x0 = int(tile % tilesX) * TILE_SIZE;
+		const int y0 = int(tile / tilesX) * TILE_SIZE;
+		RenderTile(rayBasis, width, height, x0, y0, std::min(x0 + TILE_SIZE, width), std::min(y0 + TILE_SIZE, height), pixels);
+	});
+}
+
+void CpuRenderer::Render(const Camera::RayBasis& rayBasis, const int width, const int height, uint8_t* pixels,
+	ShadowHistory& history) const
+{
+	BeginShadowFrame(history, rayBasis, width, height);
+
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	threadPool.ParallelFor(uint32_t(tilesX * tilesY), [&](const uint32_t tile)
+	{
+		const int x0 = int(tile % tilesX) * TILE_SIZE;
+		const int y0 = int(tile / tilesX) * TILE_SIZE;
+		RenderTile(rayBasis, width, height, x0, y0, std::min(x0 + TILE_SIZE, width), std::min(y0 + TILE_SIZE, height), pixels, &history);
+	});
+
+	EndShadowFrame(history);
+}
+
+void CpuRenderer::RenderGBuffer(const Camera::RayBasis& rayBasis, const ImageShape& shape, GBuffer& gbuffer) const
+{
+	gbuffer.Resize(shape);
+	gbuffer.rayBasis = rayBasis;
+
+	const int width = shape.width;
+	const int height = shape.height;
+
+	const SceneFunctions::MarchConstants constants = GetMarchConstants();
+	const int fractalIterations = GetFractalIterations();
+	const bool sphereScene = settings.scene == Scene::Sphere || settings.scene == Scene::Spheres;
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	threadPool.ParallelFor(uint32_t(tilesX * tilesY), [&](const uint32_t tile)
+	{
+		const int x0 = int(tile % tilesX) * TILE_SIZE;
+		const int y0 = int(tile / tilesX) * TILE_SIZE;
+		uint64_t evaluations = 0;
+
+		for (int y = y0; y < std::min(y0 + TILE_SIZE, height); ++y)
+		{
+			for (int x = x0; x < std::min(x0 + TILE_SIZE, width); ++x)
+			{
+				const size_t i = shape.Index(x, y);
+				const Vector3 origin = gbuffer.GetOrigin(x, y);
+				const Vector3 ray = gbuffer.GetRay(x, y);
+				const MarchResult march = March(origin, ray, 0.f, 0, evaluations);
+				gbuffer.depths(i) = march.t;
+				gbuffer.steps(i) = march.steps;
+				gbuffer.hits(i) = march.hit ? 1 : 0;
+
+				const Vector3 position = origin + march.t * ray;
+				const Vector3 normal = march.hit || sphereScene ? SurfaceNormal(settings.scene, position, settings.time, constants.epsilon,
+					fractalIterations, settings.parameters, evaluations) : Vector3::Zero();
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					gbuffer.normals(i, axis) = normal(axis);
+				}
+
+				// Only the mandelbulb has an orbit trap, taken at the point the march stopped.
+				SceneFunctions::Vector4<float> color = SceneFunctions::Vector4<float>::Zero();
+				if (march.hit && settings.scene == Scene::Mandelbulb)
+				{
+					color = SceneFunctions::Distance(settings.scene, position, settings.time, fractalIterations, settings.parameters).color;
+					++evaluations;
+				}
+				for (int channel = 0; channel < 4; ++channel)
+				{
+					gbuffer.colors(i, channel) = color(channel);
+				}
+			}
+		}
+
+		distanceEvaluations += evaluations;
+	});
+}
+
+void CpuRenderer::RenderShadows(const GBuffer& gbuffer, ImageBuffer<float>& factors, ShadowHistory* history) const
+{
+	const int width = gbuffer.shape.width;
+	const int height = gbuffer.shape.height;
+	factors.Resize(gbuffer.shape);
+	factors.Fill(1.f);
+	if (GetShadowBlockSize() == 0)
+	{
+		return;
+	}
+
+	if (history)
+	{
+		BeginShadowFrame(*history, gbuffer.rayBasis, width, height);
+	}
+
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	threadPool.ParallelFor(uint32_t(tilesX * tilesY), [&](const uint32_t tile)
+	{
+		const int x0 = int(tile % tilesX) * TILE_SIZE;
+		const int y0 = int(tile / tilesX) * TILE_SIZE;
+		const int x1 = std::min(x0 + TILE_SIZE, width);
+		const int y1 = std::min(y0 + TILE_SIZE, height);
+		const int tileWidth = x1 - x0;
+		const size_t pixelCount = size_t(tileWidth) * (y1 - y0);
+		uint64_t evaluations = 0;
+
+		Arena& arena = tileArenas.Get();
+		const ArenaScope scope(arena);
+		MarchResult* marches = arena.Allocate<MarchResult>(pixelCount);
+		Vector3* positions = arena.Allocate<Vector3>(pixelCount);
+		Vector3* normals = arena.Allocate<Vector3>(pixelCount);
+		for (int y = y0; y < y1; ++y)
+		{
+			for (int x = x0; x < x1; ++x)
+			{
+				const size_t i = size_t(y - y0) * tileWidth + (x - x0);
+				const size_t pixel = gbuffer.shape.Index(x, y);
+				marches[i] = { gbuffer.depths(pixel), gbuffer.steps(pixel), gbuffer.hits(pixel) != 0 };
+				positions[i] = gbuffer.GetPosition(x, y);
+				normals[i] = gbuffer.GetNormal(pixel);
+			}
+		}
+
+		float* tileFactors = arena.Allocate<float>(pixelCount);
+		ShadeTileShadows(gbuffer.rayBasis, width, height, x0, y0, x1, y1, marches, positions, normals, history, tileFactors, evaluations);
+		for (int y = y0; y < y1; ++y)
+		{
+			for (int x = x0; x < x1; ++x)
+			{
+				factors(gbuffer.shape.Index(x, y)) = tileFactors[size_t(y - y0) * tileWidth + (x - x0)];
+			}
+		}
+
+		distanceEvaluations += evaluations;
+	});
+
+	if (history)
+	{
+		EndShadowFrame(*history);
+	}
+}
+
+template <class Write>
+void CpuRenderer::CompositeTiles(const GBuffer& gbuffer, const ImageBuffer<float>* shadows, const ImageBuffer<float>* occlusion,
+	const SamplePlan* plan, const Write& write) const
+{
+	const ImageShape& shape = gbuffer.shape;
+	const int tilesX = (shape.width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (shape.height + TILE_SIZE - 1) / TILE_SIZE;
+	assert(!plan || plan->shape == shape);
+
+	// By tiles, which are contiguous in the tiled layout.
+	threadPool.ParallelFor(uint32_t(tilesX * tilesY), [&](const uint32_t tile)
+	{
+		const int x0 = int(tile % tilesX) * TILE_SIZE;
+		const int y0 = int(tile / tilesX) * TILE_SIZE;
+		const int samples = plan ? plan->tileSamples[tile] : 1;
+		uint64_t evaluations = 0;
+		for (int y = y0; y < std::min(y0 + TILE_SIZE, shape.height); ++y)
+		{
+			for (int x = x0; x < std::min(x0 + TILE_SIZE, shape.width); ++x)
+			{
+				const size_t i = shape.Index(x, y);
+				const MarchResult march = { gbuffer.depths(i), gbuffer.steps(i), gbuffer.hits(i) != 0 };
+				Vector3 color = ShadeSurface(gbuffer.rayBasis, gbuffer.GetPosition(x, y), gbuffer.GetNormal(i), march);
+				if (samples > 1)
+				{
+					// The G-buffer holds the first sample, the others are marched around it.
+					for (int sample = 1; sample < samples; ++sample)
+					{
+						const Eigen::Vector2f offset = SampleOffset(sample);
+						const float u = (x + offset.x()) / float(std::max(shape.width - 1, 1));
+						const float v = (y + offset.y()) / float(std::max(shape.height - 1, 1));
+						const Vector3 origin = gbuffer.rayBasis.origin0 + u * gbuffer.rayBasis.originHorizontal + v * gbuffer.rayBasis.originVertical;
+						const Vector3 ray = (gbuffer.rayBasis.ray0 + u * gbuffer.rayBasis.horizontal + v * gbuffer.rayBasis.vertical).normalized();
+						color += Shade(gbuffer.rayBasis, origin, ray, March(origin, ray, 0.f, 0, evaluations), evaluations);
+					}
+					color /= float(samples);
+				}
+				if (shadows)
+				{
+					color = (*shadows)(i) * color;
+				}
+				if (occlusion)
+				{
+					color = (*occlusion)(i) * color;
+				}
+				write(x, y, i, color);
+			}
+		}
+		distanceEvaluations += evaluations;
+	});
+}
+
+void CpuRenderer::Composite(const GBuffer& gbuffer, const ImageBuffer<float>* shadows, const ImageBuffer<float>* occlusion,
+	uint8_t* pixels, const SamplePlan* plan) const
+{
+	CompositeTiles(gbuffer, shadows, occlusion, plan, [&](const int x, const int y, size_t, const Vector3& color)
+	{
+		WritePixel(pixels + (size_t(y) * gbuffer.shape.width + x) * CHANNELS, color);
+	});
+}
+
+void CpuRenderer::Composite(const GBuffer& gbuffer, const ImageBuffer<float>* shadows, const ImageBuffer<float>* occlusion,
+	ImageBuffer<float>& colors, const SamplePlan* plan) const
+{
+	colors.Resize(gbuffer.shape, 3);
+	CompositeTiles(gbuffer, shadows, occlusion, plan, [&](int, int, const size_t index, const Vector3& color)
+	{
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			colors(index, channel) = color(channel);
+		}
+	});
+}
+
+void CpuRenderer::PlanSamples(const GBuffer& gbuffer, const SamplingSettings& sampling, SamplePlan& plan) const
+{
+	const ImageShape& shape = gbuffer.shape;
+	const int tilesX = (shape.width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (shape.height + TILE_SIZE - 1) / TILE_SIZE;
+	const size_t tileCount = size_t(tilesX) * tilesY;
+	const int maxSamples = std::clamp(sampling.maxSamples, 1, 255);
+	plan.shape = shape;
+	plan.tileSamples.resize(tileCount);
+	plan.tileScores.resize(tileCount);
+	plan.histogram.assign(size_t(maxSamples), 0);
+
+	const float maxIterations = float(GetMarchConstants().maxIterations);
+	threadPool.ParallelFor(uint32_t(tileCount), [&](const uint32_t tile)
+	{
+		const int x0 = int(tile % tilesX) * TILE_SIZE;
+		const int y0 = int(tile / tilesX) * TILE_SIZE;
+		const int x1 = std::min(x0 + TILE_SIZE, shape.width);
+		const int y1 = std::min(y0 + TILE_SIZE, shape.height);
+		uint64_t stepSum = 0;
+		uint64_t stepSquares = 0;
+		uint32_t edges = 0;
+		for (int y = y0; y < y1; ++y)
+		{
+			for (int x = x0; x < x1; ++x)
+			{
+				const size_t i = shape.Index(x, y);
+				const uint64_t steps = uint64_t(gbuffer.steps(i));
+				stepSum += steps;
+				stepSquares += steps * steps;
+				// Neighbours within the tile only, like the work groups of the shader.
+				const bool edge = (x + 1 < x1 && IsDiscontinuity(gbuffer, i, shape.Index(x + 1, y))) ||
+					(y + 1 < y1 && IsDiscontinuity(gbuffer, i, shape.Index(x, y + 1)));
+				edges += edge ? 1 : 0;
+			}
+		}
+
+		const double pixelCount = double(x1 - x0) * (y1 - y0);
+		const double mean = stepSum / pixelCount;
+		const double spread = std::sqrt(std::max(stepSquares / pixelCount - mean * mean, 0.)) / maxIterations;
+		plan.tileScores[tile] = float(spread + edges / pixelCount);
+	});
+
+	// The tiles of the last column and row may be partial.
+	const auto tilePixels = [&](const size_t tile)
+	{
+		const int x0 = int(tile % tilesX) * TILE_SIZE;
+		const int y0 = int(tile / tilesX) * TILE_SIZE;
+		return uint64_t(std::min(TILE_SIZE, shape.width - x0)) * std::min(TILE_SIZE, shape.height - y0);
+	};
+	const auto samplesAt = [&](const float scale, const float score)
+	{
+		return 1 + int(std::min(scale * score, float(maxSamples - 1)));
+	};
+
+	if (sampling.uniform)
+	{
+		plan.scale = 0.f;
+		std::fill(plan.tileSamples.begin(), plan.tileSamples.end(), uint8_t(std::clamp(int(sampling.budget), 1, maxSamples)));
+	}
+	else
+	{
+		const double budget = std::max(sampling.budget, 1.f) * double(shape.width) * shape.height;
+		const auto fits = [&](const float scale)
+		{
+			uint64_t samples = 0;
+			for (size_t tile = 0; tile < tileCount; ++tile)
+			{
+				samples += tilePixels(tile) * samplesAt(scale, plan.tileScores[tile]);
+			}
+			return double(samples) <= budget;
+		};
+
+		// The samples grow with the scale, bisect for the largest one within the budget. A scale
+		// of zero takes one sample per pixel, which always fits.
+		float low = 0.f;
+		float high = 1.f;
+		while (fits(high) && high < 1e9f)
+		{
+			low = high;
+			high *= 2.f;
+		}
+		if (fits(high))
+		{
+			low = high;
+		}
+		for (int i = 0; i < 24 && low < high; ++i)
+		{
+			const float middle = .5f * (low + high);
+			(fits(middle) ? low : high) = middle;
+		}
+		plan.scale = low;
+		for (size_t tile = 0; tile < tileCount; ++tile)
+		{
+			plan.tileSamples[tile] = uint8_t(samplesAt(low, plan.tileScores[tile]));
+		}
+	}
+
+	plan.samples = 0;
+	for (size_t tile = 0; tile < tileCount; ++tile)
+	{
+		const uint64_t pixelCount = tilePixels(tile);
+		plan.samples += pixelCount * plan.tileSamples[tile];
+		plan.histogram[plan.tileSamples[tile] - 1] += uint32_t(pixelCount);
+	}
+}
+
+void CpuRenderer::RenderSerial(const Camera::RayBasis& rayBasis, const int width, const int height, uint8_t* pixels) const
+{
+	RenderTile(rayBasis, width, height, 0, 0, width, height, pixels);
+}
+
+std::vector<uint8_t> CpuRenderer::RenderBatch(const std::vector<Camera>& cameras, const int width, const int height) const
+{
+	const size_t viewSize = size_t(width) * height * CHANNELS;
+	std::vector<uint8_t> images(viewSize * cameras.size());
+
+	threadPool.ParallelFor(uint32_t(cameras.size()), [&](const uint32_t view)
+	{
+		Camera camera = cameras[view];
+		camera.SetAspect(width / float(height));
+		camera.UpdateRayBasis();
+		RenderTile(camera.GetRayBasis(), width, height, 0, 0, width, height, images.data() + view * viewSize);
+	});
+
+	return images;
+}
+
+void CpuRenderer::RenderStereo(const Camera::RayBasis& left, const Camera::RayBasis& right, const int width, const int height,
+	uint8_t* leftPixels, uint8_t* rightPixels) const
+{
+	const SceneFunctions::MarchConstants constants = GetMarchConstants();
+	const int fractalIterations = GetFractalIterations();
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	threadPool.ParallelFor(uint32_t(tilesX * tilesY), [&](const uint32_t tile)
+	{
+		const int x0 = int(tile % tilesX) * TILE_SIZE;
+		const int y0 = int(tile / tilesX) * TILE_SIZE;
+		uint64_t evaluations = 0;
+
+		for (int y = y0; y < std::min(y0 + TILE_SIZE, height); ++y)
+		{
+			for (int x = x0; x < std::min(x0 + TILE_SIZE, width); ++x)
+			{
+				const float u = x / float(std::max(width - 1, 1));
+				const float v = y / float(std::max(height - 1, 1));
+				const Vector3 leftOrigin = left.origin0 + u * left.originHorizontal + v * left.originVertical;
+				const Vector3 leftRay = (left.ray0 + u * left.horizontal + v * left.vertical).normalized();
+				const Vector3 rightOrigin = right.origin0 + u * right.originHorizontal + v * right.originVertical;
+				const Vector3 rightRay = (right.ray0 + u * right.horizontal + v * right.vertical).normalized();
+
+				// Joint phase - the estimate at the midpoint of the two sample points bounds both of
+				// them through the Lipschitz property of the estimator: DE(p) >= DE(mid) - |p - mid|.
+				float t = 0.f;
+				int iteration = 0;
+				for (; iteration < constants.maxIterations; ++iteration)
+				{
+					const Vector3 leftPosition = leftOrigin + t * leftRay;
+					const Vector3 rightPosition = rightOrigin + t * rightRay;
+					const float separation = (leftPosition - rightPosition).norm();
+					const float dist = SceneFunctions::Distance(settings.scene, Vector3(.5f * (leftPosition + rightPosition)), settings.time,
+						fractalIterations, settings.parameters).dist;
+					++evaluations;
+
+					const float step = dist - .5f * separation;
+					if (separation >= .5f * dist || IsHit(step, t) || IsHit(step, t + step) || t + step > constants.maxDistance)
+					{
+						// Diverged or close to the surface - the rays finish separately from here.
+						break;
+					}
+
+					t += step;
+				}
+
+				const MarchResult leftMarch = March(leftOrigin, leftRay, t, iteration, evaluations);
+				const MarchResult rightMarch = March(rightOrigin, rightRay, t, iteration, evaluations);
+
+				const Vector3 leftColor = Shade(left, leftOrigin, leftRay, leftMarch, evaluations);
+				const Vector3 rightColor = Shade(right, rightOrigin, rightRay, rightMarch, evaluations);
+				WritePixel(leftPixels + (size_t(y) * width + x) * CHANNELS, leftColor);
+				WritePixel(rightPixels + (size_t(y) * width + x) * CHANNELS, rightColor);
+			}
+		}
+
+		distanceEvaluations += evaluations;
+	});
+}
+
+DeepZoomPrecision CpuRenderer::RenderDeepZoom(const DeepZoomView& view, const int width, const int height, uint8_t* pixels,
+	DeepZoomPrecision precision) const
+{
+	if (precision == DeepZoomPrecision::Automatic)
+	{
+		precision = SelectDeepZoomPrecision(view, height);
+	}
+
+	const Eigen::Vector3d forward = view.forward.normalized();
+	const Eigen::Vector3d aside = forward.cross(view.up).normalized();
+	const Eigen::Vector3d up = aside.cross(forward);
+	const double halfHeight = std::tan(SceneUtils::DegsToRads(view.fov) * .5);
+	const double halfWidth = halfHeight * view.aspect;
+	const Eigen::Vector3d ray0 = forward - halfWidth * aside - halfHeight * up;
+	const double pixelAngle = 2. * halfHeight / height;
+
+	const int maxIterations = SceneFunctions::GetMarchConstants(Scene::Mandelbulb).maxIterations;
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	threadPool.ParallelFor(uint32_t(tilesX * tilesY), [&](const uint32_t tile)
+	{
+		const int x0 = int(tile % tilesX) * TILE_SIZE;
+		const int y0 = int(tile / tilesX) * TILE_SIZE;
+		uint64_t evaluations = 0;
+
+		for (int y = y0; y < std::min(y0 + TILE_SIZE, height); ++y)
+		{
+			for (int x = x0; x < std::min(x0 + TILE_SIZE, width); ++x)
+			{
+				const double u = x / double(std::max(width - 1, 1));
+				const double v = y / double(std::max(height - 1, 1));
+				const Eigen::Vector3d ray = (ray0 + 2. * u * halfWidth * aside + 2. * v * halfHeight * up).normalized();
+
+				int steps = maxIterations;
+				switch (precision)
+				{
+				case DeepZoomPrecision::Float:
+					steps = DeepZoomSteps<float>(view.reference, view.position, ray, view.fractalIterations, pixelAngle, evaluations);
+					break;
+				case DeepZoomPrecision::Double:
+					steps = DeepZoomSteps<double>(view.reference, view.position, ray, view.fractalIterations, pixelAngle, evaluations);
+					break;
+				case DeepZoomPrecision::DoubleDoubleFull:
+					steps = DeepZoomSteps<DoubleDouble>(view.reference, view.position, ray, view.fractalIterations, pixelAngle, evaluations);
+					break;
+				case DeepZoomPrecision::DoubleDouble:
+				default:
+					steps = DeepZoomSteps<DoubleDouble, true>(view.reference, view.position, ray, view.fractalIterations, pixelAngle, evaluations);
+					break;
+				}
+
+				WritePixel(pixels + (size_t(y) * width + x) * CHANNELS, Vector3::Constant(1.f - steps / float(maxIterations)));
+			}
+		}
+
+		distanceEvaluations += evaluations;
+	});
+
+	return precision;
+}
+
+DeepZoomPrecision CpuRenderer::SelectDeepZoomPrecision(const DeepZoomView& view, const int height)
+{
+	// Distance between neighbouring rays at the reference point relative to its magnitude.
+	const double footprint = view.position.norm() * 2. * std::tan(SceneUtils::DegsToRads(view.fov) * .5) / height;
+	const double magnitude = std::max(1., double(view.reference.norm()));
+	const double relativeFootprint = footprint / magnitude;
+
+	// Keep a margin of about a thousand units in the last place per pixel.
+	if (relativeFootprint > 1e3 * std::numeric_limits<float>::epsilon())
+	{
+		return DeepZoomPrecision::Float;
+	}
+	if (relativeFootprint > 1e3 * std::numeric_limits<double>::epsilon())
+	{
+		return DeepZoomPrecision::Double;
+	}
+	return DeepZoomPrecision::DoubleDouble;
+}
+
+uint64_t CpuRenderer::GetDistanceEvaluations() const
+{
+	return distanceEvaluations;
+}
+
+ArenaStatistics CpuRenderer::GetArenaStatistics() const
+{
+	return tileArenas.GetStatistics();
+}
+
+void CpuRenderer::ResetStatistics()
+{
+	distanceEvaluations = 0;
+	tileArenas.ResetStatistics();
+}
+
+CpuRenderer::MarchResult CpuRenderer::March(const Eigen::Vector3f& origin, const Eigen::Vector3f& ray, float t, int iteration,
+	uint64_t& evaluations) const
+{
+	const SceneFunctions::MarchConstants constants = GetMarchConstants();
+	const int fractalIterations = GetFractalIterations();
+	const bool sphereScene = settings.scene == Scene::Sphere || settings.scene == Scene::Spheres;
+
+	for (; iteration < constants.maxIterations; ++iteration)
+	{
+		const float dist = SceneFunctions::Distance(settings.scene, Vector3(origin + t * ray), settings.time, fractalIterations,
+			settings.parameters).dist;
+		++evaluations;
+
+		// The sphere shaders test before stepping, the fractal shaders after.
+		if (sphereScene && IsHit(dist, t))
+		{
+			return { t, iteration, true };
+		}
+
+		t += dist;
+
+		if (!sphereScene && IsHit(dist, t))
+		{
+			return { t, iteration, true };
+		}
+
+		if (t > constants.maxDistance)
+		{
+			break;
+		}
+	}
+
+	return { t, constants.maxIterations, false };
+}
+
+Eigen::Vector3f CpuRenderer::Shade(const Camera::RayBasis& rayBasis, const Eigen::Vector3f& origin, const Eigen::Vector3f& ray,
+	const MarchResult& march, uint64_t& evaluations) const
+{
+	const Vector3 hitPosition = origin + march.t * ray;
+	if (settings.scene == Scene::Mandelbulb || settings.scene == Scene::RecursiveTetrahedron)
+	{
+		return ShadeSurface(rayBasis, hitPosition, Vector3::Zero(), march);
+	}
+
+	const Vector3 normal = SurfaceNormal(settings.scene, hitPosition, settings.time, GetMarchConstants().epsilon, GetFractalIterations(),
+		settings.parameters, evaluations);
+	return ShadeSurface(rayBasis, hitPosition, normal, march);
+}
+
+Eigen::Vector3f CpuRenderer::ShadeSurface(const Camera::RayBasis& rayBasis, const Eigen::Vector3f& hitPosition, const Eigen::Vector3f& normal,
+	const MarchResult& march) const
+{
+	if (settings.scene == Scene::Mandelbulb || settings.scene == Scene::RecursiveTetrahedron)
+	{
+		return Vector3::Constant(1.f - march.steps / float(GetMarchConstants().maxIterations));
+	}
+
+	if (settings.scene == Scene::Sphere)
+	{
+		return normal;
+	}
+
+	const Vector3 lightPosition(rayBasis.origin0.x(), rayBasis.origin0.y(), -12.f);
+	const Vector3 lightDirection = (lightPosition - hitPosition).normalized();
+	const float lightDistance = (lightPosition - hitPosition).norm();
+	const float diffuseMask = 10.f * normal.dot(lightDirection) / lightDistance;
+	return Vector3::Constant(march.hit ? diffuseMask : 0.f);
+}
+
+float CpuRenderer::Shadow(const Eigen::Vector3f& position, uint64_t& evaluations) const
+{
+	const Vector3 normal = SurfaceNormal(settings.scene, position, settings.time, GetMarchConstants().epsilon, GetFractalIterations(),
+		settings.parameters, evaluations);
+	return Shadow(position, normal, evaluations);
+}
+
+float CpuRenderer::Shadow(const Eigen::Vector3f& position, const Eigen::Vector3f& normal, uint64_t& evaluations) const
+{
+	const SceneFunctions::MarchConstants constants = GetMarchConstants();
+	const int fractalIterations = GetFractalIterations();
+	const Vector3 origin = position + normal * constants.epsilon;
+	const float lightDistance = (LIGHT_POSITION - origin).norm();
+	const Vector3 direction = (LIGHT_POSITION - origin) / lightDistance;
+
+	float factor = 1.f;
+	float t = 0.f;
+	for (int i = 0; i < SHADOW_ITERATIONS; ++i)
+	{
+		const float h = SceneFunctions::Distance(settings.scene, Vector3(origin + t * direction), settings.time, fractalIterations,
+			settings.parameters).dist;
+		++evaluations;
+		factor = std::min(factor, SHADOW_SHARPNESS * h / t);
+
+		// The factor is clamped to SHADOW_MIN, below it the penumbra is saturated.
+		if (factor < SHADOW_MIN)
+		{
+			break;
+		}
+
+		t += std::clamp(h, .01f, .2f);
+
+		// Nothing beyond the light occludes it.
+		if (t > lightDistance)
+		{
+			break;
+		}
+	}
+
+	return std::clamp(factor, SHADOW_MIN, 1.f);
+}
+
+int CpuRenderer::GetShadowBlockSize() const
+{
+	if (settings.scene != Scene::Mandelbulb && settings.scene != Scene::RecursiveTetrahedron)
+	{
+		return 0;
+	}
+
+	switch (settings.shadows)
+	{
+	case ShadowMode::Full:
+		return 1;
+	case ShadowMode::Half:
+		return 2;
+	case ShadowMode::Off:
+	default:
+		return 0;
+	}
+}
+
+void CpuRenderer::BeginShadowFrame(ShadowHistory& history, const Camera::RayBasis& rayBasis, const int width, const int height) const
+{
+	history.hasPrevious = history.hasPrevious && SameShadowScene(history.previous.settings, settings);
+	history.current.settings = settings;
+	history.current.rayBasis = rayBasis;
+	history.current.width = width;
+	history.current.height = height;
+	history.current.samples.assign(size_t(width) * height, Eigen::Vector4f(0.f, 0.f, 0.f, -1.f));
+	history.reused = 0;
+	history.traced = 0;
+}
+
+void CpuRenderer::EndShadowFrame(ShadowHistory& history)
+{
+	std::swap(history.previous, history.current);
+	history.hasPrevious = true;
+}
+
+bool CpuRenderer::IsHit(const float dist, const float t) const
+{
+	const float epsilon = GetMarchConstants().epsilon;
+	switch (settings.scene)
+	{
+	case Scene::Mandelbulb:
+		return dist < epsilon * t * .25f;
+	case Scene::RecursiveTetrahedron:
+		return dist < epsilon * t;
+	case Scene::Sphere:
+	case Scene::Spheres:
+	default:
+		return dist < epsilon;
+	}
+}
+
+SceneFunctions::MarchConstants CpuRenderer::GetMarchConstants() const
+{
+	SceneFunctions::MarchConstants constants = SceneFunctions::GetMarchConstants(settings.scene);
+	constants.maxIterations = settings.maxIterations > 0 ? settings.maxIterations : constants.maxIterations;
+	constants.epsilon = settings.epsilon > 0.f ? settings.epsilon : constants.epsilon;
+	return constants;
+}
+
+int CpuRenderer::GetFractalIterations() const
+{
+	return settings.fractalIterations > 0 ? settings.fractalIterations : SceneFunctions::FRACTAL_ITERATIONS;
+}
+
+void CpuRenderer::RenderTile(const Camera::RayBasis& rayBasis, const int width, const int height,
+	const int x0, const int y0, const int x1, const int y1, uint8_t* pixels, ShadowHistory* history) const
+{
+	uint64_t evaluations = 0;
+
+	if (GetShadowBlockSize() == 0)
+	{
+		for (int y = y0; y < y1; ++y)
+		{
+			for (int x = x0; x < x1; ++x)
+			{
+				// Same parametrization as pixelRay() and pixelOrigin().
+				const float u = x / float(std::max(width - 1, 1));
+				const float v = y / float(std::max(height - 1, 1));
+				const Vector3 origin = rayBasis.origin0 + u * rayBasis.originHorizontal + v * rayBasis.originVertical;
+				const Vector3 ray = (rayBasis.ray0 + u * rayBasis.horizontal + v * rayBasis.vertical).normalized();
+
+				const MarchResult march = March(origin, ray, 0.f, 0, evaluations);
+				WritePixel(pixels + (size_t(y) * width + x) * CHANNELS, Shade(rayBasis, origin, ray, march, evaluations));
+			}
+		}
+
+		distanceEvaluations += evaluations;
+		return;
+	}
+
+	// The shadows are upsampled from the surface of the neighbouring pixels, so the whole tile
+	// is marched before it is shaded.
+	const int tileWidth = x1 - x0;
+	const size_t pixelCount = size_t(tileWidth) * (y1 - y0);
+	Arena& arena = tileArenas.Get();
+	const ArenaScope scope(arena);
+	MarchResult* marches = arena.Allocate<MarchResult>(pixelCount);
+	Vector3* origins = arena.Allocate<Vector3>(pixelCount);
+	Vector3* rays = arena.Allocate<Vector3>(pixelCount);
+	Vector3* positions = arena.Allocate<Vector3>(pixelCount);
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = x0; x < x1; ++x)
+		{
+			const size_t i = size_t(y - y0) * tileWidth + (x - x0);
+			const float u = x / float(std::max(width - 1, 1));
+			const float v = y / float(std::max(height - 1, 1));
+			origins[i] = rayBasis.origin0 + u * rayBasis.originHorizontal + v * rayBasis.originVertical;
+			rays[i] = (rayBasis.ray0 + u * rayBasis.horizontal + v * rayBasis.vertical).normalized();
+			marches[i] = March(origins[i], rays[i], 0.f, 0, evaluations);
+			positions[i] = origins[i] + marches[i].t * rays[i];
+		}
+	}
+
+	float* factors = arena.Allocate<float>(pixelCount);
+	ShadeTileShadows(rayBasis, width, height, x0, y0, x1, y1, marches, positions, nullptr, history, factors, evaluations);
+
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = x0; x < x1; ++x)
+		{
+			const size_t i = size_t(y - y0) * tileWidth + (x - x0);
+			const Vector3 color = factors[i] * Shade(rayBasis, origins[i], rays[i], marches[i], evaluations);
+			WritePixel(pixels + (size_t(y) * width + x) * CHANNELS, color);
+		}
+	}
+
+	distanceEvaluations += evaluations;
+}
+
+void CpuRenderer::ShadeTileShadows(const Camera::RayBasis& rayBasis, const int width, const int height,
+	const int x0, const int y0, const int x1, const int y1, const MarchResult* marches, const Vector3* positions,
+	const Vector3* normals, ShadowHistory* history, float* factors, uint64_t& evaluations) const
+{
+	const int blockSize = GetShadowBlockSize();
+	const int tileWidth = x1 - x0;
+	std::fill_n(factors, size_t(tileWidth) * (y1 - y0), 1.f);
+
+	const auto trace = [&](const size_t i)
+	{
+		return normals ? Shadow(positions[i], normals[i], evaluations) : Shadow(positions[i], evaluations);
+	};
+
+	// Traces the shadow of a pixel or takes it over from the previous frame.
+	const auto sample = [&](const int x, const int y)
+	{
+		const size_t i = size_t(y - y0) * tileWidth + (x - x0);
+		float factor = 1.f;
+		if (history)
+		{
+			// About a pixel block at the depth of the sample, a moving camera hits the surface
+			// points of the previous frame up to that far apart.
+			const float u = x / float(std::max(width - 1, 1));
+			const float v = y / float(std::max(height - 1, 1));
+			const float footprint = SceneUtils::PixelFootprint(rayBasis, u, v, marches[i].t, height);
+			if (history->hasPrevious && history->Find(positions[i], blockSize, 1.5f * blockSize * footprint, factor))
+			{
+				++history->reused;
+			}
+			else
+			{
+				factor = trace(i);
+				++history->traced;
+			}
+			history->current.samples[size_t(y) * width + x] = Eigen::Vector4f(positions[i].x(), positions[i].y(), positions[i].z(), factor);
+			return factor;
+		}
+		return trace(i);
+	};
+
+	// One sample per block at its first pixel. Blocks are aligned to the image, tiles start at
+	// multiples of the block size.
+	const int blocksX = (tileWidth + blockSize - 1) / blockSize;
+	const int blocksY = (y1 - y0 + blockSize - 1) / blockSize;
+	float* blockFactors = tileArenas.Get().Allocate<float>(size_t(blocksX) * blocksY);
+	std::fill_n(blockFactors, size_t(blocksX) * blocksY, 1.f);
+	for (int by = 0; by < blocksY; ++by)
+	{
+		for (int bx = 0; bx < blocksX; ++bx)
+		{
+			const int x = x0 + bx * blockSize;
+			const int y = y0 + by * blockSize;
+			if (marches[size_t(y - y0) * tileWidth + (x - x0)].hit)
+			{
+				blockFactors[size_t(by) * blocksX + bx] = sample(x, y);
+			}
+		}
+	}
+
+	// Bilinear upsampling, leaving out the samples of other surfaces. Pixels without a sample of
+	// their own surface nearby trace their own shadow.
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = x0; x < x1; ++x)
+		{
+			const size_t i = size_t(y - y0) * tileWidth + (x - x0);
+			if (!marches[i].hit)
+			{
+				continue;
+			}
+
+			const float fx = (x - x0) / float(blockSize);
+			const float fy = (y - y0) / float(blockSize);
+			const int bx0 = int(fx);
+			const int by0 = int(fy);
+			const int bx1 = std::min(bx0 + 1, blocksX - 1);
+			const int by1 = std::min(by0 + 1, blocksY - 1);
+			const float wx = fx - bx0;
+			const float wy = fy - by0;
+			const int corners[4][2] = { { bx0, by0 }, { bx1, by0 }, { bx0, by1 }, { bx1, by1 } };
+			const float bilinear[4] = { (1.f - wx) * (1.f - wy), wx * (1.f - wy), (1.f - wx) * wy, wx * wy };
+
+			float factor = 0.f;
+			float weight = 0.f;
+			for (int c = 0; c < 4; ++c)
+			{
+				const size_t blockPixel = size_t(corners[c][1] * blockSize) * tileWidth + corners[c][0] * blockSize;
+				if (!marches[blockPixel].hit || bilinear[c] == 0.f)
+				{
+					continue;
+				}
+				const float depthWeight = 1.f - std::abs(marches[blockPixel].t - marches[i].t) / (SHADOW_DEPTH_TOLERANCE * marches[i].t);
+				if (depthWeight > 0.f)
+				{
+					factor += bilinear[c] * depthWeight * blockFactors[size_t(corners[c][1]) * blocksX + corners[c][0]];
+					weight += bilinear[c] * depthWeight;
+				}
+			}
+			factors[i] = weight > 1e-3f ? factor / weight : sample(x, y);
+		}
+	}
+}
+
+void GBuffer::Resize(const ImageShape& newShape)
+{
+	shape = newShape;
+	depths.Resize(shape);
+	normals.Resize(shape, 3);
+	colors.Resize(shape, 4);
+	steps.Resize(shape);
+	hits.Resize(shape);
+}
+
+Eigen::Vector3f GBuffer::GetOrigin(const int x, const int y) const
+{
+	// Same parametrization as pixelRay() and pixelOrigin().
+	const float u = x / float(std::max(shape.width - 1, 1));
+	const float v = y / float(std::max(shape.height - 1, 1));
+	return rayBasis.origin0 + u * rayBasis.originHorizontal + v * rayBasis.originVertical;
+}
+
+Eigen::Vector3f GBuffer::GetRay(const int x, const int y) const
+{
+	const float u = x / float(std::max(shape.width - 1, 1));
+	const float v = y / float(std::max(shape.height - 1, 1));
+	return (rayBasis.ray0 + u * rayBasis.horizontal + v * rayBasis.vertical).normalized();
+}
+
+Eigen::Vector3f GBuffer::GetPosition(const int x, const int y) const
+{
+	return GetOrigin(x, y) + depths(shape.Index(x, y)) * GetRay(x, y);
+}
+
+Eigen::Vector3f GBuffer::GetNormal(const size_t index) const
+{
+	return Eigen::Vector3f(normals(index, 0), normals(index, 1), normals(index, 2));
+}
+
+Eigen::Vector4f GBuffer::GetColor(const size_t index) const
+{
+	return Eigen::Vector4f(colors(index, 0), colors(index, 1), colors(index, 2), colors(index, 3));
+}
+
+int SamplePlan::GetSamples(const int x, const int y) const
+{
+	const int tilesX = (shape.width + ImageShape::TILE_SIZE - 1) / ImageShape::TILE_SIZE;
+	return tileSamples[size_t(y / ImageShape::TILE_SIZE) * tilesX + x / ImageShape::TILE_SIZE];
+}
+
+void ShadowHistory::Clear()
+{
+	hasPrevious = false;
+}
+
+uint32_t ShadowHistory::GetReusedCount() const
+{
+	return reused;
+}
+
+uint32_t ShadowHistory::GetTracedCount() const
+{
+	return traced;
+}
+
+bool ShadowHistory::Find(const Eigen::Vector3f& position, const int blockSize, const float tolerance, float& factor) const
+{
+	float u, v;
+	if (!SceneUtils::ProjectToImage(previous.rayBasis, position, u, v))
+	{
+		return false;
+	}
+
+	// The samples of the blocks around the point and of the pixels which traced their own, the
+	// nearest one on the same surface wins.
+	const int px = std::clamp(int(u * (previous.width - 1)), 0, previous.width - 1);
+	const int py = std::clamp(int(v * (previous.height - 1)), 0, previous.height - 1);
+	float nearest = tolerance;
+	bool found = false;
+	for (int y = py / blockSize * blockSize; y <= py + blockSize && y < previous.height; ++y)
+	{
+		for (int x = px / blockSize * blockSize; x <= px + blockSize && x < previous.width; ++x)
+		{
+			const Eigen::Vector4f& sample = previous.samples[size_t(y) * previous.width + x];
+			const float distance = (sample.head<3>() - position).norm();
+			if (sample.w() >= 0.f && distance <= nearest)
+			{
+				nearest = distance;
+				factor = sample.w();
+				found = true;
+			}
+		}
+	}
+	return found;
+}
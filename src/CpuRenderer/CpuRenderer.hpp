@@ -0,0 +1,335 @@
+#pragma once
+#include "Arena.hpp"
+#include "DoubleDouble.hpp"
+#include "ImageBuffer.hpp"
+#include "SceneFunctions.hpp"
+#include "ThreadPool.hpp"
+#include "../Camera/Camera.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/// Soft shadows of the fractal scenes, the SHADOW_RESOLUTION constant of common/shadow.glsl.
+enum class ShadowMode
+{
+	Off,
+	/// One shadow ray per pixel.
+	Full,
+	/// One shadow ray per 2x2 pixels, upsampled from the samples at the depth of the pixel.
+	Half
+};
+
+/// Settings shared by all views rendered by the CPU renderer.
+struct CpuRenderSettings
+{
+	Scene scene = Scene::Mandelbulb;
+	/// Value of the time uniform in seconds.
+	float time = 0.f;
+	/// Overrides of the shader constants MAX_ITERATIONS, EPSILON and FRACTAL_ITERATIONS, zero
+	/// keeps the default of the scene shader.
+	int maxIterations = 0;
+	float epsilon = 0.f;
+	int fractalIterations = 0;
+	/// Value of the sceneParameters uniform.
+	SceneParameters parameters;
+	ShadowMode shadows = ShadowMode::Off;
+};
+
+/// Whether the distance estimates of the scene are the same with both settings, so anything
+/// computed from them at a surface point stays valid.
+bool SameSceneGeometry(const CpuRenderSettings& a, const CpuRenderSettings& b);
+
+/// Surface seen by the pixels of a view, written by CpuRenderer::RenderGBuffer() for the passes
+/// which shade it separately - CpuRenderer::RenderShadows(), AmbientOcclusionPass and
+/// CpuRenderer::Composite(). Every attribute is a float image of its own in the layout of the
+/// shape, so a pass only streams through the attributes it reads. The counterpart of the images
+/// the fractal shaders write with GBUFFER_OUTPUT (common/gbuffer.glsl).
+struct GBuffer
+{
+	ImageShape shape;
+	Camera::RayBasis rayBasis;
+	/// Ray distance at which the march stopped.
+	ImageBuffer<float> depths;
+	/// Surface normal where the march stopped (x, y, z). Zero for the rays of the fractal scenes
+	/// which missed, the sphere scenes are shaded with the normal of every ray.
+	ImageBuffer<float> normals;
+	/// Orbit trap color of the surface (r, g, b, a), zero in the scenes without one.
+	ImageBuffer<float> colors;
+	ImageBuffer<int> steps;
+	ImageBuffer<uint8_t> hits;
+
+	void Resize(const ImageShape& shape);
+
+	/// Origin and normalized direction of the ray of the pixel.
+	Eigen::Vector3f GetOrigin(int x, int y) const;
+	Eigen::Vector3f GetRay(int x, int y) const;
+	/// Point of the pixel's ray where the march stopped.
+	Eigen::Vector3f GetPosition(int x, int y) const;
+	/// Attributes at the index of ImageShape::Index().
+	Eigen::Vector3f GetNormal(size_t index) const;
+	Eigen::Vector4f GetColor(size_t index) const;
+};
+
+/// Per-frame sample budget of adaptive supersampling, see CpuRenderer::PlanSamples().
+struct SamplingSettings
+{
+	/// Depth difference between neighbouring pixels, as a fraction of the nearer depth, above
+	/// which they are on either side of an edge. ADAPTIVE_DEPTH_TOLERANCE of
+	/// common/adaptive-sampling.glsl.
+	static constexpr float DEPTH_TOLERANCE = .05f;
+
+	/// Samples per pixel of the frame on average, the first sample of every pixel included.
+	float budget = 2.f;
+	/// Samples of a pixel at most, ADAPTIVE_MAX_SAMPLES of common/adaptive-sampling.glsl.
+	int maxSamples = 16;
+	/// Spreads the budget evenly over the pixels instead, uniform supersampling at the same cost.
+	bool uniform = false;
+};
+
+/// Samples the pixels of every tile of a G-buffer take. A tile is scored by the spread of its
+/// step counts - the shading of the fractal scenes - and the fraction of its pixels at a depth
+/// or hit discontinuity, then takes 1 + floor(scale * score) samples, at most
+/// SamplingSettings::maxSamples. The scale is the largest one whose samples fit the budget, so
+/// smooth tiles of sky or plane keep their single sample and fractal edges get the rest.
+struct SamplePlan
+{
+	ImageShape shape;
+	/// Samples of every pixel of the tile, CpuRenderer::TILE_SIZE tiles in row-major order.
+	std::vector<uint8_t> tileSamples;
+	std::vector<float> tileScores;
+	/// Samples per unit of score, ADAPTIVE_SAMPLE_SCALE of common/adaptive-sampling.glsl.
+	float scale = 0.f;
+	/// Samples of the frame, the first ones included.
+	uint64_t samples = 0;
+	/// Pixels by their sample count, entry n - 1 holds the pixels with n samples.
+	std::vector<uint32_t> histogram;
+
+	/// Samples of the pixel.
+	int GetSamples(int x, int y) const;
+};
+
+/// Shadow samples of the previous frame of a view. A shadow sample is taken over when its
+/// surface point reprojects onto a sample of the previous frame at the same point and neither
+/// the scene nor the light has changed, so a static scene only traces the shadows of surface
+/// which was not visible before - the camera may move.
+class ShadowHistory
+{
+public:
+	/// Forgets the previous frame, the next one traces every shadow.
+	void Clear();
+
+	/// Shadow samples of the last frame taken over from the frame before and traced anew.
+	uint32_t GetReusedCount() const;
+	uint32_t GetTracedCount() const;
+
+private:
+	friend class CpuRenderer;
+
+	struct Frame
+	{
+		CpuRenderSettings settings;
+		Camera::RayBasis rayBasis;
+		int width = 0;
+		int height = 0;
+		/// Surface point and shadow factor per pixel, w is negative where the pixel holds no sample.
+		std::vector<Eigen::Vector4f> samples;
+	};
+
+	/// Looks up the shadow factor of the surface point in the previous frame.
+	/// @param tolerance Distance up to which a sample counts as the same surface point
+	bool Find(const Eigen::Vector3f& position, int blockSize, float tolerance, float& factor) const;
+
+	Frame previous;
+	Frame current;
+	bool hasPrevious = false;
+	std::atomic<uint32_t> reused{ 0 };
+	std::atomic<uint32_t> traced{ 0 };
+};
+
+/// Floating point type the distance estimator of a deep zoom render is evaluated in.
+enum class DeepZoomPrecision
+{
+	Float,
+	Double,
+	/// Double-double only for the first iterations of an orbit, until the orbit has amplified
+	/// the pixel footprint enough for double precision to resolve it, then double.
+	DoubleDouble,
+	/// Double-double for the whole orbit, the reference for the other precisions.
+	DoubleDoubleFull,
+	/// Picks the cheapest precision that still resolves a pixel at the view's zoom depth.
+	Automatic
+};
+
+/// View of a deep zoom render into the mandelbulb. The camera is kept in double precision
+/// relative to a reference point stored in double-double precision, so the pixel footprint
+/// can go far below the resolution of float or double absolute coordinates.
+struct DeepZoomView
+{
+	SceneFunctions::Vector3<DoubleDouble> reference;
+	/// Camera position relative to the reference point.
+	Eigen::Vector3d position;
+	Eigen::Vector3d forward;
+	Eigen::Vector3d up;
+	/// Vertical field of view in degrees.
+	double fov = 60.;
+	double aspect = 1.;
+	/// Fractal iterations of the distance estimator. The estimate stops resolving the surface
+	/// below a distance that shrinks with the iteration count - about 8 more iterations are
+	/// needed per decade of zoom.
+	int fractalIterations = SceneFunctions::FRACTAL_ITERATIONS;
+};
+
+/// Software counterpart of the compute shaders in src/Shaders.
+/// Marches the same scenes with the same constants and writes RGBA8 pixels in row-major order,
+/// so it can be used for offline rendering and on machines without a GPU.
+/// A renderer is driven by one thread outside its pool, the first one to render with it, or
+/// by the workers of the pool - the scratch memory of that thread is not shared.
+class CpuRenderer
+{
+public:
+	/// Edge length of the square tiles an image is split into, matches the shaders' local size.
+	static constexpr int TILE_SIZE = 16;
+	/// Number of bytes per output pixel.
+	static constexpr int CHANNELS = 4;
+	/// Shadow march constants of common/shadow.glsl.
+	static constexpr int SHADOW_ITERATIONS = 64;
+	static constexpr float SHADOW_SHARPNESS = 20.f;
+	static constexpr float SHADOW_MIN = .3f;
+
+	explicit CpuRenderer(ThreadPool& threadPool);
+
+	void SetSettings(const CpuRenderSettings& settings);
+	const CpuRenderSettings& GetSettings() const;
+
+	/// Renders a single view with the tiles distributed across the thread pool.
+	/// @param pixels Destination of width * height * CHANNELS bytes.
+	void Render(const Camera::RayBasis& rayBasis, int width, int height, uint8_t* pixels) const;
+
+	/// Renders a single view like Render(), taking over the shadows of the previous frame of the
+	/// view where they are still valid and storing the shadows of this one in the history.
+	void Render(const Camera::RayBasis& rayBasis, int width, int height, uint8_t* pixels, ShadowHistory& history) const;
+
+	/// Marches every pixel of the view and stores what it hit, with the tiles distributed across
+	/// the thread pool. Shading, shadows and occlusion are left to the passes reading the G-buffer.
+	/// @param shape Size of the view and layout of the G-buffer images.
+	void RenderGBuffer(const Camera::RayBasis& rayBasis, const ImageShape& shape, GBuffer& gbuffer) const;
+	/// Shadow factor of every pixel of the G-buffer the way Render() computes it, all ones without
+	/// shadows. The factors take the shape of the G-buffer.
+	/// @param history Takes over the shadows of the previous frame where they are still valid, see
+	///                the Render() overload taking one. May be null.
+	void RenderShadows(const GBuffer& gbuffer, ImageBuffer<float>& factors, ShadowHistory* history = nullptr) const;
+	/// Shades the G-buffer the way the scene shader does and writes the RGBA8 rows of the view, the
+	/// only conversion from the layout of the G-buffer.
+	/// @param shadows Shadow factor of every pixel in the shape of the G-buffer, null for none.
+	/// @param occlusion Ambient occlusion factor of every pixel in the shape of the G-buffer, null for none.
+	/// @param pixels Destination of width * height * CHANNELS bytes.
+	/// @param plan Supersamples the pixels the plan gives more than one sample, averaging the shading
+	///             of their rays before the shadow and occlusion factors are applied. May be null.
+	void Composite(const GBuffer& gbuffer, const ImageBuffer<float>* shadows, const ImageBuffer<float>* occlusion, uint8_t* pixels,
+		const SamplePlan* plan = nullptr) const;
+	/// Composite() into the RGB colors of the G-buffer pixels in its shape instead, for passes working
+	/// on the shaded image such as UpscalePass.
+	void Composite(const GBuffer& gbuffer, const ImageBuffer<float>* shadows, const ImageBuffer<float>* occlusion,
+		ImageBuffer<float>& colors, const SamplePlan* plan = nullptr) const;
+	/// Scores the tiles of the G-buffer and spreads the sample budget of the frame over them, for
+	/// an adaptively supersampled Composite().
+	void PlanSamples(const GBuffer& gbuffer, const SamplingSettings& sampling, SamplePlan& plan) const;
+
+	/// Renders a single view on the calling thread, for callers which spread whole views across
+	/// the workers themselves.
+	void RenderSerial(const Camera::RayBasis& rayBasis, int width, int height, uint8_t* pixels) const;
+
+	/// Renders the scene from each of the cameras, one task per view.
+	/// The camera aspect ratio is overridden to match the output size.
+	/// @returns Images stored back to back, view i starting at i * width * height * CHANNELS.
+	std::vector<uint8_t> RenderBatch(const std::vector<Camera>& cameras, int width, int height) const;
+
+	/// Renders both eyes of a stereo pair. Rays of matching pixels are marched together with
+	/// a single distance estimate taken between the two sample points, for as long as the
+	/// points are closer to each other than half of that distance. Afterwards each ray
+	/// finishes on its own, so the images match independent renders up to the step sizes.
+	/// @param leftPixels Destination of width * height * CHANNELS bytes for the left eye.
+	/// @param rightPixels Destination of width * height * CHANNELS bytes for the right eye.
+	void RenderStereo(const Camera::RayBasis& left, const Camera::RayBasis& right, int width, int height,
+		uint8_t* leftPixels, uint8_t* rightPixels) const;
+
+	/// Renders the bare mandelbulb fractal (no plane, no animation) for deep zooms.
+	/// Ray offsets from the reference point are marched in double precision and the distance
+	/// estimator is evaluated in the given precision at reference + offset.
+	/// @returns The precision that has been used.
+	DeepZoomPrecision RenderDeepZoom(const DeepZoomView& view, int width, int height, uint8_t* pixels,
+		DeepZoomPrecision precision = DeepZoomPrecision::Automatic) const;
+
+	/// Returns the cheapest precision that resolves neighbouring pixels of the view.
+	static DeepZoomPrecision SelectDeepZoomPrecision(const DeepZoomView& view, int height);
+
+	/// Number of distance estimator evaluations since the last reset.
+	uint64_t GetDistanceEvaluations() const;
+	/// Allocations from the arenas of the tiles since the last reset. No heap allocations once the
+	/// arenas have grown to the largest tile of the frames rendered.
+	ArenaStatistics GetArenaStatistics() const;
+	void ResetStatistics();
+
+private:
+	/// State of a ray after marching.
+	struct MarchResult
+	{
+		float t;
+		int steps;
+		bool hit;
+	};
+
+	/// Marches the ray from distance t and the given iteration onwards.
+	MarchResult March(const Eigen::Vector3f& origin, const Eigen::Vector3f& ray, float t, int iteration,
+		uint64_t& evaluations) const;
+
+	/// Computes the color of the pixel the way the scene shader does.
+	Eigen::Vector3f Shade(const Camera::RayBasis& rayBasis, const Eigen::Vector3f& origin, const Eigen::Vector3f& ray,
+		const MarchResult& march, uint64_t& evaluations) const;
+	/// Shade() with the surface normal at the hit position given, it is only read by the sphere scenes.
+	Eigen::Vector3f ShadeSurface(const Camera::RayBasis& rayBasis, const Eigen::Vector3f& hitPosition, const Eigen::Vector3f& normal,
+		const MarchResult& march) const;
+
+	/// Soft shadow factor in [SHADOW_MIN, 1] of the point toward the light, shadow() of
+	/// common/shadow.glsl.
+	float Shadow(const Eigen::Vector3f& position, uint64_t& evaluations) const;
+	float Shadow(const Eigen::Vector3f& position, const Eigen::Vector3f& normal, uint64_t& evaluations) const;
+
+	/// Edge length of the pixel blocks sharing a shadow ray, zero without shadows.
+	int GetShadowBlockSize() const;
+
+	/// Starts a frame of the history, forgetting the previous one if the settings have changed.
+	void BeginShadowFrame(ShadowHistory& history, const Camera::RayBasis& rayBasis, int width, int height) const;
+	/// Makes the frame the previous one.
+	static void EndShadowFrame(ShadowHistory& history);
+
+	/// Whether the distance estimate terminates the march in the current scene.
+	bool IsHit(float dist, float t) const;
+
+	/// March constants of the scene with the overrides of the settings applied.
+	SceneFunctions::MarchConstants GetMarchConstants() const;
+	int GetFractalIterations() const;
+
+	void RenderTile(const Camera::RayBasis& rayBasis, int width, int height,
+		int x0, int y0, int x1, int y1, uint8_t* pixels, ShadowHistory* history = nullptr) const;
+
+	/// Shadow factors of the marched pixels of a tile, one shadow ray per block of pixels. The
+	/// arrays hold the tile's pixels in row-major order.
+	/// @param normals Surface normals of the pixels, null to compute them where needed.
+	/// @param factors Receives the factor of every pixel.
+	void ShadeTileShadows(const Camera::RayBasis& rayBasis, int width, int height, int x0, int y0, int x1, int y1,
+		const MarchResult* marches, const Eigen::Vector3f* positions, const Eigen::Vector3f* normals, ShadowHistory* history,
+		float* factors, uint64_t& evaluations) const;
+
+	/// Shades the pixels of the G-buffer for Composite() and calls write(x, y, index, color) with each.
+	template <class Write>
+	void CompositeTiles(const GBuffer& gbuffer, const ImageBuffer<float>* shadows, const ImageBuffer<float>* occlusion,
+		const SamplePlan* plan, const Write& write) const;
+
+	ThreadPool& threadPool;
+	CpuRenderSettings settings;
+	mutable std::atomic<uint64_t> distanceEvaluations{ 0 };
+	/// Transient data of the tiles, rewound when a tile is done.
+	mutable ThreadArenas tileArenas;
+};
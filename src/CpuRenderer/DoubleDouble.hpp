@@ -0,0 +1,237 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// Unevaluated sum of two doubles giving roughly 106 bits of mantissa.
+/// Arithmetic, sqrt, sin, cos, atan2, acos and integer or half-integer powers are accurate to
+/// double-double precision. log and other powers evaluate the double function at the high
+/// part and correct it to first order with the low part, so they are only accurate to double
+/// precision - enough for the final distance estimate, which is not iterated on.
+struct DoubleDouble
+{
+	double hi = 0.;
+	double lo = 0.;
+
+	constexpr DoubleDouble() = default;
+	constexpr DoubleDouble(const double value) : hi(value), lo(0.) {}
+	constexpr DoubleDouble(const double high, const double low) : hi(high), lo(low) {}
+
+	explicit operator double() const { return hi + lo; }
+	explicit operator float() const { return float(hi + lo); }
+
+	/// Sum of two doubles, exact.
+	static DoubleDouble TwoSum(const double a, const double b)
+	{
+		const double s = a + b;
+		const double bb = s - a;
+		return { s, (a - (s - bb)) + (b - bb) };
+	}
+
+	/// Sum of two doubles where |a| >= |b|, exact.
+	static DoubleDouble QuickTwoSum(const double a, const double b)
+	{
+		const double s = a + b;
+		return { s, b - (s - a) };
+	}
+
+	/// Product of two doubles, exact.
+	static DoubleDouble TwoProduct(const double a, const double b)
+	{
+		const double p = a * b;
+		return { p, std::fma(a, b, -p) };
+	}
+
+	DoubleDouble& operator+=(const DoubleDouble& other) { return *this = *this + other; }
+	DoubleDouble& operator-=(const DoubleDouble& other) { return *this = *this - other; }
+	DoubleDouble& operator*=(const DoubleDouble& other) { return *this = *this * other; }
+	DoubleDouble& operator/=(const DoubleDouble& other) { return *this = *this / other; }
+
+	DoubleDouble operator-() const { return { -hi, -lo }; }
+
+	friend DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		DoubleDouble s = TwoSum(a.hi, b.hi);
+		const DoubleDouble t = TwoSum(a.lo, b.lo);
+		s.lo += t.hi;
+		s = QuickTwoSum(s.hi, s.lo);
+		s.lo += t.lo;
+		return QuickTwoSum(s.hi, s.lo);
+	}
+
+	friend DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		return a + -b;
+	}
+
+	friend DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		DoubleDouble p = TwoProduct(a.hi, b.hi);
+		p.lo += a.hi * b.lo + a.lo * b.hi;
+		return QuickTwoSum(p.hi, p.lo);
+	}
+
+	friend DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		const double q1 = a.hi / b.hi;
+		DoubleDouble r = a - b * q1;
+		const double q2 = r.hi / b.hi;
+		r = r - b * q2;
+		const double q3 = r.hi / b.hi;
+		return QuickTwoSum(q1, q2) + q3;
+	}
+
+	friend bool operator<(const DoubleDouble& a, const DoubleDouble& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+	friend bool operator>(const DoubleDouble& a, const DoubleDouble& b) { return b < a; }
+	friend bool operator<=(const DoubleDouble& a, const DoubleDouble& b) { return !(b < a); }
+	friend bool operator>=(const DoubleDouble& a, const DoubleDouble& b) { return !(a < b); }
+	friend bool operator==(const DoubleDouble& a, const DoubleDouble& b) { return a.hi == b.hi && a.lo == b.lo; }
+	friend bool operator!=(const DoubleDouble& a, const DoubleDouble& b) { return !(a == b); }
+};
+
+inline DoubleDouble abs(const DoubleDouble& a) { return a.hi < 0. ? -a : a; }
+
+inline DoubleDouble sqrt(const DoubleDouble& a)
+{
+	if (a.hi <= 0.)
+	{
+		return DoubleDouble(0.);
+	}
+
+	// One Newton step from the double estimate doubles the number of correct bits.
+	const double s = std::sqrt(a.hi);
+	const DoubleDouble residual = a - DoubleDouble::TwoProduct(s, s);
+	return DoubleDouble::QuickTwoSum(s, residual.hi / (2. * s));
+}
+
+inline DoubleDouble floor(const DoubleDouble& a)
+{
+	const double hi = std::floor(a.hi);
+	return hi == a.hi ? DoubleDouble::QuickTwoSum(hi, std::floor(a.lo)) : DoubleDouble(hi);
+}
+
+/// Computes sine and cosine together by reduction to [-pi/4, pi/4] and Taylor series.
+inline void sincos(const DoubleDouble& a, DoubleDouble& sine, DoubleDouble& cosine)
+{
+	const DoubleDouble halfPi(1.5707963267948966, 6.123233995736766e-17);
+	const double quadrant = std::nearbyint(a.hi / halfPi.hi);
+	const DoubleDouble r = a - halfPi * quadrant;
+	const DoubleDouble r2 = r * r;
+
+	DoubleDouble sinTerm = r;
+	DoubleDouble cosTerm(1.);
+	DoubleDouble s = sinTerm;
+	DoubleDouble c = cosTerm;
+	for (int n = 1; n < 16; ++n)
+	{
+		sinTerm = -sinTerm * r2 / DoubleDouble(double((2 * n) * (2 * n + 1)));
+		cosTerm = -cosTerm * r2 / DoubleDouble(double((2 * n - 1) * (2 * n)));
+		s += sinTerm;
+		c += cosTerm;
+		if (std::abs(sinTerm.hi) < 1e-34 && std::abs(cosTerm.hi) < 1e-34)
+		{
+			break;
+		}
+	}
+
+	switch (int(std::fmod(quadrant, 4.) + 4.) % 4)
+	{
+	case 0: sine = s; cosine = c; break;
+	case 1: sine = c; cosine = -s; break;
+	case 2: sine = -s; cosine = -c; break;
+	default: sine = -c; cosine = s; break;
+	}
+}
+
+inline DoubleDouble sin(const DoubleDouble& a)
+{
+	DoubleDouble sine, cosine;
+	sincos(a, sine, cosine);
+	return sine;
+}
+
+inline DoubleDouble cos(const DoubleDouble& a)
+{
+	DoubleDouble sine, cosine;
+	sincos(a, sine, cosine);
+	return cosine;
+}
+
+inline DoubleDouble atan2(const DoubleDouble& y, const DoubleDouble& x)
+{
+	// One Newton step on the double estimate: the angle between (x, y) and (cos, sin).
+	const DoubleDouble angle(std::atan2(y.hi, x.hi));
+	if (x.hi == 0. && y.hi == 0.)
+	{
+		return angle;
+	}
+
+	DoubleDouble sine, cosine;
+	sincos(angle, sine, cosine);
+	return angle + (y * cosine - x * sine) / (x * cosine + y * sine);
+}
+
+inline DoubleDouble acos(const DoubleDouble& a)
+{
+	return atan2(sqrt((DoubleDouble(1.) - a) * (DoubleDouble(1.) + a)), a);
+}
+
+inline DoubleDouble log(const DoubleDouble& a) { return DoubleDouble::TwoSum(std::log(a.hi), a.lo / a.hi); }
+
+inline DoubleDouble pow(const DoubleDouble& a, const DoubleDouble& exponent)
+{
+	// Integer powers by squaring stay exact to double-double precision.
+	const double e = exponent.hi;
+	if (e != std::floor(e) && 2. * e == std::floor(2. * e))
+	{
+		return pow(a, DoubleDouble(e - .5)) * sqrt(a);
+	}
+	if (e == std::floor(e) && std::abs(e) <= 64.)
+	{
+		DoubleDouble result(1.);
+		DoubleDouble base = a;
+		for (int n = int(std::abs(e)); n > 0; n >>= 1)
+		{
+			if (n & 1)
+			{
+				result *= base;
+			}
+			base *= base;
+		}
+		return e < 0. ? DoubleDouble(1.) / result : result;
+	}
+
+	const double p = std::pow(a.hi, e);
+	return DoubleDouble::TwoSum(p, p * e * a.lo / a.hi);
+}
+
+namespace Eigen
+{
+	template <>
+	struct NumTraits<DoubleDouble> : GenericNumTraits<DoubleDouble>
+	{
+		typedef DoubleDouble Real;
+		typedef DoubleDouble NonInteger;
+		typedef DoubleDouble Nested;
+		typedef DoubleDouble Literal;
+
+		enum
+		{
+			IsComplex = 0,
+			IsInteger = 0,
+			IsSigned = 1,
+			RequireInitialization = 0,
+			ReadCost = 2,
+			AddCost = 20,
+			MulCost = 10
+		};
+
+		static inline Real epsilon() { return DoubleDouble(4.93038065763132e-32); }
+		static inline Real dummy_precision() { return DoubleDouble(1e-28); }
+		static inline Real highest() { return DoubleDouble(std::numeric_limits<double>::max()); }
+		static inline Real lowest() { return DoubleDouble(std::numeric_limits<double>::lowest()); }
+		static inline int digits10() { return 31; }
+	};
+}
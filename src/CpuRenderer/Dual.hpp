@@ -0,0 +1,174 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// Value together with its derivatives with respect to N variables (forward-mode automatic
+/// differentiation). Evaluating the templated distance estimators of SceneFunctions with
+/// Dual<T, 3> seeded by Variable() gives the estimate and its gradient in a single pass.
+/// The derivatives are a fixed-size Eigen array, so the operations on all of them compile to a
+/// few SIMD instructions when N fills a register (N = 4 for float with SSE). Functions with a singular derivative (sqrt at 0, acos at +-1, atan2
+/// at the origin) return a zero derivative there, comparisons only look at the value.
+template <class T, int N = 3>
+struct Dual
+{
+	using Derivatives = Eigen::Array<T, N, 1>;
+
+	T value = T(0);
+	Derivatives derivatives = Derivatives::Zero();
+
+	Dual() = default;
+	/// Constant, its derivatives are zero.
+	Dual(const T value) : value(value) {}
+	Dual(const T value, const Derivatives& derivatives) : value(value), derivatives(derivatives) {}
+
+	/// The index-th of the N variables.
+	static Dual Variable(const T value, const int index)
+	{
+		Dual variable(value);
+		variable.derivatives(index) = T(1);
+		return variable;
+	}
+
+	explicit operator T() const { return value; }
+
+	Dual& operator+=(const Dual& other) { return *this = *this + other; }
+	Dual& operator-=(const Dual& other) { return *this = *this - other; }
+	Dual& operator*=(const Dual& other) { return *this = *this * other; }
+	Dual& operator/=(const Dual& other) { return *this = *this / other; }
+
+	Dual operator-() const { return Dual(-value, -derivatives); }
+
+	friend Dual operator+(const Dual& a, const Dual& b) { return Dual(a.value + b.value, a.derivatives + b.derivatives); }
+	friend Dual operator-(const Dual& a, const Dual& b) { return Dual(a.value - b.value, a.derivatives - b.derivatives); }
+
+	friend Dual operator*(const Dual& a, const Dual& b)
+	{
+		return Dual(a.value * b.value, a.derivatives * b.value + b.derivatives * a.value);
+	}
+
+	friend Dual operator/(const Dual& a, const Dual& b)
+	{
+		const T inverse = T(1) / b.value;
+		const T quotient = a.value * inverse;
+		return Dual(quotient, (a.derivatives - b.derivatives * quotient) * inverse);
+	}
+
+	friend bool operator<(const Dual& a, const Dual& b) { return a.value < b.value; }
+	friend bool operator>(const Dual& a, const Dual& b) { return a.value > b.value; }
+	friend bool operator<=(const Dual& a, const Dual& b) { return a.value <= b.value; }
+	friend bool operator>=(const Dual& a, const Dual& b) { return a.value >= b.value; }
+	friend bool operator==(const Dual& a, const Dual& b) { return a.value == b.value; }
+	friend bool operator!=(const Dual& a, const Dual& b) { return a.value != b.value; }
+};
+
+template <class T, int N>
+Dual<T, N> abs(const Dual<T, N>& a)
+{
+	return a.value < T(0) ? -a : a;
+}
+
+template <class T, int N>
+Dual<T, N> floor(const Dual<T, N>& a)
+{
+	return Dual<T, N>(std::floor(a.value));
+}
+
+template <class T, int N>
+Dual<T, N> sqrt(const Dual<T, N>& a)
+{
+	if (!(a.value > T(0)))
+	{
+		return Dual<T, N>(T(0));
+	}
+	const T root = std::sqrt(a.value);
+	return Dual<T, N>(root, a.derivatives * (T(.5) / root));
+}
+
+template <class T, int N>
+Dual<T, N> sin(const Dual<T, N>& a)
+{
+	return Dual<T, N>(std::sin(a.value), a.derivatives * std::cos(a.value));
+}
+
+template <class T, int N>
+Dual<T, N> cos(const Dual<T, N>& a)
+{
+	return Dual<T, N>(std::cos(a.value), a.derivatives * -std::sin(a.value));
+}
+
+template <class T, int N>
+Dual<T, N> atan2(const Dual<T, N>& y, const Dual<T, N>& x)
+{
+	const T length2 = x.value * x.value + y.value * y.value;
+	if (!(length2 > T(0)))
+	{
+		return Dual<T, N>(std::atan2(y.value, x.value));
+	}
+	return Dual<T, N>(std::atan2(y.value, x.value), (y.derivatives * x.value - x.derivatives * y.value) / length2);
+}
+
+template <class T, int N>
+Dual<T, N> acos(const Dual<T, N>& a)
+{
+	const T sine2 = T(1) - a.value * a.value;
+	if (!(sine2 > T(0)))
+	{
+		return Dual<T, N>(std::acos(std::clamp(a.value, T(-1), T(1))));
+	}
+	return Dual<T, N>(std::acos(a.value), a.derivatives * (T(-1) / std::sqrt(sine2)));
+}
+
+template <class T, int N>
+Dual<T, N> log(const Dual<T, N>& a)
+{
+	return Dual<T, N>(std::log(a.value), a.derivatives / a.value);
+}
+
+template <class T, int N>
+Dual<T, N> pow(const Dual<T, N>& a, const Dual<T, N>& exponent)
+{
+	const T p = std::pow(a.value, exponent.value);
+	if (a.value == T(0))
+	{
+		return Dual<T, N>(p);
+	}
+	Dual<T, N> result(p, a.derivatives * (exponent.value * p / a.value));
+	// The scenes raise to constant exponents, which saves the log.
+	if ((exponent.derivatives != T(0)).any())
+	{
+		result.derivatives += exponent.derivatives * (p * std::log(a.value));
+	}
+	return result;
+}
+
+namespace Eigen
+{
+	template <class T, int N>
+	struct NumTraits<Dual<T, N>> : GenericNumTraits<Dual<T, N>>
+	{
+		typedef Dual<T, N> Real;
+		typedef Dual<T, N> NonInteger;
+		typedef Dual<T, N> Nested;
+		typedef Dual<T, N> Literal;
+
+		enum
+		{
+			IsComplex = 0,
+			IsInteger = 0,
+			IsSigned = 1,
+			RequireInitialization = 1,
+			ReadCost = N + 1,
+			AddCost = N + 1,
+			MulCost = 2 * N + 1
+		};
+
+		static inline Real epsilon() { return Real(NumTraits<T>::epsilon()); }
+		static inline Real dummy_precision() { return Real(NumTraits<T>::dummy_precision()); }
+		static inline Real highest() { return Real(NumTraits<T>::highest()); }
+		static inline Real lowest() { return Real(NumTraits<T>::lowest()); }
+		static inline int digits10() { return NumTraits<T>::digits10(); }
+	};
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Order in which the pixels of an ImageBuffer channel are stored.
+enum class ImageLayout
+{
+	/// Row-major, pixel (x, y) at y * width + x.
+	Linear,
+	/// Square tiles of TILE_SIZE pixels stored one after the other in row-major order, the
+	/// pixels of a tile in Morton (Z) order. A tile is a contiguous block of memory, so the
+	/// passes working on the 16x16 tiles of the renderer - and their neighbourhoods, which stay
+	/// in the same or an adjacent block - touch few cache lines and pages.
+	Tiled
+};
+
+/// Size and layout of an image, maps pixel coordinates to the index into its channels.
+struct ImageShape
+{
+	/// Edge length of the tiles of ImageLayout::Tiled, CpuRenderer::TILE_SIZE.
+	static constexpr int TILE_SIZE = 16;
+
+	int width = 0;
+	int height = 0;
+	ImageLayout layout = ImageLayout::Linear;
+
+	/// Entries per channel, the tiled layout pads the image to whole tiles.
+	size_t GetSize() const
+	{
+		if (layout == ImageLayout::Linear)
+		{
+			return size_t(width) * height;
+		}
+		return size_t(GetTilesX()) * ((height + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE * TILE_SIZE;
+	}
+
+	/// Index of the pixel into the channels.
+	size_t Index(const int x, const int y) const
+	{
+		if (layout == ImageLayout::Linear)
+		{
+			return size_t(y) * width + x;
+		}
+		const size_t tile = size_t(y / TILE_SIZE) * GetTilesX() + x / TILE_SIZE;
+		return tile * TILE_SIZE * TILE_SIZE | (Spread(uint32_t(y % TILE_SIZE)) << 1 | Spread(uint32_t(x % TILE_SIZE)));
+	}
+
+	bool operator==(const ImageShape& other) const
+	{
+		return width == other.width && height == other.height && layout == other.layout;
+	}
+	bool operator!=(const ImageShape& other) const { return !(*this == other); }
+
+private:
+	int GetTilesX() const { return (width + TILE_SIZE - 1) / TILE_SIZE; }
+
+	// Moves the four bits of the tile coordinate to the even bits.
+	static uint32_t Spread(uint32_t value)
+	{
+		value = (value | value << 2) & 0x33u;
+		return (value | value << 1) & 0x55u;
+	}
+};
+
+/// Image of one or more channels, each stored in an array of its own (structure of arrays) in
+/// the order of the shape's layout. Holds the intermediate buffers of the CPU renderer, which are
+/// only converted to RGBA8 rows when the final pixels are written.
+template <class T>
+class ImageBuffer
+{
+public:
+	/// Resizes the channels, the contents are only kept when the shape stays the same.
+	void Resize(const ImageShape& newShape, const int newChannels = 1)
+	{
+		shape = newShape;
+		channels = newChannels;
+		size = shape.GetSize();
+		data.resize(size * channels);
+	}
+
+	void Fill(const T value) { data.assign(data.size(), value); }
+
+	const ImageShape& GetShape() const { return shape; }
+	int GetChannels() const { return channels; }
+
+	T* GetChannel(const int channel) { return data.data() + channel * size; }
+	const T* GetChannel(const int channel) const { return data.data() + channel * size; }
+
+	/// Value of the channel at the index of ImageShape::Index().
+	T& operator()(const size_t index, const int channel = 0) { return data[channel * size + index]; }
+	const T& operator()(const size_t index, const int channel = 0) const { return data[channel * size + index]; }
+
+private:
+	ImageShape shape;
+	int channels = 0;
+	size_t size = 0;
+	std::vector<T> data;
+};
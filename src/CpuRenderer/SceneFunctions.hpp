@@ -0,0 +1,456 @@
+#pragma once
+#include "Dual.hpp"
+#include "../Scene/SceneParameters.hpp"
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+
+/// Scenes available in src/Shaders which have a CPU counterpart.
+enum class Scene
+{
+	Mandelbulb,
+	RecursiveTetrahedron,
+	Sphere,
+	Spheres
+};
+
+/// Static class with C++ ports of the distance estimators used by the compute shaders.
+/// The functions are templated on the scalar type so that the same code can be evaluated in
+/// float (matching the shaders) or in higher precision.
+/// Keep the constants in sync with the corresponding .comp.glsl files, the ones the shaders
+/// read from the sceneParameters uniform are taken from SceneParameters.
+class SceneFunctions
+{
+public:
+	template <class T>
+	using Vector3 = Eigen::Matrix<T, 3, 1>;
+	template <class T>
+	using Vector4 = Eigen::Matrix<T, 4, 1>;
+
+	static constexpr int FRACTAL_ITERATIONS = 32;
+	/// Power of the bare mandelbulb, the scene takes it from SceneParameters.
+	static constexpr float FRACTAL_POWER = 8.f;
+
+	/// Distance estimate together with the orbit trap color of the surface (if the scene has one).
+	template <class T>
+	struct Hit
+	{
+		T dist;
+		Vector4<T> color;
+	};
+
+	/// March constants of a scene.
+	struct MarchConstants
+	{
+		float epsilon;
+		int maxIterations;
+		float maxDistance;
+	};
+
+	/// Returns the ray march constants the shader of the scene uses.
+	static MarchConstants GetMarchConstants(Scene scene)
+	{
+		switch (scene)
+		{
+		case Scene::Sphere:
+		case Scene::Spheres:
+			return { .001f, 10, 1000.f };
+		case Scene::Mandelbulb:
+		case Scene::RecursiveTetrahedron:
+		default:
+			return { .001f, 256, 10000.f };
+		}
+	}
+
+	template <class T>
+	static Vector3<T> RotateY(const Vector3<T>& p, T rad)
+	{
+		using std::cos;
+		using std::sin;
+		return Vector3<T>(p.x() * cos(rad) + p.z() * sin(rad), p.y(), -p.x() * sin(rad) + p.z() * cos(rad));
+	}
+
+	template <class T>
+	static Vector3<T> RotateZ(const Vector3<T>& p, T rad)
+	{
+		using std::cos;
+		using std::sin;
+		return Vector3<T>(p.x() * cos(rad) - p.y() * sin(rad), p.x() * sin(rad) + p.y() * cos(rad), p.z());
+	}
+
+	template <class T>
+	static T Plane(const Vector3<T>& position, const Vector3<T>& origin, const Vector3<T>& normal)
+	{
+		return (position - origin).dot(normal);
+	}
+
+	template <class T>
+	static T SmoothUnion(T d1, T d2, T k)
+	{
+		const T h = std::clamp(T(.5) + T(.5) * (d2 - d1) / k, T(0), T(1));
+		return d2 + (d1 - d2) * h - k * h * (T(1) - h);
+	}
+
+	/// Running state of the mandelbulb iteration.
+	template <class T>
+	struct MandelbulbOrbit
+	{
+		Vector3<T> w;
+		T m;
+		/// Running derivative, also the factor by which the orbit amplifies a position offset.
+		T dz;
+		Vector4<T> trap;
+	};
+
+	/// Starts the mandelbulb orbit of the position.
+	template <class T>
+	static MandelbulbOrbit<T> MandelbulbStart(const Vector3<T>& position)
+	{
+		using std::abs;
+
+		MandelbulbOrbit<T> orbit;
+		orbit.w = position;
+		orbit.m = position.squaredNorm();
+		orbit.dz = T(1);
+		orbit.trap = Vector4<T>(abs(position.x()), abs(position.y()), abs(position.z()), orbit.m);
+		return orbit;
+	}
+
+	/// Advances the mandelbulb orbit by one iteration.
+	/// @returns False once the orbit has escaped.
+	template <class T>
+	static bool MandelbulbStep(const Vector3<T>& position, MandelbulbOrbit<T>& orbit, const T power = T(FRACTAL_POWER))
+	{
+		using std::abs;
+		using std::acos;
+		using std::atan2;
+		using std::cos;
+		using std::pow;
+		using std::sin;
+		using std::sqrt;
+
+		// dz = power*z^(power-1)*dz
+		orbit.dz = power * pow(orbit.m, (power - T(1)) * T(.5)) * orbit.dz + T(1);
+
+		// z = z^power+z
+		const Vector3<T>& w = orbit.w;
+		const T r = sqrt(orbit.m);
+		const T b = power * acos(w.y() / r);
+		const T a = power * atan2(w.x(), w.z());
+		orbit.w = position + pow(r, power) * Vector3<T>(sin(b) * sin(a), cos(b), sin(b) * cos(a));
+
+		orbit.trap = orbit.trap.cwiseMin(Vector4<T>(abs(orbit.w.x()), abs(orbit.w.y()), abs(orbit.w.z()), orbit.m));
+
+		orbit.m = orbit.w.squaredNorm();
+		return !(orbit.m > T(256));
+	}
+
+	/// Distance estimate of a finished mandelbulb orbit (through the Hubbard-Douady potential).
+	template <class T>
+	static T MandelbulbDistance(const MandelbulbOrbit<T>& orbit, Vector4<T>& color)
+	{
+		using std::log;
+		using std::sqrt;
+
+		color = Vector4<T>(orbit.m, orbit.trap.y(), orbit.trap.z(), orbit.trap.w());
+		return T(.25) * log(orbit.m) * sqrt(orbit.m) / orbit.dz;
+	}
+
+	/// Mandelbulb distance estimate.
+	/// The iteration count bounds how close to the surface the estimate resolves.
+	template <class T>
+	static T Mandelbulb(const Vector3<T>& position, Vector4<T>& color, const int iterations = FRACTAL_ITERATIONS,
+		const T power = T(FRACTAL_POWER))
+	{
+		MandelbulbOrbit<T> orbit = MandelbulbStart(position);
+		for (int i = 0; i < iterations; ++i)
+		{
+			if (!MandelbulbStep(position, orbit, power))
+			{
+				break;
+			}
+		}
+		return MandelbulbDistance(orbit, color);
+	}
+
+	/// Sierpinski tetrahedron distance estimate through space folding.
+	/// @param scale, offset Scale and offset of every fold
+	template <class T>
+	static T RecursiveTetrahedron(const Vector3<T>& position, const int iterations = FRACTAL_ITERATIONS,
+		const T scale = T(SceneParameters().fractalScale), const T offset = T(SceneParameters().fractalOffset))
+	{
+		Vector3<T> z = position;
+		T w = T(1);
+		for (int i = 0; i < iterations; ++i)
+		{
+			if (z.x() + z.y() < T(0)) { const T x = z.x(); z.x() = -z.y(); z.y() = -x; }
+			if (z.x() + z.z() < T(0)) { const T x = z.x(); z.x() = -z.z(); z.z() = -x; }
+			if (z.y() + z.z() < T(0)) { const T y = z.y(); z.y() = -z.z(); z.z() = -y; }
+			z *= scale;
+			w *= scale;
+			z -= Vector3<T>::Constant(offset * (scale - T(1)));
+		}
+		return (z.norm() - T(1.5)) / w;
+	}
+
+	/// Evaluates DE() of the given scene shader at the position.
+	/// @param fractalIterations Value of the FRACTAL_ITERATIONS constant of the fractal scenes
+	/// @param parameters Value of the sceneParameters uniform
+	template <class T>
+	static Hit<T> Distance(Scene scene, const Vector3<T>& position, T time, const int fractalIterations = FRACTAL_ITERATIONS,
+		const SceneParameters& parameters = SceneParameters())
+	{
+		using std::cos;
+		using std::floor;
+
+		Hit<T> res;
+		res.color.setZero();
+
+		switch (scene)
+		{
+		case Scene::Mandelbulb:
+		{
+			Vector3<T> p = (position - parameters.objectPosition.head<3>().cast<T>()) / T(parameters.objectScale);
+			p.y() += T(-1) + T(2) * (cos(time) + T(1)) * T(.5);
+			res.dist = Mandelbulb(p, res.color, fractalIterations, T(parameters.fractalPower));
+			res.dist = SmoothUnion(res.dist, Plane(position, Vector3<T>(T(0), T(parameters.planeHeight), T(0)), Vector3<T>(T(0), T(-1), T(0))),
+				T(parameters.smoothUnionK));
+			break;
+		}
+		case Scene::RecursiveTetrahedron:
+		{
+			const T rotation = time * T(parameters.rotationSpeed);
+			const Vector3<T> p = RotateY(RotateZ(position, rotation), rotation * T(.5));
+			res.dist = SmoothUnion(RecursiveTetrahedron(p, fractalIterations, T(parameters.fractalScale), T(parameters.fractalOffset)),
+				Plane(position, Vector3<T>(T(0), T(parameters.planeHeight), T(0)), Vector3<T>(T(0), T(-1), T(0))), T(parameters.smoothUnionK));
+			break;
+		}
+		case Scene::Sphere:
+			res.dist = position.norm() - T(10);
+			break;
+		case Scene::Spheres:
+		{
+			// Instance on the xy-plane.
+			Vector3<T> z = position;
+			z.x() = z.x() - floor(z.x()) - T(.5);
+			z.y() = z.y() - floor(z.y()) - T(.5);
+			res.dist = z.norm() - T(.3);
+			break;
+		}
+		}
+
+		return res;
+	}
+
+	/// Evaluates Distance() in forward-mode automatic differentiation.
+	/// @param gradient Gradient of the distance estimate, unnormalized - its length is the local
+	/// Lipschitz constant of the estimate
+	template <class T>
+	static Hit<T> DistanceGradient(Scene scene, const Vector3<T>& position, T time, Vector3<T>& gradient,
+		const int fractalIterations = FRACTAL_ITERATIONS, const SceneParameters& parameters = SceneParameters())
+	{
+		// The fourth derivative is padding, four lanes fill a SIMD register.
+		using D = Dual<T, 4>;
+
+		const Vector3<D> p(D::Variable(position.x(), 0), D::Variable(position.y(), 1), D::Variable(position.z(), 2));
+		const Hit<D> hit = Distance(scene, p, D(time), fractalIterations, parameters);
+		gradient = hit.dist.derivatives.template head<3>().matrix();
+		Hit<T> res;
+		res.dist = hit.dist.value;
+		for (int i = 0; i < 4; ++i)
+		{
+			res.color(i) = hit.color(i).value;
+		}
+		return res;
+	}
+
+	/// Normalized gradient of the mandelbulb distance estimate, the outward normal of the surface.
+	/// The Jacobian of the orbit and the gradient of the running derivative are carried along the
+	/// iteration (rescaled together so they do not overflow), which costs about one extra
+	/// distance estimate instead of four.
+	/// @returns False where the gradient is degenerate - at the poles of the power map or when it
+	/// overflows.
+	template <class T>
+	static bool MandelbulbGradient(const Vector3<T>& position, Vector3<T>& gradient, T& dist, const int iterations = FRACTAL_ITERATIONS,
+		const T power = T(FRACTAL_POWER))
+	{
+		using std::acos;
+		using std::atan2;
+		using std::cos;
+		using std::isfinite;
+		using std::log;
+		using std::pow;
+		using std::sin;
+		using std::sqrt;
+		using Matrix3 = Eigen::Matrix<T, 3, 3>;
+
+		MandelbulbOrbit<T> orbit = MandelbulbStart(position);
+		// Derivatives of the orbit point and of dz, divided by the same factor.
+		Matrix3 jacobian = Matrix3::Identity();
+		Vector3<T> dzGradient = Vector3<T>::Zero();
+		T inverseScale = T(1);
+		for (int i = 0; i < iterations; ++i)
+		{
+			// dz = power*m^((power-1)/2)*dz + 1 differentiated, with the gradient of m = |w|^2.
+			const Vector3<T>& w = orbit.w;
+			const Vector3<T> mGradient = T(2) * jacobian.transpose() * w;
+			dzGradient = power * (power - T(1)) * T(.5) * pow(orbit.m, (power - T(3)) * T(.5)) * orbit.dz * mGradient +
+				power * pow(orbit.m, (power - T(1)) * T(.5)) * dzGradient;
+
+			// Derivative of the power map w -> r^power * (sin b sin a, cos b, sin b cos a) with
+			// b = power * acos(y / r) and a = power * atan2(x, z).
+			const T r = sqrt(orbit.m);
+			const T rho2 = w.x() * w.x() + w.z() * w.z();
+			const T b = power * acos(w.y() / r);
+			const T a = power * atan2(w.x(), w.z());
+			const T radius = pow(r, power);
+			const Vector3<T> dRadius = power * pow(r, power - T(2)) * w;
+			const Vector3<T> dTheta = -(Vector3<T>(T(0), T(1), T(0)) - w.y() / orbit.m * w) / sqrt(rho2);
+			const Vector3<T> dPhi(w.z() / rho2, T(0), -w.x() / rho2);
+			const Vector3<T> byRadius(sin(b) * sin(a), cos(b), sin(b) * cos(a));
+			const Vector3<T> byB = radius * Vector3<T>(cos(b) * sin(a), -sin(b), cos(b) * cos(a));
+			const Vector3<T> byA = radius * Vector3<T>(sin(b) * cos(a), T(0), -sin(b) * sin(a));
+			const Matrix3 derivative = byRadius * dRadius.transpose() + power * byB * dTheta.transpose() + power * byA * dPhi.transpose();
+
+			jacobian = derivative * jacobian + inverseScale * Matrix3::Identity();
+			const T largest = std::max(jacobian.cwiseAbs().maxCoeff(), dzGradient.cwiseAbs().maxCoeff());
+			if (largest > T(1e4))
+			{
+				jacobian /= largest;
+				dzGradient /= largest;
+				inverseScale /= largest;
+			}
+
+			if (!MandelbulbStep(position, orbit, power))
+			{
+				break;
+			}
+		}
+
+		// dist = log(m)*sqrt(m)/(4*dz) differentiated.
+		Vector4<T> color;
+		dist = MandelbulbDistance(orbit, color);
+		const Vector3<T> mGradient = T(2) * jacobian.transpose() * orbit.w;
+		const T sqrtM = sqrt(orbit.m);
+		gradient = T(.25) / orbit.dz * (T(1) / sqrtM + log(orbit.m) / (T(2) * sqrtM)) * mGradient - dist / orbit.dz * dzGradient;
+		const T length = gradient.norm();
+		if (!isfinite(length) || !(length > T(0)))
+		{
+			return false;
+		}
+		gradient /= length;
+		return true;
+	}
+
+	/// Gradient of the recursive tetrahedron estimate. The folds are reflections, so the
+	/// gradient is the direction of the folded point mapped back through them.
+	template <class T>
+	static Vector3<T> RecursiveTetrahedronGradient(const Vector3<T>& position, T& dist, const int iterations = FRACTAL_ITERATIONS,
+		const T scale = T(SceneParameters().fractalScale), const T offset = T(SceneParameters().fractalOffset))
+	{
+		using Matrix3 = Eigen::Matrix<T, 3, 3>;
+
+		Vector3<T> z = position;
+		// Product of the folds, the scaling leaves the direction alone.
+		Matrix3 folds = Matrix3::Identity();
+		T w = T(1);
+		const auto fold = [&z, &folds](const int i, const int j)
+		{
+			if (z(i) + z(j) < T(0))
+			{
+				const T zi = z(i);
+				z(i) = -z(j);
+				z(j) = -zi;
+				const Eigen::Matrix<T, 1, 3> row = folds.row(i);
+				folds.row(i) = -folds.row(j);
+				folds.row(j) = -row;
+			}
+		};
+		for (int i = 0; i < iterations; ++i)
+		{
+			fold(0, 1);
+			fold(0, 2);
+			fold(1, 2);
+			z *= scale;
+			w *= scale;
+			z -= Vector3<T>::Constant(offset * (scale - T(1)));
+		}
+		dist = (z.norm() - T(1.5)) / w;
+		return (folds.transpose() * z).normalized();
+	}
+
+	/// Outward normal of the scene at the position from its analytic gradient.
+	/// @returns False where the scene has none, see MandelbulbGradient().
+	template <class T>
+	static bool AnalyticNormal(Scene scene, const Vector3<T>& position, T time, Vector3<T>& normal,
+		const int fractalIterations = FRACTAL_ITERATIONS, const SceneParameters& parameters = SceneParameters())
+	{
+		using std::cos;
+		using std::floor;
+
+		// Gradient of SmoothUnion(d1, d2, k) - the terms of the blend factor cancel out.
+		const auto blendWithPlane = [&parameters](const Vector3<T>& position, const T dist, const Vector3<T>& gradient)
+		{
+			const T planeDist = Plane(position, Vector3<T>(T(0), T(parameters.planeHeight), T(0)), Vector3<T>(T(0), T(-1), T(0)));
+			const T h = std::clamp(T(.5) + T(.5) * (planeDist - dist) / T(parameters.smoothUnionK), T(0), T(1));
+			return Vector3<T>(h * gradient + (T(1) - h) * Vector3<T>(T(0), T(-1), T(0))).normalized();
+		};
+
+		switch (scene)
+		{
+		case Scene::Mandelbulb:
+		{
+			Vector3<T> p = (position - parameters.objectPosition.head<3>().cast<T>()) / T(parameters.objectScale);
+			p.y() += T(-1) + T(2) * (cos(time) + T(1)) * T(.5);
+			Vector3<T> gradient;
+			T dist;
+			if (!MandelbulbGradient(p, gradient, dist, fractalIterations, T(parameters.fractalPower)))
+			{
+				return false;
+			}
+			normal = blendWithPlane(position, dist, gradient);
+			return true;
+		}
+		case Scene::RecursiveTetrahedron:
+		{
+			const T rotation = time * T(parameters.rotationSpeed);
+			const Vector3<T> p = RotateY(RotateZ(position, rotation), rotation * T(.5));
+			T dist;
+			const Vector3<T> gradient = RecursiveTetrahedronGradient(p, dist, fractalIterations, T(parameters.fractalScale),
+				T(parameters.fractalOffset));
+			// Back through the rotations.
+			normal = blendWithPlane(position, dist, RotateZ(RotateY(gradient, -rotation * T(.5)), -rotation));
+			return true;
+		}
+		case Scene::Sphere:
+			normal = position.normalized();
+			return true;
+		case Scene::Spheres:
+		{
+			Vector3<T> z = position;
+			z.x() = z.x() - floor(z.x()) - T(.5);
+			z.y() = z.y() - floor(z.y()) - T(.5);
+			normal = z.normalized();
+			return true;
+		}
+		}
+		return false;
+	}
+
+	/// Normal from four tetrahedral samples of the distance estimate, the scheme of
+	/// surfaceNormal() in common/march.glsl.
+	template <class T>
+	static Vector3<T> TetrahedralNormal(Scene scene, const Vector3<T>& position, T time, T epsilon,
+		const int fractalIterations = FRACTAL_ITERATIONS, const SceneParameters& parameters = SceneParameters())
+	{
+		const T e = T(.5773);
+		const Vector3<T> offsets[] = { Vector3<T>(e, -e, -e), Vector3<T>(-e, -e, e), Vector3<T>(-e, e, -e), Vector3<T>(e, e, e) };
+		Vector3<T> normal = Vector3<T>::Zero();
+		for (const Vector3<T>& offset : offsets)
+		{
+			normal += offset * Distance(scene, Vector3<T>(position + offset * epsilon), time, fractalIterations, parameters).dist;
+		}
+		return normal.normalized();
+	}
+};
@@ -0,0 +1,143 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+	// Pool and index of the worker running on this thread.
+	thread_local const ThreadPool* currentPool = nullptr;
+	thread_local uint32_t currentIndex = 0;
+}
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	workers.reserve(threadCount);
+	// Nested ParallelFor() calls add a job each, the list only grows past this for deep nesting.
+	jobs.reserve(16);
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push(std::move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+void ThreadPool::ParallelFor(const uint32_t count, void (*invoke)(const void* body, uint32_t index), const void* body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	Job job;
+	job.invoke = invoke;
+	job.body = body;
+	job.count = count;
+	if (count > 1 && !workers.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(&job);
+		}
+		taskAvailable.notify_all();
+	}
+	Work(job);
+
+	// Workers that have not joined yet no longer can, the job goes out of scope once the ones
+	// inside are done.
+	std::unique_lock<std::mutex> lock(mutex);
+	RemoveJob(job);
+	helpersLeft.wait(lock, [&]() { return job.helpers == 0; });
+}
+
+void ThreadPool::Work(Job& job)
+{
+	for (uint32_t i = job.next++; i < job.count; i = job.next++)
+	{
+		job.invoke(job.body, i);
+	}
+}
+
+void ThreadPool::RemoveJob(const Job& job)
+{
+	const auto found = std::find(jobs.begin(), jobs.end(), &job);
+	if (found != jobs.end())
+	{
+		jobs.erase(found);
+	}
+}
+
+uint32_t ThreadPool::GetThreadCount() const
+{
+	return uint32_t(workers.size());
+}
+
+uint32_t ThreadPool::GetCurrentThreadIndex() const
+{
+	return currentPool == this ? currentIndex : GetThreadCount();
+}
+
+void ThreadPool::WorkerLoop(const uint32_t index)
+{
+	currentPool = this;
+	currentIndex = index;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		taskAvailable.wait(lock, [this]() { return stopping || !jobs.empty() || !tasks.empty(); });
+
+		// ParallelFor() callers wait on their jobs, so these go before the queued tasks.
+		if (!jobs.empty())
+		{
+			Job& job = *jobs.back();
+			++job.helpers;
+			lock.unlock();
+			Work(job);
+			lock.lock();
+			RemoveJob(job);
+			if (--job.helpers == 0)
+			{
+				helpersLeft.notify_all();
+			}
+			continue;
+		}
+
+		if (stopping && tasks.empty())
+		{
+			return;
+		}
+		std::function<void()> task = std::move(tasks.front());
+		tasks.pop();
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
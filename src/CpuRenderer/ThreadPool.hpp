@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/// Fixed set of worker threads executing submitted tasks in FIFO order.
+class ThreadPool
+{
+public:
+	/// Creates the pool with the given number of workers, zero picks one per hardware thread.
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// Queues a task for execution on one of the workers.
+	void Submit(std::function<void()> task);
+
+	/// Runs body(i) for every i in [0, count) across the workers and returns once all of them
+	/// are done. The calling thread takes part in the work, so the call may be nested inside
+	/// a task without deadlocking the pool. Neither the call nor the body is copied to the heap,
+	/// so a frame of ParallelFor calls does not allocate.
+	template <class Body>
+	void ParallelFor(uint32_t count, const Body& body);
+
+	/// Number of worker threads of the pool.
+	uint32_t GetThreadCount() const;
+
+	/// Index of the calling thread among the workers of the pool, GetThreadCount() on any other
+	/// thread. Lets per-thread data be kept in arrays of GetThreadCount() + 1 entries.
+	uint32_t GetCurrentThreadIndex() const;
+
+private:
+	// A ParallelFor() call, on the stack of the calling thread. Workers take indices from it
+	// until they run out and the caller waits for them to leave before it returns.
+	struct Job
+	{
+		void (*invoke)(const void* body, uint32_t index);
+		const void* body;
+		uint32_t count;
+		std::atomic<uint32_t> next{ 0 };
+		// Workers inside the job.
+		uint32_t helpers = 0;
+	};
+
+	void ParallelFor(uint32_t count, void (*invoke)(const void* body, uint32_t index), const void* body);
+	static void Work(Job& job);
+	// Takes the job off the list of jobs workers join, with the mutex held.
+	void RemoveJob(const Job& job);
+	void WorkerLoop(uint32_t index);
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	// Jobs with indices left, workers join the latest first.
+	std::vector<Job*> jobs;
+	std::mutex mutex;
+	std::condition_variable taskAvailable;
+	std::condition_variable helpersLeft;
+	bool stopping = false;
+};
+
+template <class Body>
+void ThreadPool::ParallelFor(const uint32_t count, const Body& body)
+{
+	ParallelFor(count, [](const void* body, const uint32_t index) { (*static_cast<const Body*>(body))(index); }, &body);
+}
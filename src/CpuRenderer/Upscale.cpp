@@ -0,0 +1,155 @@
+#include "Upscale.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	// Whether the G-buffer pixels at the indices see the same surface, sameSurface() of
+	// upscale.comp.glsl.
+	bool SameSurface(const GBuffer& gbuffer, const size_t a, const size_t b)
+	{
+		const bool hit = gbuffer.hits(a) != 0;
+		if (hit != (gbuffer.hits(b) != 0))
+		{
+			return false;
+		}
+		if (!hit)
+		{
+			return true;
+		}
+		const float depthA = gbuffer.depths(a);
+		const float depthB = gbuffer.depths(b);
+		return std::abs(depthA - depthB) <= UpscalePass::DEPTH_TOLERANCE * std::min(depthA, depthB) &&
+			gbuffer.GetNormal(a).dot(gbuffer.GetNormal(b)) >= UpscalePass::NORMAL_THRESHOLD;
+	}
+
+	uint8_t ToUnorm8(const float value)
+	{
+		return uint8_t(std::clamp(value, 0.f, 1.f) * 255.f + .5f);
+	}
+}
+
+UpscalePass::UpscalePass(ThreadPool& threadPool)
+	: threadPool(threadPool)
+{
+}
+
+void UpscalePass::Run(const GBuffer& gbuffer, const ImageBuffer<float>& colors, const UpscaleFilter filter, const int width,
+	const int height, uint8_t* pixels)
+{
+	const ImageShape& shape = gbuffer.shape;
+	assert(colors.GetShape() == shape && colors.GetChannels() == 3);
+	const float scaleX = (shape.width - 1) / float(std::max(width - 1, 1));
+	const float scaleY = (shape.height - 1) / float(std::max(height - 1, 1));
+	const int tilesX = (width + CpuRenderer::TILE_SIZE - 1) / CpuRenderer::TILE_SIZE;
+	const int tilesY = (height + CpuRenderer::TILE_SIZE - 1) / CpuRenderer::TILE_SIZE;
+
+	std::atomic<uint64_t> edges{ 0 };
+	threadPool.ParallelFor(uint32_t(tilesX * tilesY), [&](const uint32_t tile)
+	{
+		const int tileX = int(tile % tilesX) * CpuRenderer::TILE_SIZE;
+		const int tileY = int(tile / tilesX) * CpuRenderer::TILE_SIZE;
+		uint64_t tileEdges = 0;
+		for (int y = tileY; y < std::min(tileY + CpuRenderer::TILE_SIZE, height); ++y)
+		{
+			const float sampleY = y * scaleY;
+			const int y0 = std::min(int(sampleY), std::max(shape.height - 2, 0));
+			const int y1 = std::min(y0 + 1, shape.height - 1);
+			const float wy = std::min(sampleY - y0, 1.f);
+			for (int x = tileX; x < std::min(tileX + CpuRenderer::TILE_SIZE, width); ++x)
+			{
+				const float sampleX = x * scaleX;
+				const int x0 = std::min(int(sampleX), std::max(shape.width - 2, 0));
+				const int x1 = std::min(x0 + 1, shape.width - 1);
+				const float wx = std::min(sampleX - x0, 1.f);
+
+				const size_t samples[4] = { shape.Index(x0, y0), shape.Index(x1, y0), shape.Index(x0, y1), shape.Index(x1, y1) };
+				float weights[4] = { (1.f - wx) * (1.f - wy), wx * (1.f - wy), (1.f - wx) * wy, wx * wy };
+				// Weights of the samples on the side of the edge the pixel is on, and how much of
+				// the bilinear color the color of that side replaces.
+				float sideWeights[4] = { 0.f, 0.f, 0.f, 0.f };
+				float sideBlend = 0.f;
+
+				if (filter == UpscaleFilter::Nearest)
+				{
+					const int closest = int(std::max_element(weights, weights + 4) - weights);
+					std::fill_n(weights, 4, 0.f);
+					weights[closest] = 1.f;
+				}
+				else if (filter == UpscaleFilter::EdgeAware)
+				{
+					// The surface nearest to the camera and the samples on it, the edge runs
+					// between them and the others.
+					int nearest = -1;
+					for (int corner = 0; corner < 4; ++corner)
+					{
+						if (gbuffer.hits(samples[corner]) != 0 && (nearest < 0 || gbuffer.depths(samples[corner]) < gbuffer.depths(samples[nearest])))
+						{
+							nearest = corner;
+						}
+					}
+					bool nearSide[4] = { true, true, true, true };
+					bool edge = false;
+					for (int corner = 0; corner < 4 && nearest >= 0; ++corner)
+					{
+						nearSide[corner] = SameSurface(gbuffer, samples[nearest], samples[corner]);
+						edge = edge || !nearSide[corner];
+					}
+
+					if (edge)
+					{
+						// Bilinear interpolation of the side (1 near, -1 far) places the edge
+						// between the samples. Close to it the side is a guess, so the pixel fades from
+						// the samples on its side to all of them - wrong guesses cost more than blur.
+						float side = 0.f;
+						for (int corner = 0; corner < 4; ++corner)
+						{
+							side += nearSide[corner] ? weights[corner] : -weights[corner];
+						}
+						for (int corner = 0; corner < 4; ++corner)
+						{
+							sideWeights[corner] = nearSide[corner] == (side >= 0.f) ? weights[corner] : 0.f;
+						}
+						sideBlend = side * side;
+						++tileEdges;
+					}
+				}
+
+				float color[3] = { 0.f, 0.f, 0.f };
+				float sideColor[3] = { 0.f, 0.f, 0.f };
+				float sideWeight = 0.f;
+				for (int corner = 0; corner < 4; ++corner)
+				{
+					for (int channel = 0; channel < 3; ++channel)
+					{
+						const float sample = colors(samples[corner], channel);
+						color[channel] += weights[corner] * sample;
+						sideColor[channel] += sideWeights[corner] * sample;
+					}
+					sideWeight += sideWeights[corner];
+				}
+				for (int channel = 0; channel < 3 && sideBlend > 0.f; ++channel)
+				{
+					color[channel] += sideBlend * (sideColor[channel] / sideWeight - color[channel]);
+				}
+
+				uint8_t* pixel = pixels + (size_t(y) * width + x) * CpuRenderer::CHANNELS;
+				for (int channel = 0; channel < 3; ++channel)
+				{
+					pixel[channel] = ToUnorm8(color[channel]);
+				}
+				pixel[3] = 255;
+			}
+		}
+		edges += tileEdges;
+	});
+	edgePixels = edges;
+}
+
+uint64_t UpscalePass::GetEdgePixels() const
+{
+	return edgePixels;
+}
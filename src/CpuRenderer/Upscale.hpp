@@ -0,0 +1,47 @@
+#pragma once
+#include "CpuRenderer.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+
+/// Reconstruction of the pixels between the samples of an upscaled image.
+enum class UpscaleFilter
+{
+	/// The closest sample, stretching the image.
+	Nearest,
+	Bilinear,
+	/// Bilinear within a surface. Where the 2x2 samples around a pixel straddle a depth or normal
+	/// discontinuity, the edge is placed along the zero crossing of the bilinearly interpolated
+	/// side of the samples, and the pixel only blends the samples on its side of it - fading to the
+	/// bilinear color right at the edge, where the side is a guess.
+	EdgeAware
+};
+
+/// Upscaling of an image shaded from a G-buffer of lower resolution, guided by the depths and
+/// normals of the G-buffer - the counterpart of upscale.comp.glsl. Lets the march run at half
+/// resolution without smearing the fractal edges across the background.
+class UpscalePass
+{
+public:
+	/// Constants of upscale.comp.glsl.
+	/// Samples further apart in depth than this fraction of the nearer one are on different surfaces.
+	static constexpr float DEPTH_TOLERANCE = .05f;
+	/// Samples whose normals have a smaller cosine between them are on different surfaces.
+	static constexpr float NORMAL_THRESHOLD = .8f;
+
+	explicit UpscalePass(ThreadPool& threadPool);
+
+	/// Writes the RGBA8 rows of the image of the given size, sampled from the colors of the G-buffer
+	/// pixels. The rays of pixel (0, 0) and (width - 1, height - 1) are those of the first and last
+	/// pixel of the G-buffer, like the ray parametrization of the shaders.
+	/// @param colors RGB color of every pixel of the G-buffer in its shape, see CpuRenderer::Composite().
+	/// @param pixels Destination of width * height * CpuRenderer::CHANNELS bytes.
+	void Run(const GBuffer& gbuffer, const ImageBuffer<float>& colors, UpscaleFilter filter, int width, int height, uint8_t* pixels);
+
+	/// Pixels of the last Run() whose samples straddle an edge.
+	uint64_t GetEdgePixels() const;
+
+private:
+	ThreadPool& threadPool;
+	uint64_t edgePixels = 0;
+};
@@ -1,5 +1,15 @@
 #include "Filesystem.hpp"
 
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
 void RMFilesystem::Init(const std::string& root)
 {
 	filesystem = std::make_unique<Core::Filesystem>(root);
@@ -9,3 +19,51 @@ const Core::Filesystem& RMFilesystem::Get() const
 {
 	return *filesystem.get();
 }
+
+std::string NormalizePath(const std::string& path)
+{
+	std::error_code error;
+	const std::filesystem::path absolute = std::filesystem::absolute(path, error);
+	return (error ? std::filesystem::path(path) : absolute).lexically_normal().string();
+}
+
+std::string GetTemporarySuffix()
+{
+#ifdef _WIN32
+	const long long processId = _getpid();
+#else
+	const long long processId = getpid();
+#endif
+	return std::to_string(processId) + '-' + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+bool WriteFileAtomically(const std::string& path, const std::function<bool(std::ostream& file)>& write)
+{
+	const std::string temporaryPath = path + ".tmp" + GetTemporarySuffix();
+	std::error_code error;
+	{
+		std::ofstream file(temporaryPath, std::ios_base::binary | std::ios_base::trunc);
+		if (!file || !write(file) || !file.flush())
+		{
+			file.close();
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+	}
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::error_code removeError;
+		std::filesystem::remove(temporaryPath, removeError);
+		return false;
+	}
+	return true;
+}
+
+bool WriteFileAtomically(const std::string& path, const std::string& contents)
+{
+	return WriteFileAtomically(path, [&contents](std::ostream& file)
+	{
+		return bool(file.write(contents.data(), std::streamsize(contents.size())));
+	});
+}
@@ -1,7 +1,9 @@
 #pragma once
 #include <SoftwareCore/Filesystem.hpp>
 #include <SoftwareCore/Singleton.hpp>
+#include <functional>
 #include <memory>
+#include <ostream>
 #include <string>
 
 class RMFilesystem
@@ -14,3 +16,17 @@ private:
 };
 
 #define RMFS (::Core::Singleton<::RMFilesystem>::GetInstance().Get())
+
+/// Absolute and lexically normal form of the path, for comparing paths. Relative to the
+/// working directory, the path is only made normal if the working directory is gone.
+std::string NormalizePath(const std::string& path);
+
+/// Suffix for temporary files which no other thread of any process shares - the process id and
+/// a hash of the thread id.
+std::string GetTemporarySuffix();
+
+/// Writes through a temporary file next to the path which is renamed over it, so concurrent
+/// readers never see a partial file. On failure the file at the path is left as it was.
+/// @param write Writes the contents to the binary stream, returns whether it succeeded
+bool WriteFileAtomically(const std::string& path, const std::function<bool(std::ostream& file)>& write);
+bool WriteFileAtomically(const std::string& path, const std::string& contents);
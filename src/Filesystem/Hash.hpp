@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// 64-bit FNV-1a hash used to key the on-disk caches. Hashes can be chained by passing the
+/// previous result as the seed.
+constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+
+inline uint64_t HashBytes(const void* data, const size_t size, uint64_t seed = HASH_SEED)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		seed = (seed ^ bytes[i]) * 1099511628211ull;
+	}
+	return seed;
+}
+
+inline uint64_t HashString(const std::string& text, const uint64_t seed = HASH_SEED)
+{
+	// The length separates consecutive strings, so ("ab", "c") and ("a", "bc") differ.
+	const uint64_t size = text.size();
+	return HashBytes(text.data(), text.size(), HashBytes(&size, sizeof(size), seed));
+}
+
+/// Lower-case hexadecimal form of the hash for file names.
+inline std::string HashToString(const uint64_t hash)
+{
+	const char* digits = "0123456789abcdef";
+	std::string text(16, '0');
+	for (int i = 0; i < 16; ++i)
+	{
+		text[15 - i] = digits[(hash >> (4 * i)) & 0xf];
+	}
+	return text;
+}
@@ -0,0 +1,312 @@
+#include "FileWatcher.hpp"
+#include "../Filesystem/Filesystem.hpp"
+
+#include <SoftwareCore/DefaultLogger.hpp>
+#include <algorithm>
+#include <cerrno>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// How long the watcher thread waits for events before it checks for stopping and debouncing.
+	constexpr int WAIT_MS = 20;
+
+	bool IsInside(const std::string& path, const std::string& directory)
+	{
+		return path.size() > directory.size() && path.compare(0, directory.size(), directory) == 0 &&
+			(path[directory.size()] == '/' || path[directory.size()] == '\\' || directory.back() == '/' || directory.back() == '\\');
+	}
+
+	void AddUnique(std::vector<std::string>& paths, const std::string& path)
+	{
+		if (std::find(paths.begin(), paths.end(), path) == paths.end())
+		{
+			paths.push_back(path);
+		}
+	}
+}
+
+FileWatcher::FileWatcher(std::vector<std::string> paths, const std::chrono::milliseconds debounce, Callback callback)
+	: debounce(debounce), callback(std::move(callback))
+{
+	for (const std::string& path : paths)
+	{
+		std::error_code error;
+		const std::string normalized = NormalizePath(path);
+		if (std::filesystem::is_directory(normalized, error))
+		{
+			directories.push_back(normalized);
+		}
+		else if (std::filesystem::is_regular_file(normalized, error))
+		{
+			files.push_back(normalized);
+		}
+		else
+		{
+			CoreLogWarn(DefaultLogger, "File watcher: %s does not exist.", path.c_str());
+		}
+	}
+
+#ifdef __linux__
+	inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify < 0)
+	{
+		CoreLogWarn(DefaultLogger, "File watcher: inotify is not available, polling every %d ms.", int(POLL_INTERVAL.count()));
+	}
+	else
+	{
+		for (const std::string& directory : directories)
+		{
+			AddNativeWatch(directory);
+		}
+		for (const std::string& file : files)
+		{
+			AddNativeWatch(std::filesystem::path(file).parent_path().string());
+		}
+	}
+#endif
+
+	if (inotify < 0)
+	{
+		std::vector<std::string> ignored;
+		PollChanges(ignored);
+	}
+
+	thread = std::thread(&FileWatcher::WatchLoop, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+	stopping = true;
+	thread.join();
+#ifdef __linux__
+	if (inotify >= 0)
+	{
+		close(inotify);
+	}
+#endif
+}
+
+bool FileWatcher::IsNative() const
+{
+	return inotify >= 0;
+}
+
+void FileWatcher::WatchLoop()
+{
+	Changes changes;
+	auto nextPoll = std::chrono::steady_clock::now() + POLL_INTERVAL;
+
+	while (!stopping)
+	{
+		std::vector<std::string> changed;
+		if (inotify >= 0)
+		{
+#ifdef __linux__
+			pollfd descriptor = { inotify, POLLIN, 0 };
+			if (poll(&descriptor, 1, WAIT_MS) > 0 && !ReadNativeChanges(changed))
+			{
+				CoreLogError(DefaultLogger, "File watcher: reading inotify events failed, watching stopped.");
+				return;
+			}
+#endif
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+			if (std::chrono::steady_clock::now() >= nextPoll)
+			{
+				PollChanges(changed);
+				nextPoll = std::chrono::steady_clock::now() + POLL_INTERVAL;
+			}
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if (!changed.empty())
+		{
+			if (changes.files.empty())
+			{
+				changes.firstChange = now;
+			}
+			changes.lastChange = now;
+			for (const std::string& file : changed)
+			{
+				AddUnique(changes.files, file);
+			}
+		}
+
+		// Quiet for long enough, the batch is complete.
+		if (!changes.files.empty() && now - changes.lastChange >= debounce)
+		{
+			callback(changes);
+			changes.files.clear();
+		}
+	}
+}
+
+bool FileWatcher::IsWatched(const std::string& path) const
+{
+	if (std::find(files.begin(), files.end(), path) != files.end())
+	{
+		return true;
+	}
+	return std::any_of(directories.begin(), directories.end(), [&path](const std::string& directory)
+	{
+		return IsInside(path, directory);
+	});
+}
+
+bool FileWatcher::ReadNativeChanges(std::vector<std::string>& changed)
+{
+#ifdef __linux__
+	alignas(inotify_event) char buffer[16 * 1024];
+	for (;;)
+	{
+		const ssize_t size = read(inotify, buffer, sizeof(buffer));
+		if (size < 0)
+		{
+			return errno == EAGAIN || errno == EINTR;
+		}
+		if (size == 0)
+		{
+			return true;
+		}
+
+		for (ssize_t offset = 0; offset < size;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				CoreLogWarn(DefaultLogger, "File watcher: events were lost, reporting every watched file as changed.");
+				RescanNative(changed);
+				continue;
+			}
+			const auto watch = watches.find(event->wd);
+			if (watch == watches.end() || event->len == 0)
+			{
+				continue;
+			}
+			const std::string path = (std::filesystem::path(watch->second) / event->name).lexically_normal().string();
+			if (!IsWatched(path))
+			{
+				continue;
+			}
+			if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+			{
+				// New subdirectory of a watched tree.
+				AddNativeWatch(path);
+			}
+			else if (!(event->mask & IN_ISDIR))
+			{
+				AddUnique(changed, path);
+			}
+		}
+	}
+#else
+	return false;
+#endif
+}
+
+void FileWatcher::AddNativeWatch(const std::string& directory)
+{
+#ifdef __linux__
+	// Writes are reported once the file is closed, editors saving through a temporary file
+	// are seen as a move.
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+	const int watch = inotify_add_watch(inotify, directory.c_str(), mask);
+	if (watch < 0)
+	{
+		CoreLogWarn(DefaultLogger, "File watcher: cannot watch %s.", directory.c_str());
+		return;
+	}
+	watches[watch] = directory;
+
+	if (std::find(directories.begin(), directories.end(), directory) == directories.end() && !IsWatched(directory))
+	{
+		// Parent directory of watched files, its subdirectories are of no interest.
+		return;
+	}
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (entry.is_directory(error))
+		{
+			AddNativeWatch(entry.path().lexically_normal().string());
+		}
+	}
+#else
+	(void)directory;
+#endif
+}
+
+void FileWatcher::RescanNative(std::vector<std::string>& changed)
+{
+	// Deleted files are reported as well, a watched file need not exist.
+	for (const std::string& file : files)
+	{
+		AddUnique(changed, file);
+	}
+	std::error_code error;
+	for (const std::string& directory : directories)
+	{
+		// Watching a directory again keeps its watch descriptor.
+		AddNativeWatch(directory);
+		for (auto entry = std::filesystem::recursive_directory_iterator(directory, error);
+			!error && entry != std::filesystem::recursive_directory_iterator(); entry.increment(error))
+		{
+			if (entry->is_regular_file(error))
+			{
+				AddUnique(changed, entry->path().lexically_normal().string());
+			}
+		}
+	}
+}
+
+void FileWatcher::PollChanges(std::vector<std::string>& changed)
+{
+	std::map<std::string, std::filesystem::file_time_type> current;
+	std::error_code error;
+	for (const std::string& file : files)
+	{
+		const auto time = std::filesystem::last_write_time(file, error);
+		if (!error)
+		{
+			current[file] = time;
+		}
+	}
+	for (const std::string& directory : directories)
+	{
+		for (auto entry = std::filesystem::recursive_directory_iterator(directory, error);
+			!error && entry != std::filesystem::recursive_directory_iterator(); entry.increment(error))
+		{
+			if (entry->is_regular_file(error))
+			{
+				current[entry->path().lexically_normal().string()] = entry->last_write_time(error);
+			}
+		}
+	}
+
+	for (const auto& file : current)
+	{
+		const auto previous = modificationTimes.find(file.first);
+		if (previous == modificationTimes.end() || previous->second != file.second)
+		{
+			changed.push_back(file.first);
+		}
+	}
+	for (const auto& file : modificationTimes)
+	{
+		if (current.find(file.first) == current.end())
+		{
+			changed.push_back(file.first);
+		}
+	}
+	modificationTimes = std::move(current);
+}
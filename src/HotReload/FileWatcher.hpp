@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Watches files and directory trees for changes on a background thread and reports them in
+/// debounced batches - editors save through several writes, renames and deletes, and a build
+/// touches many files at once, all of which should turn into a single notification.
+/// Uses inotify on Linux and polls the modification times elsewhere.
+class FileWatcher
+{
+public:
+	/// Files changed since the last notification.
+	struct Changes
+	{
+		/// Normalized paths of the changed, created or deleted files.
+		std::vector<std::string> files;
+		/// When the first and the last change of the batch was seen.
+		std::chrono::steady_clock::time_point firstChange;
+		std::chrono::steady_clock::time_point lastChange;
+	};
+
+	/// Called on the watcher thread, further changes are collected until it returns. Should the
+	/// system drop events meanwhile, every file of the watched paths is reported as changed.
+	using Callback = std::function<void(const Changes& changes)>;
+
+	/// Polling interval of the modification times when inotify is not available.
+	static constexpr std::chrono::milliseconds POLL_INTERVAL{ 250 };
+
+	/// Starts watching. Directories are watched with all their subdirectories, files through
+	/// their parent directory. Paths which do not exist are skipped with a warning.
+	/// @param debounce Quiet time after the last change before the callback is called
+	FileWatcher(std::vector<std::string> paths, std::chrono::milliseconds debounce, Callback callback);
+	/// Stops the watcher thread, changes which have not been reported yet are dropped.
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	/// Whether changes are reported by the operating system rather than found by polling.
+	bool IsNative() const;
+
+private:
+	void WatchLoop();
+	// Whether the path is one of the watched files or lies in a watched directory.
+	bool IsWatched(const std::string& path) const;
+	// Adds the changes seen since the last call to the batch, returns false on failure.
+	bool ReadNativeChanges(std::vector<std::string>& changed);
+	void AddNativeWatch(const std::string& directory);
+	// After the event queue overflowed: watches the subdirectories created meanwhile and adds
+	// every watched file to the batch.
+	void RescanNative(std::vector<std::string>& changed);
+	void PollChanges(std::vector<std::string>& changed);
+
+	std::vector<std::string> directories;
+	std::vector<std::string> files;
+	std::chrono::milliseconds debounce;
+	Callback callback;
+
+	int inotify = -1;
+	/// Watched directory of each inotify watch descriptor.
+	std::map<int, std::string> watches;
+	/// Last modification times of the polled files.
+	std::map<std::string, std::filesystem::file_time_type> modificationTimes;
+
+	std::atomic<bool> stopping{ false };
+	std::thread thread;
+};
@@ -0,0 +1,43 @@
+#include "ParameterReloader.hpp"
+
+#include <SoftwareCore/DefaultLogger.hpp>
+
+ParameterReloader::ParameterReloader(const std::string& path, const std::chrono::milliseconds debounce)
+	: path(path)
+{
+	Load();
+	watcher = std::make_unique<FileWatcher>(std::vector<std::string>{ path }, debounce, [this](const FileWatcher::Changes&) { Load(); });
+}
+
+ParameterReloader::~ParameterReloader()
+{
+	watcher.reset();
+}
+
+bool ParameterReloader::TakeChange(SceneParameters& parameters)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!changed)
+	{
+		return false;
+	}
+	parameters = this->parameters;
+	changed = false;
+	return true;
+}
+
+void ParameterReloader::Load()
+{
+	// Parameters left out of the file go back to their default.
+	SceneParameters loaded;
+	std::string error;
+	if (!LoadSceneParameters(path, loaded, error))
+	{
+		CoreLogError(DefaultLogger, "Scene parameters not applied, %s.", error.c_str());
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	parameters = loaded;
+	changed = true;
+}
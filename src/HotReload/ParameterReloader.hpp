@@ -0,0 +1,37 @@
+#pragma once
+#include "FileWatcher.hpp"
+#include "../Scene/SceneParameters.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/// Live tweaking of the scene parameters. The parameter file is read again on every change and
+/// the result waits in TakeChange() for the render loop, which only uploads a uniform - unlike
+/// PipelineReloader nothing is compiled and the pipeline keeps running.
+class ParameterReloader
+{
+public:
+	static constexpr std::chrono::milliseconds DEFAULT_DEBOUNCE{ 50 };
+
+	/// Reads the parameter file right away and starts watching it.
+	explicit ParameterReloader(const std::string& path, std::chrono::milliseconds debounce = DEFAULT_DEBOUNCE);
+	~ParameterReloader();
+
+	ParameterReloader(const ParameterReloader&) = delete;
+	ParameterReloader& operator=(const ParameterReloader&) = delete;
+
+	/// Takes the parameters read since the last call, including the initial read. A file which
+	/// does not parse is logged and skipped, the previous parameters stay.
+	bool TakeChange(SceneParameters& parameters);
+
+private:
+	void Load();
+
+	std::string path;
+	std::mutex mutex;
+	SceneParameters parameters;
+	bool changed = false;
+	std::unique_ptr<FileWatcher> watcher;
+};
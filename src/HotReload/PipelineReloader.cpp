@@ -0,0 +1,225 @@
+#include "PipelineReloader.hpp"
+#include "../Config/PipelineConfig.hpp"
+#include "../Filesystem/Filesystem.hpp"
+#include "../Filesystem/Hash.hpp"
+
+#include <SoftwareCore/DefaultLogger.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	uint64_t HashFile(const std::string& path)
+	{
+		std::ifstream file(path, std::ios_base::binary);
+		std::stringstream text;
+		text << file.rdbuf();
+		return HashString(text.str());
+	}
+
+	std::string JoinNames(const std::vector<std::string>& names)
+	{
+		std::string joined;
+		for (const std::string& name : names)
+		{
+			joined += (joined.empty() ? "" : ", ") + name;
+		}
+		return joined.empty() ? "configs only" : joined;
+	}
+
+	double ElapsedMs(const std::chrono::steady_clock::time_point from, const std::chrono::steady_clock::time_point to)
+	{
+		return std::chrono::duration<double, std::milli>(to - from).count();
+	}
+}
+
+PipelineReloader::PipelineReloader(const std::string& frontendConfigPath, const std::string& backendConfigPath, std::string presetName,
+	const std::vector<std::string>& watchedPaths, const std::string& cacheDirectory, const std::chrono::milliseconds debounce)
+	: frontendConfigPath(NormalizePath(frontendConfigPath)), backendConfigPath(NormalizePath(backendConfigPath)),
+	presetName(std::move(presetName)), cache(cacheDirectory)
+{
+	std::string error;
+	if (PrepareShaderVariants(this->frontendConfigPath, this->presetName, cache, "", prepared, error, &compilePool))
+	{
+		configHash = HashFile(prepared.configPath);
+		CoreLogInfo(DefaultLogger, "Shader preset %s: %u variant(s) from the cache, %u written.", prepared.preset.name.c_str(),
+			cache.GetHitCount(), cache.GetMissCount());
+	}
+	else
+	{
+		// The shaders of the config include files HawkEye can not resolve, it can not be used as it is.
+		CoreLogError(DefaultLogger, "No pipeline to configure, %s.", error.c_str());
+		prepared = PreparedShaderVariants();
+		failed = true;
+	}
+
+	std::vector<std::string> paths = watchedPaths;
+	paths.push_back(this->frontendConfigPath);
+	paths.push_back(this->backendConfigPath);
+	watcher = std::make_unique<FileWatcher>(paths, debounce, [this](const FileWatcher::Changes& changes) { OnChanges(changes); });
+}
+
+PipelineReloader::~PipelineReloader()
+{
+	watcher.reset();
+}
+
+PreparedShaderVariants PipelineReloader::GetPrepared() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return prepared;
+}
+
+bool PipelineReloader::TakeReload(Reload& reload)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!pending)
+	{
+		return false;
+	}
+	reload = std::move(*pending);
+	pending.reset();
+	return true;
+}
+
+uint32_t PipelineReloader::GetIgnoredCount() const
+{
+	return ignored.load();
+}
+
+uint32_t PipelineReloader::GetRejectedCount() const
+{
+	return rejected.load();
+}
+
+bool PipelineReloader::AffectsPipeline(const std::vector<std::string>& files, bool& backendChanged) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool affects = failed;
+	for (const std::string& file : files)
+	{
+		backendChanged |= file == backendConfigPath;
+		affects |= file == frontendConfigPath || file == backendConfigPath;
+		for (const ShaderVariantCache::NodeVariants& node : prepared.nodes)
+		{
+			affects |= std::any_of(node.dependencies.begin(), node.dependencies.end(),
+				[&file](const std::string& dependency) { return NormalizePath(dependency) == file; });
+		}
+	}
+	return affects;
+}
+
+void PipelineReloader::OnChanges(const FileWatcher::Changes& changes)
+{
+	bool backendChanged = false;
+	if (!AffectsPipeline(changes.files, backendChanged))
+	{
+		++ignored;
+		return;
+	}
+
+	// HawkEye is only initialized again with a backend config it can use.
+	ConfigBlob backendConfig;
+	std::string backendError;
+	if (backendChanged && !LoadBackendConfig(backendConfigPath, backendConfig, backendError))
+	{
+		CoreLogError(DefaultLogger, "Hot reload rejected, %s.", backendError.c_str());
+		++rejected;
+		return;
+	}
+
+	// Written next to the config the pipeline runs with and moved over it once validated, so a
+	// broken edit never replaces a working config.
+	PreparedShaderVariants next;
+	std::string error;
+	const std::string stagingPath = (std::filesystem::path(cache.GetDirectory()) / "FrontendConfig-reload.yaml").string();
+	if (!PrepareShaderVariants(frontendConfigPath, presetName, cache, stagingPath, next, error, &compilePool))
+	{
+		CoreLogError(DefaultLogger, "Hot reload rejected, %s.", error.c_str());
+		std::lock_guard<std::mutex> lock(mutex);
+		failed = true;
+		++rejected;
+		return;
+	}
+	for (const ShaderVariantCache::NodeVariants& node : next.nodes)
+	{
+		// Without a compiler the pipeline gets to compile the variants itself.
+		if (!node.compiled && cache.HasCompiler())
+		{
+			CoreLogError(DefaultLogger, "Hot reload rejected, node %s does not compile:\n%s", node.node.c_str(), node.log.c_str());
+			std::lock_guard<std::mutex> lock(mutex);
+			++rejected;
+			return;
+		}
+	}
+
+	const uint64_t nextHash = HashFile(stagingPath);
+	std::lock_guard<std::mutex> lock(mutex);
+	if (nextHash == configHash && !backendChanged && !failed)
+	{
+		++ignored;
+		return;
+	}
+
+	std::vector<std::string> nodes;
+	for (const ShaderVariantCache::NodeVariants& node : next.nodes)
+	{
+		const auto previous = std::find_if(prepared.nodes.begin(), prepared.nodes.end(),
+			[&node](const ShaderVariantCache::NodeVariants& p) { return p.node == node.node; });
+		if (previous == prepared.nodes.end() || previous->sourcePaths != node.sourcePaths)
+		{
+			nodes.push_back(node.node);
+		}
+	}
+
+	next.configPath = (std::filesystem::path(cache.GetDirectory()) / ("FrontendConfig-" + next.preset.name + ".yaml")).string();
+	std::error_code renameError;
+	std::filesystem::rename(stagingPath, next.configPath, renameError);
+	if (renameError)
+	{
+		CoreLogError(DefaultLogger, "Hot reload rejected, cannot write %s.", next.configPath.c_str());
+		++rejected;
+		return;
+	}
+
+	if (!pending)
+	{
+		pending = std::make_unique<Reload>();
+		pending->changeTime = changes.firstChange;
+	}
+	pending->frontendConfigPath = next.configPath;
+	pending->constants = next.preset.constants;
+	for (const std::string& node : nodes)
+	{
+		if (std::find(pending->nodes.begin(), pending->nodes.end(), node) == pending->nodes.end())
+		{
+			pending->nodes.push_back(node);
+		}
+	}
+	pending->backendChanged |= backendChanged;
+	pending->preparedTime = std::chrono::steady_clock::now();
+
+	CoreLogInfo(DefaultLogger, "Hot reload of %s prepared %.1f ms after the change.", JoinNames(nodes).c_str(),
+		ElapsedMs(changes.firstChange, pending->preparedTime));
+
+	prepared = std::move(next);
+	configHash = nextHash;
+	failed = false;
+}
+
+void ApplyShaderConstants(const ShaderConstants& constants, CpuRenderSettings& settings)
+{
+	const auto find = [&constants](const char* name) -> const char*
+	{
+		const auto constant = constants.find(name);
+		return constant == constants.end() ? "0" : constant->second.c_str();
+	};
+
+	// Float literals keep their GLSL suffix, strtof stops at it.
+	settings.maxIterations = int(std::strtol(find("MAX_ITERATIONS"), nullptr, 10));
+	settings.epsilon = std::strtof(find("EPSILON"), nullptr);
+	settings.fractalIterations = int(std::strtol(find("FRACTAL_ITERATIONS"), nullptr, 10));
+}
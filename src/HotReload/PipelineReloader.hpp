@@ -0,0 +1,95 @@
+#pragma once
+#include "FileWatcher.hpp"
+#include "../CpuRenderer/CpuRenderer.hpp"
+#include "../CpuRenderer/ThreadPool.hpp"
+#include "../ShaderCache/ShaderVariantCache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Hot reload of the shaders and the pipeline configs while the renderer keeps running.
+/// Changes to the watched files are debounced, then the shader variants are prepared and
+/// compiled on the watcher thread - only the variants of nodes whose shaders or includes
+/// changed miss the cache. A variant that does not compile keeps the running pipeline. The
+/// result waits in TakeReload() for the render loop to swap it in between two frames.
+class PipelineReloader
+{
+public:
+	/// Pipeline state to swap in.
+	struct Reload
+	{
+		/// Variant config to configure the pipeline with.
+		std::string frontendConfigPath;
+		/// Shader constants of the preset, for the CPU renderer.
+		ShaderConstants constants;
+		/// Nodes whose shader variants changed, empty if only the configs did.
+		std::vector<std::string> nodes;
+		/// The backend config changed, HawkEye has to be initialized again.
+		bool backendChanged = false;
+		/// First file change of the reload and when the reload was ready.
+		std::chrono::steady_clock::time_point changeTime;
+		std::chrono::steady_clock::time_point preparedTime;
+	};
+
+	static constexpr std::chrono::milliseconds DEFAULT_DEBOUNCE{ 100 };
+
+	/// Prepares the shader variants of the preset right away, compiling them in parallel, and
+	/// starts watching.
+	/// @param watchedPaths Files and directories to watch besides the two configs
+	/// @param cacheDirectory Directory of the shader variant cache and the variant configs
+	PipelineReloader(const std::string& frontendConfigPath, const std::string& backendConfigPath, std::string presetName,
+		const std::vector<std::string>& watchedPaths, const std::string& cacheDirectory,
+		std::chrono::milliseconds debounce = DEFAULT_DEBOUNCE);
+	~PipelineReloader();
+
+	PipelineReloader(const PipelineReloader&) = delete;
+	PipelineReloader& operator=(const PipelineReloader&) = delete;
+
+	/// Last successfully prepared variants. The config path is empty if nothing could be
+	/// prepared yet.
+	PreparedShaderVariants GetPrepared() const;
+
+	/// Takes the reload prepared since the last call, never blocks on the preparation.
+	/// Reloads prepared before the render loop got to take them are merged.
+	bool TakeReload(Reload& reload);
+
+	/// Change batches which did not affect the pipeline - files no node depends on, or edits
+	/// leaving the variants and the configs as they were.
+	uint32_t GetIgnoredCount() const;
+	/// Change batches rejected because a config could not be read or a variant did not compile.
+	uint32_t GetRejectedCount() const;
+
+private:
+	void OnChanges(const FileWatcher::Changes& changes);
+	// Whether any of the files is a config or a dependency of the current variants.
+	bool AffectsPipeline(const std::vector<std::string>& files, bool& backendChanged) const;
+
+	std::string frontendConfigPath;
+	std::string backendConfigPath;
+	std::string presetName;
+	ShaderVariantCache cache;
+	/// Compiles the variants of a preparation in parallel.
+	ThreadPool compilePool;
+
+	mutable std::mutex mutex;
+	PreparedShaderVariants prepared;
+	/// Hash of the prepared variant config, edits which leave it unchanged are ignored.
+	uint64_t configHash = 0;
+	/// The last preparation failed, every change is worth another try.
+	bool failed = false;
+	std::unique_ptr<Reload> pending;
+
+	std::atomic<uint32_t> ignored{ 0 };
+	std::atomic<uint32_t> rejected{ 0 };
+
+	/// Last member, stopped before the state it reports to goes away.
+	std::unique_ptr<FileWatcher> watcher;
+};
+
+/// Applies the MAX_ITERATIONS, EPSILON and FRACTAL_ITERATIONS shader constants to the CPU
+/// renderer settings, constants which are not given fall back to the defaults of the scene.
+void ApplyShaderConstants(const ShaderConstants& constants, CpuRenderSettings& settings);
@@ -3,50 +3,78 @@
 #include <SoftwareCore/Input.hpp>
 #include <SoftwareCore/DefaultLogger.hpp>
 
-void UpdateCamera(HawkEye::Pipeline& pipeline, Camera& camera)
+#include <algorithm>
+#include <cassert>
+
+// Pads a direction to the vec4 layout used by uniform blocks.
+static Eigen::Vector4f ShaderVector(const Eigen::Vector3f& v)
 {
-	camera.UpdateViewProjectionMatrices();
-	if (pipeline.Configured())
-	{
-		Eigen::Matrix4f viewProjectionMatrix = camera.GetProjectionMatrix() * camera.GetViewMatrix();
+	return Eigen::Vector4f(v.x(), v.y(), v.z(), 0.f);
+}
 
-		Eigen::Matrix4f inverseViewProjectionMatrix = viewProjectionMatrix.inverse();
+SceneUniforms::SceneUniforms(UniformRing& ring)
+	: ring(ring), camera(ring.Register<ShaderCamera>("rayMarch", "camera")), time(ring.Register<float>("rayMarch", "time")),
+	parameters(ring, "rayMarch", "sceneParameters")
+{
+}
 
-		Eigen::Vector3f cameraPosition = camera.GetPosition();
-		Eigen::Vector4f eye = Eigen::Vector4f(cameraPosition.x(), cameraPosition.y(), cameraPosition.z(), 1.f);
+void UpdateCamera(SceneUniforms& uniforms, Camera& camera)
+{
+	camera.UpdateRayBasis();
+#ifdef DEBUG
+	assert(camera.MeasureRayBasisError() <= 1e-3f);
+#endif
+
+	const Camera::RayBasis& rayBasis = camera.GetRayBasis();
+	const ShaderCamera shaderCamera = {
+		rayBasis.origin0.homogeneous(),
+		ShaderVector(rayBasis.ray0), ShaderVector(rayBasis.horizontal), ShaderVector(rayBasis.vertical),
+		ShaderVector(rayBasis.originHorizontal), ShaderVector(rayBasis.originVertical)
+	};
+	uniforms.ring.Write(uniforms.camera, shaderCamera);
+}
 
-		Eigen::Vector4f ray00 = inverseViewProjectionMatrix * Eigen::Vector4f(-1, -1, 0, 1);
-		ray00 /= ray00.w();
-		ray00 -= eye;
+void ApplyInput(SceneUniforms& uniforms, Camera& camera, const FrameInput& input, const float timeDelta)
+{
+	if (input.forward || input.back || input.left || input.right || input.up || input.down)
+	{
+		//const float moveSensitivity = shift ? 120.f : 50.f;
+		const float moveSensitivity = .005f;
+		const float forwardDelta =
+			((input.forward ? moveSensitivity : -moveSensitivity) +
+				(input.back ? -moveSensitivity : moveSensitivity))
+			* timeDelta;
+		const float rightDelta =
+			((input.right ? moveSensitivity : -moveSensitivity) +
+				(input.left ? -moveSensitivity : moveSensitivity))
+			* timeDelta;
+		const float upDelta =
+			((input.up ? -moveSensitivity : moveSensitivity) +
+				(input.down ? moveSensitivity : -moveSensitivity))
+			* timeDelta;
 
-		Eigen::Vector4f ray10 = inverseViewProjectionMatrix * Eigen::Vector4f(1, -1, 0, 1);
-		ray10 /= ray10.w();
-		ray10 -= eye;
+		camera.TranslateLocal({ rightDelta, upDelta, forwardDelta });
+	}
 
-		Eigen::Vector4f ray01 = inverseViewProjectionMatrix * Eigen::Vector4f(-1, 1, 0, 1);
-		ray01 /= ray01.w();
-		ray01 -= eye;
+	if (input.dragX != 0 || input.dragY != 0)
+	{
+		const float mouseSensitivity = 0.001f;
+		const float xMove = mouseSensitivity * input.dragX;
+		const float yMove = mouseSensitivity * input.dragY;
 
-		struct ShaderCamera
-		{
-			Eigen::Vector4f position;
-			Eigen::Vector4f ray0;
-			Eigen::Vector4f horizontal;
-			Eigen::Vector4f vertical;
-		};
+		camera.Rotate({ 0, 1, 0 }, -xMove);
+		camera.RotateLocal({ 1, 0, 0 }, yMove);
+	}
 
-		ShaderCamera shaderCamera = {
-			eye, ray00, ray10 - ray00, ray01 - ray00
-		};
+	UpdateCamera(uniforms, camera);
 
-		pipeline.SetUniform("rayMarch", "camera", shaderCamera);
-	}
+	uniforms.elapsed += timeDelta * .001f;
+	uniforms.ring.Write(uniforms.time, uniforms.elapsed);
 }
 
-void HandleInput(HawkEye::Pipeline& pipeline, EverViewport::Window& window, Camera& camera, float timeDelta)
+void HandleInput(SceneUniforms& uniforms, EverViewport::Window& window, Camera& camera, float timeDelta)
 {
 	static bool lastEsc = false;
-	static float timeUniform = 0.f;
 
 	bool nowEsc = CoreInput.IsKeyPressed(Core::Input::Keys::Escape);
 	if (nowEsc && !lastEsc)
@@ -59,63 +87,25 @@ void HandleInput(HawkEye::Pipeline& pipeline, EverViewport::Window& window, Came
 	static uint16_t lastMouseX = 0;
 	static uint16_t lastMouseY = 0;
 
-	bool forward = CoreInput.IsKeyPressed(Core::Input::Keys::W) || CoreInput.IsKeyPressed(Core::Input::Keys::Up);
-	bool back = CoreInput.IsKeyPressed(Core::Input::Keys::S) || CoreInput.IsKeyPressed(Core::Input::Keys::Down);
-	bool left = CoreInput.IsKeyPressed(Core::Input::Keys::A) || CoreInput.IsKeyPressed(Core::Input::Keys::Left);
-	bool right = CoreInput.IsKeyPressed(Core::Input::Keys::D) || CoreInput.IsKeyPressed(Core::Input::Keys::Right);
+	FrameInput input;
+	input.forward = CoreInput.IsKeyPressed(Core::Input::Keys::W) || CoreInput.IsKeyPressed(Core::Input::Keys::Up);
+	input.back = CoreInput.IsKeyPressed(Core::Input::Keys::S) || CoreInput.IsKeyPressed(Core::Input::Keys::Down);
+	input.left = CoreInput.IsKeyPressed(Core::Input::Keys::A) || CoreInput.IsKeyPressed(Core::Input::Keys::Left);
+	input.right = CoreInput.IsKeyPressed(Core::Input::Keys::D) || CoreInput.IsKeyPressed(Core::Input::Keys::Right);
 
-	bool up = CoreInput.IsKeyPressed(Core::Input::Keys::R);
-	bool down = CoreInput.IsKeyPressed(Core::Input::Keys::F);
-
-	bool shift = CoreInput.IsKeyPressed(Core::Input::Keys::Shift);
-
-	if (forward || back || left || right || up || down)
-	{
-		//const float moveSensitivity = shift ? 120.f : 50.f;
-		const float moveSensitivity = .005f;
-		const float forwardDelta =
-			((forward ? moveSensitivity : -moveSensitivity) +
-				(back ? -moveSensitivity : moveSensitivity))
-			* timeDelta;
-		const float rightDelta =
-			((right ? moveSensitivity : -moveSensitivity) +
-				(left ? -moveSensitivity : moveSensitivity))
-			* timeDelta;
-		const float upDelta =
-			((up ? -moveSensitivity : moveSensitivity) +
-				(down ? moveSensitivity : -moveSensitivity))
-			* timeDelta;
-
-		camera.TranslateLocal({ rightDelta, upDelta, forwardDelta });
-	}
+	input.up = CoreInput.IsKeyPressed(Core::Input::Keys::R);
+	input.down = CoreInput.IsKeyPressed(Core::Input::Keys::F);
 
 	uint16_t mouseX = CoreInput.GetMouseX();
 	uint16_t mouseY = CoreInput.GetMouseY();
-	const bool isMousePressedLeft = CoreInput.IsMouseButtonPressed(Core::Input::MouseButtons::Left);
-	const float mouseSensitivity = 0.001f;
-
-	if (isMousePressedLeft)
+	if (CoreInput.IsMouseButtonPressed(Core::Input::MouseButtons::Left))
 	{
-		const int deltaX = int(lastMouseX) - int(mouseX);
-		const int deltaY = int(lastMouseY) - int(mouseY);
-		static int maxD = 0;
-
-		const float xMove = mouseSensitivity * deltaX;
-		const float yMove = mouseSensitivity * deltaY;
-
-		camera.Rotate({ 0, 1, 0 }, -xMove);
-		camera.RotateLocal({ 1, 0, 0 }, yMove);
+		input.dragX = int(lastMouseX) - int(mouseX);
+		input.dragY = int(lastMouseY) - int(mouseY);
 	}
 
-	UpdateCamera(pipeline, camera);
+	ApplyInput(uniforms, camera, input, timeDelta);
 
 	lastMouseX = mouseX;
 	lastMouseY = mouseY;
-
-	timeUniform += timeDelta * .001f;
-
-	if (pipeline.Configured())
-	{
-		pipeline.SetUniform("rayMarch", "time", timeUniform);
-	}
 }
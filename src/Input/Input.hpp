@@ -1,8 +1,53 @@
 #pragma once
 #include "../Camera/Camera.hpp"
+#include "../Scene/SceneParameters.hpp"
+#include "../Uniforms/ParameterBlock.hpp"
+#include "../Uniforms/UniformRing.hpp"
 
 #include <HawkEye/HawkEyeAPI.hpp>
 #include <EverViewport/WindowAPI.hpp>
 
-void UpdateCamera(HawkEye::Pipeline& pipeline, Camera& camera);
-void HandleInput(HawkEye::Pipeline& pipeline, EverViewport::Window& window, Camera& camera, float timeDelta);
+/// Camera uniform of the rayMarch node, directions padded to vec4.
+struct ShaderCamera
+{
+	Eigen::Vector4f position;
+	Eigen::Vector4f ray0;
+	Eigen::Vector4f horizontal;
+	Eigen::Vector4f vertical;
+	Eigen::Vector4f originHorizontal;
+	Eigen::Vector4f originVertical;
+};
+
+/// Uniforms of the rayMarch node, staged in the ring and uploaded when it is flushed.
+struct SceneUniforms
+{
+	explicit SceneUniforms(UniformRing& ring);
+
+	UniformRing& ring;
+	UniformRing::Handle camera;
+	UniformRing::Handle time;
+	ParameterBlock<SceneParameters> parameters;
+	/// Seconds written to the time uniform.
+	float elapsed = 0.f;
+};
+
+/// Controls held in a frame, read from the window by HandleInput() or replayed.
+struct FrameInput
+{
+	bool forward = false;
+	bool back = false;
+	bool left = false;
+	bool right = false;
+	bool up = false;
+	bool down = false;
+	/// Mouse position of the last frame minus the current one in pixels while the left button is
+	/// held, zero otherwise.
+	int dragX = 0;
+	int dragY = 0;
+};
+
+void UpdateCamera(SceneUniforms& uniforms, Camera& camera);
+/// Moves the camera by the input of a frame and stages the camera and time uniforms. Runs every
+/// frame, so it must not allocate.
+void ApplyInput(SceneUniforms& uniforms, Camera& camera, const FrameInput& input, float timeDelta);
+void HandleInput(SceneUniforms& uniforms, EverViewport::Window& window, Camera& camera, float timeDelta);
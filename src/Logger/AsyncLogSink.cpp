@@ -0,0 +1,226 @@
+#include "AsyncLogSink.hpp"
+#include "ThreadIndex.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	// By name, the values of Core::LoggerSeverity are not ours to index with.
+	const char* SeverityPrefix(const Core::LoggerSeverity severity)
+	{
+		switch (severity)
+		{
+		case Core::LoggerSeverity::Trace:
+			return "[Trace] ";
+		case Core::LoggerSeverity::Debug:
+			return "[Debug] ";
+		case Core::LoggerSeverity::Info:
+			return "[Info] ";
+		case Core::LoggerSeverity::Warn:
+			return "[Warn] ";
+		case Core::LoggerSeverity::Error:
+			return "[Error] ";
+		case Core::LoggerSeverity::Fatal:
+			return "[Fatal] ";
+		}
+		return "";
+	}
+
+	// The writer sleeps this long at most when a wake-up races with it going to sleep.
+	constexpr std::chrono::milliseconds WRITER_IDLE_TIMEOUT(2);
+}
+
+AsyncLogSink::AsyncLogSink(std::vector<Output> outputs, uint32_t capacity, FullPolicy policy)
+	: outputs(std::move(outputs)), policy(policy), start(std::chrono::steady_clock::now())
+{
+	uint64_t size = 2;
+	while (size < capacity)
+	{
+		size <<= 1;
+	}
+	mask = size - 1;
+
+	ring.reset(new Record[size]);
+	for (uint64_t i = 0; i < size; ++i)
+	{
+		ring[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	writer = std::thread(&AsyncLogSink::WriterLoop, this);
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+	stopping.store(true);
+	WakeWriter();
+	writer.join();
+}
+
+void AsyncLogSink::Push(const char* message, Core::LoggerSeverity severity)
+{
+	// Bounded multi-producer queue: a slot whose sequence equals the position is free for the
+	// producer which claims that position.
+	uint64_t position = enqueuePosition.load(std::memory_order_relaxed);
+	Record* record;
+	for (;;)
+	{
+		record = &ring[position & mask];
+		const uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+		const int64_t difference = int64_t(sequence) - int64_t(position);
+		if (difference == 0)
+		{
+			if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// Full, the slot still holds the record of the previous lap.
+			if (policy == FullPolicy::Drop)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			WakeWriter();
+			std::this_thread::yield();
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+		else
+		{
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	record->timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	record->threadIndex = CurrentThreadIndex();
+	record->severity = severity;
+	const size_t length = std::min<size_t>(std::strlen(message), MESSAGE_CAPACITY);
+	std::memcpy(record->text, message, length);
+	record->length = uint16_t(length);
+	record->sequence.store(position + 1, std::memory_order_release);
+
+	if (writerSleeping.load(std::memory_order_relaxed))
+	{
+		WakeWriter();
+	}
+
+	if (severity == Core::LoggerSeverity::Fatal)
+	{
+		Flush();
+	}
+}
+
+void AsyncLogSink::Flush()
+{
+	const uint64_t target = enqueuePosition.load(std::memory_order_acquire);
+	while (writtenPosition.load(std::memory_order_acquire) < target)
+	{
+		WakeWriter();
+		std::this_thread::yield();
+	}
+}
+
+uint64_t AsyncLogSink::GetDroppedCount() const
+{
+	return dropped.load(std::memory_order_relaxed);
+}
+
+void AsyncLogSink::WriterLoop()
+{
+	std::vector<std::string> batches(outputs.size());
+	for (;;)
+	{
+		if (Drain(batches) > 0)
+		{
+			continue;
+		}
+
+		if (stopping.load())
+		{
+			// Producers may still have been publishing while the stop was requested.
+			if (Drain(batches) == 0)
+			{
+				break;
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		writerSleeping.store(true);
+		wake.wait_for(lock, WRITER_IDLE_TIMEOUT);
+		writerSleeping.store(false);
+	}
+}
+
+uint64_t AsyncLogSink::Drain(std::vector<std::string>& batches)
+{
+	for (std::string& batch : batches)
+	{
+		batch.clear();
+	}
+
+	uint64_t count = 0;
+	for (;;)
+	{
+		Record& record = ring[dequeuePosition & mask];
+		if (record.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+		{
+			break;
+		}
+
+		char header[48];
+		const int64_t microseconds = record.timestamp / 1000;
+		const int headerLength = std::snprintf(header, sizeof(header), "[%6lld.%06lld] [T%u] %s",
+			(long long)(microseconds / 1000000), (long long)(microseconds % 1000000), record.threadIndex,
+			SeverityPrefix(record.severity));
+
+		for (size_t i = 0; i < outputs.size(); ++i)
+		{
+			if (int(record.severity) < int(outputs[i].minimumSeverity))
+			{
+				continue;
+			}
+			batches[i].append(header, headerLength);
+			batches[i].append(record.text, record.length);
+			if (record.length == MESSAGE_CAPACITY)
+			{
+				batches[i].append("...\n");
+			}
+		}
+
+		record.sequence.store(dequeuePosition + mask + 1, std::memory_order_release);
+		++dequeuePosition;
+		++count;
+	}
+
+	const uint64_t droppedNow = dropped.load(std::memory_order_relaxed);
+	if (droppedNow != reportedDropped)
+	{
+		const std::string report = "[Warn] " + std::to_string(droppedNow - reportedDropped) + " log messages dropped\n";
+		for (std::string& batch : batches)
+		{
+			batch += report;
+		}
+		reportedDropped = droppedNow;
+	}
+
+	for (size_t i = 0; i < outputs.size(); ++i)
+	{
+		if (!batches[i].empty())
+		{
+			outputs[i].stream->write(batches[i].data(), batches[i].size());
+			outputs[i].stream->flush();
+		}
+	}
+
+	writtenPosition.store(dequeuePosition, std::memory_order_release);
+	return count;
+}
+
+void AsyncLogSink::WakeWriter()
+{
+	wake.notify_one();
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <SoftwareCore/DefaultLogger.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Logger output which moves formatting and writing off the calling thread.
+/// Producers copy the message into a bounded lock-free multi-producer ring, a dedicated writer
+/// thread drains it in batches, prefixes every record with its timestamp, thread and severity
+/// and writes each batch with a single call per output stream.
+class AsyncLogSink
+{
+public:
+	/// What Push() does when the ring is full.
+	enum class FullPolicy
+	{
+		/// Discards the message and counts it, the caller never waits.
+		Drop,
+		/// Yields until the writer frees a slot, no message is lost.
+		Block
+	};
+
+	/// Stream receiving every message whose severity is numbered at least as high as the given one.
+	struct Output
+	{
+		std::ostream* stream;
+		Core::LoggerSeverity minimumSeverity;
+	};
+
+	static constexpr uint32_t DEFAULT_CAPACITY = 4096;
+	/// Longer messages are truncated.
+	static constexpr uint32_t MESSAGE_CAPACITY = 232;
+
+	/// Starts the writer thread. The capacity is rounded up to a power of two.
+	AsyncLogSink(std::vector<Output> outputs, uint32_t capacity = DEFAULT_CAPACITY, FullPolicy policy = FullPolicy::Block);
+	/// Writes out all queued messages and joins the writer thread.
+	~AsyncLogSink();
+
+	AsyncLogSink(const AsyncLogSink&) = delete;
+	AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+	/// Queues the message, safe to call from any number of threads.
+	/// Fatal messages are flushed before the call returns.
+	void Push(const char* message, Core::LoggerSeverity severity);
+
+	/// Returns once every message pushed before the call has been written.
+	void Flush();
+
+	/// Number of messages discarded by the Drop policy.
+	uint64_t GetDroppedCount() const;
+
+private:
+	struct Record
+	{
+		std::atomic<uint64_t> sequence;
+		int64_t timestamp;
+		uint32_t threadIndex;
+		Core::LoggerSeverity severity;
+		uint16_t length;
+		char text[MESSAGE_CAPACITY];
+	};
+
+	void WriterLoop();
+	// Formats and writes all published records, returns the number written.
+	uint64_t Drain(std::vector<std::string>& batches);
+	void WakeWriter();
+
+	std::vector<Output> outputs;
+	FullPolicy policy;
+	std::unique_ptr<Record[]> ring;
+	uint64_t mask;
+	std::chrono::steady_clock::time_point start;
+
+	alignas(64) std::atomic<uint64_t> enqueuePosition{ 0 };
+	alignas(64) std::atomic<uint64_t> writtenPosition{ 0 };
+	uint64_t dequeuePosition = 0;
+	std::atomic<uint64_t> dropped{ 0 };
+	uint64_t reportedDropped = 0;
+
+	std::atomic<bool> writerSleeping{ false };
+	std::atomic<bool> stopping{ false };
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	std::thread writer;
+};
@@ -0,0 +1,160 @@
+#include "BinaryLog.hpp"
+
+namespace
+{
+	// Zero is never a generation, a call site starts out matching no log.
+	std::atomic<uint32_t> nextGeneration{ 1 };
+}
+
+BinaryLog::BinaryLog(const std::string& path)
+	: file(path, std::ios_base::binary | std::ios_base::trunc), generation(nextGeneration.fetch_add(1)),
+	start(std::chrono::steady_clock::now())
+{
+	buffer.reserve(FLUSH_THRESHOLD * 2);
+	buffer.insert(buffer.end(), BinaryLogFormat::MAGIC, BinaryLogFormat::MAGIC + sizeof(BinaryLogFormat::MAGIC));
+	uint8_t version[sizeof(BinaryLogFormat::VERSION)];
+	std::memcpy(version, &BinaryLogFormat::VERSION, sizeof(version));
+	buffer.insert(buffer.end(), version, version + sizeof(version));
+
+	// Handing off and reusing buffers only allocates while the writer is behind.
+	full.reserve(4);
+	spare.reserve(4);
+	writer = std::thread(&BinaryLog::WriterLoop, this);
+}
+
+BinaryLog::~BinaryLog()
+{
+	Flush();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+}
+
+bool BinaryLog::IsOpen() const
+{
+	return file.is_open();
+}
+
+uint32_t BinaryLog::RegisterFormat(const char* format)
+{
+	// The decoder would misread the records of a format it cannot parse.
+	std::vector<BinaryLogFormat::ArgumentType> types;
+	if (!BinaryLogFormat::ParseArgumentTypes(format, types))
+	{
+		return INVALID_FORMAT;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const uint32_t id = uint32_t(formatTypes.size());
+	formatTypes.push_back(std::move(types));
+
+	const size_t length = std::strlen(format);
+	BinaryLogFormat::WriteVarint(buffer, uint64_t(id) << 1 | 1);
+	BinaryLogFormat::WriteVarint(buffer, length);
+	buffer.insert(buffer.end(), format, format + length);
+	return id;
+}
+
+uint32_t BinaryLog::GetFormatId(const char* format)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto known = formatIds.find(format);
+		if (known != formatIds.end())
+		{
+			return known->second;
+		}
+	}
+	// Two threads may both register the format, each of its two ids decodes to it.
+	const uint32_t id = RegisterFormat(format);
+	std::lock_guard<std::mutex> lock(mutex);
+	return formatIds.emplace(format, id).first->second;
+}
+
+uint64_t BinaryLog::GetDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return dropped;
+}
+
+void BinaryLog::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!buffer.empty())
+	{
+		HandOffLocked();
+	}
+	const uint64_t target = handedOff;
+	writtenChanged.wait(lock, [this, target]() { return written >= target; });
+}
+
+void BinaryLog::EncodeString(std::vector<uint8_t>& buffer, const char* value, size_t length)
+{
+	BinaryLogFormat::WriteVarint(buffer, length);
+	buffer.insert(buffer.end(), value, value + length);
+}
+
+bool BinaryLog::MatchesLocked(const uint32_t formatId, const BinaryLogFormat::ArgumentType* types, const size_t count) const
+{
+	if (formatId >= formatTypes.size() || formatTypes[formatId].size() != count)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		// Integers are converted to the signedness of the conversion, as printf would.
+		const BinaryLogFormat::ArgumentType expected = formatTypes[formatId][i];
+		const bool integer = types[i] == BinaryLogFormat::ArgumentType::Signed || types[i] == BinaryLogFormat::ArgumentType::Unsigned;
+		const bool integerExpected = expected == BinaryLogFormat::ArgumentType::Signed || expected == BinaryLogFormat::ArgumentType::Unsigned;
+		if (types[i] != expected && !(integer && integerExpected))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void BinaryLog::HandOffLocked()
+{
+	full.push_back(std::move(buffer));
+	if (!spare.empty())
+	{
+		buffer = std::move(spare.back());
+		spare.pop_back();
+	}
+	else
+	{
+		buffer = std::vector<uint8_t>();
+		buffer.reserve(FLUSH_THRESHOLD * 2);
+	}
+	++handedOff;
+	wake.notify_one();
+}
+
+void BinaryLog::WriterLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		wake.wait(lock, [this]() { return !full.empty() || stopping; });
+		if (full.empty())
+		{
+			return;
+		}
+
+		std::vector<uint8_t> chunk = std::move(full.front());
+		full.erase(full.begin());
+		lock.unlock();
+		file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+		file.flush();
+		lock.lock();
+
+		chunk.clear();
+		spare.push_back(std::move(chunk));
+		++written;
+		writtenChanged.notify_all();
+	}
+}
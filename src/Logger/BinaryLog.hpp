@@ -0,0 +1,207 @@
+#pragma once
+#include "BinaryLogFormat.hpp"
+#include "ThreadIndex.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/// Compact log for high-rate telemetry (per-frame timings, per-tile statistics).
+/// Format strings are registered once and records only hold the arguments, formatting is
+/// left to the offline decoder (tools/LogDecoder). See BinaryLogFormat.hpp for the layout.
+/// Full buffers are written by a writer thread, recording never waits on the file.
+class BinaryLog
+{
+public:
+	/// Records are handed to the writer thread once this many bytes are buffered.
+	static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+	/// Id of a format string which could not be registered, records with it are dropped.
+	static constexpr uint32_t INVALID_FORMAT = ~uint32_t(0);
+
+	/// Opens the file and starts the writer thread.
+	explicit BinaryLog(const std::string& path);
+	/// Writes out the buffered records and joins the writer thread.
+	~BinaryLog();
+
+	BinaryLog(const BinaryLog&) = delete;
+	BinaryLog& operator=(const BinaryLog&) = delete;
+
+	bool IsOpen() const;
+
+	/// Registers a printf format string and returns the id to record it with, or INVALID_FORMAT
+	/// if it has a conversion the decoder does not support. Supported conversions are
+	/// d i u c o x X f F e E g G a A s with any flags, width, precision and length modifier.
+	uint32_t RegisterFormat(const char* format);
+	/// Id of the format string in this log, registered on the first call with the pointer.
+	uint32_t GetFormatId(const char* format);
+	/// Id of the format string for a call site which keeps the id of the last log it recorded
+	/// to in the site, see LogTelemetry. Another log - or the same log opened again - is told
+	/// apart by its generation, so the site never records with an id of a different log.
+	uint32_t GetFormatId(std::atomic<uint64_t>& site, const char* format);
+
+	/// Appends a record of the registered format, safe to call from any thread.
+	/// Integers, floating point values and C strings are accepted. A record the decoder could
+	/// not read back - an unknown id, a different number of arguments than conversions or an
+	/// argument of another type than its conversion - is dropped and counted.
+	template <class... Args>
+	void Record(uint32_t formatId, const Args&... args);
+	/// Number of records dropped so far.
+	uint64_t GetDroppedCount();
+
+	/// Returns once the buffered records are written to the file.
+	void Flush();
+
+private:
+	static void EncodeString(std::vector<uint8_t>& buffer, const char* value, size_t length);
+	// Integers are stored as the format string declares them, not by their C++ signedness.
+	template <class T>
+	static void Encode(std::vector<uint8_t>& buffer, BinaryLogFormat::ArgumentType type, const T& value);
+
+	template <class T>
+	static BinaryLogFormat::ArgumentType TypeOf();
+
+	// Whether arguments of the types can be recorded with the format.
+	bool MatchesLocked(uint32_t formatId, const BinaryLogFormat::ArgumentType* types, size_t count) const;
+	// Queues the buffer for the writer thread and continues with a written one.
+	void HandOffLocked();
+	void WriterLoop();
+
+	std::ofstream file;
+	std::mutex mutex;
+	std::vector<uint8_t> buffer;
+	std::vector<std::vector<BinaryLogFormat::ArgumentType>> formatTypes;
+	std::unordered_map<const char*, uint32_t> formatIds;
+	const uint32_t generation;
+	std::chrono::steady_clock::time_point start;
+	uint64_t lastTimestamp = 0;
+	uint64_t dropped = 0;
+
+	// Buffers waiting for the writer in order, and written ones kept for reuse.
+	std::vector<std::vector<uint8_t>> full;
+	std::vector<std::vector<uint8_t>> spare;
+	uint64_t handedOff = 0;
+	uint64_t written = 0;
+	bool stopping = false;
+	std::condition_variable wake;
+	std::condition_variable writtenChanged;
+	std::thread writer;
+};
+
+/// Records telemetry into the binary log opened by InitLogger, the format string is registered
+/// with a log on the first call of each call site. Does nothing when no binary log is open.
+#define LogTelemetry(format, ...) \
+	do \
+	{ \
+		if (BinaryLog* binaryLog_ = GetBinaryLog()) \
+		{ \
+			static std::atomic<uint64_t> formatSite_{ 0 }; \
+			binaryLog_->Record(binaryLog_->GetFormatId(formatSite_, format), ##__VA_ARGS__); \
+		} \
+	} while (false)
+
+/// Binary log opened by InitLogger, or null if none was requested.
+BinaryLog* GetBinaryLog();
+
+inline uint32_t BinaryLog::GetFormatId(std::atomic<uint64_t>& site, const char* format)
+{
+	// Generation in the high half, id in the low half.
+	const uint64_t cached = site.load(std::memory_order_relaxed);
+	if (uint32_t(cached >> 32) == generation)
+	{
+		return uint32_t(cached);
+	}
+	const uint32_t id = GetFormatId(format);
+	site.store(uint64_t(generation) << 32 | id, std::memory_order_relaxed);
+	return id;
+}
+
+template <class T>
+BinaryLogFormat::ArgumentType BinaryLog::TypeOf()
+{
+	if constexpr (std::is_floating_point<T>::value)
+	{
+		return BinaryLogFormat::ArgumentType::Floating;
+	}
+	else if constexpr (std::is_convertible<T, const char*>::value || std::is_same<T, std::string>::value)
+	{
+		return BinaryLogFormat::ArgumentType::String;
+	}
+	else
+	{
+		return std::is_signed<T>::value ? BinaryLogFormat::ArgumentType::Signed : BinaryLogFormat::ArgumentType::Unsigned;
+	}
+}
+
+template <class T>
+void BinaryLog::Encode(std::vector<uint8_t>& buffer, BinaryLogFormat::ArgumentType type, const T& value)
+{
+	if constexpr (std::is_convertible<const T&, const char*>::value)
+	{
+		const char* string = value;
+		EncodeString(buffer, string, std::strlen(string));
+	}
+	else if constexpr (std::is_same<T, std::string>::value)
+	{
+		EncodeString(buffer, value.data(), value.size());
+	}
+	else if constexpr (std::is_floating_point<T>::value)
+	{
+		const double promoted = double(value);
+		uint8_t bytes[sizeof(double)];
+		std::memcpy(bytes, &promoted, sizeof(double));
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(double));
+	}
+	else
+	{
+		static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Unsupported binary log argument.");
+		if (type == BinaryLogFormat::ArgumentType::Signed)
+		{
+			BinaryLogFormat::WriteVarint(buffer, BinaryLogFormat::ZigZag(int64_t(value)));
+		}
+		else
+		{
+			BinaryLogFormat::WriteVarint(buffer, uint64_t(value));
+		}
+	}
+}
+
+template <class... Args>
+void BinaryLog::Record(uint32_t formatId, const Args&... args)
+{
+	// An array, a record must not allocate.
+	const std::array<BinaryLogFormat::ArgumentType, sizeof...(Args)> argumentTypes = { TypeOf<typename std::decay<Args>::type>()... };
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!MatchesLocked(formatId, argumentTypes.data(), argumentTypes.size()))
+	{
+		++dropped;
+		return;
+	}
+
+	const uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	BinaryLogFormat::WriteVarint(buffer, uint64_t(formatId) << 1);
+	BinaryLogFormat::WriteVarint(buffer, timestamp - lastTimestamp);
+	BinaryLogFormat::WriteVarint(buffer, CurrentThreadIndex());
+	lastTimestamp = timestamp;
+
+	// Expands to one Encode per argument, in order.
+	const BinaryLogFormat::ArgumentType* type = formatTypes[formatId].data();
+	const int expand[] = { 0, (Encode(buffer, *type++, args), 0)... };
+	(void)expand;
+	(void)type;
+
+	if (buffer.size() >= FLUSH_THRESHOLD)
+	{
+		HandOffLocked();
+	}
+}
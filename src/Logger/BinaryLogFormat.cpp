@@ -0,0 +1,362 @@
+#include "BinaryLogFormat.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace BinaryLogFormat
+{
+	namespace
+	{
+		// Literal text up to the next conversion, and the conversion itself with its length
+		// modifier removed.
+		struct Segment
+		{
+			std::string literal;
+			std::string specification;
+			char conversion = 0;
+		};
+
+		bool SplitFormat(const std::string& format, std::vector<Segment>& segments)
+		{
+			segments.clear();
+			Segment segment;
+			for (size_t i = 0; i < format.size(); ++i)
+			{
+				if (format[i] != '%')
+				{
+					segment.literal += format[i];
+					continue;
+				}
+				if (i + 1 < format.size() && format[i + 1] == '%')
+				{
+					segment.literal += '%';
+					++i;
+					continue;
+				}
+
+				segment.specification = "%";
+				++i;
+				while (i < format.size() && std::strchr("-+ #0123456789.", format[i]))
+				{
+					segment.specification += format[i++];
+				}
+				while (i < format.size() && std::strchr("hljztL", format[i]))
+				{
+					++i;
+				}
+				if (i == format.size() || !std::strchr("diucoxXfFeEgGaAs", format[i]))
+				{
+					return false;
+				}
+				segment.conversion = format[i];
+				segments.push_back(segment);
+				segment = Segment();
+			}
+			if (!segment.literal.empty())
+			{
+				segments.push_back(segment);
+			}
+			return true;
+		}
+
+		ArgumentType TypeOf(const char conversion)
+		{
+			switch (conversion)
+			{
+			case 'd': case 'i': case 'c':
+				return ArgumentType::Signed;
+			case 'u': case 'o': case 'x': case 'X':
+				return ArgumentType::Unsigned;
+			case 's':
+				return ArgumentType::String;
+			default:
+				return ArgumentType::Floating;
+			}
+		}
+
+		template <class... Args>
+		void AppendFormatted(std::string& text, const char* specification, Args... args)
+		{
+			char buffer[128];
+			const int length = std::snprintf(buffer, sizeof(buffer), specification, args...);
+			if (length < 0)
+			{
+				return;
+			}
+			if (size_t(length) < sizeof(buffer))
+			{
+				text.append(buffer, length);
+				return;
+			}
+			std::string large(size_t(length) + 1, '\0');
+			std::snprintf(&large[0], large.size(), specification, args...);
+			text.append(large.data(), length);
+		}
+
+		void AppendArgument(std::string& text, const Segment& segment, const Argument& argument)
+		{
+			switch (argument.type)
+			{
+			case ArgumentType::Signed:
+				if (segment.conversion == 'c')
+				{
+					AppendFormatted(text, (segment.specification + 'c').c_str(), int(argument.signedValue));
+				}
+				else
+				{
+					AppendFormatted(text, (segment.specification + "ll" + segment.conversion).c_str(), (long long)argument.signedValue);
+				}
+				break;
+			case ArgumentType::Unsigned:
+				AppendFormatted(text, (segment.specification + "ll" + segment.conversion).c_str(), (unsigned long long)argument.unsignedValue);
+				break;
+			case ArgumentType::Floating:
+				AppendFormatted(text, (segment.specification + segment.conversion).c_str(), argument.floatingValue);
+				break;
+			case ArgumentType::String:
+				AppendFormatted(text, (segment.specification + 's').c_str(), argument.stringValue.c_str());
+				break;
+			}
+		}
+
+		std::string CsvQuote(const std::string& value)
+		{
+			std::string quoted = "\"";
+			for (const char c : value)
+			{
+				if (c == '"')
+				{
+					quoted += "\"\"";
+				}
+				else if (c == '\n')
+				{
+					quoted += "\\n";
+				}
+				else
+				{
+					quoted += c;
+				}
+			}
+			return quoted + '"';
+		}
+	}
+
+	bool ParseArgumentTypes(const std::string& format, std::vector<ArgumentType>& types)
+	{
+		std::vector<Segment> segments;
+		if (!SplitFormat(format, segments))
+		{
+			return false;
+		}
+
+		types.clear();
+		for (const Segment& segment : segments)
+		{
+			if (segment.conversion)
+			{
+				types.push_back(TypeOf(segment.conversion));
+			}
+		}
+		return true;
+	}
+
+	void WriteVarint(std::vector<uint8_t>& buffer, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back(uint8_t(value) | 0x80);
+			value >>= 7;
+		}
+		buffer.push_back(uint8_t(value));
+	}
+
+	bool ReadVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (data == end)
+			{
+				return false;
+			}
+			const uint8_t byte = *data++;
+			value |= uint64_t(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool Reader::Open(const std::string& path)
+	{
+		std::ifstream file(path, std::ios_base::binary);
+		if (!file)
+		{
+			error = "cannot open " + path;
+			return false;
+		}
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+		uint32_t version = 0;
+		if (data.size() < sizeof(MAGIC) + sizeof(version) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+		{
+			error = path + " is not a binary log";
+			return false;
+		}
+		std::memcpy(&version, data.data() + sizeof(MAGIC), sizeof(version));
+		if (version != VERSION)
+		{
+			error = path + " has unsupported version " + std::to_string(version);
+			return false;
+		}
+
+		cursor = data.data() + sizeof(MAGIC) + sizeof(version);
+		end = data.data() + data.size();
+		timestamp = 0;
+		formats.clear();
+		error.clear();
+		return true;
+	}
+
+	bool Reader::Next(Record& record)
+	{
+		while (cursor != end)
+		{
+			uint64_t tag;
+			if (!ReadVarint(cursor, end, tag))
+			{
+				error = "truncated entry";
+				return false;
+			}
+			const uint32_t id = uint32_t(tag >> 1);
+
+			if (tag & 1)
+			{
+				uint64_t length;
+				if (!ReadVarint(cursor, end, length) || uint64_t(end - cursor) < length)
+				{
+					error = "truncated format definition";
+					return false;
+				}
+				Format& format = formats[id];
+				format.text.assign(reinterpret_cast<const char*>(cursor), size_t(length));
+				cursor += length;
+				if (!ParseArgumentTypes(format.text, format.types))
+				{
+					error = "unsupported format string '" + format.text + "'";
+					return false;
+				}
+				continue;
+			}
+
+			const auto format = formats.find(id);
+			if (format == formats.end())
+			{
+				error = "record with undefined format " + std::to_string(id);
+				return false;
+			}
+
+			uint64_t delta, threadIndex;
+			if (!ReadVarint(cursor, end, delta) || !ReadVarint(cursor, end, threadIndex))
+			{
+				error = "truncated record";
+				return false;
+			}
+			timestamp += delta;
+			record.timestamp = timestamp;
+			record.threadIndex = uint32_t(threadIndex);
+			record.formatId = id;
+			record.arguments.resize(format->second.types.size());
+
+			for (size_t i = 0; i < record.arguments.size(); ++i)
+			{
+				Argument& argument = record.arguments[i];
+				argument.type = format->second.types[i];
+				uint64_t value = 0;
+				switch (argument.type)
+				{
+				case ArgumentType::Floating:
+					if (end - cursor < ptrdiff_t(sizeof(double)))
+					{
+						error = "truncated record";
+						return false;
+					}
+					std::memcpy(&argument.floatingValue, cursor, sizeof(double));
+					cursor += sizeof(double);
+					break;
+				case ArgumentType::String:
+					if (!ReadVarint(cursor, end, value) || uint64_t(end - cursor) < value)
+					{
+						error = "truncated record";
+						return false;
+					}
+					argument.stringValue.assign(reinterpret_cast<const char*>(cursor), size_t(value));
+					cursor += value;
+					break;
+				default:
+					if (!ReadVarint(cursor, end, value))
+					{
+						error = "truncated record";
+						return false;
+					}
+					argument.signedValue = UnZigZag(value);
+					argument.unsignedValue = value;
+					break;
+				}
+			}
+			return true;
+		}
+		return false;
+	}
+
+	std::string Reader::FormatText(const Record& record) const
+	{
+		std::vector<Segment> segments;
+		SplitFormat(formats.at(record.formatId).text, segments);
+
+		std::string text;
+		size_t argument = 0;
+		for (const Segment& segment : segments)
+		{
+			text += segment.literal;
+			if (segment.conversion)
+			{
+				AppendArgument(text, segment, record.arguments[argument++]);
+			}
+		}
+		return text;
+	}
+
+	std::string Reader::FormatCsv(const Record& record) const
+	{
+		std::string row;
+		AppendFormatted(row, "%.9f,%u,%u,", record.timestamp * 1e-9, record.threadIndex, record.formatId);
+		row += CsvQuote(formats.at(record.formatId).text);
+		for (const Argument& argument : record.arguments)
+		{
+			row += ',';
+			switch (argument.type)
+			{
+			case ArgumentType::Signed: row += std::to_string(argument.signedValue); break;
+			case ArgumentType::Unsigned: row += std::to_string(argument.unsignedValue); break;
+			case ArgumentType::Floating: AppendFormatted(row, "%.17g", argument.floatingValue); break;
+			case ArgumentType::String: row += CsvQuote(argument.stringValue); break;
+			}
+		}
+		return row;
+	}
+
+	const char* Reader::CsvHeader()
+	{
+		return "time_s,thread,format_id,format,arguments...";
+	}
+
+	const std::string& Reader::GetError() const
+	{
+		return error;
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Layout of the binary log shared by the writer (BinaryLog) and the decoder tool.
+///
+/// The file starts with the magic "RMBL" and a uint32 version, followed by entries which all
+/// start with a varint tag. An odd tag (id << 1 | 1) defines the format string of the id and
+/// is followed by the varint string length and its characters. An even tag (id << 1) is a
+/// record: the varint nanoseconds since the previous record, the varint thread index and the
+/// arguments. Integers are stored as varints (signed ones zigzag encoded), floating point
+/// values as raw little-endian doubles and strings as a varint length and the characters.
+/// The argument types follow from the printf conversions of the format string.
+namespace BinaryLogFormat
+{
+	constexpr char MAGIC[4] = { 'R', 'M', 'B', 'L' };
+	constexpr uint32_t VERSION = 1;
+
+	/// How an argument is stored in a record.
+	enum class ArgumentType : uint8_t
+	{
+		Signed,
+		Unsigned,
+		Floating,
+		String
+	};
+
+	/// Argument types of the printf conversions in the format string, or false when the
+	/// string holds a conversion the format cannot store (%n, %p, * widths).
+	bool ParseArgumentTypes(const std::string& format, std::vector<ArgumentType>& types);
+
+	void WriteVarint(std::vector<uint8_t>& buffer, uint64_t value);
+	bool ReadVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value);
+
+	inline uint64_t ZigZag(int64_t value) { return (uint64_t(value) << 1) ^ uint64_t(value >> 63); }
+	inline int64_t UnZigZag(uint64_t value) { return int64_t(value >> 1) ^ -int64_t(value & 1); }
+
+	/// Decoded argument, only the member of its type is valid.
+	struct Argument
+	{
+		ArgumentType type;
+		int64_t signedValue = 0;
+		uint64_t unsignedValue = 0;
+		double floatingValue = 0.;
+		std::string stringValue;
+	};
+
+	struct Record
+	{
+		/// Nanoseconds since the log was opened.
+		uint64_t timestamp;
+		uint32_t threadIndex;
+		uint32_t formatId;
+		std::vector<Argument> arguments;
+	};
+
+	/// Sequential reader of a binary log held in memory.
+	class Reader
+	{
+	public:
+		/// Reads the whole file, false if it can not be opened or is not a binary log.
+		bool Open(const std::string& path);
+
+		/// Decodes the next record, skipping format definitions.
+		/// @returns False at the end of the log or when the rest of it is corrupt (see GetError()).
+		bool Next(Record& record);
+
+		/// Record formatted through its format string, as the text logger would have written it.
+		std::string FormatText(const Record& record) const;
+		/// Record as a CSV row: time in seconds, thread, format id, quoted format, arguments.
+		std::string FormatCsv(const Record& record) const;
+		static const char* CsvHeader();
+
+		/// Empty unless Open() or Next() failed on a malformed log.
+		const std::string& GetError() const;
+
+	private:
+		struct Format
+		{
+			std::string text;
+			std::vector<ArgumentType> types;
+		};
+
+		std::vector<uint8_t> data;
+		const uint8_t* cursor = nullptr;
+		const uint8_t* end = nullptr;
+		uint64_t timestamp = 0;
+		std::unordered_map<uint32_t, Format> formats;
+		std::string error;
+	};
+}
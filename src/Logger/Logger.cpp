@@ -1,83 +1,68 @@
 #include "Logger.hpp"
+#include "AsyncLogSink.hpp"
+#include "BinaryLog.hpp"
 #include "../Filesystem/Filesystem.hpp"
 
 #include <SoftwareCore/DefaultLogger.hpp>
 #include <iostream>
 #include <fstream>
+#include <memory>
 
-void PrintConsole(const char* message, Core::LoggerSeverity severity)
-{
-	const char* traceSev = "[Trace] ";
-	const char* debugSev = "[Debug] ";
-	const char* infoSev = "[Info] ";
-	const char* warnSev = "[Warn] ";
-	const char* errorSev = "[Error] ";
-	const char* fatalSev = "[Fatal] ";
-
-	switch (severity)
-	{
-	case Core::LoggerSeverity::Trace:
-		std::cout << traceSev;
-		break;
-	case Core::LoggerSeverity::Debug:
-		std::cout << debugSev;
-		break;
-	case Core::LoggerSeverity::Info:
-		std::cout << infoSev;
-		break;
-	case Core::LoggerSeverity::Warn:
-		std::cout << warnSev;
-		break;
-	case Core::LoggerSeverity::Error:
-		std::cout << errorSev;
-		break;
-	case Core::LoggerSeverity::Fatal:
-		std::cout << fatalSev;
-		break;
-	}
+static std::ofstream output;
+static std::unique_ptr<AsyncLogSink> sink;
+static std::unique_ptr<BinaryLog> binaryLog;
 
-	std::cout << message;
-}
+// The log file keeps the severities it kept before the sink, numbered 3 and above.
+static constexpr Core::LoggerSeverity FILE_MINIMUM_SEVERITY = Core::LoggerSeverity(3);
 
-static std::ofstream output;
-void PrintFile(const char* message, Core::LoggerSeverity severity)
+// Console gets every message, the log file FILE_MINIMUM_SEVERITY and above. Both are written by the sink's
+// writer thread, so logging from render and worker threads does not wait on I/O. Once the
+// logger is shut down - say in the destructor of a static - messages go to the console directly.
+void PrintAsync(const char* message, Core::LoggerSeverity severity)
 {
-	if ((int)severity < 3)
+	if (!sink)
 	{
+		std::cout << message;
 		return;
 	}
+	sink->Push(message, severity);
+}
+
+void InitLogger(const std::string& logFile, const std::string& binaryLogFile)
+{
+	const std::string logFilePath = RMFS.GetAbsolutePath(logFile);
+	output.open(logFilePath, std::ios_base::trunc);
+
+	sink = std::make_unique<AsyncLogSink>(std::vector<AsyncLogSink::Output>{
+		{ &std::cout, Core::LoggerSeverity::Trace },
+		{ &output, FILE_MINIMUM_SEVERITY } });
 
-	const char* traceSev = "[Trace] ";
-	const char* debugSev = "[Debug] ";
-	const char* infoSev = "[Info] ";
-	const char* warnSev = "[Warn] ";
-	const char* errorSev = "[Error] ";
-	const char* fatalSev = "[Fatal] ";
+	DefaultLogger.SetNewOutput(&PrintAsync);
 
-	switch (severity)
+	if (!binaryLogFile.empty())
 	{
-	case Core::LoggerSeverity::Info:
-		output << infoSev;
-		break;
-	case Core::LoggerSeverity::Warn:
-		output << warnSev;
-		break;
-	case Core::LoggerSeverity::Error:
-		output << errorSev;
-		break;
-	case Core::LoggerSeverity::Fatal:
-		output << fatalSev;
-		break;
+		binaryLog = std::make_unique<BinaryLog>(RMFS.GetAbsolutePath(binaryLogFile));
+		if (!binaryLog->IsOpen())
+		{
+			CoreLogWarn(DefaultLogger, "Could not open the binary log %s.", binaryLogFile.c_str());
+			binaryLog.reset();
+		}
 	}
-
-	output << message;
 }
 
-void InitLogger(const std::string& logFile)
+BinaryLog* GetBinaryLog()
 {
-	const std::string logFilePath = RMFS.GetAbsolutePath(logFile);
-	output.open(logFilePath, std::ios_base::trunc);
+	return binaryLog.get();
+}
 
-	DefaultLogger.SetNewOutput(&PrintConsole);
-	DefaultLogger.SetNewOutput(&PrintFile);
+void ShutdownLogger()
+{
+	if (binaryLog && binaryLog->GetDroppedCount() > 0)
+	{
+		CoreLogWarn(DefaultLogger, "Dropped %llu telemetry records which did not match their format strings.",
+			(unsigned long long)binaryLog->GetDroppedCount());
+	}
+	binaryLog.reset();
+	sink.reset();
+	output.close();
 }
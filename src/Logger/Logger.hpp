@@ -1,4 +1,9 @@
 #pragma once
 #include <string>
 
-void InitLogger(const std::string& logFile);
+/// Opens the text log and, when a binary log file is given, the telemetry log written by
+/// LogTelemetry (see BinaryLog.hpp).
+void InitLogger(const std::string& logFile, const std::string& binaryLogFile = "");
+/// Writes out pending messages and stops the logger thread. Later messages are printed to the
+/// console on the calling thread, threads still logging have to be stopped before.
+void ShutdownLogger();
@@ -0,0 +1,12 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/// Small sequential index of the calling thread, stable for its lifetime.
+/// Shared by the log outputs so that their records refer to the same threads.
+inline uint32_t CurrentThreadIndex()
+{
+	static std::atomic<uint32_t> nextThreadIndex{ 0 };
+	thread_local const uint32_t threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+	return threadIndex;
+}
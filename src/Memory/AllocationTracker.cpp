@@ -0,0 +1,118 @@
+#include "AllocationTracker.hpp"
+
+#ifdef TRACK_ALLOCATIONS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace
+{
+	// Plain integers, constructed before anything can allocate.
+	std::atomic<uint64_t> allocations{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };
+
+	void Count(const size_t size)
+	{
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void* Allocate(const size_t size) noexcept
+	{
+		Count(size);
+		return std::malloc(size == 0 ? 1 : size);
+	}
+
+	void* AllocateAligned(const size_t size, const std::align_val_t alignment) noexcept
+	{
+		Count(size);
+#ifdef _WIN32
+		return _aligned_malloc(size == 0 ? 1 : size, size_t(alignment));
+#else
+		// aligned_alloc() takes whole multiples of the alignment.
+		const size_t multiple = size_t(alignment);
+		return std::aligned_alloc(multiple, (size == 0 ? 1 : (size + multiple - 1) / multiple) * multiple);
+#endif
+	}
+
+	void FreeAligned(void* pointer) noexcept
+	{
+#ifdef _WIN32
+		_aligned_free(pointer);
+#else
+		std::free(pointer);
+#endif
+	}
+
+	void* AllocateOrThrow(const size_t size)
+	{
+		void* pointer = Allocate(size);
+		if (!pointer)
+		{
+			throw std::bad_alloc();
+		}
+		return pointer;
+	}
+
+	void* AllocateAlignedOrThrow(const size_t size, const std::align_val_t alignment)
+	{
+		void* pointer = AllocateAligned(size, alignment);
+		if (!pointer)
+		{
+			throw std::bad_alloc();
+		}
+		return pointer;
+	}
+}
+
+// Replacements of every form of the global operator new and the matching operator delete.
+
+void* operator new(const size_t size) { return AllocateOrThrow(size); }
+void* operator new[](const size_t size) { return AllocateOrThrow(size); }
+void* operator new(const size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new[](const size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new(const size_t size, const std::align_val_t alignment) { return AllocateAlignedOrThrow(size, alignment); }
+void* operator new[](const size_t size, const std::align_val_t alignment) { return AllocateAlignedOrThrow(size, alignment); }
+void* operator new(const size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(size, alignment); }
+void* operator new[](const size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(size, alignment); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(pointer); }
+
+bool IsAllocationTrackingEnabled()
+{
+	return true;
+}
+
+AllocationCounts GetAllocationCounts()
+{
+	return { allocations.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed) };
+}
+
+#else
+
+bool IsAllocationTrackingEnabled()
+{
+	return false;
+}
+
+AllocationCounts GetAllocationCounts()
+{
+	return {};
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+
+/// Heap allocations through the global operator new, counted by its replacement in
+/// AllocationTracker.cpp. Only builds with TRACK_ALLOCATIONS defined (premake5 --track-allocations)
+/// replace it, the counts stay zero in any other build.
+struct AllocationCounts
+{
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+
+	AllocationCounts operator-(const AllocationCounts& other) const
+	{
+		return { allocations - other.allocations, bytes - other.bytes };
+	}
+};
+
+/// Whether the build counts allocations.
+bool IsAllocationTrackingEnabled();
+
+/// Allocations of all threads since the start of the process.
+AllocationCounts GetAllocationCounts();
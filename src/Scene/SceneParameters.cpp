@@ -0,0 +1,98 @@
+#include "SceneParameters.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+namespace
+{
+	bool ParseFloat(const YamlNode* node, const std::string& name, float& value, std::string& error)
+	{
+		const std::string& text = node ? node->GetScalar() : std::string();
+		char* end = nullptr;
+		errno = 0;
+		const float parsed = std::strtof(text.c_str(), &end);
+		if (!node || node->GetType() != YamlNode::Type::Scalar || text.empty() || *end != '\0' || errno == ERANGE)
+		{
+			error = name + " has to be a number";
+			return false;
+		}
+		value = parsed;
+		return true;
+	}
+}
+
+bool SetSceneParameter(SceneParameters& parameters, const std::string& name, const float value, std::string& error)
+{
+	const std::pair<const char*, float*> scalars[] = {
+		{ "object-scale", &parameters.objectScale },
+		{ "plane-height", &parameters.planeHeight },
+		{ "smooth-union-k", &parameters.smoothUnionK },
+		{ "fractal-scale", &parameters.fractalScale },
+		{ "fractal-offset", &parameters.fractalOffset },
+		{ "rotation-speed", &parameters.rotationSpeed },
+		{ "fractal-power", &parameters.fractalPower },
+	};
+	const auto scalar = std::find_if(std::begin(scalars), std::end(scalars), [&name](const auto& s) { return name == s.first; });
+	if (scalar == std::end(scalars))
+	{
+		error = "unknown scene parameter " + name;
+		return false;
+	}
+	*scalar->second = value;
+	return true;
+}
+
+bool ParseSceneParameters(const YamlNode& root, SceneParameters& parameters, std::string& error)
+{
+	if (root.IsNull())
+	{
+		return true;
+	}
+	if (root.GetType() != YamlNode::Type::Mapping)
+	{
+		error = "scene parameters have to be a mapping";
+		return false;
+	}
+
+	SceneParameters parsed = parameters;
+	for (const auto& entry : root.GetEntries())
+	{
+		if (entry.first == "object-position")
+		{
+			if (entry.second.GetItems().size() != 3)
+			{
+				error = "object-position has to be a sequence of 3 numbers";
+				return false;
+			}
+			for (int i = 0; i < 3; ++i)
+			{
+				if (!ParseFloat(&entry.second.GetItems()[i], "object-position", parsed.objectPosition(i), error))
+				{
+					return false;
+				}
+			}
+			continue;
+		}
+
+		float value = 0.f;
+		if (!ParseFloat(&entry.second, entry.first, value, error) || !SetSceneParameter(parsed, entry.first, value, error))
+		{
+			return false;
+		}
+	}
+
+	parameters = parsed;
+	return true;
+}
+
+bool LoadSceneParameters(const std::string& path, SceneParameters& parameters, std::string& error)
+{
+	YamlNode root;
+	if (!YamlNode::Load(path, root, error) || !ParseSceneParameters(root, parameters, error))
+	{
+		error = path + ", " + error;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "../Config/Yaml.hpp"
+
+#include <Eigen/Dense>
+
+#include <string>
+
+/// Constants of the scene distance estimators which can be changed while running without
+/// recompiling a shader. Uploaded as the sceneParameters uniform of the rayMarch node in the
+/// std140 layout of common/scene-parameters.glsl - keep the two in sync.
+struct SceneParameters
+{
+	/// Where the mandelbulb sits, w is unused.
+	Eigen::Vector4f objectPosition = Eigen::Vector4f(0.f, 0.f, -25.f, 0.f);
+	/// Size of the mandelbulb.
+	float objectScale = 7.f;
+	/// Height of the ground plane of the fractal scenes.
+	float planeHeight = 12.f;
+	/// Blend distance between a fractal and the ground plane.
+	float smoothUnionK = 2.5f;
+	/// Scale and offset of every fold of the recursive tetrahedron.
+	float fractalScale = 2.f;
+	float fractalOffset = 10.f;
+	/// Rotation of the recursive tetrahedron around z in radians per second, around y at half of it.
+	float rotationSpeed = .25f;
+	/// Exponent of the mandelbulb iteration.
+	float fractalPower = 8.f;
+	float padding = 0.f;
+};
+
+static_assert(sizeof(SceneParameters) == 48, "SceneParameters has to match the std140 layout of the shader block");
+
+/// Sets the scalar parameter of the given name, as it is spelled in src/SceneParameters.yaml.
+bool SetSceneParameter(SceneParameters& parameters, const std::string& name, float value, std::string& error);
+
+/// Reads the parameters from a mapping like src/SceneParameters.yaml. Parameters the mapping
+/// leaves out keep their value.
+bool ParseSceneParameters(const YamlNode& root, SceneParameters& parameters, std::string& error);
+/// Reads and parses the parameter file.
+bool LoadSceneParameters(const std::string& path, SceneParameters& parameters, std::string& error);
@@ -0,0 +1,128 @@
+#include "ShaderPrecompiler.hpp"
+#include "../Config/PipelineConfig.hpp"
+#include "../CpuRenderer/ThreadPool.hpp"
+#include "../Filesystem/Filesystem.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+namespace
+{
+	// Shader stage files have the stage before the extension, mandelbulb.comp.glsl.
+	bool IsShaderStage(const std::filesystem::path& path)
+	{
+		return path.extension() == ".glsl" && !path.stem().extension().empty();
+	}
+
+	void AddShader(std::vector<std::string>& shaders, const std::string& path)
+	{
+		const std::string normalized = NormalizePath(path);
+		if (std::find(shaders.begin(), shaders.end(), normalized) == shaders.end())
+		{
+			shaders.push_back(normalized);
+		}
+	}
+}
+
+bool PrecompileShaderVariants(const std::string& frontendConfigPath, const std::string& shaderDirectory, ShaderVariantCache& cache,
+	ThreadPool* threadPool, PrecompileReport& report, std::string& error)
+{
+	ConfigBlob frontendConfig;
+	std::vector<ShaderPreset> presets;
+	std::string defaultPreset;
+	if (!LoadFrontendConfig(frontendConfigPath, frontendConfig, error) ||
+		!LoadShaderPresets(frontendConfig.GetRoot(), presets, defaultPreset, error))
+	{
+		return false;
+	}
+	if (presets.empty())
+	{
+		presets.push_back({ "default", {} });
+	}
+
+	std::vector<std::string> shaders;
+	const ConfigNode nodes = frontendConfig.GetRoot().Find("nodes");
+	for (uint32_t i = 0; i < nodes.GetChildCount(); ++i)
+	{
+		const ConfigNode nodeShaders = nodes.GetChild(i).Find("shaders");
+		for (uint32_t j = 0; j < nodeShaders.GetChildCount(); ++j)
+		{
+			AddShader(shaders, ResolveShaderPath(std::string(nodeShaders.GetChild(j).GetScalar())));
+		}
+	}
+	std::error_code directoryError;
+	for (const auto& entry : std::filesystem::directory_iterator(shaderDirectory, directoryError))
+	{
+		if (entry.is_regular_file(directoryError) && IsShaderStage(entry.path()))
+		{
+			AddShader(shaders, entry.path().string());
+		}
+	}
+	if (directoryError)
+	{
+		error = "cannot read " + shaderDirectory + ": " + directoryError.message();
+		return false;
+	}
+
+	std::vector<ShaderVariantCache::Request> requests;
+	for (const ShaderPreset& preset : presets)
+	{
+		for (const std::string& shader : shaders)
+		{
+			requests.push_back({ shader, preset.constants });
+		}
+	}
+
+	std::vector<ShaderVariantCache::Variant> variants;
+	if (!cache.GetVariants(requests, threadPool, variants, error))
+	{
+		return false;
+	}
+
+	report = PrecompileReport();
+	report.variants = uint32_t(variants.size());
+	for (ShaderVariantCache::Variant& variant : variants)
+	{
+		report.cacheHits += variant.cacheHit && variant.compiled;
+		if (!variant.compiled)
+		{
+			report.failed.push_back(std::move(variant));
+		}
+	}
+	return true;
+}
+
+int RunShaderPrecompile(const std::string& cacheDirectory)
+{
+	ShaderVariantCache cache(cacheDirectory);
+	ThreadPool threadPool;
+	PrecompileReport report;
+	std::string error;
+
+	const auto before = std::chrono::steady_clock::now();
+	const bool prepared = PrecompileShaderVariants(RMFS.GetAbsolutePath("../../src/FrontendConfig.yaml"),
+		RMFS.GetAbsolutePath("../../src/Shaders"), cache, &threadPool, report, error);
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before).count();
+
+	if (!prepared)
+	{
+		std::printf("Shader precompilation failed: %s\n", error.c_str());
+		return 1;
+	}
+	if (!cache.HasCompiler())
+	{
+		std::printf("Shader precompilation failed: glslangValidator not found.\n");
+		return 1;
+	}
+
+	for (const ShaderVariantCache::Variant& variant : report.failed)
+	{
+		std::printf("%s does not compile:\n%s\n", variant.sourcePath.c_str(), variant.log.c_str());
+	}
+	std::printf("%u shader variants in %s: %u from the cache, %u compiled, %zu failed, %.1f ms on %u threads.\n", report.variants,
+		cache.GetDirectory().c_str(), report.cacheHits, report.variants - report.cacheHits - uint32_t(report.failed.size()),
+		report.failed.size(), ms, threadPool.GetThreadCount());
+	return report.failed.empty() ? 0 : 1;
+}
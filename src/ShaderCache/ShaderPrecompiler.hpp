@@ -0,0 +1,29 @@
+#pragma once
+#include "ShaderVariantCache.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Outcome of PrecompileShaderVariants().
+struct PrecompileReport
+{
+	uint32_t variants = 0;
+	/// Variants found compiled in the cache.
+	uint32_t cacheHits = 0;
+	/// Variants which did not compile, with the compiler log.
+	std::vector<ShaderVariantCache::Variant> failed;
+};
+
+/// Compiles the variants of every shader preset of the frontend config, for the node shaders and
+/// for every shader stage file in the shader directory (one per scene), so neither a preset nor
+/// a scene switch compiles anything at runtime.
+/// @param threadPool Compiles the variants in parallel if not null
+bool PrecompileShaderVariants(const std::string& frontendConfigPath, const std::string& shaderDirectory, ShaderVariantCache& cache,
+	ThreadPool* threadPool, PrecompileReport& report, std::string& error);
+
+/// Headless precompilation for deployment images: RayMarcher --precompile-shaders [directory]
+/// Fills the shader cache (the one the renderer uses by default) and prints a report to the
+/// standard output.
+/// @returns Process exit code - 0 if every variant compiled, 1 otherwise.
+int RunShaderPrecompile(const std::string& cacheDirectory);
@@ -0,0 +1,124 @@
+#include "ShaderPreprocessor.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	constexpr int MAX_INCLUDE_DEPTH = 32;
+
+	// Parses '#include "name"' or '#include <name>', returns false for other lines.
+	bool ParseInclude(const std::string& line, std::string& name)
+	{
+		size_t i = line.find_first_not_of(" \t");
+		if (i == std::string::npos || line[i] != '#')
+		{
+			return false;
+		}
+		i = line.find_first_not_of(" \t", i + 1);
+		if (i == std::string::npos || line.compare(i, 7, "include") != 0)
+		{
+			return false;
+		}
+		i = line.find_first_not_of(" \t", i + 7);
+		if (i == std::string::npos || (line[i] != '"' && line[i] != '<'))
+		{
+			return false;
+		}
+		const size_t end = line.find(line[i] == '"' ? '"' : '>', i + 1);
+		if (end == std::string::npos)
+		{
+			return false;
+		}
+		name = line.substr(i + 1, end - i - 1);
+		return true;
+	}
+}
+
+ShaderPreprocessor::ShaderPreprocessor(std::vector<std::string> includeDirectories)
+	: includeDirectories(std::move(includeDirectories)) {}
+
+bool ShaderPreprocessor::Expand(const std::string& path, Result& result, std::string& error) const
+{
+	result.source.clear();
+	result.files.clear();
+	return ExpandFile(std::filesystem::path(path).lexically_normal().string(), 0, result, error);
+}
+
+bool ShaderPreprocessor::ExpandFile(const std::string& path, const int includeDepth, Result& result, std::string& error) const
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+
+	const int sourceIndex = int(result.files.size());
+	result.files.push_back(path);
+	if (sourceIndex > 0)
+	{
+		result.source += "#line 1 " + std::to_string(sourceIndex) + '\n';
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		std::string name;
+		if (!ParseInclude(line, name))
+		{
+			result.source += line;
+			result.source += '\n';
+			continue;
+		}
+
+		std::string includePath;
+		if (!Resolve(path, name, includePath))
+		{
+			error = path + ':' + std::to_string(lineNumber) + ": cannot find include \"" + name + '"';
+			return false;
+		}
+		if (std::find(result.files.begin(), result.files.end(), includePath) != result.files.end())
+		{
+			// Already included, keep the line count.
+			result.source += '\n';
+			continue;
+		}
+		if (includeDepth + 1 > MAX_INCLUDE_DEPTH)
+		{
+			error = path + ':' + std::to_string(lineNumber) + ": includes nested too deep";
+			return false;
+		}
+
+		if (!ExpandFile(includePath, includeDepth + 1, result, error))
+		{
+			return false;
+		}
+		result.source += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(sourceIndex) + '\n';
+	}
+	return true;
+}
+
+bool ShaderPreprocessor::Resolve(const std::string& includingFile, const std::string& name, std::string& path) const
+{
+	std::vector<std::filesystem::path> candidates = { std::filesystem::path(includingFile).parent_path() / name };
+	for (const std::string& directory : includeDirectories)
+	{
+		candidates.push_back(std::filesystem::path(directory) / name);
+	}
+
+	for (const std::filesystem::path& candidate : candidates)
+	{
+		std::error_code error;
+		if (std::filesystem::is_regular_file(candidate, error))
+		{
+			path = candidate.lexically_normal().string();
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/// Expands #include "file" directives of GLSL sources, so that the scenes can share the
+/// kernels in src/Shaders/common while HawkEye and glslangValidator get a single source.
+/// Includes resolve against the directory of the including file first and the include
+/// directories after that. Every file is included at most once per expansion.
+class ShaderPreprocessor
+{
+public:
+	struct Result
+	{
+		/// Source with all includes expanded. #line directives keep compiler messages pointing
+		/// at the original lines, with the index into files as the source string number.
+		std::string source;
+		/// The shader followed by every file it includes, directly or not - all the files the
+		/// expanded source depends on.
+		std::vector<std::string> files;
+	};
+
+	explicit ShaderPreprocessor(std::vector<std::string> includeDirectories = {});
+
+	/// Expands the shader, on failure the error names the file and line of the problem.
+	bool Expand(const std::string& path, Result& result, std::string& error) const;
+
+private:
+	bool ExpandFile(const std::string& path, int includeDepth, Result& result, std::string& error) const;
+	bool Resolve(const std::string& includingFile, const std::string& name, std::string& path) const;
+
+	std::vector<std::string> includeDirectories;
+};
@@ -0,0 +1,519 @@
+#include "ShaderVariantCache.hpp"
+#include "ShaderPreprocessor.hpp"
+#include "../Config/PipelineConfig.hpp"
+#include "../Filesystem/Filesystem.hpp"
+#include "../Filesystem/Hash.hpp"
+#include "../CpuRenderer/ThreadPool.hpp"
+
+#include <SoftwareCore/DefaultLogger.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+namespace
+{
+	bool IsIdentifier(const std::string& name)
+	{
+		if (name.empty() || std::isdigit((unsigned char)name[0]))
+		{
+			return false;
+		}
+		for (const char c : name)
+		{
+			if (!std::isalnum((unsigned char)c) && c != '_')
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ReadText(const std::string& path, std::string& text)
+	{
+		std::ifstream file(path, std::ios_base::binary);
+		if (!file)
+		{
+			return false;
+		}
+		std::stringstream stream;
+		stream << file.rdbuf();
+		text = stream.str();
+		return true;
+	}
+
+	// Preset of the name among the loaded ones (the default one if the name is empty, one without
+	// constants if there are none), null if there is no such preset.
+	const ShaderPreset* FindPreset(std::vector<ShaderPreset>& presets, std::string& defaultPreset, const std::string& presetName,
+		std::string& error)
+	{
+		if (presets.empty())
+		{
+			// The includes still have to be expanded.
+			presets.push_back({ "default", {} });
+			defaultPreset = presets.front().name;
+		}
+
+		const std::string& name = presetName.empty() ? defaultPreset : presetName;
+		const auto preset = std::find_if(presets.begin(), presets.end(), [&name](const ShaderPreset& p) { return p.name == name; });
+		if (preset == presets.end())
+		{
+			std::string names;
+			for (const ShaderPreset& known : presets)
+			{
+				names += (names.empty() ? "" : ", ") + known.name;
+			}
+			error = "unknown shader preset " + name + " (presets: " + names + ")";
+			return nullptr;
+		}
+		return &*preset;
+	}
+
+	// Shader stage from the file name, mandelbulb.comp.glsl -> comp.
+	std::string ShaderStage(const std::string& path)
+	{
+		const std::string stageExtension = std::filesystem::path(path).stem().extension().string();
+		return stageExtension.empty() ? "" : stageExtension.substr(1);
+	}
+}
+
+bool LoadShaderPresets(const ConfigNode& frontendConfig, std::vector<ShaderPreset>& presets, std::string& defaultPreset,
+	std::string& error)
+{
+	presets.clear();
+	defaultPreset.clear();
+
+	const ConfigNode section = frontendConfig.Find("shader-presets");
+	if (!section)
+	{
+		return true;
+	}
+
+	const ConfigNode presetNodes = section.Find("presets");
+	if (presetNodes.GetType() != YamlNode::Type::Mapping)
+	{
+		error = "shader-presets needs a presets mapping";
+		return false;
+	}
+
+	for (uint32_t i = 0; i < presetNodes.GetChildCount(); ++i)
+	{
+		ShaderPreset preset;
+		preset.name = std::string(presetNodes.GetKey(i));
+		const ConfigNode constants = presetNodes.GetChild(i);
+		for (uint32_t j = 0; j < constants.GetChildCount(); ++j)
+		{
+			const std::string name(constants.GetKey(j));
+			const ConfigNode value = constants.GetChild(j);
+			if (!IsIdentifier(name) || value.GetType() != YamlNode::Type::Scalar ||
+				value.GetScalar().find('\n') != std::string_view::npos)
+			{
+				error = "invalid constant '" + name + "' in shader preset " + preset.name;
+				return false;
+			}
+			preset.constants[name] = std::string(value.GetScalar());
+		}
+		presets.push_back(std::move(preset));
+	}
+
+	const ConfigNode defaultNode = section.Find("default");
+	if (defaultNode)
+	{
+		defaultPreset = std::string(defaultNode.GetScalar());
+	}
+	else if (!presets.empty())
+	{
+		defaultPreset = presets.front().name;
+	}
+	return true;
+}
+
+ShaderVariantCache::ShaderVariantCache(std::string directory, std::string compiler)
+	: directory(std::move(directory)), compiler(std::move(compiler))
+{
+	std::error_code error;
+	std::filesystem::create_directories(this->directory, error);
+}
+
+std::string ShaderVariantCache::InjectConstants(const std::string& source, const ShaderConstants& constants)
+{
+	std::string defines;
+	for (const auto& constant : constants)
+	{
+		defines += "#define " + constant.first + ' ' + constant.second + '\n';
+	}
+
+	// The defines have to follow #version, #line keeps compiler messages pointing at the
+	// lines of the original source.
+	size_t versionEnd = 0;
+	int versionLine = 0;
+	const size_t version = source.find("#version");
+	if (version != std::string::npos)
+	{
+		versionEnd = source.find('\n', version);
+		versionEnd = versionEnd == std::string::npos ? source.size() : versionEnd + 1;
+		for (size_t i = 0; i < versionEnd; ++i)
+		{
+			versionLine += source[i] == '\n';
+		}
+	}
+
+	std::string result = source.substr(0, versionEnd);
+	if (versionEnd > 0 && result.back() != '\n')
+	{
+		result += '\n';
+	}
+	result += defines;
+	result += "#line " + std::to_string(versionLine + 1) + '\n';
+	result.append(source, versionEnd, std::string::npos);
+	return result;
+}
+
+uint64_t ShaderVariantCache::ComputeKey(const std::string& source, const ShaderConstants& constants)
+{
+	uint64_t key = HashString(source);
+	for (const auto& constant : constants)
+	{
+		key = HashString(constant.second, HashString(constant.first, key));
+	}
+	return key;
+}
+
+bool ShaderVariantCache::GetVariant(const std::string& shaderPath, const ShaderConstants& constants, Variant& variant)
+{
+	std::string source;
+	if (!LookupVariant(shaderPath, constants, variant, source))
+	{
+		return false;
+	}
+	AcceptWrittenSource(variant);
+	if (variant.cacheHit)
+	{
+		++hits;
+		return true;
+	}
+	++misses;
+	return CompileVariant(source, constants, variant);
+}
+
+bool ShaderVariantCache::GetVariants(const std::vector<Request>& requests, ThreadPool* threadPool, std::vector<Variant>& variants,
+	std::string& error)
+{
+	const auto forEach = [threadPool](const uint32_t count, const std::function<void(uint32_t)>& body)
+	{
+		if (threadPool)
+		{
+			threadPool->ParallelFor(count, body);
+			return;
+		}
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			body(i);
+		}
+	};
+
+	// Every lookup goes first, so the variants on disk are ready before any compilation starts.
+	variants.assign(requests.size(), Variant());
+	std::vector<std::string> sources(requests.size());
+	std::vector<char> found(requests.size());
+	forEach(uint32_t(requests.size()), [&](const uint32_t i)
+	{
+		found[i] = LookupVariant(requests[i].shaderPath, requests[i].constants, variants[i], sources[i]);
+	});
+	for (uint32_t i = 0; i < requests.size(); ++i)
+	{
+		if (found[i])
+		{
+			AcceptWrittenSource(variants[i]);
+		}
+	}
+
+	// Requests of the same variant are compiled once.
+	std::vector<uint32_t> misses;
+	std::map<std::string, uint32_t> firstRequests;
+	for (uint32_t i = 0; i < requests.size(); ++i)
+	{
+		if (!found[i])
+		{
+			error = variants[i].log;
+			return false;
+		}
+		if (!variants[i].cacheHit && firstRequests.emplace(variants[i].spirvPath, i).second)
+		{
+			misses.push_back(i);
+		}
+	}
+	this->misses += uint32_t(misses.size());
+	hits += uint32_t(requests.size() - misses.size());
+
+	std::vector<char> written(misses.size());
+	forEach(uint32_t(misses.size()), [&](const uint32_t i)
+	{
+		written[i] = CompileVariant(sources[misses[i]], requests[misses[i]].constants, variants[misses[i]]);
+	});
+	for (uint32_t i = 0; i < misses.size(); ++i)
+	{
+		if (!written[i])
+		{
+			error = variants[misses[i]].log;
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < requests.size(); ++i)
+	{
+		const uint32_t first = variants[i].cacheHit ? i : firstRequests[variants[i].spirvPath];
+		if (first != i)
+		{
+			variants[i].compiled = variants[first].compiled;
+			variants[i].log = variants[first].log;
+			variants[i].cacheHit = true;
+		}
+	}
+	return true;
+}
+
+bool ShaderVariantCache::LookupVariant(const std::string& shaderPath, const ShaderConstants& constants, Variant& variant,
+	std::string& source) const
+{
+	ShaderPreprocessor::Result expanded;
+	if (!ShaderPreprocessor().Expand(shaderPath, expanded, variant.log))
+	{
+		return false;
+	}
+	source = std::move(expanded.source);
+	variant.dependencies = std::move(expanded.files);
+
+	// name-0123456789abcdef.comp.glsl next to name-0123456789abcdef.spv
+	const std::filesystem::path file(shaderPath);
+	const std::string stage = ShaderStage(shaderPath);
+	const std::string name = file.stem().stem().string();
+	variant.key = ComputeKey(source, constants);
+	const std::string base = (std::filesystem::path(directory) / (name + '-' + HashToString(variant.key))).string();
+	variant.sourcePath = base + (stage.empty() ? "" : '.' + stage) + file.extension().string();
+	variant.spirvPath = base + ".spv";
+	variant.log.clear();
+
+	std::error_code error;
+	variant.cacheHit = std::filesystem::exists(variant.spirvPath, error) && std::filesystem::exists(variant.sourcePath, error);
+	variant.compiled = variant.cacheHit;
+	return true;
+}
+
+void ShaderVariantCache::AcceptWrittenSource(Variant& variant)
+{
+	// The pipeline compiles the source itself, the variant stays uncompiled.
+	if (!variant.cacheHit && !HasCompiler())
+	{
+		std::error_code error;
+		variant.cacheHit = std::filesystem::exists(variant.sourcePath, error);
+	}
+}
+
+bool ShaderVariantCache::CompileVariant(const std::string& source, const ShaderConstants& constants, Variant& variant)
+{
+	if (!WriteFileAtomically(variant.sourcePath, InjectConstants(source, constants)))
+	{
+		variant.log = "cannot write " + variant.sourcePath;
+		return false;
+	}
+	if (!HasCompiler())
+	{
+		return true;
+	}
+
+	const std::string stage = ShaderStage(variant.sourcePath);
+	const std::string temporarySuffix = GetTemporarySuffix();
+	const std::string temporarySpirv = variant.spirvPath + ".tmp" + temporarySuffix;
+	const std::string logPath = variant.spirvPath + ".log" + temporarySuffix;
+	std::string command = '"' + compiler + "\" -V" + (stage.empty() ? "" : " -S " + stage) + " -o \"" + temporarySpirv + "\" \"" +
+		variant.sourcePath + "\" > \"" + logPath + "\" 2>&1";
+#ifdef _WIN32
+	// cmd strips the outer quotes of a command starting with a quote.
+	command = '"' + command + '"';
+#endif
+	const int status = std::system(command.c_str());
+	std::error_code error;
+	ReadText(logPath, variant.log);
+	std::filesystem::remove(logPath, error);
+
+	if (status != 0)
+	{
+		std::filesystem::remove(temporarySpirv, error);
+		return true;
+	}
+	std::filesystem::rename(temporarySpirv, variant.spirvPath, error);
+	variant.compiled = !error;
+	return true;
+}
+
+bool ShaderVariantCache::WriteVariantConfig(const ConfigNode& frontendConfig, const ShaderPreset& preset, const std::string& outputPath,
+	std::string (*resolvePath)(const std::string&), std::string& error, std::vector<NodeVariants>* nodeVariants, ThreadPool* threadPool)
+{
+	YamlNode config;
+	if (!frontendConfig.ToYaml(config, error))
+	{
+		return false;
+	}
+	config.Remove("shader-presets");
+
+	YamlNode* nodes = config.Find("nodes");
+	if (!nodes || nodes->GetType() != YamlNode::Type::Sequence)
+	{
+		error = "the frontend config has no nodes";
+		return false;
+	}
+
+	// The shaders of all nodes are prepared together, to compile them in parallel.
+	std::vector<Request> requests;
+	for (const YamlNode& node : nodes->GetItems())
+	{
+		if (const YamlNode* shaders = node.Find("shaders"))
+		{
+			for (const auto& shader : shaders->GetEntries())
+			{
+				requests.push_back({ resolvePath(shader.second.GetScalar()), preset.constants });
+			}
+		}
+	}
+	std::vector<Variant> variants;
+	if (!GetVariants(requests, threadPool, variants, error))
+	{
+		return false;
+	}
+
+	if (nodeVariants)
+	{
+		nodeVariants->clear();
+	}
+	auto variant = variants.begin();
+	for (YamlNode& node : nodes->GetItems())
+	{
+		YamlNode* shaders = node.Find("shaders");
+		if (!shaders)
+		{
+			continue;
+		}
+		const YamlNode* name = node.Find("name");
+		NodeVariants nodeVariant;
+		nodeVariant.node = name ? name->GetScalar() : "";
+		for (auto& shader : shaders->GetEntries())
+		{
+			if (!variant->compiled)
+			{
+				// A missing compiler was warned about once already.
+				if (HasCompiler())
+				{
+					CoreLogWarn(DefaultLogger, "Shader variant %s was not compiled to SPIR-V:\n%s", variant->sourcePath.c_str(), variant->log.c_str());
+				}
+				nodeVariant.log = nodeVariant.compiled ? variant->log : nodeVariant.log;
+				nodeVariant.compiled = false;
+			}
+			shader.second = YamlNode(std::filesystem::absolute(variant->sourcePath).string());
+			nodeVariant.sourcePaths.push_back(shader.second.GetScalar());
+			nodeVariant.dependencies.insert(nodeVariant.dependencies.end(), variant->dependencies.begin(), variant->dependencies.end());
+			++variant;
+		}
+		if (nodeVariants)
+		{
+			nodeVariants->push_back(std::move(nodeVariant));
+		}
+	}
+
+	if (!WriteFileAtomically(outputPath, "# Generated from FrontendConfig.yaml for shader preset " + preset.name + ".\n" + config.Emit()))
+	{
+		error = "cannot write " + outputPath;
+		return false;
+	}
+	return true;
+}
+
+bool ShaderVariantCache::HasCompiler()
+{
+	std::call_once(compilerChecked, [this]()
+	{
+#ifdef _WIN32
+		const std::string command = "\"\"" + compiler + "\" --version > NUL 2>&1\"";
+#else
+		const std::string command = '"' + compiler + "\" --version > /dev/null 2>&1";
+#endif
+		compilerFound = std::system(command.c_str()) == 0;
+		if (!compilerFound)
+		{
+			CoreLogWarn(DefaultLogger, "Shader compiler %s not found, shader variants are left to the pipeline to compile.", compiler.c_str());
+		}
+	});
+	return compilerFound;
+}
+
+const std::string& ShaderVariantCache::GetDirectory() const
+{
+	return directory;
+}
+
+uint32_t ShaderVariantCache::GetHitCount() const
+{
+	return hits.load();
+}
+
+uint32_t ShaderVariantCache::GetMissCount() const
+{
+	return misses.load();
+}
+
+std::string ResolveShaderPath(const std::string& path)
+{
+	return std::filesystem::path(path).is_absolute() ? path : RMFS.GetAbsolutePath(path);
+}
+
+bool PrepareShaderVariants(const std::string& frontendConfigPath, const std::string& presetName, ShaderVariantCache& cache,
+	const std::string& outputPath, PreparedShaderVariants& prepared, std::string& error, ThreadPool* threadPool)
+{
+	ConfigBlob frontendConfig;
+	std::vector<ShaderPreset> presets;
+	std::string defaultPreset;
+	if (!LoadFrontendConfig(frontendConfigPath, frontendConfig, error) ||
+		!LoadShaderPresets(frontendConfig.GetRoot(), presets, defaultPreset, error))
+	{
+		error = "shader presets not loaded: " + error;
+		return false;
+	}
+	const ShaderPreset* preset = FindPreset(presets, defaultPreset, presetName, error);
+	if (!preset)
+	{
+		return false;
+	}
+
+	prepared.preset = *preset;
+	prepared.configPath = !outputPath.empty() ? outputPath :
+		(std::filesystem::path(cache.GetDirectory()) / ("FrontendConfig-" + preset->name + ".yaml")).string();
+	if (!cache.WriteVariantConfig(frontendConfig.GetRoot(), *preset, prepared.configPath, &ResolveShaderPath, error, &prepared.nodes, threadPool))
+	{
+		error = "shader variants of preset " + preset->name + " not prepared: " + error;
+		return false;
+	}
+	return true;
+}
+
+bool FindShaderPreset(const std::string& frontendConfigPath, const std::string& presetName, ShaderPreset& preset, std::string& error)
+{
+	ConfigBlob frontendConfig;
+	std::vector<ShaderPreset> presets;
+	std::string defaultPreset;
+	if (!LoadFrontendConfig(frontendConfigPath, frontendConfig, error) ||
+		!LoadShaderPresets(frontendConfig.GetRoot(), presets, defaultPreset, error))
+	{
+		error = "shader presets not loaded: " + error;
+		return false;
+	}
+	const ShaderPreset* found = FindPreset(presets, defaultPreset, presetName, error);
+	if (!found)
+	{
+		return false;
+	}
+	preset = *found;
+	return true;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include "../Config/ConfigBlob.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+/// Values of the shader constants (FRACTAL_ITERATIONS, MAX_ITERATIONS, EPSILON, ...) by name.
+using ShaderConstants = std::map<std::string, std::string>;
+
+/// Named set of shader constants from the shader-presets section of FrontendConfig.yaml.
+struct ShaderPreset
+{
+	std::string name;
+	ShaderConstants constants;
+};
+
+/// Reads the shader-presets section of the frontend config. The default preset is the one
+/// named by its default key, or the first one.
+bool LoadShaderPresets(const ConfigNode& frontendConfig, std::vector<ShaderPreset>& presets, std::string& defaultPreset,
+	std::string& error);
+
+/// On-disk cache of shader variants - shader sources with their includes expanded and a set of
+/// constants injected as defines, compiled to SPIR-V with glslangValidator. Variants are keyed
+/// by a hash of the expanded source and the constants, so editing any included file
+/// invalidates them and switching between presets only compiles each variant once.
+class ShaderVariantCache
+{
+public:
+	struct Variant
+	{
+		/// Source with the constants injected.
+		std::string sourcePath;
+		/// Compiled SPIR-V module, valid if compiled is set.
+		std::string spirvPath;
+		uint64_t key = 0;
+		bool cacheHit = false;
+		bool compiled = false;
+		/// Compiler output when compilation failed.
+		std::string log;
+		/// The shader and every file it includes.
+		std::vector<std::string> dependencies;
+	};
+
+	/// Shader and constants of a variant.
+	struct Request
+	{
+		std::string shaderPath;
+		ShaderConstants constants;
+	};
+
+	/// Variants of the shaders of one node of a variant config.
+	struct NodeVariants
+	{
+		std::string node;
+		/// Variant source of each shader of the node.
+		std::vector<std::string> sourcePaths;
+		/// The shaders of the node and every file they include.
+		std::vector<std::string> dependencies;
+		/// Whether all the variants are compiled, the first compiler log otherwise.
+		bool compiled = true;
+		std::string log;
+	};
+
+	/// @param directory Cache directory, created when missing
+	/// @param compiler glslangValidator executable, looked up in PATH by default
+	explicit ShaderVariantCache(std::string directory, std::string compiler = "glslangValidator");
+
+	/// Source text with the constants defined right after its #version line.
+	static std::string InjectConstants(const std::string& source, const ShaderConstants& constants);
+	/// Cache key of the variant.
+	static uint64_t ComputeKey(const std::string& source, const ShaderConstants& constants);
+
+	/// Expands the includes of the shader and looks the variant up in the cache, writing and
+	/// compiling it on a miss.
+	/// A variant which does not compile keeps its source and is compiled again on the next
+	/// lookup. Without a compiler the source is the variant, one already written is a hit.
+	/// Safe to call from several threads.
+	/// @returns False if the shader or its includes can not be read or the variant can not be
+	/// written.
+	bool GetVariant(const std::string& shaderPath, const ShaderConstants& constants, Variant& variant);
+
+	/// GetVariant() of every request, in parallel on the thread pool if one is given. All the
+	/// requests are looked up in the cache before compiling the misses, requests of the same
+	/// variant are compiled once.
+	/// @returns False if a shader or its includes can not be read or a variant can not be
+	/// written, with the reason in the error.
+	bool GetVariants(const std::vector<Request>& requests, ThreadPool* threadPool, std::vector<Variant>& variants, std::string& error);
+
+	/// Writes a copy of the frontend config without the shader-presets section whose node
+	/// shaders are the variants of the preset.
+	/// @param resolvePath Turns a shader path of the config into a readable path
+	/// @param nodes Receives the variants of every node with shaders if not null
+	/// @param threadPool Compiles the variants of all nodes in parallel if not null
+	bool WriteVariantConfig(const ConfigNode& frontendConfig, const ShaderPreset& preset, const std::string& outputPath,
+		std::string (*resolvePath)(const std::string&), std::string& error, std::vector<NodeVariants>* nodes = nullptr,
+		ThreadPool* threadPool = nullptr);
+
+	/// Whether the compiler can be run at all. Checked once, on the first call, which warns if
+	/// it cannot.
+	bool HasCompiler();
+
+	const std::string& GetDirectory() const;
+	uint32_t GetHitCount() const;
+	uint32_t GetMissCount() const;
+
+private:
+	// Expands the shader and fills in the paths and the key of the variant, cacheHit tells
+	// whether it is compiled already.
+	bool LookupVariant(const std::string& shaderPath, const ShaderConstants& constants, Variant& variant, std::string& source) const;
+	// Without a compiler, turns a miss whose source is written already into a hit.
+	void AcceptWrittenSource(Variant& variant);
+	// Writes the variant source and compiles it if there is a compiler.
+	bool CompileVariant(const std::string& source, const ShaderConstants& constants, Variant& variant);
+
+	std::string directory;
+	std::string compiler;
+	std::atomic<uint32_t> hits{ 0 };
+	std::atomic<uint32_t> misses{ 0 };
+	std::once_flag compilerChecked;
+	bool compilerFound = false;
+};
+
+/// Shader paths of the configs are relative to the executable unless they are absolute.
+std::string ResolveShaderPath(const std::string& path);
+
+/// Frontend config prepared for a shader preset.
+struct PreparedShaderVariants
+{
+	/// Generated config to configure the pipeline with.
+	std::string configPath;
+	ShaderPreset preset;
+	std::vector<ShaderVariantCache::NodeVariants> nodes;
+};
+
+/// Loads the frontend config, prepares the shader variants of the preset (the config default if
+/// the name is empty, no constants if the config has no presets) and writes the variant config.
+/// @param outputPath Path of the variant config, FrontendConfig-<preset>.yaml in the cache
+/// directory if empty
+/// @param threadPool Compiles the variants in parallel if not null
+bool PrepareShaderVariants(const std::string& frontendConfigPath, const std::string& presetName, ShaderVariantCache& cache,
+	const std::string& outputPath, PreparedShaderVariants& prepared, std::string& error, ThreadPool* threadPool = nullptr);
+
+/// Loads the shader presets of the frontend config and finds the one PrepareShaderVariants() would
+/// prepare for the name. The error of an unknown name lists the presets of the config.
+bool FindShaderPreset(const std::string& frontendConfigPath, const std::string& presetName, ShaderPreset& preset, std::string& error);
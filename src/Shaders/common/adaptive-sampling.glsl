@@ -0,0 +1,111 @@
+// Adaptive supersampling of the fractal scenes, ADAPTIVE_MAX_SAMPLES above 1 turns it on (shader
+// presets set it, see FrontendConfig.yaml). Every pixel marches its first ray, then the work
+// group - a 16x16 tile - scores itself by the spread of its step counts, which the fractals are
+// shaded by, plus the fraction of its pixels next to a depth or hit discontinuity. Each of its
+// pixels takes 1 + ADAPTIVE_SAMPLE_SCALE * score samples, at most ADAPTIVE_MAX_SAMPLES, so tiles
+// of sky or plane keep a single sample and the rays go to the fractal edges.
+// The CPU renderer picks the scale of every frame which fits its sample budget
+// (CpuRenderer::PlanSamples); the shader takes a constant one. The default is about what the
+// adaptive-sampling benchmark solves for a budget of 2 samples per pixel, 12 gives about 4.
+// Include after common/march.glsl. Keep in sync with CpuRenderer::PlanSamples and
+// CpuRenderer::Composite.
+
+#ifndef ADAPTIVE_MAX_SAMPLES
+#define ADAPTIVE_MAX_SAMPLES 1
+#endif
+#ifndef ADAPTIVE_SAMPLE_SCALE
+#define ADAPTIVE_SAMPLE_SCALE 5.f
+#endif
+
+// Depth difference of neighbouring pixels, as a fraction of the nearer depth, above which they
+// lie on either side of an edge.
+const float ADAPTIVE_DEPTH_TOLERANCE = .05f;
+
+#if ADAPTIVE_MAX_SAMPLES > 1
+// Depth of every pixel of the work group, -1 without a hit and -2 outside of the image.
+shared float adaptiveDepths[16 * 16];
+shared uint adaptivePixels;
+shared uint adaptiveStepSum;
+shared uint adaptiveStepSquares;
+shared uint adaptiveEdges;
+#endif
+
+// Offset of a sample from the center of its pixel in pixels, zero for the first one - the R2
+// low-discrepancy sequence.
+vec2 sampleOffset(int index)
+{
+	return fract(.5f + float(index) * vec2(.754877666f, .569840291f)) - .5f;
+}
+
+// Whether pixels of the given depths (negative without a hit) lie on either side of an edge.
+bool edge(float depth, float neighbour)
+{
+	if (neighbour < -1.5f)
+	{
+		return false;
+	}
+	if ((depth < 0.f) != (neighbour < 0.f))
+	{
+		return true;
+	}
+	return depth >= 0.f && abs(depth - neighbour) > ADAPTIVE_DEPTH_TOLERANCE * min(depth, neighbour);
+}
+
+// Samples every pixel of the work group takes. Every invocation of the work group has to call
+// it, pixels outside of the image with inImage set to false.
+int tileSamples(bool inImage, bool hit, float depth, int steps)
+{
+#if ADAPTIVE_MAX_SAMPLES <= 1
+	return 1;
+#else
+	uint local = gl_LocalInvocationIndex;
+	if (local == 0)
+	{
+		adaptivePixels = 0;
+		adaptiveStepSum = 0;
+		adaptiveStepSquares = 0;
+		adaptiveEdges = 0;
+	}
+	float ownDepth = inImage ? (hit ? depth : -1.f) : -2.f;
+	adaptiveDepths[local] = ownDepth;
+	barrier();
+
+	if (inImage)
+	{
+		atomicAdd(adaptivePixels, 1u);
+		atomicAdd(adaptiveStepSum, uint(steps));
+		atomicAdd(adaptiveStepSquares, uint(steps * steps));
+
+		// Neighbours within the work group only, right and below.
+		ivec2 position = ivec2(gl_LocalInvocationID.xy);
+		bool isEdge = (position.x < 15 && edge(ownDepth, adaptiveDepths[local + 1])) ||
+			(position.y < 15 && edge(ownDepth, adaptiveDepths[local + 16]));
+		if (isEdge)
+		{
+			atomicAdd(adaptiveEdges, 1u);
+		}
+	}
+	barrier();
+
+	float pixels = float(max(adaptivePixels, 1u));
+	float mean = float(adaptiveStepSum) / pixels;
+	float spread = sqrt(max(float(adaptiveStepSquares) / pixels - mean * mean, 0.f)) / float(MAX_ITERATIONS);
+	float score = spread + float(adaptiveEdges) / pixels;
+	return 1 + int(min(ADAPTIVE_SAMPLE_SCALE * score, float(ADAPTIVE_MAX_SAMPLES - 1)));
+#endif
+}
+
+// Step shading of the pixel averaged over its samples, the one of the first sample given.
+float supersampledShade(float firstShade, int samples)
+{
+	vec2 size = vec2(imageSize(resultImage) - 1);
+	float shade = firstShade;
+	for (int i = 1; i < samples; i++)
+	{
+		vec2 pos = (vec2(pixelCoords) + sampleOffset(i)) / size;
+		vec3 ray = normalize(camera.ray0.xyz + pos.x * camera.horizontal.xyz + pos.y * camera.vertical.xyz);
+		vec3 origin = camera.position.xyz + pos.x * camera.originHorizontal.xyz + pos.y * camera.originVertical.xyz;
+		shade += 1.f - float(march(origin, ray).steps) / float(MAX_ITERATIONS);
+	}
+	return shade / float(samples);
+}
@@ -0,0 +1,96 @@
+// Ambient occlusion of the fractal scenes from distance estimates along the surface normal.
+// Include after common/march.glsl. AO_RESOLUTION picks the mode (shader presets override it,
+// see FrontendConfig.yaml):
+//   0   no occlusion,
+//   1   sampled for every pixel,
+//   2   sampled for one pixel per 2x2 pixels of the work group, upsampled with weights leaving
+//       out samples of other surfaces (depth and normal) - pixels without one sample their own.
+// Keep in sync with AmbientOcclusionPass, which accumulates the occlusion over frames as well.
+
+#ifndef AO_RESOLUTION
+#define AO_RESOLUTION 0
+#endif
+
+const int AO_SAMPLES = 5;
+// Distance along the normal of the last sample.
+const float AO_DISTANCE = 1.5f;
+const float AO_STRENGTH = 1.5f;
+// Samples further from the depth of a pixel than this fraction of it are not upsampled into it.
+const float AO_DEPTH_TOLERANCE = .05f;
+// Exponent of the cosine between the normals of a sample and a pixel in the upsampling weight.
+const float AO_NORMAL_POWER = 8.f;
+
+// Occlusion factor in [0, 1] of the surface point, 1 where nothing occludes.
+float ambientOcclusion(vec3 position, vec3 normal)
+{
+	// Average of how much closer the surface is than the distance along the normal, nearer
+	// samples weighing more.
+	float occluded = 0.f;
+	float weights = 0.f;
+	float weight = 1.f;
+	for (int i = 1; i <= AO_SAMPLES; i++)
+	{
+		float h = AO_DISTANCE * float(i) / float(AO_SAMPLES);
+		occluded += weight * max(h - SCENE_DISTANCE(position + h * normal), 0.f) / h;
+		weights += weight;
+		weight *= .75f;
+	}
+	return clamp(1.f - AO_STRENGTH * occluded / weights, 0.f, 1.f);
+}
+
+#if AO_RESOLUTION > 1
+// Blocks per row of the 16x16 work group of common/camera.glsl.
+const int AO_BLOCKS = 16 / AO_RESOLUTION;
+// Normal and depth (negative without a hit), and occlusion of the first pixel of every block.
+shared vec4 occlusionSurfaces[AO_BLOCKS * AO_BLOCKS];
+shared float occlusionSamples[AO_BLOCKS * AO_BLOCKS];
+#endif
+
+// Occlusion factor of the pixel whose ray hit the surface at the depth. Every invocation of the
+// work group has to call it, pixels outside of the image with hit set to false.
+float sceneOcclusion(bool hit, vec3 hitPosition, float depth)
+{
+#if AO_RESOLUTION == 0
+	return 1.f;
+#else
+	vec3 normal = hit ? sceneNormal(hitPosition) : vec3(0.f);
+#if AO_RESOLUTION == 1
+	return hit ? ambientOcclusion(hitPosition, normal) : 1.f;
+#else
+	ivec2 local = ivec2(gl_LocalInvocationID.xy);
+	if (local.x % AO_RESOLUTION == 0 && local.y % AO_RESOLUTION == 0)
+	{
+		ivec2 block = local / AO_RESOLUTION;
+		occlusionSurfaces[block.y * AO_BLOCKS + block.x] = vec4(normal, hit ? depth : -1.f);
+		occlusionSamples[block.y * AO_BLOCKS + block.x] = hit ? ambientOcclusion(hitPosition, normal) : 1.f;
+	}
+	barrier();
+
+	if (!hit)
+	{
+		return 1.f;
+	}
+
+	// Bilinear upsampling, leaving out the samples of other surfaces.
+	vec2 position = vec2(local) / float(AO_RESOLUTION);
+	ivec2 block0 = ivec2(position);
+	ivec2 block1 = min(block0 + 1, ivec2(AO_BLOCKS - 1));
+	vec2 w = position - vec2(block0);
+	float value = 0.f;
+	float weight = 0.f;
+	for (int corner = 0; corner < 4; corner++)
+	{
+		bool right = (corner & 1) != 0;
+		bool bottom = (corner & 2) != 0;
+		int index = (bottom ? block1.y : block0.y) * AO_BLOCKS + (right ? block1.x : block0.x);
+		vec4 surface = occlusionSurfaces[index];
+		float bilinear = (right ? w.x : 1.f - w.x) * (bottom ? w.y : 1.f - w.y);
+		float depthWeight = surface.w < 0.f ? 0.f : max(1.f - abs(surface.w - depth) / (AO_DEPTH_TOLERANCE * depth), 0.f);
+		float normalWeight = pow(max(dot(surface.xyz, normal), 0.f), AO_NORMAL_POWER);
+		value += bilinear * depthWeight * normalWeight * occlusionSamples[index];
+		weight += bilinear * depthWeight * normalWeight;
+	}
+	return weight > 1e-3f ? value / weight : ambientOcclusion(hitPosition, normal);
+#endif
+#endif
+}
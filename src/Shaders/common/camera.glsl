@@ -0,0 +1,46 @@
+// Output image and camera of the ray marching compute shaders.
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0, rgba8) uniform writeonly image2D resultImage;
+
+// Get camera parameters.
+layout(set = 1, binding = 0) uniform Camera
+{
+	vec4 position;
+	vec4 ray0;
+	vec4 horizontal;
+	vec4 vertical;
+	vec4 originHorizontal;
+	vec4 originVertical;
+} camera;
+
+// Retrieve pixel coordinates.
+ivec2 pixelCoords = ivec2(gl_GlobalInvocationID.xy);
+
+// Determine the ray to be cast from the pixel to the scene.
+vec3 pixelRay()
+{
+	ivec2 size = imageSize(resultImage);
+	
+	if (pixelCoords.x >= size.x || pixelCoords.y >= size.y)
+		return vec3(0);
+
+	vec2 pos = vec2(pixelCoords) / vec2(size.x - 1, size.y - 1);
+
+	return normalize(camera.ray0.xyz + pos.x * camera.horizontal.xyz + pos.y * camera.vertical.xyz);
+}
+
+// Determine the origin of the ray cast from the pixel (differs per pixel for orthographic cameras).
+vec3 pixelOrigin()
+{
+	vec2 pos = vec2(pixelCoords) / vec2(imageSize(resultImage) - 1);
+
+	return camera.position.xyz + pos.x * camera.originHorizontal.xyz + pos.y * camera.originVertical.xyz;
+}
+
+// Output the RGB to the appropriate pixel spot.
+void outputColor(vec3 color)
+{
+	imageStore(resultImage, pixelCoords, vec4(color, 1));
+}
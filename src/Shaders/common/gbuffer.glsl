@@ -0,0 +1,34 @@
+// G-buffer output of the fractal scenes, for pipelines which shade, shadow and occlude the
+// surface in nodes of their own - possibly at other rates and resolutions - instead of in the
+// march kernel. Defining GBUFFER_OUTPUT makes the kernel write what every ray hit to the images
+// below, next to resultImage of common/camera.glsl, and leave shadows and occlusion out of the
+// color it writes there. The node has to provide the images at these bindings. Include after
+// common/march.glsl, the scene may define
+//   SCENE_COLOR(p)    orbit trap color of the surface at p as a vec4, zero without it.
+// Keep in sync with GBuffer and CpuRenderer::RenderGBuffer.
+
+#ifdef GBUFFER_OUTPUT
+
+#ifndef SCENE_COLOR
+#define SCENE_COLOR(p) vec4(0.f)
+#endif
+
+// Ray distance at which the march stopped.
+layout(binding = 1, r32f) uniform writeonly image2D depthImage;
+// Surface normal, w is 1 where the ray hit the surface and 0 where it missed (normal zero).
+layout(binding = 2, rgba16f) uniform writeonly image2D normalImage;
+// Orbit trap color of the surface.
+layout(binding = 3, rgba16f) uniform writeonly image2D colorImage;
+// March iterations.
+layout(binding = 4, r32i) uniform writeonly iimage2D stepsImage;
+
+// Writes the G-buffer of the pixel whose ray was marched from the origin.
+void outputGBuffer(March result, vec3 hitPosition)
+{
+	imageStore(depthImage, pixelCoords, vec4(result.t));
+	imageStore(normalImage, pixelCoords, result.hit ? vec4(sceneNormal(hitPosition), 1.f) : vec4(0.f));
+	imageStore(colorImage, pixelCoords, result.hit ? SCENE_COLOR(hitPosition) : vec4(0.f));
+	imageStore(stepsImage, pixelCoords, ivec4(result.steps));
+}
+
+#endif
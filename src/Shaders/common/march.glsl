@@ -0,0 +1,90 @@
+// Ray march kernels shared by the scenes. Include after the scene defines
+//   SCENE_DISTANCE(p)         distance estimate at p as a float,
+//   EPSILON, MAX_ITERATIONS and MAX_DISTANCE,
+// and optionally
+//   MARCH_HIT_THRESHOLD(t)    distance below which the surface counts as hit at ray distance t,
+//   MARCH_TEST_BEFORE_STEP    test for the hit before advancing the ray instead of after.
+//   SCENE_NORMAL(p, normal)   analytic surface normal at p, false where the scene has none.
+// Keep in sync with CpuRenderer::March.
+
+#ifndef MARCH_HIT_THRESHOLD
+#define MARCH_HIT_THRESHOLD(t) (EPSILON * (t))
+#endif
+
+struct March
+{
+	float t;
+	int steps;
+	bool hit;
+};
+
+// Sphere trace the ray from the origin.
+March march(vec3 origin, vec3 ray)
+{
+	March result = March(0.f, MAX_ITERATIONS, false);
+
+	for (int i = 0; i < MAX_ITERATIONS; i++)
+	{
+		// Estimate scene distance.
+		float sdf = SCENE_DISTANCE(origin + result.t * ray);
+
+#ifndef MARCH_TEST_BEFORE_STEP
+		result.t += sdf;
+#endif
+
+		// Test for surface proximity.
+		if (sdf < MARCH_HIT_THRESHOLD(result.t))
+		{
+			result.hit = true;
+			result.steps = i;
+			break;
+		}
+
+#ifdef MARCH_TEST_BEFORE_STEP
+		result.t += sdf;
+#endif
+
+		// Test for escaped ray.
+		if (result.t > MAX_DISTANCE)
+		{
+			break;
+		}
+	}
+
+	return result;
+}
+
+// Estimate surface normal from four tetrahedral samples.
+vec3 surfaceNormal(vec3 surfacePoint)
+{
+    vec2 e = vec2(1.0, -1.0) * 0.5773;
+    return normalize(e.xyy * SCENE_DISTANCE(surfacePoint + e.xyy * EPSILON) + e.yyx * SCENE_DISTANCE(surfacePoint + e.yyx * EPSILON) +
+                     e.yxy * SCENE_DISTANCE(surfacePoint + e.yxy * EPSILON) + e.xxx * SCENE_DISTANCE(surfacePoint + e.xxx * EPSILON));
+}
+
+// Surface normal at the point, analytic where the scene provides SCENE_NORMAL and from four
+// tetrahedral samples elsewhere.
+vec3 sceneNormal(vec3 surfacePoint)
+{
+#ifdef SCENE_NORMAL
+	vec3 normal;
+	if (SCENE_NORMAL(surfacePoint, normal))
+	{
+		return normal;
+	}
+#endif
+	return surfaceNormal(surfacePoint);
+}
+
+// Estimate surface normal from six central differences.
+vec3 centralDifferenceNormal(vec3 surfacePoint)
+{
+	vec3 xDir = vec3(EPSILON, 0, 0);
+	vec3 yDir = vec3(0, EPSILON, 0);
+	vec3 zDir = vec3(0, 0, EPSILON);
+
+	return normalize(
+		vec3(SCENE_DISTANCE(surfacePoint + xDir) - SCENE_DISTANCE(surfacePoint - xDir),
+			SCENE_DISTANCE(surfacePoint + yDir) - SCENE_DISTANCE(surfacePoint - yDir),
+			SCENE_DISTANCE(surfacePoint + zDir) - SCENE_DISTANCE(surfacePoint - zDir)));
+}
@@ -0,0 +1,14 @@
+// Scene constants which are changed while running without recompiling the shader, edited in
+// src/SceneParameters.yaml. Keep in sync with SceneParameters in src/Scene/SceneParameters.hpp.
+
+layout(set = 1, binding = 2) uniform SceneParameters
+{
+	vec4 objectPosition;
+	float objectScale;
+	float planeHeight;
+	float smoothUnionK;
+	float fractalScale;
+	float fractalOffset;
+	float rotationSpeed;
+	float fractalPower;
+} parameters;
@@ -0,0 +1,59 @@
+// Distance function building blocks.
+
+const float PI = 3.14159265f;
+
+// Distance estimate together with the orbit trap color of the surface.
+struct Hit
+{
+	float dist;
+	vec4 color;
+};
+
+vec3 rotateX(vec3 p, float rad)
+{
+    return vec3(p.x, p.y * cos(rad) - p.z * sin(rad), p.y * sin(rad) + p.z * cos(rad));
+}
+
+vec3 rotateY(vec3 p, float rad)
+{
+    return vec3(p.x * cos(rad) + p.z * sin(rad), p.y, -p.x * sin(rad) + p.z * cos(rad));
+}
+
+vec3 rotateZ(vec3 p, float rad)
+{
+    return vec3(p.x * cos(rad) - p.y * sin(rad), p.x * sin(rad) + p.y * cos(rad), p.z);
+}
+
+vec3 move(vec3 position, vec3 dir)
+{
+	return position - dir;
+}
+
+vec3 scale(vec3 position, float s)
+{
+	return position / s;
+}
+
+float plane(vec3 position, vec3 origin, vec3 normal)
+{
+	return dot(position - origin, normal);
+}
+
+float distanceFromSphere(vec3 point, vec3 origin, float radius)
+{
+	return length(point - origin) - radius;
+}
+
+float smoothUnion(float d1, float d2, float k)
+{
+    float h = clamp(0.5 + 0.5 * (d2 - d1) / k, 0.0, 1.0);
+    return mix(d2, d1, h) - k * h * (1.0 - h);
+}
+
+// Normal of smoothUnion(d1, d2, k) from the normals of its operands, the derivative terms of
+// the blend factor cancel out.
+vec3 smoothUnionNormal(float d1, vec3 n1, float d2, vec3 n2, float k)
+{
+    float h = clamp(0.5 + 0.5 * (d2 - d1) / k, 0.0, 1.0);
+    return normalize(mix(n2, n1, h));
+}
@@ -0,0 +1,99 @@
+// Soft shadows of the fractal scenes. Include after common/march.glsl. SHADOW_RESOLUTION picks
+// the mode (shader presets override it, see FrontendConfig.yaml):
+//   0   no shadows,
+//   1   one shadow ray per pixel,
+//   2   one shadow ray per 2x2 pixels of the work group, upsampled from the samples at the depth
+//       of the pixel - pixels without such a sample trace their own.
+// Keep in sync with CpuRenderer::Shadow and CpuRenderer::ShadeTileShadows.
+
+#ifndef SHADOW_RESOLUTION
+#define SHADOW_RESOLUTION 0
+#endif
+
+const vec3 LIGHT_POSITION = vec3(10.f, 10.f, 5.f);
+const int SHADOW_ITERATIONS = 64;
+const float SHADOW_SHARPNESS = 20.f;
+const float SHADOW_MIN = .3f;
+// Samples further from the depth of a pixel than this fraction of it are not upsampled into it.
+const float SHADOW_DEPTH_TOLERANCE = .05f;
+
+// Soft shadow factor in [SHADOW_MIN, 1] of the surface point toward the light.
+float shadow(vec3 surfacePoint)
+{
+	vec3 origin = surfacePoint + sceneNormal(surfacePoint) * EPSILON;
+	float lightDistance = length(LIGHT_POSITION - origin);
+	vec3 direction = (LIGHT_POSITION - origin) / lightDistance;
+
+	float res = 1.f;
+	float t = 0.f;
+	for (int i = 0; i < SHADOW_ITERATIONS; i++)
+	{
+		float h = SCENE_DISTANCE(origin + direction * t);
+		res = min(res, SHADOW_SHARPNESS * h / t);
+
+		// The factor is clamped to SHADOW_MIN, below it the penumbra is saturated.
+		if (res < SHADOW_MIN)
+		{
+			break;
+		}
+
+		t += clamp(h, .01f, .2f);
+
+		// Nothing beyond the light occludes it.
+		if (t > lightDistance)
+		{
+			break;
+		}
+	}
+	return clamp(res, SHADOW_MIN, 1.f);
+}
+
+#if SHADOW_RESOLUTION > 1
+// Blocks per row of the 16x16 work group of common/camera.glsl.
+const int SHADOW_BLOCKS = 16 / SHADOW_RESOLUTION;
+// Depth (negative without a hit) and shadow factor of the first pixel of every block.
+shared vec2 shadowSamples[SHADOW_BLOCKS * SHADOW_BLOCKS];
+#endif
+
+// Shadow factor of the pixel whose ray hit the surface at the depth. Every invocation of the work
+// group has to call it, pixels outside of the image with hit set to false.
+float sceneShadow(bool hit, vec3 hitPosition, float depth)
+{
+#if SHADOW_RESOLUTION == 0
+	return 1.f;
+#elif SHADOW_RESOLUTION == 1
+	return hit ? shadow(hitPosition) : 1.f;
+#else
+	ivec2 local = ivec2(gl_LocalInvocationID.xy);
+	if (local.x % SHADOW_RESOLUTION == 0 && local.y % SHADOW_RESOLUTION == 0)
+	{
+		ivec2 block = local / SHADOW_RESOLUTION;
+		shadowSamples[block.y * SHADOW_BLOCKS + block.x] = vec2(hit ? depth : -1.f, hit ? shadow(hitPosition) : 1.f);
+	}
+	barrier();
+
+	if (!hit)
+	{
+		return 1.f;
+	}
+
+	// Bilinear upsampling, leaving out the samples of other surfaces.
+	vec2 position = vec2(local) / float(SHADOW_RESOLUTION);
+	ivec2 block0 = ivec2(position);
+	ivec2 block1 = min(block0 + 1, ivec2(SHADOW_BLOCKS - 1));
+	vec2 w = position - vec2(block0);
+	float factor = 0.f;
+	float weight = 0.f;
+	for (int corner = 0; corner < 4; corner++)
+	{
+		bool right = (corner & 1) != 0;
+		bool bottom = (corner & 2) != 0;
+		vec2 s = shadowSamples[(bottom ? block1.y : block0.y) * SHADOW_BLOCKS + (right ? block1.x : block0.x)];
+		float bilinear = (right ? w.x : 1.f - w.x) * (bottom ? w.y : 1.f - w.y);
+		float depthWeight = s.x < 0.f ? 0.f : max(1.f - abs(s.x - depth) / (SHADOW_DEPTH_TOLERANCE * depth), 0.f);
+		factor += bilinear * depthWeight * s.y;
+		weight += bilinear * depthWeight;
+	}
+	return weight > 1e-3f ? factor / weight : shadow(hitPosition);
+#endif
+}
@@ -5,79 +5,21 @@
 // https://github.com/takah29/ray-marching/blob/main/main_mandelbulb.glsl
 //
 
-layout(local_size_x = 16, local_size_y = 16) in;
-
-layout(binding = 0, rgba8) uniform writeonly image2D resultImage;
-
-// Get camera parameters.
-layout(set = 1, binding = 0) uniform Camera
-{
-	vec4 position;
-	vec4 ray0;
-	vec4 horizontal;
-	vec4 vertical;
-} camera;
+#include "common/camera.glsl"
 
 layout(set = 1, binding = 1) uniform Time
 {
 	float seconds;
 } time;
 
-// Retrieve pixel coordinates.
-ivec2 pixelCoords = ivec2(gl_GlobalInvocationID.xy);
-
-// Determine the ray to be cast from the pixel to the scene.
-vec3 pixelRay()
-{
-	ivec2 size = imageSize(resultImage);
-	
-	if (pixelCoords.x >= size.x || pixelCoords.y >= size.y)
-		return vec3(0);
-
-	vec2 pos = vec2(pixelCoords) / vec2(size.x - 1, size.y - 1);
-
-	return normalize(camera.ray0.xyz + pos.x * camera.horizontal.xyz + pos.y * camera.vertical.xyz);
-}
+#include "common/scene-parameters.glsl"
+#include "common/sdf.glsl"
 
-// Output the RGB to the appropriate pixel spot.
-void outputColor(vec3 color)
-{
-	imageStore(resultImage, pixelCoords, vec4(color, 1));
-}
-
-// Specify fractal constants.
-const int FRACTAL_ITERATIONS = 32;
-const float FRACTAL_POWER = 8;
-
-vec3 rotateX(vec3 p, float rad)
-{
-    return vec3(p.x, p.y * cos(rad) - p.z * sin(rad), p.y * sin(rad) + p.z * cos(rad));
-}
-
-vec3 rotateY(vec3 p, float rad)
-{
-    return vec3(p.x * cos(rad) + p.z * sin(rad), p.y, -p.x * sin(rad) + p.z * cos(rad));
-}
-
-vec3 rotateZ(vec3 p, float rad)
-{
-    return vec3(p.x * cos(rad) - p.y * sin(rad), p.x * sin(rad) + p.y * cos(rad), p.z);
-}
-
-vec3 move(vec3 position, vec3 dir)
-{
-	return position - dir;
-}
-
-vec3 scale(vec3 position, float s)
-{
-	return position / s;
-}
-
-float plane(vec3 position, vec3 origin, vec3 normal)
-{
-	return dot(position - origin, normal);
-}
+// Specify fractal constants (shader variants override them, see FrontendConfig.yaml).
+#ifndef FRACTAL_ITERATIONS
+#define FRACTAL_ITERATIONS 32
+#endif
+#define FRACTAL_POWER parameters.fractalPower
 
 float mandelbulb(vec3 position, out vec4 color)
 {
@@ -90,14 +32,14 @@ float mandelbulb(vec3 position, out vec4 color)
     for (int i = 0; i < FRACTAL_ITERATIONS; i++) {
         // trigonometric version
 
-        // dz = 8*z^7*dz
-        dz = 8.0 * pow(m, 3.5) * dz + 1.0;
+        // dz = power*z^(power-1)*dz
+        dz = FRACTAL_POWER * pow(m, (FRACTAL_POWER - 1.f) * .5f) * dz + 1.0;
 
-        // z = z^8+z
+        // z = z^power+z
         float r = length(w);
         float b = FRACTAL_POWER * acos(w.y / r);
         float a = FRACTAL_POWER * atan(w.x, w.z);
-        w = position + pow(r, 8.f) * vec3(sin(b) * sin(a), cos(b), sin(b) * cos(a));
+        w = position + pow(r, FRACTAL_POWER) * vec3(sin(b) * sin(a), cos(b), sin(b) * cos(a));
 
         trap = min(trap, vec4(abs(w), m));
 
@@ -111,110 +53,163 @@ float mandelbulb(vec3 position, out vec4 color)
     return 0.25 * log(m) * sqrt(m) / dz;
 }
 
-float smoothUnion(float d1, float d2, float k)
-{
-    float h = clamp(0.5 + 0.5 * (d2 - d1) / k, 0.0, 1.0);
-    return mix(d2, d1, h) - k * h * (1.0 - h);
-}
-
-const float PI = 3.14159265f;
-
-struct Hit
-{
-	float dist;
-	vec4 color;
-};
-
 // Estimate distance to the fractal surface.
 Hit DE(vec3 position)
 {
 	vec3 originalPosition = position;
 	Hit res;
-	position = scale(move(position, vec3(0, 0, -25.f)), 7.f);
+	position = scale(move(position, parameters.objectPosition.xyz), parameters.objectScale);
 	position += vec3(0.f, mix(-1.f, 1.f, (cos(time.seconds) + 1) * .5f), 0.f);
 	res.dist = mandelbulb(position, res.color);
-	res.dist = smoothUnion(res.dist, plane(originalPosition, vec3(0, 12, 0), vec3(0, -1, 0)), 2.5f);
+	res.dist = smoothUnion(res.dist, plane(originalPosition, vec3(0, parameters.planeHeight, 0), vec3(0, -1, 0)), parameters.smoothUnionK);
 	return res;
 }
 
-// Specify ray march constants.
-const float EPSILON = .001f;
-const int MAX_ITERATIONS =  256;
-const float MAX_DISTANCE = 10000.f;
-
-// Estimate surface normal.
-vec3 surfaceNormal(vec3 surfacePoint)
+// Gradient of the distance estimate, the outward normal. The Jacobian of the orbit and the gradient
+// of dz are carried along (rescaled so they do not overflow), see SceneFunctions::MandelbulbGradient.
+// False where the gradient is degenerate.
+bool mandelbulbGradient(vec3 position, out vec3 gradient, out float dist)
 {
-    vec2 e = vec2(1.0, -1.0) * 0.5773;
-    return normalize(e.xyy * DE(surfacePoint + e.xyy * EPSILON).dist + e.yyx * DE(surfacePoint + e.yyx * EPSILON).dist +
-                     e.yxy * DE(surfacePoint + e.yxy * EPSILON).dist + e.xxx * DE(surfacePoint + e.xxx * EPSILON).dist);
+	vec3 w = position;
+	float m = dot(w, w);
+	float dz = 1.0;
+	mat3 jacobian = mat3(1.f);
+	vec3 dzGradient = vec3(0.f);
+	float inverseScale = 1.f;
+
+	for (int i = 0; i < FRACTAL_ITERATIONS; i++)
+	{
+		// Gradient of dz = power * m^((power - 1) / 2) * dz + 1.
+		vec3 mGradient = 2.f * (transpose(jacobian) * w);
+		dzGradient = FRACTAL_POWER * (FRACTAL_POWER - 1.f) * .5f * pow(m, (FRACTAL_POWER - 3.f) * .5f) * dz * mGradient +
+			FRACTAL_POWER * pow(m, (FRACTAL_POWER - 1.f) * .5f) * dzGradient;
+
+		// Derivative of the power map.
+		float r = length(w);
+		float rho2 = w.x * w.x + w.z * w.z;
+		float b = FRACTAL_POWER * acos(w.y / r);
+		float a = FRACTAL_POWER * atan(w.x, w.z);
+		float radius = pow(r, FRACTAL_POWER);
+		vec3 dRadius = FRACTAL_POWER * pow(r, FRACTAL_POWER - 2.f) * w;
+		vec3 dTheta = -(vec3(0.f, 1.f, 0.f) - w.y / m * w) / sqrt(rho2);
+		vec3 dPhi = vec3(w.z, 0.f, -w.x) / rho2;
+		vec3 byRadius = vec3(sin(b) * sin(a), cos(b), sin(b) * cos(a));
+		vec3 byB = radius * vec3(cos(b) * sin(a), -sin(b), cos(b) * cos(a));
+		vec3 byA = radius * vec3(sin(b) * cos(a), 0.f, -sin(b) * sin(a));
+		mat3 derivative = outerProduct(byRadius, dRadius) + FRACTAL_POWER * (outerProduct(byB, dTheta) + outerProduct(byA, dPhi));
+
+		jacobian = derivative * jacobian + inverseScale * mat3(1.f);
+		vec3 columnMax = max(max(abs(jacobian[0]), abs(jacobian[1])), max(abs(jacobian[2]), abs(dzGradient)));
+		float largest = max(max(columnMax.x, columnMax.y), columnMax.z);
+		if (largest > 1e4f)
+		{
+			jacobian /= largest;
+			dzGradient /= largest;
+			inverseScale /= largest;
+		}
+
+		dz = FRACTAL_POWER * pow(m, (FRACTAL_POWER - 1.f) * .5f) * dz + 1.0;
+		w = position + radius * byRadius;
+		m = dot(w, w);
+		if (m > 256.0)
+		{
+			break;
+		}
+	}
+
+	// Gradient of dist = log(m) * sqrt(m) / (4 * dz).
+	dist = 0.25 * log(m) * sqrt(m) / dz;
+	float sqrtM = sqrt(m);
+	vec3 mGradient = 2.f * (transpose(jacobian) * w);
+	gradient = .25f / dz * (1.f / sqrtM + log(m) / (2.f * sqrtM)) * mGradient - dist / dz * dzGradient;
+	float length2 = dot(gradient, gradient);
+	if (isnan(length2) || isinf(length2) || length2 <= 0.f)
+	{
+		return false;
+	}
+	gradient *= inversesqrt(length2);
+	return true;
 }
 
-const int SHADOW_ITERATIONS = 64;
-float shadow(vec3 origin, vec3 direction, float k)
+// Analytic normal of DE().
+bool analyticNormal(vec3 position, out vec3 normal)
 {
-    float res = 1.f;
-    float t = 0.f;
-    for (int i = 0; i < SHADOW_ITERATIONS; i++)
+	vec3 originalPosition = position;
+	position = scale(move(position, parameters.objectPosition.xyz), parameters.objectScale);
+	position += vec3(0.f, mix(-1.f, 1.f, (cos(time.seconds) + 1) * .5f), 0.f);
+
+	vec3 gradient;
+	float dist;
+	if (!mandelbulbGradient(position, gradient, dist))
 	{
-        float h = DE(origin + direction * t).dist;
-        res = min(res, k * h / t);
-        if (res < .001f) break;
-        t += clamp(h, .01f, .2f);
-    }
-    return clamp(res, .3f, 1.f);
+		return false;
+	}
+	normal = smoothUnionNormal(dist, gradient, plane(originalPosition, vec3(0, parameters.planeHeight, 0), vec3(0, -1, 0)),
+		vec3(0, -1, 0), parameters.smoothUnionK);
+	return true;
 }
 
+// Specify ray march constants (shader variants override them, see FrontendConfig.yaml).
+#ifndef EPSILON
+#define EPSILON .001f
+#endif
+#ifndef MAX_ITERATIONS
+#define MAX_ITERATIONS 256
+#endif
+const float MAX_DISTANCE = 10000.f;
+
+#define SCENE_DISTANCE(p) DE(p).dist
+#define MARCH_HIT_THRESHOLD(t) (EPSILON * (t) * .25f)
+#define SCENE_NORMAL(p, normal) analyticNormal(p, normal)
+#define SCENE_COLOR(p) DE(p).color
+#include "common/march.glsl"
+#include "common/shadow.glsl"
+#include "common/ambient-occlusion.glsl"
+#include "common/gbuffer.glsl"
+#include "common/adaptive-sampling.glsl"
+
 void main()
 {
 	// Determine ray to be cast into the scene.
 	vec3 ray = pixelRay();
 
-	// Terminate the pixel is not in the image.
-	if (ray == vec3(0))
-	{
-		return;
-	}
+	// Pixels outside of the image are not marched, but take part in the shadow and occlusion
+	// passes of their work group.
+	bool inImage = ray != vec3(0);
 
-	float t = 0.f;
-	int steps = MAX_ITERATIONS;
-	bool hit = false;
-	vec3 hitColor;
+	// Determine where the ray starts.
+	vec3 origin = pixelOrigin();
 
 	// Ray march.
-	for (int i = 0; i < MAX_ITERATIONS; i++)
+	March result = March(0.f, MAX_ITERATIONS, false);
+	if (inImage)
 	{
-		vec3 position = camera.position.xyz + t * ray;
-		
-		// Estimate scene distance.
-		Hit h = DE(position);
-		t += h.dist;
-
-		// Test for surface proximity.
-		if (h.dist < EPSILON * t * .25f)
-		{
-			hit = true;
-			steps = i;
-			hitColor = h.color.rgb;
-			break;
-		}
-
-		// Test for escaped ray.
-		if (t > MAX_DISTANCE)
-		{
-			break;
-		}
+		result = march(origin, ray);
 	}
 
 	// Determine the surface position that has been hit by the ray.
-	vec3 hitPosition = camera.position.xyz + t * ray;
-	// Determine the normal of the surface point.
-	vec3 hitNormal = surfaceNormal(hitPosition);
+	vec3 hitPosition = origin + result.t * ray;
+#ifdef GBUFFER_OUTPUT
+	// Shadows and occlusion are left to the nodes reading the G-buffer.
+	float shadowMult = 1.f;
+	float occlusion = 1.f;
+#else
+	float shadowMult = sceneShadow(result.hit, hitPosition, result.t);
+	float occlusion = sceneOcclusion(result.hit, hitPosition, result.t);
+#endif
+	int samples = tileSamples(inImage, result.hit, result.t, result.steps);
+
+	if (!inImage)
+	{
+		return;
+	}
 
-	vec3 lightPosition = vec3(10.f, 10.f, 5.f);
-	float shadowMult = 1.f;//shadow(hitPosition + hitNormal * EPSILON, camera.position.xyz, 20.f);
+#ifdef GBUFFER_OUTPUT
+	outputGBuffer(result, hitPosition);
+#endif
 
 	// Output color.
-	vec3 resultColor = shadowMult * (1.f - vec3(steps / float(MAX_ITERATIONS)));
+	// The shadow and occlusion of the first sample apply to all of them.
+	vec3 resultColor = shadowMult * occlusion * vec3(supersampledShade(1.f - result.steps / float(MAX_ITERATIONS), samples));
 	outputColor(resultColor);
 }
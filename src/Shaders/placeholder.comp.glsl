@@ -0,0 +1,41 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Shown while the scene shaders compile at startup. Self-contained, the pipeline is configured
+// with this source directly, without includes or a shader variant.
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0, rgba8) uniform writeonly image2D resultImage;
+
+// Same interface as the scene shaders, so the camera and time updates apply unchanged.
+layout(set = 1, binding = 0) uniform Camera
+{
+	vec4 position;
+	vec4 ray0;
+	vec4 horizontal;
+	vec4 vertical;
+	vec4 originHorizontal;
+	vec4 originVertical;
+} camera;
+
+layout(set = 1, binding = 1) uniform Time
+{
+	float seconds;
+} time;
+
+void main()
+{
+	ivec2 pixelCoords = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(resultImage);
+	if (pixelCoords.x >= size.x || pixelCoords.y >= size.y)
+	{
+		return;
+	}
+
+	// Dark vertical gradient with a band sweeping across it.
+	vec2 pos = vec2(pixelCoords) / vec2(size - 1);
+	float band = smoothstep(.1f, 0.f, abs(pos.x - fract(time.seconds * .5f)));
+	vec3 color = mix(vec3(.08f, .08f, .1f), vec3(.02f), pos.y) + .1f * band;
+	imageStore(resultImage, pixelCoords, vec4(color, 1));
+}
@@ -1,54 +1,36 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(local_size_x = 16, local_size_y = 16) in;
+#include "common/camera.glsl"
+#include "common/sdf.glsl"
 
-layout(binding = 0, rgba8) uniform writeonly image2D resultImage;
-
-layout(set = 1, binding = 0) uniform Camera
-{
-	vec4 position;
-	vec4 ray0;
-	vec4 horizontal;
-	vec4 vertical;
-} camera;
-
-
-uvec2 pictureSize = (gl_NumWorkGroups * gl_WorkGroupSize).xy;
-uvec2 pixelCoords = gl_GlobalInvocationID.xy;
-
-vec3 pixelRay()
-{
-	ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
-	ivec2 size = imageSize(resultImage);
-	
-	if (pix.x >= size.x || pix.y >= size.y)
-		return vec3(0);
-
-	vec2 pos = vec2(pix) / vec2(size.x - 1, size.y - 1);
-
-	return normalize(camera.ray0.xyz + pos.x * camera.horizontal.xyz + pos.y * camera.vertical.xyz);
-}
-
-void outputColor(vec3 color)
-{
-	imageStore(resultImage, ivec2(pixelCoords), vec4(color, 1));
-}
-
-float distanceFromSphere(vec3 point, vec3 origin, float radius)
+float DE(vec3 position)
 {
-	return length(point - origin) - radius;
+	return distanceFromSphere(position, vec3(0), 10.f);
 }
 
-float DE(vec3 position)
+// Analytic normal of DE().
+bool analyticNormal(vec3 position, out vec3 normal)
 {
-	return distanceFromSphere(position, vec3(0), 10.f);
+	normal = normalize(position);
+	return true;
 }
 
-const float EPSILON = .001f;
-const int MAX_ITERATIONS =  10;
+// Specify ray march constants (shader variants override them, see FrontendConfig.yaml).
+#ifndef EPSILON
+#define EPSILON .001f
+#endif
+#ifndef MAX_ITERATIONS
+#define MAX_ITERATIONS 10
+#endif
 const float MAX_DISTANCE = 1000.f;
 
+#define SCENE_DISTANCE(p) DE(p)
+#define SCENE_NORMAL(p, normal) analyticNormal(p, normal)
+#define MARCH_HIT_THRESHOLD(t) EPSILON
+#define MARCH_TEST_BEFORE_STEP
+#include "common/march.glsl"
+
 void main()
 {
 	vec3 ray = pixelRay();
@@ -58,38 +40,13 @@ void main()
 		return;
 	}
 
-	float t = 0.f;
-	bool hit = false;
-	int steps = MAX_ITERATIONS;
-
-	for (int i = 0; i < MAX_ITERATIONS; ++i)
-	{
-		float sdf = DE(camera.position.xyz + t * ray);
-
-		if (sdf < EPSILON)
-		{
-			hit = true;
-			steps = i;
-			break;
-		}
-
-		t += sdf;
-
-		if (t > MAX_DISTANCE)
-		{
-			break;
-		}
-	}
+	// Determine where the ray starts.
+	vec3 origin = pixelOrigin();
 
-	vec3 hitPosition = camera.position.xyz + t * ray;
-	vec3 xDir = vec3(EPSILON, 0, 0);
-	vec3 yDir = vec3(0, EPSILON, 0);
-	vec3 zDir = vec3(0, 0, EPSILON);
+	March result = march(origin, ray);
 
-	vec3 normal = normalize(
-		vec3(DE(hitPosition+xDir)-DE(hitPosition-xDir),
-			DE(hitPosition+yDir)-DE(hitPosition-yDir),
-			DE(hitPosition+zDir)-DE(hitPosition-zDir)));
+	vec3 hitPosition = origin + result.t * ray;
+	vec3 normal = sceneNormal(hitPosition);
 
 	outputColor(normal);
 }
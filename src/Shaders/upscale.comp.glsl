@@ -0,0 +1,102 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Edge-aware upscaling of the rayMarch output rendered at a lower resolution, guided by the
+// depths and normals the march writes with GBUFFER_OUTPUT (common/gbuffer.glsl). Within a surface
+// a pixel is interpolated bilinearly from the 2x2 samples around it. Where the samples straddle
+// a depth or normal discontinuity, the edge is placed along the zero crossing of the bilinearly
+// interpolated side of the samples - near surface or not - and the pixel only blends the samples
+// on its side, so the fractal edges stay sharp instead of being smeared into the background.
+// Close to the edge the side is a guess, there the pixel fades to the bilinear color.
+// The node runs at the full resolution and has to provide the images below, the inputs from a
+// rayMarch node with GBUFFER_OUTPUT. Keep in sync with UpscalePass.
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0, rgba8) uniform writeonly image2D resultImage;
+// Color, depth and normal (w is 1 where the ray hit) of the low resolution march.
+layout(binding = 1, rgba8) uniform readonly image2D colorImage;
+layout(binding = 2, r32f) uniform readonly image2D depthImage;
+layout(binding = 3, rgba16f) uniform readonly image2D normalImage;
+
+// Samples further apart in depth than this fraction of the nearer one are on different surfaces.
+const float DEPTH_TOLERANCE = .05f;
+// Samples whose normals have a smaller cosine between them are on different surfaces.
+const float NORMAL_THRESHOLD = .8f;
+
+// Whether the samples see the same surface.
+bool sameSurface(vec4 normalA, float depthA, vec4 normalB, float depthB)
+{
+	bool hit = normalA.w > .5f;
+	if (hit != (normalB.w > .5f))
+	{
+		return false;
+	}
+	if (!hit)
+	{
+		return true;
+	}
+	return abs(depthA - depthB) <= DEPTH_TOLERANCE * min(depthA, depthB) && dot(normalA.xyz, normalB.xyz) >= NORMAL_THRESHOLD;
+}
+
+void main()
+{
+	ivec2 pixelCoords = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(resultImage);
+	if (pixelCoords.x >= size.x || pixelCoords.y >= size.y)
+	{
+		return;
+	}
+
+	// The first and last pixels share their rays with the first and last samples, like the ray
+	// parametrization of common/camera.glsl.
+	ivec2 sampleSize = imageSize(colorImage);
+	vec2 position = vec2(pixelCoords) * vec2(sampleSize - 1) / vec2(max(size - 1, ivec2(1)));
+	ivec2 sample0 = min(ivec2(position), max(sampleSize - 2, ivec2(0)));
+	ivec2 sample1 = min(sample0 + 1, sampleSize - 1);
+	vec2 w = min(position - vec2(sample0), vec2(1.f));
+
+	ivec2 corners[4] = ivec2[4](sample0, ivec2(sample1.x, sample0.y), ivec2(sample0.x, sample1.y), sample1);
+	float weights[4] = float[4]((1.f - w.x) * (1.f - w.y), w.x * (1.f - w.y), (1.f - w.x) * w.y, w.x * w.y);
+	vec4 normals[4];
+	float depths[4];
+	int nearest = -1;
+	for (int corner = 0; corner < 4; corner++)
+	{
+		normals[corner] = imageLoad(normalImage, corners[corner]);
+		depths[corner] = imageLoad(depthImage, corners[corner]).x;
+		if (normals[corner].w > .5f && (nearest < 0 || depths[corner] < depths[nearest]))
+		{
+			nearest = corner;
+		}
+	}
+
+	// The surface nearest to the camera and the samples on it, the edge runs between them and
+	// the others.
+	bool nearSide[4] = bool[4](true, true, true, true);
+	bool edge = false;
+	float side = 0.f;
+	for (int corner = 0; corner < 4 && nearest >= 0; corner++)
+	{
+		nearSide[corner] = sameSurface(normals[nearest], depths[nearest], normals[corner], depths[corner]);
+		edge = edge || !nearSide[corner];
+		side += nearSide[corner] ? weights[corner] : -weights[corner];
+	}
+
+	vec3 color = vec3(0.f);
+	vec3 sideColor = vec3(0.f);
+	float sideWeight = 0.f;
+	for (int corner = 0; corner < 4; corner++)
+	{
+		vec3 sampleColor = imageLoad(colorImage, corners[corner]).rgb;
+		float cornerSideWeight = nearSide[corner] == (side >= 0.f) ? weights[corner] : 0.f;
+		color += weights[corner] * sampleColor;
+		sideColor += cornerSideWeight * sampleColor;
+		sideWeight += cornerSideWeight;
+	}
+	if (edge)
+	{
+		color = mix(color, sideColor / sideWeight, side * side);
+	}
+	imageStore(resultImage, pixelCoords, vec4(color, 1.f));
+}
@@ -1,7 +1,14 @@
 #include "Logger/Logger.hpp"
+#include "Logger/BinaryLog.hpp"
 #include "Filesystem/Filesystem.hpp"
 #include "Input/Input.hpp"
 #include "Camera/Camera.hpp"
+#include "Benchmark/Benchmark.hpp"
+#include "Config/PipelineConfig.hpp"
+#include "HotReload/ParameterReloader.hpp"
+#include "HotReload/PipelineReloader.hpp"
+#include "ShaderCache/ShaderPrecompiler.hpp"
+#include "Sweep/ParameterSweep.hpp"
 
 #include <HawkEye/HawkEyeAPI.hpp>
 #include <SoftwareCore/DefaultLogger.hpp>
@@ -9,9 +16,13 @@
 
 #include <EverViewport/WindowAPI.hpp>
 
+#include <future>
+#include <memory>
 #include <thread>
 
 static HawkEye::Pipeline pipeline;
+static UniformRing uniformRing;
+static SceneUniforms sceneUniforms(uniformRing);
 
 static int windowWidth = 720;
 static int windowHeight = 480;
@@ -20,11 +31,88 @@ static Camera camera(windowWidth / float(windowHeight));
 
 int main(int argc, char* argv[])
 {
+	const auto startTime = std::chrono::steady_clock::now();
 	Core::Singleton<RMFilesystem>::GetInstance().Init(argv[0]);
-	InitLogger("log.txt");
+	// Per-frame telemetry goes to a binary log, decode it with LogDecoder.
+	bool telemetry = false;
+	// Shader preset of FrontendConfig.yaml, its default when empty.
+	std::string shaderPreset;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		if (argument == "--telemetry")
+		{
+			telemetry = true;
+		}
+		else if (argument == "--preset" && i + 1 < argc)
+		{
+			shaderPreset = argv[++i];
+		}
+	}
+	InitLogger("log.txt", telemetry ? "telemetry.rmbl" : "");
 
-	const std::string pathToBackend = RMFS.GetAbsolutePath("../../src/BackendConfig.yaml");
+	// Headless benchmarks of the CPU renderer: RayMarcher --benchmark <name>
+	if (argc > 2 && std::string(argv[1]) == "--benchmark")
+	{
+		const int result = RunBenchmark(argv[2]);
+		ShutdownLogger();
+		return result;
+	}
+
+	// Fills the shader cache without opening a window: RayMarcher --precompile-shaders [directory]
+	if (argc > 1 && std::string(argv[1]) == "--precompile-shaders")
+	{
+		const int result = RunShaderPrecompile(argc > 2 ? argv[2] : RMFS.GetAbsolutePath("shader-cache"));
+		ShutdownLogger();
+		return result;
+	}
+
+	// Renders a parameter sweep on the CPU: RayMarcher --sweep <spec.yaml> [output directory]
+	if (argc > 2 && std::string(argv[1]) == "--sweep")
+	{
+		const int result = RunSweepCommand(argv[2], argc > 3 ? argv[3] : "");
+		ShutdownLogger();
+		return result;
+	}
+
+	// Validates the configs and compiles them to blobs: RayMarcher --compile-configs
+	if (argc > 1 && std::string(argv[1]) == "--compile-configs")
+	{
+		const int result = RunConfigCompile();
+		ShutdownLogger();
+		return result;
+	}
+
+	// A misspelled --preset would leave no shaders to configure the pipeline with.
 	const std::string pathToFrontend = RMFS.GetAbsolutePath("../../src/FrontendConfig.yaml");
+	ShaderPreset preset;
+	std::string presetError;
+	if (!FindShaderPreset(pathToFrontend, shaderPreset, preset, presetError))
+	{
+		CoreLogError(DefaultLogger, "Cannot start, %s.", presetError.c_str());
+		ShutdownLogger();
+		return 1;
+	}
+
+	const std::string pathToBackend = RMFS.GetAbsolutePath("../../src/BackendConfig.yaml");
+	ConfigBlob backendConfig;
+	std::string backendError;
+	// HawkEye reads the same file, it must not be initialized with one that failed to validate.
+	if (!LoadBackendConfig(pathToBackend, backendConfig, backendError))
+	{
+		CoreLogError(DefaultLogger, "Cannot start, invalid backend config, %s.", backendError.c_str());
+		ShutdownLogger();
+		return 1;
+	}
+
+	// Prepares the shader variants on the worker threads, the window shows a placeholder until
+	// they are ready. Afterwards edits to the shaders and configs are swapped in while running.
+	std::future<std::unique_ptr<PipelineReloader>> startup = std::async(std::launch::async, [&pathToFrontend, &pathToBackend, &shaderPreset]()
+	{
+		return std::make_unique<PipelineReloader>(pathToFrontend, pathToBackend, shaderPreset,
+			std::vector<std::string>{ RMFS.GetAbsolutePath("../../src/Shaders") }, RMFS.GetAbsolutePath("shader-cache"));
+	});
+	std::unique_ptr<PipelineReloader> reloader;
 
 	HawkEye::HRendererData rendererData = HawkEye::Initialize(pathToBackend.c_str());
 
@@ -33,6 +121,7 @@ int main(int argc, char* argv[])
 	{
 		if (pipeline.Configured())
 		{
+			uniformRing.Flush(pipeline);
 			pipeline.DrawFrame();
 		}
 	};
@@ -42,7 +131,7 @@ int main(int argc, char* argv[])
 		windowHeight = height;
 		camera.SetAspect(windowWidth / float(windowHeight));
 		camera.UpdateViewProjectionMatrices();
-		UpdateCamera(pipeline, camera);
+		UpdateCamera(sceneUniforms, camera);
 		if (pipeline.Configured())
 		{
 			pipeline.Resize(width, height);
@@ -50,14 +139,23 @@ int main(int argc, char* argv[])
 	};
 	EverViewport::Window window(64, 64, windowWidth, windowHeight, "Ray Marcher", windowCallbacks);
 
-	pipeline.Configure(rendererData, pathToFrontend.c_str(), windowWidth, windowHeight,
-		window.GetWindowHandle(), window.GetProgramConnection());
+	// A warm shader cache is ready by now, no placeholder needed.
+	if (startup.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		pipeline.Configure(rendererData, RMFS.GetAbsolutePath("../../src/PlaceholderConfig.yaml").c_str(), windowWidth, windowHeight,
+			window.GetWindowHandle(), window.GetProgramConnection());
+	}
 
 	camera.SetPosition(0, 0, -40);
 
+	// Edits of the scene parameters only change a uniform, no shader is compiled for them.
+	auto parameterReloader = std::make_unique<ParameterReloader>(RMFS.GetAbsolutePath("../../src/SceneParameters.yaml"));
+
 	const float targetTimeDelta = 1 / 60.f * 1000.f;
 	float timeDelta = 1.f;
 	auto before = std::chrono::high_resolution_clock::now();
+	uint32_t frameIndex = 0;
+	int exitCode = 0;
 	while (!window.ShouldClose())
 	{
 		auto now = std::chrono::high_resolution_clock::now();
@@ -70,14 +168,85 @@ int main(int argc, char* argv[])
 			std::this_thread::sleep_for(std::chrono::milliseconds(int(targetTimeDelta - timeDelta)));
 		}
 
-		HandleInput(pipeline, window, camera, timeDelta);
+		HandleInput(sceneUniforms, window, camera, timeDelta);
+
+		SceneParameters parameters;
+		if (parameterReloader->TakeChange(parameters))
+		{
+			const auto changed = sceneUniforms.parameters.Set(parameters);
+			if (!changed.IsEmpty())
+			{
+				CoreLogInfo(DefaultLogger, "Scene parameters changed in bytes %u to %u.", changed.begin, changed.end);
+			}
+		}
 
 		window.PollMessages();
+
+		// Swapping between frames, the variants have been compiled in the background.
+		PipelineReloader::Reload reload;
+		if (!reloader && startup.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			reloader = startup.get();
+			if (reloader->GetPrepared().configPath.empty())
+			{
+				CoreLogError(DefaultLogger, "Exiting, the shader variants could not be prepared (see above).");
+				exitCode = 1;
+				break;
+			}
+			if (pipeline.Configured())
+			{
+				pipeline.Shutdown();
+			}
+			pipeline.Configure(rendererData, reloader->GetPrepared().configPath.c_str(), windowWidth, windowHeight,
+				window.GetWindowHandle(), window.GetProgramConnection());
+			// The new pipeline starts without uniforms.
+			uniformRing.Invalidate();
+			CoreLogInfo(DefaultLogger, "Scene pipeline configured %.1f ms after the start, after %u placeholder frame(s).",
+				std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count(), frameIndex);
+		}
+		else if (reloader && reloader->TakeReload(reload))
+		{
+			pipeline.Shutdown();
+			if (reload.backendChanged)
+			{
+				HawkEye::Shutdown();
+				rendererData = HawkEye::Initialize(pathToBackend.c_str());
+			}
+			pipeline.Configure(rendererData, reload.frontendConfigPath.c_str(), windowWidth, windowHeight,
+				window.GetWindowHandle(), window.GetProgramConnection());
+			uniformRing.Invalidate();
+
+			const auto swapped = std::chrono::steady_clock::now();
+			CoreLogInfo(DefaultLogger, "Hot reload swapped in %.1f ms after the change, %.1f ms after it was prepared.",
+				std::chrono::duration<float, std::milli>(swapped - reload.changeTime).count(),
+				std::chrono::duration<float, std::milli>(swapped - reload.preparedTime).count());
+		}
+
+		// All uniforms of the frame in one upload.
+		uniformRing.Flush(pipeline);
 		pipeline.DrawFrame();
+		if (frameIndex == 0)
+		{
+			CoreLogInfo(DefaultLogger, "First frame drawn %.1f ms after the start.",
+				std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+		}
+
+		LogTelemetry("Frame %u: %.3f ms\n", frameIndex++, timeDelta);
+	}
+
+	// Everything logging from other threads stops before the logger: the file watchers of the
+	// reloaders and the startup, which may still be preparing the variants when the window closes.
+	parameterReloader.reset();
+	reloader.reset();
+	if (startup.valid())
+	{
+		// Waits for it and destroys the reloader it made.
+		startup.get();
 	}
 
 	pipeline.Shutdown();
 	HawkEye::Shutdown();
+	ShutdownLogger();
 
-	return 0;
+	return exitCode;
 }
\ No newline at end of file
@@ -0,0 +1,423 @@
+#include "ParameterSweep.hpp"
+#include "../Camera/Camera.hpp"
+#include "../Config/Yaml.hpp"
+#include "../Filesystem/Filesystem.hpp"
+#include "../Filesystem/Hash.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	// Bump when the CPU renderer changes its output, cached images of older versions are ignored.
+	constexpr uint32_t SWEEP_CACHE_VERSION = 2;
+	constexpr uint32_t SWEEP_CACHE_MAGIC = 0x57534d52; // "RMSW"
+
+	// Gap between the cells of the contact sheet in pixels.
+	constexpr int SHEET_GAP = 2;
+
+	struct CachedImageHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		double renderMs;
+		uint64_t evaluations;
+	};
+
+	const std::pair<const char*, Scene> sceneNames[] = {
+		{ "mandelbulb", Scene::Mandelbulb },
+		{ "recursive-tetrahedron", Scene::RecursiveTetrahedron },
+		{ "sphere", Scene::Sphere },
+		{ "spheres", Scene::Spheres },
+	};
+
+	bool ParseNumber(const YamlNode* node, const std::string& name, float& value, std::string& error)
+	{
+		const std::string text = node ? node->GetScalar() : std::string();
+		char* end = nullptr;
+		const float parsed = std::strtof(text.c_str(), &end);
+		if (text.empty() || *end != '\0' || !std::isfinite(parsed))
+		{
+			error = name + " has to be a number";
+			return false;
+		}
+		value = parsed;
+		return true;
+	}
+
+	bool ParseVector(const YamlNode* node, const std::string& name, Eigen::Vector3f& value, std::string& error)
+	{
+		if (!node || node->GetItems().size() != 3)
+		{
+			error = name + " has to be a sequence of 3 numbers";
+			return false;
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			if (!ParseNumber(&node->GetItems()[i], name, value(i), error))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	Camera::RayBasis GetRayBasis(const SweepSpec& spec)
+	{
+		Camera camera(spec.cameraPosition, spec.cameraTarget, Eigen::Vector3f(0.f, 1.f, 0.f), spec.fieldOfView,
+			spec.width / float(spec.height), .01f, 10000.f);
+		camera.UpdateRayBasis();
+		return camera.GetRayBasis();
+	}
+
+	// Everything the image of a cell depends on. The fields are hashed one by one, padding of
+	// the settings would make equal settings hash differently.
+	uint64_t HashCell(const SweepSpec& spec, const CpuRenderSettings& settings, const Camera::RayBasis& rayBasis)
+	{
+		uint64_t key = HashBytes(&SWEEP_CACHE_VERSION, sizeof(SWEEP_CACHE_VERSION));
+		const int32_t integers[] = { int32_t(settings.scene), settings.maxIterations, settings.fractalIterations, int32_t(settings.shadows), spec.width,
+			spec.height };
+		key = HashBytes(integers, sizeof(integers), key);
+		const float floats[] = { settings.time, settings.epsilon };
+		key = HashBytes(floats, sizeof(floats), key);
+		key = HashBytes(&settings.parameters, sizeof(settings.parameters), key);
+		for (const Eigen::Vector3f* vector : { &rayBasis.origin0, &rayBasis.originHorizontal, &rayBasis.originVertical,
+			&rayBasis.ray0, &rayBasis.horizontal, &rayBasis.vertical })
+		{
+			key = HashBytes(vector->data(), 3 * sizeof(float), key);
+		}
+		return key;
+	}
+
+	std::string GetCachePath(const std::string& cacheDirectory, const uint64_t key)
+	{
+		return (std::filesystem::path(cacheDirectory) / (HashToString(key) + ".rmsw")).string();
+	}
+
+	bool ReadCachedImage(const std::string& path, const SweepSpec& spec, SweepCell& cell)
+	{
+		std::ifstream file(path, std::ios_base::binary);
+		CachedImageHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != SWEEP_CACHE_MAGIC ||
+			header.version != SWEEP_CACHE_VERSION || int(header.width) != spec.width || int(header.height) != spec.height)
+		{
+			return false;
+		}
+		cell.pixels.resize(size_t(spec.width) * spec.height * CpuRenderer::CHANNELS);
+		if (!file.read(reinterpret_cast<char*>(cell.pixels.data()), std::streamsize(cell.pixels.size())))
+		{
+			return false;
+		}
+		cell.renderMs = header.renderMs;
+		cell.evaluations = header.evaluations;
+		return true;
+	}
+
+	// The cache only saves time, a cell whose image can not be written is still rendered.
+	void WriteCachedImage(const std::string& path, const SweepSpec& spec, const SweepCell& cell)
+	{
+		const CachedImageHeader header{ SWEEP_CACHE_MAGIC, SWEEP_CACHE_VERSION, uint32_t(spec.width), uint32_t(spec.height),
+			cell.renderMs, cell.evaluations };
+		WriteFileAtomically(path, [&header, &cell](std::ostream& file)
+		{
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			return bool(file.write(reinterpret_cast<const char*>(cell.pixels.data()), std::streamsize(cell.pixels.size())));
+		});
+	}
+}
+
+float SweepAxis::GetValue(const int index) const
+{
+	return count > 1 ? first + (last - first) * index / float(count - 1) : first;
+}
+
+uint32_t SweepSpec::GetCellCount() const
+{
+	uint32_t count = 1;
+	for (const SweepAxis& axis : axes)
+	{
+		count *= uint32_t(axis.count);
+	}
+	return count;
+}
+
+bool LoadSweepSpec(const std::string& path, SweepSpec& spec, std::string& error)
+{
+	YamlNode root;
+	if (!YamlNode::Load(path, root, error))
+	{
+		return false;
+	}
+	spec = SweepSpec();
+
+	const YamlNode* scene = root.Find("scene");
+	const auto sceneName = std::find_if(std::begin(sceneNames), std::end(sceneNames),
+		[scene](const auto& name) { return scene && scene->GetScalar() == name.first; });
+	if (sceneName == std::end(sceneNames))
+	{
+		error = "scene has to be one of mandelbulb, recursive-tetrahedron, sphere and spheres";
+		return false;
+	}
+	spec.settings.scene = sceneName->second;
+
+	float width = float(spec.width);
+	float height = float(spec.height);
+	if ((root.Find("width") && !ParseNumber(root.Find("width"), "width", width, error)) ||
+		(root.Find("height") && !ParseNumber(root.Find("height"), "height", height, error)))
+	{
+		return false;
+	}
+	spec.width = int(width);
+	spec.height = int(height);
+	if (spec.width < 2 || spec.height < 2)
+	{
+		error = "the image has to be at least 2x2 pixels";
+		return false;
+	}
+
+	if (const YamlNode* camera = root.Find("camera"))
+	{
+		if (!ParseVector(camera->Find("position"), "camera position", spec.cameraPosition, error) ||
+			!ParseVector(camera->Find("target"), "camera target", spec.cameraTarget, error) ||
+			(camera->Find("field-of-view") && !ParseNumber(camera->Find("field-of-view"), "field-of-view", spec.fieldOfView, error)))
+		{
+			return false;
+		}
+	}
+
+	// Values of the parameters which are not swept.
+	if (const YamlNode* settings = root.Find("settings"))
+	{
+		for (const auto& entry : settings->GetEntries())
+		{
+			float value = 0.f;
+			if (!ParseNumber(&entry.second, entry.first, value, error) || !ApplySweepParameter(entry.first, value, spec.settings, error))
+			{
+				return false;
+			}
+		}
+	}
+
+	const YamlNode* axes = root.Find("axes");
+	if (!axes || axes->GetItems().empty())
+	{
+		error = "axes has to be a sequence of at least one axis";
+		return false;
+	}
+	for (const YamlNode& node : axes->GetItems())
+	{
+		SweepAxis axis;
+		axis.parameter = node.Find("parameter") ? node.Find("parameter")->GetScalar() : std::string();
+		float count = 0.f;
+		CpuRenderSettings probe;
+		if (!ParseNumber(node.Find("from"), axis.parameter + " from", axis.first, error) ||
+			!ParseNumber(node.Find("to"), axis.parameter + " to", axis.last, error) ||
+			!ParseNumber(node.Find("count"), axis.parameter + " count", count, error) ||
+			!ApplySweepParameter(axis.parameter, axis.first, probe, error))
+		{
+			return false;
+		}
+		axis.count = int(count);
+		if (axis.count < 1)
+		{
+			error = axis.parameter + " count has to be positive";
+			return false;
+		}
+		spec.axes.push_back(axis);
+	}
+	return true;
+}
+
+bool ApplySweepParameter(const std::string& parameter, const float value, CpuRenderSettings& settings, std::string& error)
+{
+	if (parameter == "time")
+	{
+		settings.time = value;
+	}
+	else if (parameter == "epsilon")
+	{
+		settings.epsilon = value;
+	}
+	else if (parameter == "max-iterations")
+	{
+		settings.maxIterations = int(std::lround(value));
+	}
+	else if (parameter == "iterations")
+	{
+		settings.fractalIterations = int(std::lround(value));
+	}
+	else if (!SetSceneParameter(settings.parameters, parameter, value, error))
+	{
+		error = "unknown sweep parameter " + parameter;
+		return false;
+	}
+	return true;
+}
+
+bool RunSweep(const SweepSpec& spec, const std::string& cacheDirectory, ThreadPool& threadPool, SweepReport& report,
+	std::string& error)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const Camera::RayBasis rayBasis = GetRayBasis(spec);
+	const uint32_t cellCount = spec.GetCellCount();
+
+	report = SweepReport();
+	report.cells.resize(cellCount);
+	std::vector<CpuRenderSettings> settings(cellCount, spec.settings);
+	for (uint32_t i = 0; i < cellCount; ++i)
+	{
+		// The first axis changes fastest.
+		uint32_t index = i;
+		for (const SweepAxis& axis : spec.axes)
+		{
+			const float value = axis.GetValue(int(index % uint32_t(axis.count)));
+			index /= uint32_t(axis.count);
+			report.cells[i].values.push_back(value);
+			if (!ApplySweepParameter(axis.parameter, value, settings[i], error))
+			{
+				return false;
+			}
+		}
+		report.cells[i].key = HashCell(spec, settings[i], rayBasis);
+	}
+
+	std::error_code directoryError;
+	std::filesystem::create_directories(cacheDirectory, directoryError);
+
+	// One task per cell, the cells are small enough that splitting them into tiles would only
+	// add scheduling overhead.
+	threadPool.ParallelFor(cellCount, [&](const uint32_t i)
+	{
+		SweepCell& cell = report.cells[i];
+		const std::string cachePath = GetCachePath(cacheDirectory, cell.key);
+		cell.cached = ReadCachedImage(cachePath, spec, cell);
+		if (cell.cached)
+		{
+			return;
+		}
+
+		CpuRenderer renderer(threadPool);
+		renderer.SetSettings(settings[i]);
+		cell.pixels.resize(size_t(spec.width) * spec.height * CpuRenderer::CHANNELS);
+		const auto renderStart = std::chrono::steady_clock::now();
+		renderer.RenderSerial(rayBasis, spec.width, spec.height, cell.pixels.data());
+		cell.renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+		cell.evaluations = renderer.GetDistanceEvaluations();
+		WriteCachedImage(cachePath, spec, cell);
+	});
+
+	for (const SweepCell& cell : report.cells)
+	{
+		++(cell.cached ? report.cached : report.rendered);
+	}
+	report.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+bool WriteContactSheet(const SweepSpec& spec, const SweepReport& report, const std::string& path, std::string& error)
+{
+	const int columns = spec.axes.empty() ? 1 : spec.axes.front().count;
+	const int rows = (int(report.cells.size()) + columns - 1) / columns;
+	const int sheetWidth = columns * spec.width + (columns + 1) * SHEET_GAP;
+	const int sheetHeight = rows * spec.height + (rows + 1) * SHEET_GAP;
+
+	std::vector<uint8_t> sheet(size_t(sheetWidth) * sheetHeight * 3, 32);
+	for (size_t i = 0; i < report.cells.size(); ++i)
+	{
+		const int x0 = SHEET_GAP + int(i % columns) * (spec.width + SHEET_GAP);
+		const int y0 = SHEET_GAP + int(i / columns) * (spec.height + SHEET_GAP);
+		const std::vector<uint8_t>& pixels = report.cells[i].pixels;
+		for (int y = 0; y < spec.height; ++y)
+		{
+			for (int x = 0; x < spec.width; ++x)
+			{
+				const uint8_t* source = &pixels[(size_t(y) * spec.width + x) * CpuRenderer::CHANNELS];
+				uint8_t* destination = &sheet[(size_t(y0 + y) * sheetWidth + x0 + x) * 3];
+				std::copy(source, source + 3, destination);
+			}
+		}
+	}
+
+	std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+	file << "P6\n" << sheetWidth << ' ' << sheetHeight << "\n255\n";
+	file.write(reinterpret_cast<const char*>(sheet.data()), std::streamsize(sheet.size()));
+	if (!file)
+	{
+		error = "cannot write " + path;
+		return false;
+	}
+	return true;
+}
+
+bool WriteSweepCsv(const SweepSpec& spec, const SweepReport& report, const std::string& path, std::string& error)
+{
+	std::ofstream file(path, std::ios_base::trunc);
+	file << "cell";
+	for (const SweepAxis& axis : spec.axes)
+	{
+		file << ',' << axis.parameter;
+	}
+	file << ",cached,render_ms,evaluations,key\n";
+
+	char line[128];
+	for (size_t i = 0; i < report.cells.size(); ++i)
+	{
+		const SweepCell& cell = report.cells[i];
+		file << i;
+		for (const float value : cell.values)
+		{
+			std::snprintf(line, sizeof(line), ",%g", value);
+			file << line;
+		}
+		std::snprintf(line, sizeof(line), ",%d,%.3f,%llu,", cell.cached ? 1 : 0, cell.renderMs, (unsigned long long)cell.evaluations);
+		file << line << HashToString(cell.key) << '\n';
+	}
+	if (!file)
+	{
+		error = "cannot write " + path;
+		return false;
+	}
+	return true;
+}
+
+int RunSweepCommand(const std::string& specPath, const std::string& outputDirectory)
+{
+	SweepSpec spec;
+	SweepReport report;
+	std::string error;
+	ThreadPool threadPool;
+	const std::string directory = outputDirectory.empty() ? RMFS.GetAbsolutePath("sweep") : outputDirectory;
+	std::error_code directoryError;
+	std::filesystem::create_directories(directory, directoryError);
+	const std::string sheetPath = (std::filesystem::path(directory) / "contact-sheet.ppm").string();
+	const std::string csvPath = (std::filesystem::path(directory) / "sweep.csv").string();
+
+	if (!LoadSweepSpec(specPath, spec, error) || !RunSweep(spec, RMFS.GetAbsolutePath("sweep-cache"), threadPool, report, error) ||
+		!WriteContactSheet(spec, report, sheetPath, error) || !WriteSweepCsv(spec, report, csvPath, error))
+	{
+		std::printf("Sweep failed: %s\n", error.c_str());
+		return 1;
+	}
+
+	double renderMs = 0.0;
+	uint64_t evaluations = 0;
+	for (const SweepCell& cell : report.cells)
+	{
+		renderMs += cell.cached ? 0.0 : cell.renderMs;
+		evaluations += cell.cached ? 0 : cell.evaluations;
+	}
+	std::printf("Sweep of %zu cells of %dx%d on %u threads: %u rendered, %u from the cache, %.1f ms\n", report.cells.size(),
+		spec.width, spec.height, threadPool.GetThreadCount(), report.rendered, report.cached, report.totalMs);
+	std::printf("  %.1f cells/s, %.1f renders/s, %.2f M distance evaluations/s of render time\n",
+		report.cells.size() * 1000.0 / report.totalMs, report.rendered * 1000.0 / report.totalMs,
+		renderMs > 0.0 ? evaluations / renderMs / 1000.0 : 0.0);
+	std::printf("  %s\n  %s\n", sheetPath.c_str(), csvPath.c_str());
+	return 0;
+}
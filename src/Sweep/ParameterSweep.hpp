@@ -0,0 +1,82 @@
+#pragma once
+#include "../CpuRenderer/CpuRenderer.hpp"
+#include "../CpuRenderer/ThreadPool.hpp"
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Parameter swept across a grid of renders, sampled at count evenly spaced values from first
+/// to last. The parameter is an override of CpuRenderSettings (max-iterations, epsilon,
+/// iterations for FRACTAL_ITERATIONS, time) or one of the scene parameters of
+/// src/SceneParameters.yaml.
+struct SweepAxis
+{
+	std::string parameter;
+	float first = 0.f;
+	float last = 0.f;
+	int count = 1;
+
+	float GetValue(int index) const;
+};
+
+/// Grid of CPU renders exploring a parameter space, read from a file like src/Sweeps/*.yaml.
+struct SweepSpec
+{
+	CpuRenderSettings settings;
+	int width = 64;
+	int height = 48;
+	Eigen::Vector3f cameraPosition = Eigen::Vector3f(0.f, 0.f, -40.f);
+	Eigen::Vector3f cameraTarget = Eigen::Vector3f::Zero();
+	/// Vertical field of view in degrees.
+	float fieldOfView = 60.f;
+	/// The first axis runs along the rows of the contact sheet, the others down its columns.
+	std::vector<SweepAxis> axes;
+
+	uint32_t GetCellCount() const;
+};
+
+/// Render of one combination of the axis values.
+struct SweepCell
+{
+	/// Value of every axis.
+	std::vector<float> values;
+	/// Hash of everything the image depends on, names the cached image.
+	uint64_t key = 0;
+	bool cached = false;
+	/// Cost of the render, carried over from the original render for cached cells.
+	double renderMs = 0.0;
+	uint64_t evaluations = 0;
+	/// RGBA8 image in row-major order.
+	std::vector<uint8_t> pixels;
+};
+
+struct SweepReport
+{
+	std::vector<SweepCell> cells;
+	uint32_t rendered = 0;
+	uint32_t cached = 0;
+	double totalMs = 0.0;
+};
+
+bool LoadSweepSpec(const std::string& path, SweepSpec& spec, std::string& error);
+
+/// Sets the parameter of a sweep axis in the settings.
+bool ApplySweepParameter(const std::string& parameter, float value, CpuRenderSettings& settings, std::string& error);
+
+/// Renders every cell of the sweep which is not in the cache directory yet, one cell per task
+/// on the thread pool, and stores the new images in the cache.
+bool RunSweep(const SweepSpec& spec, const std::string& cacheDirectory, ThreadPool& threadPool, SweepReport& report,
+	std::string& error);
+
+/// Writes all cells of the sweep into one binary PPM image, with a gap between the cells.
+bool WriteContactSheet(const SweepSpec& spec, const SweepReport& report, const std::string& path, std::string& error);
+/// Writes a row per cell with the axis values, whether it came from the cache and its cost.
+bool WriteSweepCsv(const SweepSpec& spec, const SweepReport& report, const std::string& path, std::string& error);
+
+/// Headless sweep: RayMarcher --sweep <spec.yaml> [output directory]
+/// Writes contact-sheet.ppm and sweep.csv to the output directory and prints the throughput.
+/// @returns Process exit code - 0 on success, 1 otherwise.
+int RunSweepCommand(const std::string& specPath, const std::string& outputDirectory);
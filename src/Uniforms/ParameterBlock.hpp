@@ -0,0 +1,70 @@
+#pragma once
+#include "UniformRing.hpp"
+
+#include <cstdint>
+
+/// Uniform block of plain data whose current value is kept on the CPU, so that setting it can
+/// be skipped when no byte changed. The value is staged in the ring on construction.
+/// T must not contain implicit padding, the bytes are compared.
+template <class T, class Ring = UniformRing>
+class ParameterBlock
+{
+public:
+	/// Changed bytes [begin, end) of the block, empty if nothing changed.
+	struct ByteRange
+	{
+		uint32_t begin;
+		uint32_t end;
+
+		bool IsEmpty() const { return begin >= end; }
+	};
+
+	ParameterBlock(Ring& ring, const char* node, const char* uniform, const T& value = T());
+
+	/// Stages the value if it differs from the current one.
+	ByteRange Set(const T& value);
+	const T& Get() const;
+
+private:
+	Ring& ring;
+	typename Ring::Handle handle;
+	T value;
+};
+
+template <class T, class Ring>
+ParameterBlock<T, Ring>::ParameterBlock(Ring& ring, const char* node, const char* uniform, const T& value)
+	: ring(ring), handle(ring.template Register<T>(node, uniform)), value(value)
+{
+	ring.Write(handle, value);
+}
+
+template <class T, class Ring>
+typename ParameterBlock<T, Ring>::ByteRange ParameterBlock<T, Ring>::Set(const T& next)
+{
+	const uint8_t* current = reinterpret_cast<const uint8_t*>(&value);
+	const uint8_t* changed = reinterpret_cast<const uint8_t*>(&next);
+	ByteRange range{ 0, uint32_t(sizeof(T)) };
+	while (range.begin < range.end && current[range.begin] == changed[range.begin])
+	{
+		++range.begin;
+	}
+	while (range.end > range.begin && current[range.end - 1] == changed[range.end - 1])
+	{
+		--range.end;
+	}
+	if (range.IsEmpty())
+	{
+		return range;
+	}
+
+	// The pipeline takes whole uniforms, the range only decides whether one is sent at all.
+	value = next;
+	ring.Write(handle, value);
+	return range;
+}
+
+template <class T, class Ring>
+const T& ParameterBlock<T, Ring>::Get() const
+{
+	return value;
+}
@@ -0,0 +1,249 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace HawkEye
+{
+	class Pipeline;
+}
+
+/// Per-frame staging of pipeline uniforms. Node and uniform names are resolved to handles once,
+/// a frame's writes go into its slot of a ring with FRAMES_IN_FLIGHT slots and Flush() uploads
+/// everything written since the last flush in one pass. A slot is only written again after
+/// FRAMES_IN_FLIGHT - 1 further flushes, so an upload may read it while the next frame is staged.
+/// HawkEye only takes uniforms by name, so every upload still ends in a SetUniform() that looks
+/// up the node and the uniform - the ring saves the lookups and string copies on this side and
+/// the uploads of uniforms that were not written.
+///
+/// The pipeline is a parameter so that the ring builds without HawkEye - the headless tests
+/// flush into a stand-in with the same Configured() and SetUniform().
+template <class Pipeline>
+class BasicUniformRing
+{
+public:
+	using Handle = uint32_t;
+	static constexpr Handle INVALID_HANDLE = ~Handle(0);
+	static constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+	/// Offset alignment of every uniform within a slot, the common minimum of uniform buffers.
+	static constexpr uint32_t ALIGNMENT = 256;
+
+	/// Reserves space for a uniform of the type, registering a name twice returns the same handle.
+	template <class T>
+	Handle Register(const char* node, const char* uniform);
+	/// @returns Handle of a registered uniform or INVALID_HANDLE.
+	Handle Find(const char* node, const char* uniform) const;
+
+	/// Names of a registered uniform, as the pipeline takes them.
+	const std::string& GetNode(Handle handle) const;
+	const std::string& GetUniform(Handle handle) const;
+
+	/// Stages the value for the next flush, T has to be the registered type.
+	template <class T>
+	void Write(Handle handle, const T& value);
+
+	/// Makes the next flush upload every uniform written so far, for a newly configured pipeline.
+	void Invalidate();
+	/// Uploads the uniforms staged since the last flush and moves on to the next slot. Nothing
+	/// is uploaded while the pipeline is not configured, the values stay staged until it is.
+	/// @returns Number of uniforms uploaded.
+	uint32_t Flush(Pipeline& pipeline);
+	/// Flush() into something other than a pipeline, such as the headless replay of the main loop.
+	/// Calls upload(handle, data) for every uniform staged since the last flush.
+	template <class Sink>
+	uint32_t FlushTo(const Sink& upload);
+
+	uint64_t GetFrameIndex() const;
+
+private:
+	using Upload = void (*)(Pipeline& pipeline, const std::string& node, const std::string& uniform, const uint8_t* data);
+
+	struct Binding
+	{
+		std::string node;
+		std::string uniform;
+		uint32_t offset;
+		uint32_t size;
+		Upload upload;
+		// Frame whose slot holds the latest value, UINT64_MAX if never written.
+		uint64_t writtenFrame;
+		bool staged;
+	};
+
+	template <class T>
+	static void UploadAs(Pipeline& pipeline, const std::string& node, const std::string& uniform, const uint8_t* data);
+	static std::string HandleKey(const char* node, const char* uniform);
+
+	Handle Register(const char* node, const char* uniform, uint32_t size, Upload upload);
+	uint8_t* GetSlot(uint64_t frame);
+	void Stage(Handle handle, const void* value, uint32_t size);
+
+	std::vector<Binding> bindings;
+	std::unordered_map<std::string, Handle> handles;
+	// FRAMES_IN_FLIGHT slots of slotSize bytes each.
+	std::vector<uint8_t> storage;
+	uint32_t slotSize = 0;
+	uint64_t frame = 0;
+	// Handles to upload on the next flush, each once.
+	std::vector<Handle> staged;
+};
+
+/// Ring of the HawkEye pipeline the application renders with.
+using UniformRing = BasicUniformRing<HawkEye::Pipeline>;
+
+template <class Pipeline>
+template <class T>
+typename BasicUniformRing<Pipeline>::Handle BasicUniformRing<Pipeline>::Register(const char* node, const char* uniform)
+{
+	return Register(node, uniform, uint32_t(sizeof(T)), &UploadAs<T>);
+}
+
+template <class Pipeline>
+typename BasicUniformRing<Pipeline>::Handle BasicUniformRing<Pipeline>::Find(const char* node, const char* uniform) const
+{
+	const auto handle = handles.find(HandleKey(node, uniform));
+	return handle == handles.end() ? INVALID_HANDLE : handle->second;
+}
+
+template <class Pipeline>
+const std::string& BasicUniformRing<Pipeline>::GetNode(const Handle handle) const
+{
+	return bindings[handle].node;
+}
+
+template <class Pipeline>
+const std::string& BasicUniformRing<Pipeline>::GetUniform(const Handle handle) const
+{
+	return bindings[handle].uniform;
+}
+
+template <class Pipeline>
+template <class T>
+void BasicUniformRing<Pipeline>::Write(const Handle handle, const T& value)
+{
+	Stage(handle, &value, uint32_t(sizeof(T)));
+}
+
+template <class Pipeline>
+void BasicUniformRing<Pipeline>::Invalidate()
+{
+	for (Handle handle = 0; handle < Handle(bindings.size()); ++handle)
+	{
+		Binding& binding = bindings[handle];
+		if (binding.writtenFrame != UINT64_MAX && !binding.staged)
+		{
+			binding.staged = true;
+			staged.push_back(handle);
+		}
+	}
+}
+
+template <class Pipeline>
+uint32_t BasicUniformRing<Pipeline>::Flush(Pipeline& pipeline)
+{
+	if (!pipeline.Configured())
+	{
+		return 0;
+	}
+
+	return FlushTo([&](const Handle handle, const uint8_t* data)
+	{
+		const Binding& binding = bindings[handle];
+		binding.upload(pipeline, binding.node, binding.uniform, data);
+	});
+}
+
+template <class Pipeline>
+template <class Sink>
+uint32_t BasicUniformRing<Pipeline>::FlushTo(const Sink& upload)
+{
+	// Uniforms written in an earlier frame (only after Invalidate) are uploaded from the slot
+	// holding their latest value.
+	for (const Handle handle : staged)
+	{
+		Binding& binding = bindings[handle];
+		binding.staged = false;
+		upload(handle, GetSlot(binding.writtenFrame) + binding.offset);
+	}
+	const uint32_t uploaded = uint32_t(staged.size());
+	staged.clear();
+	++frame;
+	return uploaded;
+}
+
+template <class Pipeline>
+uint64_t BasicUniformRing<Pipeline>::GetFrameIndex() const
+{
+	return frame;
+}
+
+template <class Pipeline>
+template <class T>
+void BasicUniformRing<Pipeline>::UploadAs(Pipeline& pipeline, const std::string& node, const std::string& uniform, const uint8_t* data)
+{
+	// Slot sizes and offsets are multiples of ALIGNMENT within storage from operator new, so the
+	// staged bytes are aligned for any uniform type and can be read in place.
+	pipeline.SetUniform(node, uniform, *reinterpret_cast<const T*>(data));
+}
+
+template <class Pipeline>
+std::string BasicUniformRing<Pipeline>::HandleKey(const char* node, const char* uniform)
+{
+	return std::string(node) + '\0' + uniform;
+}
+
+template <class Pipeline>
+typename BasicUniformRing<Pipeline>::Handle BasicUniformRing<Pipeline>::Register(const char* node, const char* uniform, const uint32_t size,
+	const Upload upload)
+{
+	const std::string key = HandleKey(node, uniform);
+	const auto known = handles.find(key);
+	if (known != handles.end())
+	{
+		assert(bindings[known->second].size == size);
+		return known->second;
+	}
+
+	const Handle handle = Handle(bindings.size());
+	bindings.push_back(Binding{ node, uniform, slotSize, size, upload, UINT64_MAX, false });
+	handles.emplace(key, handle);
+
+	// Growing the slots moves them, the staged values move along.
+	const uint32_t oldSlotSize = slotSize;
+	slotSize += (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	std::vector<uint8_t> grown(size_t(slotSize) * FRAMES_IN_FLIGHT);
+	for (uint32_t slot = 0; slot < FRAMES_IN_FLIGHT && oldSlotSize > 0; ++slot)
+	{
+		std::memcpy(&grown[size_t(slot) * slotSize], &storage[size_t(slot) * oldSlotSize], oldSlotSize);
+	}
+	storage.swap(grown);
+	return handle;
+}
+
+template <class Pipeline>
+uint8_t* BasicUniformRing<Pipeline>::GetSlot(const uint64_t frame)
+{
+	return &storage[size_t(frame % FRAMES_IN_FLIGHT) * slotSize];
+}
+
+template <class Pipeline>
+void BasicUniformRing<Pipeline>::Stage(const Handle handle, const void* value, const uint32_t size)
+{
+	assert(handle < bindings.size() && bindings[handle].size == size);
+	if (handle >= bindings.size())
+	{
+		return;
+	}
+
+	Binding& binding = bindings[handle];
+	std::memcpy(GetSlot(frame) + binding.offset, value, size);
+	binding.writtenFrame = frame;
+	if (!binding.staged)
+	{
+		binding.staged = true;
+		staged.push_back(handle);
+	}
+}
@@ -0,0 +1,62 @@
+#include "Tests.hpp"
+#include "../src/Camera/Camera.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	// Checks the analytic ray basis against unprojecting with the inverse view-projection matrix
+	// for perspective and orthographic cameras over a range of aspects, fields of view and
+	// orientations.
+	template <class T>
+	bool CheckRayBasis(const char* name, const T tolerance)
+	{
+		using Vector3 = typename CameraT<T>::Vector3;
+		const T aspects[] = { T(.5), T(1), T(16. / 9.), T(3) };
+		const T fovs[] = { T(10), T(45), T(60), T(90), T(120) };
+		const Vector3 positions[] = { Vector3(0, 0, -40), Vector3(15, -8, -5), Vector3(-3, 20, 7) };
+		const Vector3 target(0, 0, 0);
+
+		bool passed = true;
+		for (const bool perspective : { true, false })
+		{
+			T error = 0;
+			int cameras = 0;
+			for (const T aspect : aspects)
+			{
+				for (const T fov : fovs)
+				{
+					for (const Vector3& position : positions)
+					{
+						CameraT<T> camera(position, target, Vector3(0, 1, 0), fov, aspect, T(.01), T(10000), perspective);
+						error = std::max(error, camera.MeasureRayBasisError());
+						// Turned and moved like the interactive camera.
+						camera.RotateLocal(Vector3(1, 0, 0), T(.3));
+						camera.TranslateLocal(Vector3(1, 2, 3));
+						error = std::max(error, camera.MeasureRayBasisError());
+						cameras += 2;
+					}
+				}
+			}
+			std::printf("  %-6s %-12s %3d cameras, largest relative error %.2e\n", name, perspective ? "perspective" : "orthographic",
+				cameras, double(error));
+			passed = passed && error <= tolerance;
+		}
+		return passed;
+	}
+
+	bool RayBasisTest()
+	{
+		const bool floatPassed = CheckRayBasis<float>("float", 1e-5f);
+		const bool doublePassed = CheckRayBasis<double>("double", 1e-9);
+		return floatPassed && doublePassed;
+	}
+}
+
+std::vector<Test> GetCameraTests()
+{
+	return {
+		{ "camera/ray-basis", &RayBasisTest },
+	};
+}
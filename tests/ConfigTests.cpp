@@ -0,0 +1,85 @@
+#include "Tests.hpp"
+#include "../src/Config/ConfigBlob.hpp"
+#include "../src/Config/PipelineConfig.hpp"
+#include "../src/Filesystem/Filesystem.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	// The configs compile into blobs which the next loads reuse, validated every time.
+	bool BlobReuseTest()
+	{
+		const std::string directory = RMFS.GetAbsolutePath("test-config-blobs");
+		bool passed = true;
+		for (const std::string name : { "BackendConfig", "FrontendConfig" })
+		{
+			const std::string path = RMFS.GetAbsolutePath("../../src/" + name + ".yaml");
+			const auto validate = name == "BackendConfig" ? &ValidateBackendConfig : &ValidateFrontendConfig;
+			std::filesystem::remove_all(directory);
+
+			ConfigBlob blob;
+			std::string error;
+			bool cold = true;
+			bool warm = false;
+			const bool ok = LoadCompiledConfig(path, directory, validate, blob, error, &cold) &&
+				LoadCompiledConfig(path, directory, validate, blob, error, &warm);
+			std::printf("  %-15s %s\n", name.c_str(), !ok ? error.c_str() : cold ? "cold load used a blob" : !warm ? "blob not reused" : "reused");
+			passed = passed && ok && !cold && warm;
+		}
+		std::filesystem::remove_all(directory);
+		return passed;
+	}
+
+	// A touched copy keeps its blob once the text is compared, an edited one is compiled again.
+	bool BlobStalenessTest()
+	{
+		const std::string directory = RMFS.GetAbsolutePath("test-config-staleness");
+		std::filesystem::remove_all(directory);
+		const std::string copy = directory + "/source/BackendConfig.yaml";
+		std::filesystem::create_directories(directory + "/source");
+		std::filesystem::copy_file(RMFS.GetAbsolutePath("../../src/BackendConfig.yaml"), copy);
+		const auto now = std::filesystem::file_time_type::clock::now();
+		const struct
+		{
+			const char* name;
+			std::chrono::minutes age;
+			const char* append;
+			bool expectBlob;
+		} steps[] = {
+			{ "compiled", std::chrono::minutes(60), "", false },
+			{ "reused", std::chrono::minutes(60), "", true },
+			{ "touched", std::chrono::minutes(30), "", true },
+			{ "edited", std::chrono::minutes(10), "# edited\n", false },
+			{ "edited reused", std::chrono::minutes(10), "", true },
+		};
+		bool passed = true;
+		for (const auto& step : steps)
+		{
+			if (*step.append)
+			{
+				std::ofstream(copy, std::ios_base::app) << step.append;
+			}
+			std::filesystem::last_write_time(copy, now - step.age);
+			ConfigBlob blob;
+			std::string error;
+			bool fromBlob = false;
+			const bool ok = LoadCompiledConfig(copy, directory, &ValidateBackendConfig, blob, error, &fromBlob) && fromBlob == step.expectBlob;
+			std::printf("  %-13s %s\n", step.name, ok ? "as expected" : error.empty() ? "wrong source" : error.c_str());
+			passed = passed && ok;
+		}
+		std::filesystem::remove_all(directory);
+		return passed;
+	}
+}
+
+std::vector<Test> GetConfigTests()
+{
+	return {
+		{ "config/blob-reuse", &BlobReuseTest },
+		{ "config/blob-staleness", &BlobStalenessTest },
+	};
+}
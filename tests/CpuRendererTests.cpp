@@ -0,0 +1,262 @@
+#include "Tests.hpp"
+#include "../src/CpuRenderer/AmbientOcclusion.hpp"
+#include "../src/CpuRenderer/Arena.hpp"
+#include "../src/CpuRenderer/CpuRenderer.hpp"
+#include "../src/Filesystem/Filesystem.hpp"
+#include "../src/Logger/BinaryLog.hpp"
+#include "../src/Memory/AllocationTracker.hpp"
+#include "../src/Uniforms/ParameterBlock.hpp"
+#include "../src/Uniforms/UniformRing.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	// Takes the uniforms of a flush without a pipeline.
+	struct NullPipeline
+	{
+		bool Configured() const { return true; }
+		template <class T>
+		void SetUniform(const std::string&, const std::string&, const T&) {}
+	};
+
+	// Rendering through the G-buffer passes has to give the image of the single pass of Render().
+	bool GBufferCompositeTest()
+	{
+		const int width = 96;
+		const int height = 64;
+		const struct
+		{
+			const char* name;
+			Scene scene;
+			Eigen::Vector3f position;
+			Eigen::Vector3f target;
+		} views[] = {
+			{ "mandelbulb", Scene::Mandelbulb, Eigen::Vector3f(15.f, -8.f, -5.f), Eigen::Vector3f(0.f, 0.f, -25.f) },
+			{ "recursive-tetrahedron", Scene::RecursiveTetrahedron, Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero() },
+			{ "spheres", Scene::Spheres, Eigen::Vector3f(0.f, 0.f, -8.f), Eigen::Vector3f::Zero() } };
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		bool passed = true;
+		for (const auto& view : views)
+		{
+			Camera camera(view.position, view.target, Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height), .01f, 10000.f);
+			camera.UpdateRayBasis();
+			CpuRenderSettings settings;
+			settings.scene = view.scene;
+			settings.shadows = ShadowMode::Half;
+			renderer.SetSettings(settings);
+
+			std::vector<uint8_t> reference(size_t(width) * height * CpuRenderer::CHANNELS);
+			std::vector<uint8_t> pixels(reference.size());
+			renderer.Render(camera.GetRayBasis(), width, height, reference.data());
+
+			GBuffer gbuffer;
+			ImageBuffer<float> shadows;
+			renderer.RenderGBuffer(camera.GetRayBasis(), { width, height, ImageLayout::Tiled }, gbuffer);
+			renderer.RenderShadows(gbuffer, shadows);
+			renderer.Composite(gbuffer, &shadows, nullptr, pixels.data());
+
+			int differing = 0;
+			for (size_t i = 0; i < pixels.size(); ++i)
+			{
+				differing += pixels[i] != reference[i] ? 1 : 0;
+			}
+			std::printf("  %-22s %dx%d, %d of %zu bytes differ from render\n", view.name, width, height, differing, pixels.size());
+			passed = passed && differing == 0;
+		}
+		return passed;
+	}
+
+	// Images one pixel wide or high have to be rendered like the first column or row of a wider one.
+	bool OnePixelTest()
+	{
+		const int size = 8;
+		const struct
+		{
+			int width;
+			int height;
+		} shapes[] = { { 1, size }, { size, 1 } };
+
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		CpuRenderSettings settings;
+		settings.scene = Scene::Spheres;
+		renderer.SetSettings(settings);
+		Camera camera(Eigen::Vector3f(0.f, 0.f, -8.f), Eigen::Vector3f::Zero(), Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, 1.f, .01f, 10000.f);
+		camera.UpdateRayBasis();
+
+		std::vector<uint8_t> reference(size_t(size) * size * CpuRenderer::CHANNELS);
+		renderer.Render(camera.GetRayBasis(), size, size, reference.data());
+		bool passed = true;
+		for (const auto& shape : shapes)
+		{
+			std::vector<uint8_t> pixels(size_t(shape.width) * shape.height * CpuRenderer::CHANNELS);
+			renderer.Render(camera.GetRayBasis(), shape.width, shape.height, pixels.data());
+
+			int differing = 0;
+			for (int y = 0; y < shape.height; ++y)
+			{
+				for (int x = 0; x < shape.width; ++x)
+				{
+					for (int channel = 0; channel < CpuRenderer::CHANNELS; ++channel)
+					{
+						const size_t i = (size_t(y) * shape.width + x) * CpuRenderer::CHANNELS + channel;
+						const size_t j = (size_t(y) * size + x) * CpuRenderer::CHANNELS + channel;
+						differing += pixels[i] != reference[j] ? 1 : 0;
+					}
+				}
+			}
+			std::printf("  %dx%d, %d of %zu bytes differ from the %dx%d render\n", shape.width, shape.height, differing, pixels.size(),
+				size, size);
+			passed = passed && differing == 0;
+		}
+		return passed;
+	}
+
+	// Once the arenas have grown, the frames of a still camera through Render() and through the
+	// G-buffer passes must not take more memory from the heap.
+	bool ArenaSteadyStateTest()
+	{
+		const int width = 64;
+		const int height = 48;
+		const int warmUpFrames = 2;
+		const int frameCount = 6;
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		AmbientOcclusionPass occlusionPass(threadPool);
+		CpuRenderSettings settings;
+		settings.scene = Scene::RecursiveTetrahedron;
+		settings.shadows = ShadowMode::Half;
+		renderer.SetSettings(settings);
+		Camera camera(Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero(), Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height),
+			.01f, 10000.f);
+		camera.UpdateRayBasis();
+
+		std::vector<uint8_t> pixels(size_t(width) * height * CpuRenderer::CHANNELS);
+		ShadowHistory history;
+		GBuffer gbuffer;
+		ImageBuffer<float> shadows;
+		ImageBuffer<float> occlusion;
+		const auto frame = [&]()
+		{
+			renderer.Render(camera.GetRayBasis(), width, height, pixels.data(), history);
+			renderer.RenderGBuffer(camera.GetRayBasis(), { width, height, ImageLayout::Tiled }, gbuffer);
+			renderer.RenderShadows(gbuffer, shadows);
+			occlusionPass.Run(settings, gbuffer, occlusion);
+			renderer.Composite(gbuffer, &shadows, &occlusion, pixels.data());
+		};
+
+		for (int i = 0; i < warmUpFrames; ++i)
+		{
+			frame();
+		}
+		renderer.ResetStatistics();
+		occlusionPass.ResetArenaStatistics();
+		for (int i = 0; i < frameCount; ++i)
+		{
+			frame();
+		}
+
+		ArenaStatistics statistics = renderer.GetArenaStatistics();
+		statistics += occlusionPass.GetArenaStatistics();
+		std::printf("  %d frames after %d to warm up: %u heap allocations of the arenas\n", frameCount, warmUpFrames,
+			unsigned(statistics.heapAllocations));
+		return statistics.heapAllocations == 0;
+	}
+
+	// Headless replay of the frames of the interactive loop - the camera moving, the scene
+	// parameters changing as after a reload, the uniforms flushed, the CPU renderer drawing in
+	// place of the pipeline and a telemetry record per frame. Once warmed up a frame must not
+	// allocate.
+	bool MainLoopAllocationsTest()
+	{
+		const int width = 64;
+		const int height = 48;
+		const int warmUpFrames = 8;
+		const int frameCount = 60;
+		ThreadPool threadPool;
+		CpuRenderer renderer(threadPool);
+		CpuRenderSettings settings;
+		settings.scene = Scene::RecursiveTetrahedron;
+		settings.shadows = ShadowMode::Half;
+		renderer.SetSettings(settings);
+		NullPipeline pipeline;
+		BasicUniformRing<NullPipeline> ring;
+		const auto cameraHandle = ring.Register<Camera::RayBasis>("rayMarch", "camera");
+		const auto timeHandle = ring.Register<float>("rayMarch", "time");
+		ParameterBlock<SceneParameters, BasicUniformRing<NullPipeline>> parameters(ring, "rayMarch", "sceneParameters");
+		Camera camera(Eigen::Vector3f(0.f, -2.f, -45.f), Eigen::Vector3f::Zero(), Eigen::Vector3f(0.f, 1.f, 0.f), 60.f, width / float(height),
+			.01f, 10000.f);
+		const std::string logPath = RMFS.GetAbsolutePath("test-main-loop.rmbl");
+		std::atomic<uint64_t> site{ 0 };
+
+		std::vector<uint8_t> pixels(size_t(width) * height * CpuRenderer::CHANNELS);
+		ShadowHistory history;
+		AllocationCounts total;
+		int allocatingFrames = 0;
+		{
+			BinaryLog log(logPath);
+			const auto frame = [&](const int index)
+			{
+				// Walks forward and back, then turns.
+				const int phase = index % 40;
+				camera.TranslateLocal(Eigen::Vector3f(0.f, 0.f, phase < 10 ? .1f : phase < 20 ? -.1f : 0.f));
+				camera.RotateLocal(Eigen::Vector3f(1.f, 0.f, 0.f), phase >= 30 ? .002f : 0.f);
+				camera.UpdateRayBasis();
+				ring.Write(cameraHandle, camera.GetRayBasis());
+				ring.Write(timeHandle, index / 60.f);
+
+				if (index % 16 == 0)
+				{
+					settings.parameters.smoothUnionK = 2.5f + std::sin(index * .1f);
+					if (!parameters.Set(settings.parameters).IsEmpty())
+					{
+						renderer.SetSettings(settings);
+					}
+				}
+
+				ring.Flush(pipeline);
+				renderer.Render(camera.GetRayBasis(), width, height, pixels.data(), history);
+				log.Record(log.GetFormatId(site, "Replayed frame %d\n"), index);
+			};
+
+			for (int i = 0; i < warmUpFrames; ++i)
+			{
+				frame(i);
+			}
+			for (int i = 0; i < frameCount; ++i)
+			{
+				const AllocationCounts before = GetAllocationCounts();
+				frame(warmUpFrames + i);
+				const AllocationCounts counts = GetAllocationCounts() - before;
+				total.allocations += counts.allocations;
+				total.bytes += counts.bytes;
+				allocatingFrames += counts.allocations > 0 ? 1 : 0;
+			}
+		}
+		std::remove(logPath.c_str());
+
+		// The Tests project always defines TRACK_ALLOCATIONS, a build without it cannot pass.
+		if (!IsAllocationTrackingEnabled())
+		{
+			std::printf("  allocations not counted, TRACK_ALLOCATIONS is not defined\n");
+			return false;
+		}
+		std::printf("  %d frames after %d to warm up: %llu heap allocations (%llu bytes) in %d frame(s)\n", frameCount, warmUpFrames,
+			(unsigned long long)total.allocations, (unsigned long long)total.bytes, allocatingFrames);
+		return total.allocations == 0;
+	}
+}
+
+std::vector<Test> GetCpuRendererTests()
+{
+	return {
+		{ "cpu-renderer/gbuffer-composite", &GBufferCompositeTest },
+		{ "cpu-renderer/one-pixel", &OnePixelTest },
+		{ "cpu-renderer/arena-steady-state", &ArenaSteadyStateTest },
+		{ "cpu-renderer/main-loop-allocations", &MainLoopAllocationsTest },
+	};
+}
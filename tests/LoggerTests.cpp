@@ -0,0 +1,183 @@
+#include "Tests.hpp"
+#include "../src/Filesystem/Filesystem.hpp"
+#include "../src/Logger/AsyncLogSink.hpp"
+#include "../src/Logger/BinaryLog.hpp"
+#include "../src/Logger/BinaryLogFormat.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace
+{
+	// Texts of the records of a binary log, false if it does not decode cleanly.
+	bool DecodeLog(const std::string& path, std::vector<std::string>& texts)
+	{
+		BinaryLogFormat::Reader reader;
+		BinaryLogFormat::Record record;
+		if (!reader.Open(path))
+		{
+			std::printf("  %s: %s\n", path.c_str(), reader.GetError().c_str());
+			return false;
+		}
+		while (reader.Next(record))
+		{
+			texts.push_back(reader.FormatText(record));
+		}
+		if (!reader.GetError().empty())
+		{
+			std::printf("  %s: %s\n", path.c_str(), reader.GetError().c_str());
+		}
+		return reader.GetError().empty();
+	}
+
+	// Decoding has to reproduce the text printf() gives for every record, with the records handed
+	// to the writer thread in several buffers.
+	bool RoundTripTest()
+	{
+		const uint32_t recordCount = 50000;
+		const char* format = "Tile %u of frame %u: %d steps, %.3f ms, %s\n";
+		const char* const names[] = { "march", "shadows", "" };
+		const std::string path = RMFS.GetAbsolutePath("test-log.rmbl");
+
+		const auto steps = [](uint32_t i) { return int(i * 7919u % 256u) - 128; };
+		const auto tileMs = [](uint32_t i) { return .05 + (i % 97) * .001; };
+		{
+			BinaryLog log(path);
+			const uint32_t formatId = log.RegisterFormat(format);
+			for (uint32_t i = 0; i < recordCount; ++i)
+			{
+				log.Record(formatId, i % 1024, i / 1024, steps(i), tileMs(i), names[i % 3]);
+			}
+		}
+
+		std::vector<std::string> texts;
+		const bool decoded = DecodeLog(path, texts);
+		uint32_t mismatches = 0;
+		char message[128];
+		for (uint32_t i = 0; i < texts.size(); ++i)
+		{
+			std::snprintf(message, sizeof(message), format, i % 1024, i / 1024, steps(i), tileMs(i), names[i % 3]);
+			mismatches += texts[i] != message;
+		}
+		std::printf("  decoded %zu of %u records, %u differ from the text\n", texts.size(), recordCount, mismatches);
+		std::remove(path.c_str());
+		return decoded && texts.size() == recordCount && mismatches == 0;
+	}
+
+	// A call site recording to one log, another one and the first again - as across a restart
+	// of the logger - records with the ids of each log. The second log registered another
+	// format first, so reusing the id of the first log would decode to the wrong text.
+	bool CallSiteTest()
+	{
+		const std::string firstPath = RMFS.GetAbsolutePath("test-log-first.rmbl");
+		const std::string secondPath = RMFS.GetAbsolutePath("test-log-second.rmbl");
+		std::atomic<uint64_t> site{ 0 };
+		const char* siteFormat = "Frame %u\n";
+		{
+			BinaryLog first(firstPath);
+			BinaryLog second(secondPath);
+			second.RegisterFormat("Other %d\n");
+			first.Record(first.GetFormatId(site, siteFormat), 1u);
+			second.Record(second.GetFormatId(site, siteFormat), 2u);
+			first.Record(first.GetFormatId(site, siteFormat), 3u);
+		}
+
+		const std::pair<std::string, std::vector<std::string>> expected[] = {
+			{ firstPath, { "Frame 1\n", "Frame 3\n" } },
+			{ secondPath, { "Frame 2\n" } },
+		};
+		bool passed = true;
+		for (const auto& log : expected)
+		{
+			std::vector<std::string> texts;
+			const bool decoded = DecodeLog(log.first, texts);
+			std::printf("  %zu records, %s\n", texts.size(), texts == log.second ? "as recorded" : "wrong texts");
+			passed = passed && decoded && texts == log.second;
+			std::remove(log.first.c_str());
+		}
+		return passed;
+	}
+
+	// Every output gets the messages of its minimum severity and above, each with the prefix
+	// of its severity.
+	bool SinkSeverityTest()
+	{
+		const struct
+		{
+			Core::LoggerSeverity severity;
+			const char* prefix;
+		} severities[] = {
+			{ Core::LoggerSeverity::Trace, "[Trace] " },
+			{ Core::LoggerSeverity::Debug, "[Debug] " },
+			{ Core::LoggerSeverity::Info, "[Info] " },
+			{ Core::LoggerSeverity::Warn, "[Warn] " },
+			{ Core::LoggerSeverity::Error, "[Error] " },
+			{ Core::LoggerSeverity::Fatal, "[Fatal] " },
+		};
+		std::ostringstream all;
+		std::ostringstream warnings;
+		{
+			AsyncLogSink sink({ { &all, Core::LoggerSeverity::Trace }, { &warnings, Core::LoggerSeverity::Warn } });
+			for (const auto& severity : severities)
+			{
+				sink.Push("message\n", severity.severity);
+			}
+		}
+
+		bool passed = true;
+		for (const auto& severity : severities)
+		{
+			const std::string line = std::string(severity.prefix) + "message\n";
+			const bool inAll = all.str().find(line) != std::string::npos;
+			const bool inWarnings = warnings.str().find(line) != std::string::npos;
+			std::printf("  %-8s Trace output %-3s Warn output %s\n", severity.prefix, inAll ? "yes" : "no", inWarnings ? "yes" : "no");
+			passed = passed && inAll && inWarnings == (int(severity.severity) >= int(Core::LoggerSeverity::Warn));
+		}
+		return passed;
+	}
+
+	// Records the decoder could not read back are dropped, the log around them stays readable.
+	bool MismatchTest()
+	{
+		const std::string path = RMFS.GetAbsolutePath("test-log-mismatch.rmbl");
+		uint32_t unsupported;
+		uint64_t dropped;
+		{
+			BinaryLog log(path);
+			const uint32_t formatId = log.RegisterFormat("Tile %u: %.1f ms\n");
+			unsupported = log.RegisterFormat("Tile at %p\n");
+			log.Record(formatId, 1u, 2.0);
+			// Too few and too many arguments, an integer for %f, a string for %u.
+			log.Record(formatId, 3u);
+			log.Record(formatId, 4u, 5.0, 6);
+			log.Record(formatId, 7u, 8);
+			log.Record(formatId, "9", 10.0);
+			// Ids of no format.
+			log.Record(unsupported, 11u);
+			log.Record(formatId + 1, 11u, 12.0);
+			log.Record(formatId, 13u, 14.f);
+			dropped = log.GetDroppedCount();
+		}
+
+		std::vector<std::string> texts;
+		const bool decoded = DecodeLog(path, texts);
+		const std::vector<std::string> expected = { "Tile 1: 2.0 ms\n", "Tile 13: 14.0 ms\n" };
+		std::printf("  %zu records kept, %llu dropped, unsupported format %s\n", texts.size(), (unsigned long long)dropped,
+			unsupported == BinaryLog::INVALID_FORMAT ? "rejected" : "registered");
+		std::remove(path.c_str());
+		return decoded && texts == expected && dropped == 6 && unsupported == BinaryLog::INVALID_FORMAT;
+	}
+}
+
+std::vector<Test> GetLoggerTests()
+{
+	return {
+		{ "logger/sink-severities", &SinkSeverityTest },
+		{ "logger/binary-round-trip", &RoundTripTest },
+		{ "logger/binary-call-sites", &CallSiteTest },
+		{ "logger/binary-mismatch", &MismatchTest },
+	};
+}
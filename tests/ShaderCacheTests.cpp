@@ -0,0 +1,110 @@
+#include "Tests.hpp"
+#include "../src/Filesystem/Filesystem.hpp"
+#include "../src/ShaderCache/ShaderPreprocessor.hpp"
+#include "../src/ShaderCache/ShaderVariantCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <string>
+
+namespace
+{
+	const char* const sceneShaders[] = { "mandelbulb", "recursive-tetrahedron", "sphere", "spheres" };
+
+	// Number of times the text occurs in the source.
+	int CountOccurrences(const std::string& source, const std::string& text)
+	{
+		int count = 0;
+		for (size_t i = source.find(text); i != std::string::npos; i = source.find(text, i + text.size()))
+		{
+			++count;
+		}
+		return count;
+	}
+
+	// Expands the includes of every scene shader, the result has to be self-contained: no include
+	// left and every shared kernel defined exactly once.
+	bool PreprocessTest()
+	{
+		const char* const kernels[] = { "vec3 pixelRay()", "vec3 pixelOrigin()", "void outputColor(vec3 color)",
+			"float smoothUnion(", "March march(", "vec3 surfaceNormal(" };
+		// Only the fractal scenes include the shading stages.
+		const char* const shadingKernels[] = { "float shadow(", "float ambientOcclusion(", "void outputGBuffer(", "int tileSamples(" };
+		const char* const shadedShaders[] = { "mandelbulb", "recursive-tetrahedron" };
+
+		const ShaderPreprocessor preprocessor;
+		bool passed = true;
+		for (const char* shader : sceneShaders)
+		{
+			ShaderPreprocessor::Result result;
+			std::string error;
+			const std::string path = RMFS.GetAbsolutePath(std::string("../../src/Shaders/") + shader + ".comp.glsl");
+			if (!preprocessor.Expand(path, result, error))
+			{
+				std::printf("  %-22s failed: %s\n", shader, error.c_str());
+				passed = false;
+				continue;
+			}
+
+			std::string problems;
+			if (CountOccurrences(result.source, "#include") != 0)
+			{
+				problems += " unexpanded include,";
+			}
+			const bool shaded = std::any_of(std::begin(shadedShaders), std::end(shadedShaders),
+				[&](const char* name) { return std::strcmp(name, shader) == 0; });
+			std::vector<const char*> expected(std::begin(kernels), std::end(kernels));
+			expected.insert(expected.end(), std::begin(shadingKernels), shaded ? std::end(shadingKernels) : std::begin(shadingKernels));
+			for (const char* kernel : expected)
+			{
+				if (CountOccurrences(result.source, kernel) != 1)
+				{
+					problems += std::string(" ") + kernel + " defined " + std::to_string(CountOccurrences(result.source, kernel)) + "x,";
+				}
+			}
+			std::printf("  %-22s %5zu bytes  %zu files%s\n", shader, result.source.size(), result.files.size(),
+				problems.empty() ? "" : problems.c_str());
+			passed = passed && problems.empty();
+		}
+		return passed;
+	}
+
+	// Without a compiler a variant is its source: the first lookup writes it, later ones - one
+	// at a time or in a batch - find it and count as hits, uncompiled either way.
+	bool NoCompilerTest()
+	{
+		const std::string directory = RMFS.GetAbsolutePath("test-shader-cache");
+		std::filesystem::remove_all(directory);
+		ShaderVariantCache cache(directory, "no-such-shader-compiler");
+		const ShaderConstants constants = { { "MAX_ITERATIONS", "96" } };
+		const std::string path = RMFS.GetAbsolutePath("../../src/Shaders/sphere.comp.glsl");
+
+		ShaderVariantCache::Variant first;
+		ShaderVariantCache::Variant second;
+		std::vector<ShaderVariantCache::Variant> batch;
+		std::string error;
+		const bool ok = cache.GetVariant(path, constants, first) && cache.GetVariant(path, constants, second) &&
+			cache.GetVariants({ { path, constants }, { path, constants } }, nullptr, batch, error);
+		std::filesystem::remove_all(directory);
+		if (!ok)
+		{
+			std::printf("  %s\n", error.empty() ? first.log.c_str() : error.c_str());
+			return false;
+		}
+
+		std::printf("  compiler %s, %u hits, %u misses\n", cache.HasCompiler() ? "found" : "missing", cache.GetHitCount(), cache.GetMissCount());
+		return !cache.HasCompiler() && !first.cacheHit && second.cacheHit && batch[0].cacheHit && batch[1].cacheHit && !first.compiled &&
+			!second.compiled && !batch[0].compiled && cache.GetHitCount() == 3 && cache.GetMissCount() == 1;
+	}
+}
+
+std::vector<Test> GetShaderCacheTests()
+{
+	return {
+		{ "shader-cache/preprocess", &PreprocessTest },
+		{ "shader-cache/no-compiler", &NoCompilerTest },
+	};
+}
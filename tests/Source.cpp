@@ -0,0 +1,73 @@
+#include "Tests.hpp"
+#include "../src/Filesystem/Filesystem.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// Headless checks of the modules which build without a window or a GPU.
+// Usage: Tests [area or test...], runs every test when none is given, e.g. Tests camera config/blob-staleness
+int main(int argc, char** argv)
+{
+	Core::Singleton<RMFilesystem>::GetInstance().Init(argv[0]);
+
+	std::vector<Test> tests;
+	for (std::vector<Test> (*area)() : { &GetCameraTests, &GetCpuRendererTests, &GetConfigTests, &GetShaderCacheTests,
+		&GetLoggerTests, &GetUniformsTests, &GetSweepTests })
+	{
+		const std::vector<Test> areaTests = area();
+		tests.insert(tests.end(), areaTests.begin(), areaTests.end());
+	}
+
+	// A test is selected by its name or by the name of its area.
+	const auto selected = [&](const Test& test)
+	{
+		if (argc < 2)
+		{
+			return true;
+		}
+		for (int i = 1; i < argc; ++i)
+		{
+			const size_t length = std::strlen(argv[i]);
+			if (std::strcmp(test.name, argv[i]) == 0 || (std::strncmp(test.name, argv[i], length) == 0 && test.name[length] == '/'))
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	int run = 0;
+	std::vector<const char*> failed;
+	for (const Test& test : tests)
+	{
+		if (!selected(test))
+		{
+			continue;
+		}
+		std::printf("%s\n", test.name);
+		const bool passed = test.function();
+		std::printf("  %s\n", passed ? "ok" : "FAILED");
+		++run;
+		if (!passed)
+		{
+			failed.push_back(test.name);
+		}
+	}
+
+	if (run == 0)
+	{
+		std::printf("No test matches, available:\n");
+		for (const Test& test : tests)
+		{
+			std::printf("  %s\n", test.name);
+		}
+		return 1;
+	}
+	std::printf("%d of %d tests passed\n", run - int(failed.size()), run);
+	for (const char* name : failed)
+	{
+		std::printf("  FAILED %s\n", name);
+	}
+	return failed.empty() ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include "Tests.hpp"
+#include "../src/Filesystem/Filesystem.hpp"
+#include "../src/Sweep/ParameterSweep.hpp"
+
+#include <cstdio>
+#include <filesystem>
+
+namespace
+{
+	// A cold sweep renders every cell, running it again takes every cell from the cache with the
+	// same image.
+	bool CacheTest()
+	{
+		const std::string directory = RMFS.GetAbsolutePath("test-sweep");
+		SweepSpec spec;
+		std::string error;
+		if (!LoadSweepSpec(RMFS.GetAbsolutePath("../../src/Sweeps/tetrahedron-folds.yaml"), spec, error))
+		{
+			std::printf("  %s\n", error.c_str());
+			return false;
+		}
+		// Only whether the cells are cached matters here.
+		spec.width = 16;
+		spec.height = 12;
+
+		std::filesystem::remove_all(directory);
+		ThreadPool threadPool;
+		SweepReport cold;
+		SweepReport warm;
+		const bool ok = RunSweep(spec, directory, threadPool, cold, error) && RunSweep(spec, directory, threadPool, warm, error);
+		std::filesystem::remove_all(directory);
+		if (!ok)
+		{
+			std::printf("  %s\n", error.c_str());
+			return false;
+		}
+
+		bool samePixels = cold.cells.size() == warm.cells.size();
+		for (size_t i = 0; samePixels && i < cold.cells.size(); ++i)
+		{
+			samePixels = cold.cells[i].pixels == warm.cells[i].pixels;
+		}
+		std::printf("  %u cells, cold: %u rendered %u cached, warm: %u rendered %u cached, images %s\n", spec.GetCellCount(),
+			cold.rendered, cold.cached, warm.rendered, warm.cached, samePixels ? "equal" : "differ");
+		return cold.rendered == spec.GetCellCount() && warm.cached == spec.GetCellCount() && samePixels;
+	}
+}
+
+std::vector<Test> GetSweepTests()
+{
+	return {
+		{ "sweep/cache", &CacheTest },
+	};
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+
+/// Check of the headless test runner, named "<area>/<check>". Prints what it compared and
+/// returns whether everything matched.
+struct Test
+{
+	const char* name;
+	bool (*function)();
+};
+
+/// Checks of each area, run in this order.
+std::vector<Test> GetCameraTests();
+std::vector<Test> GetCpuRendererTests();
+std::vector<Test> GetConfigTests();
+std::vector<Test> GetShaderCacheTests();
+std::vector<Test> GetLoggerTests();
+std::vector<Test> GetUniformsTests();
+std::vector<Test> GetSweepTests();
@@ -0,0 +1,142 @@
+#include "Tests.hpp"
+#include "../src/Uniforms/ParameterBlock.hpp"
+#include "../src/Uniforms/UniformRing.hpp"
+
+#include <Eigen/Dense>
+
+#include <cstdio>
+#include <functional>
+#include <string>
+
+namespace
+{
+	// Stands in for HawkEye::Pipeline, sums up the uniforms it is given.
+	class CountingPipeline
+	{
+	public:
+		bool Configured() const
+		{
+			return configured;
+		}
+
+		template <class T>
+		void SetUniform(const std::string& node, const std::string& uniform, const T& value)
+		{
+			checksum += std::hash<std::string>()(node) ^ std::hash<std::string>()(uniform);
+			checksum += *reinterpret_cast<const uint8_t*>(&value);
+			++uploads;
+		}
+
+		bool configured = true;
+		uint64_t uploads = 0;
+		uint64_t checksum = 0;
+	};
+
+	using Ring = BasicUniformRing<CountingPipeline>;
+
+	// Writing through handles and flushing the ring has to end in the pipeline calls of setting
+	// every uniform by name.
+	bool StagingTest()
+	{
+		const int frameCount = 100;
+		bool passed = true;
+		for (const int uniformCount : { 2, 8, 32 })
+		{
+			std::vector<std::string> names;
+			for (int i = 0; i < uniformCount; ++i)
+			{
+				names.push_back("parameter" + std::to_string(i));
+			}
+			Ring ring;
+			std::vector<Ring::Handle> handles;
+			for (const std::string& name : names)
+			{
+				handles.push_back(ring.Register<Eigen::Vector4f>("rayMarch", name.c_str()));
+			}
+
+			CountingPipeline direct;
+			CountingPipeline staged;
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				const Eigen::Vector4f value(float(frame), 2.f, 3.f, 4.f);
+				for (size_t i = 0; i < names.size(); ++i)
+				{
+					direct.SetUniform("rayMarch", names[i], value);
+					ring.Write(handles[i], value);
+				}
+				ring.Flush(staged);
+			}
+
+			const bool same = direct.uploads == staged.uploads && direct.checksum == staged.checksum;
+			std::printf("  %2d uniforms: %llu uploads by name, %llu from the ring, checksums %s\n", uniformCount,
+				(unsigned long long)direct.uploads, (unsigned long long)staged.uploads, direct.checksum == staged.checksum ? "equal" : "differ");
+			passed = passed && same;
+		}
+		return passed;
+	}
+
+	// Values staged while the pipeline is not configured wait for it, Invalidate() uploads every
+	// written uniform again and unwritten ones are never uploaded.
+	bool FlushTest()
+	{
+		Ring ring;
+		const Ring::Handle camera = ring.Register<Eigen::Vector4f>("rayMarch", "camera");
+		const Ring::Handle time = ring.Register<float>("rayMarch", "time");
+		ring.Register<float>("rayMarch", "unused");
+		CountingPipeline pipeline;
+		pipeline.configured = false;
+
+		ring.Write(camera, Eigen::Vector4f(1.f, 2.f, 3.f, 4.f));
+		ring.Write(time, 1.f);
+		const uint32_t unconfigured = ring.Flush(pipeline);
+		pipeline.configured = true;
+		const uint32_t configured = ring.Flush(pipeline);
+		const uint32_t idle = ring.Flush(pipeline);
+		ring.Write(time, 2.f);
+		const uint32_t changed = ring.Flush(pipeline);
+		ring.Invalidate();
+		const uint32_t invalidated = ring.Flush(pipeline);
+
+		std::printf("  uploads: unconfigured %u, configured %u, idle %u, changed %u, invalidated %u\n", unconfigured, configured, idle,
+			changed, invalidated);
+		return unconfigured == 0 && configured == 2 && idle == 0 && changed == 1 && invalidated == 2 &&
+			ring.Find("rayMarch", "time") == time && ring.Find("rayMarch", "missing") == Ring::INVALID_HANDLE;
+	}
+
+	struct Parameters
+	{
+		float smoothUnionK = 2.5f;
+		float fold = 1.f;
+		float offset[2] = { 0.f, 0.f };
+	};
+
+	// A parameter block uploads only when a byte changed, and reports which ones.
+	bool ParameterBlockTest()
+	{
+		Ring ring;
+		ParameterBlock<Parameters, Ring> block(ring, "rayMarch", "sceneParameters");
+		CountingPipeline pipeline;
+		const uint32_t initial = ring.Flush(pipeline);
+
+		Parameters parameters;
+		const bool unchanged = block.Set(parameters).IsEmpty();
+		const uint32_t afterUnchanged = ring.Flush(pipeline);
+		parameters.fold = 2.f;
+		const auto range = block.Set(parameters);
+		const uint32_t afterChanged = ring.Flush(pipeline);
+
+		std::printf("  uploads: initial %u, unchanged %u, changed %u of bytes [%u, %u)\n", initial, afterUnchanged, afterChanged,
+			range.begin, range.end);
+		return initial == 1 && unchanged && afterUnchanged == 0 && afterChanged == 1 && range.begin >= sizeof(float) &&
+			range.end <= 2 * sizeof(float) && block.Get().fold == 2.f;
+	}
+}
+
+std::vector<Test> GetUniformsTests()
+{
+	return {
+		{ "uniforms/staging", &StagingTest },
+		{ "uniforms/flush", &FlushTest },
+		{ "uniforms/parameter-block", &ParameterBlockTest },
+	};
+}
@@ -0,0 +1,78 @@
+#include "../../src/Logger/BinaryLogFormat.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Turns a binary telemetry log (see src/Logger/BinaryLog.hpp) back into text or CSV.
+// Usage: LogDecoder <log.rmbl> [--csv] [--output <file>]
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s <log.rmbl> [--csv] [--output <file>]\n", argv[0]);
+		return 1;
+	}
+
+	bool csv = false;
+	std::ofstream file;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--csv") == 0)
+		{
+			csv = true;
+		}
+		else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+		{
+			file.open(argv[++i], std::ios_base::trunc);
+			if (!file)
+			{
+				std::fprintf(stderr, "Cannot open %s for writing.\n", argv[i]);
+				return 1;
+			}
+		}
+		else
+		{
+			std::fprintf(stderr, "Unknown argument '%s'.\n", argv[i]);
+			return 1;
+		}
+	}
+	std::ostream& output = file.is_open() ? file : std::cout;
+
+	BinaryLogFormat::Reader reader;
+	if (!reader.Open(argv[1]))
+	{
+		std::fprintf(stderr, "%s\n", reader.GetError().c_str());
+		return 1;
+	}
+
+	if (csv)
+	{
+		output << BinaryLogFormat::Reader::CsvHeader() << '\n';
+	}
+
+	BinaryLogFormat::Record record;
+	while (reader.Next(record))
+	{
+		if (csv)
+		{
+			output << reader.FormatCsv(record) << '\n';
+		}
+		else
+		{
+			char prefix[48];
+			const uint64_t microseconds = record.timestamp / 1000;
+			std::snprintf(prefix, sizeof(prefix), "[%6llu.%06llu] [T%u] ", (unsigned long long)(microseconds / 1000000),
+				(unsigned long long)(microseconds % 1000000), record.threadIndex);
+			output << prefix << reader.FormatText(record);
+		}
+	}
+
+	if (!reader.GetError().empty())
+	{
+		std::fprintf(stderr, "Stopped decoding: %s\n", reader.GetError().c_str());
+		return 1;
+	}
+	return 0;
+}